@@ -1,9 +1,16 @@
 #include "G4MTRunManager.hh"
+#include "G4Run.hh"
 #include "G4UIExecutive.hh"
 #include "G4VisExecutive.hh"
 #include "Geometry.hh"
 #include "OpticalSimulationActionInitialization.hh"
+#include "OpticalSimulationCache.hh"
+#include "OpticalSimulationOptimizer.hh"
+#include "OpticalSimulationOutput.hh"
 #include "OpticalSimulationPhysics.hh"
+#include "OpticalSimulationScanDriver.hh"
+#include "OpticalSimulationServer.hh"
+#include "OpticalSimulationTopUp.hh"
 #include <thread>
 #include "G4UImanager.hh"
 #include "G4PhysicalVolumeStore.hh"
@@ -62,6 +69,24 @@ int main(int argc, char **argv) {
 
     G4UImanager *UI = G4UImanager::GetUIpointer();
 
+    // Scans (/OpticalSimulation/scan/) are driven from the master thread
+    OpticalSimulationScanDriver *scanDriver =
+        new OpticalSimulationScanDriver(outputFile, Ncores, flag_MT);
+    // Design optimization (/OpticalSimulation/optimizer/) as well
+    OpticalSimulationOptimizer *optimizer =
+        new OpticalSimulationOptimizer(outputFile, Ncores, flag_MT);
+    // Batch results of identical configurations are reused
+    // (/OpticalSimulation/cache/)
+    OpticalSimulationCache *cache = new OpticalSimulationCache(outputFile);
+    // Existing outputs can be extended with more events
+    // (/OpticalSimulation/topup/)
+    OpticalSimulationTopUp *topUp = new OpticalSimulationTopUp(
+        outputFile, Ncores, flag_MT, TotalNParticles);
+    // Jobs can be submitted to the initialized executable over a local
+    // socket (/OpticalSimulation/server/)
+    OpticalSimulationServer *server =
+        new OpticalSimulationServer(Ncores, flag_MT);
+
     // Visualization mode
     if (argc == 2) {
         G4UIExecutive *ui = new G4UIExecutive(argc, argv);
@@ -75,29 +100,32 @@ int main(int argc, char **argv) {
         G4String macro = argv[3];
         UI->ApplyCommand(command + macro);
 
-        std::string runCommand = "/run/beamOn " + std::string(argv[2]);
-        UI->ApplyCommand(runCommand);
-
-        // Merge ROOT files if MT
-        if (flag_MT) {
-            std::string mergeCommand = "/control/shell hadd -k -f " +
-                                       std::string(outputFile) + ".root";
-            for (size_t i = 1; i <= Ncores; ++i)
-                mergeCommand += " " + std::string(outputFile) + "_" + std::to_string(i) + ".root";
-            UI->ApplyCommand(mergeCommand);
+        // A scan, an optimization, a top-up or the server run from the macro
+        // handles its own runs and outputs
+        if (!scanDriver->HasRun() && !optimizer->HasRun() &&
+            !topUp->HasRun() && !server->HasRun() &&
+            !cache->Retrieve(TotalNParticles)) {
+            std::string runCommand = "/run/beamOn " + std::string(argv[2]);
+            UI->ApplyCommand(runCommand);
 
-            for (size_t i = 0; i <= Ncores; ++i) {
-                std::string removeCommand = "/control/shell rm -f " +
-                                            std::string(outputFile) + "_" + std::to_string(i) + ".root";
-                UI->ApplyCommand(removeCommand);
-            }
+            // Merge ROOT files if MT
+            if (flag_MT)
+                OpticalSimulationOutput::MergeThreadFiles(outputFile, Ncores);
+            // Events actually processed (precision monitor, aborts)
+            const G4Run *run = runManager->GetCurrentRun();
+            cache->Store(run ? run->GetNumberOfEvent() : 0);
         }
     }
 
-    std::string movefile = "/control/shell mv " + std::string(outputFile) + ".root ../Resultats";
-    UI->ApplyCommand(movefile);
-    G4cout << "Output saved in Resultats folder to file " << outputFile << ".root" << G4endl;
+    if (!scanDriver->HasRun() && !optimizer->HasRun() && !topUp->HasRun() &&
+        !server->HasRun())
+        OpticalSimulationOutput::MoveToResults(outputFile);
 
+    delete server;
+    delete topUp;
+    delete cache;
+    delete optimizer;
+    delete scanDriver;
     delete visManager;
     delete runManager;
 
@@ -0,0 +1,363 @@
+/**
+ * @file OpticalSimulationAnalysis.cc
+ * @brief Multithreaded standard analysis of OpticalSimulation outputs.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Usage:
+ *   ./OpticalSimulationAnalysis [input ROOT file(s)] [output ROOT file]
+ *                               [threads] [photon threshold] [tail start]
+ *                               [alpha efficiency]
+ *
+ * The input may be a glob pattern ("../Resultats/run_*.root"). Threads = 0
+ * (default) uses all the cores; the photon threshold (default 1) defines a
+ * detected event and the tail start (default 50 ns) the PSD tail window, as
+ * for /OpticalSimulation/classifier/. The alpha efficiency (default 0.9) is
+ * the working point of the beta misidentification.
+ *
+ * Each tree is read in two passes with implicit multithreading over its
+ * clusters: the scalar columns giving the ranges of the 2D histograms, then
+ * every product booked on the same RDataFrame:
+ *  - detection efficiency (binomial error) and photon fate fractions;
+ *  - deposit (ZnS, scintillator, total) and photon (generated, detected,
+ *    detected wavelength) spectra;
+ *  - alpha/beta separation variables: ZnS deposit fraction and PSD tail
+ *    fraction of the detected events, versus the detected photons;
+ *  - per separation variable, its distributions for alpha and beta sources
+ *    and their figure of merit |<a> - <b>| / (FWHM_a + FWHM_b) (Gaussian
+ *    FWHM from the RMS) with the beta misidentification at the alpha
+ *    efficiency. The source of an Optical row is the `pdg` of the Input
+ *    row of the same key (segment, run, event, subevent), loaded in a
+ *    first pass; outputs without the `pdg` branch skip this part;
+ *  - arrival-time distributions (all detected photons, first photon);
+ *  - incident energy and position spectra of the Input tree.
+ */
+
+#include "ROOT/RDataFrame.hxx"
+#include "TFile.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TROOT.h"
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+using RVecF = ROOT::VecOps::RVec<float>;
+
+//! Optical-tree counters of the photon fates (absorbed ... detected)
+static const char *fates[] = {"absorbed",    "bulk_abs_ZnS", "bulk_abs_Sc",
+                              "escaped",     "failed",       "killed",
+                              "detected"};
+
+//! Separation variables of the detected events
+static const char *variables[] = {"zns_fraction", "tail_fraction"};
+
+/**
+ * @brief Figure of merit and beta misidentification of one variable.
+ *
+ * The alpha side is the one of the larger mean; the cut keeps at least the
+ * requested fraction of the alphas, bin by bin from that side.
+ */
+static void Separation(const TH1D &alpha, const TH1D &beta,
+                       double alphaEfficiency, double &fom, double &misid) {
+    const double fwhm = 2. * std::sqrt(2. * std::log(2.));
+    const double width = fwhm * (alpha.GetRMS() + beta.GetRMS());
+    fom = width > 0. ? std::abs(alpha.GetMean() - beta.GetMean()) / width
+                     : 0.;
+
+    const int nBins = alpha.GetNbinsX() + 1;
+    const bool alphaHigh = alpha.GetMean() >= beta.GetMean();
+    const double nAlpha = alpha.Integral(0, nBins);
+    const double nBeta = beta.Integral(0, nBins);
+    double kept = 0., misidentified = 0.;
+    for (int i = 0; i <= nBins && kept < alphaEfficiency * nAlpha; ++i) {
+        int bin = alphaHigh ? nBins - i : i;
+        kept += alpha.GetBinContent(bin);
+        misidentified += beta.GetBinContent(bin);
+    }
+    misid = nBeta > 0. ? misidentified / nBeta : 0.;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: ./OpticalSimulationAnalysis [input ROOT file(s)] "
+                     "[output ROOT file] [threads] [photon threshold] "
+                     "[tail start ns] [alpha efficiency]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string input = argv[1];
+    std::string outputName = argc > 2 ? argv[2] : "analysis.root";
+    unsigned threads = argc > 3 ? std::stoul(argv[3]) : 0;
+    int threshold = argc > 4 ? std::stoi(argv[4]) : 1;
+    float tailStart = argc > 5 ? std::stof(argv[5]) : 50.f;
+    double alphaEfficiency = argc > 6 ? std::stod(argv[6]) : 0.9;
+
+    ROOT::EnableImplicitMT(threads);
+    auto start = std::chrono::steady_clock::now();
+
+    ROOT::RDataFrame optical("Optical", input); // one entry per event
+    ROOT::RDataFrame primaries("Input", input); // filled when energy > 0
+
+    // Key of the Optical and Input rows, as in the index of the outputs
+    using Key = std::pair<Long64_t, Long64_t>;
+    auto key = [](int segment, int run, int event, int subevent) {
+        return Key(Long64_t(segment) * 65536 + run,
+                   Long64_t(event) * 1024 + subevent);
+    };
+    const std::vector<std::string> keyColumns = {"segment", "run", "event",
+                                                 "subevent"};
+
+    // First pass on scalar columns only: ranges of the 2D histograms and
+    // sources of the primaries (one column, the rows stay aligned in MT)
+    auto maxDetected = optical.Max<int>("detected");
+    auto xMin = primaries.Min<float>("x"), xMax = primaries.Max<float>("x");
+    auto yMin = primaries.Min<float>("y"), yMax = primaries.Max<float>("y");
+    const bool hasSource = primaries.HasColumn("pdg");
+    using SourceRow = std::pair<Key, int>;
+    ROOT::RDF::RResultPtr<std::vector<SourceRow>> sourceRows;
+    if (hasSource)
+        sourceRows =
+            primaries
+                .Define("source_row",
+                        [key](int segment, int run, int event, int subevent,
+                              int pdg) {
+                            return SourceRow(
+                                key(segment, run, event, subevent), pdg);
+                        },
+                        {"segment", "run", "event", "subevent", "pdg"})
+                .Take<SourceRow>("source_row");
+    ROOT::RDF::RunGraphs({maxDetected, xMin});
+    const double photonMax = *maxDetected + 1.;
+
+    // Source type of every primary: 0 alpha, 1 beta (e-/e+), -1 other
+    std::map<Key, int> sources;
+    if (hasSource) {
+        for (const auto &row : *sourceRows)
+            sources[row.first] = row.second == 1000020040 ? 0
+                                 : std::abs(row.second) == 11 ? 1
+                                                              : -1;
+    } else {
+        std::cout << "No pdg branch in the Input tree: alpha/beta figures "
+                     "of merit skipped"
+                  << std::endl;
+    }
+
+    auto events =
+        optical
+            .Define("generated",
+                    "double(scintillation_ZnS + cerenkov_ZnS + "
+                    "scintillation_Sc + cerenkov_Sc)")
+            .Define("deposit_total", "deposit_ZnS + deposit_Sc")
+            .Define("is_detected",
+                    [threshold](int n) { return n >= threshold; },
+                    {"detected"});
+
+    auto nEvents = events.Count();
+    auto nDetected = events.Filter("is_detected").Count();
+    auto generatedSum = events.Sum<double>("generated");
+    // Photon counts summed in double: no overflow on large files
+    std::vector<ROOT::RDF::RResultPtr<double>> fateSums;
+    for (const char *fate : fates)
+        fateSums.push_back(
+            events.Define(std::string("fate_") + fate,
+                          [](int count) { return double(count); }, {fate})
+                .Sum<double>(std::string("fate_") + fate));
+
+    std::vector<ROOT::RDF::RResultPtr<TH1D>> histograms;
+    std::vector<ROOT::RDF::RResultPtr<TH2D>> maps;
+
+    // Spectra (automatic ranges, merged over the threads)
+    histograms.push_back(events.Histo1D(
+        {"deposit_ZnS", "Deposit in ZnS:Ag;E [keV];Events", 500, 0., 0.},
+        "deposit_ZnS"));
+    histograms.push_back(events.Histo1D(
+        {"deposit_Sc", "Deposit in EJ-212;E [keV];Events", 500, 0., 0.},
+        "deposit_Sc"));
+    histograms.push_back(events.Histo1D(
+        {"deposit_total", "Total deposit;E [keV];Events", 500, 0., 0.},
+        "deposit_total"));
+    histograms.push_back(events.Histo1D(
+        {"generated", "Generated photons;Photons;Events", 500, 0., 0.},
+        "generated"));
+    histograms.push_back(events.Histo1D(
+        {"detected", "Detected photons;Photons;Events", 500, 0., 0.},
+        "detected"));
+    histograms.push_back(events.Histo1D(
+        {"wavelength_detected",
+         "Birth wavelength of the detected photons;#lambda [nm];Photons", 400,
+         300., 700.},
+        "birth_wavelength_detected"));
+
+    // Alpha/beta separation of the detected events
+    auto detected =
+        events.Filter("is_detected")
+            .Define("zns_fraction",
+                    "deposit_total > 0 ? deposit_ZnS / deposit_total : 0.f")
+            .Define("tail_fraction",
+                    [tailStart](const RVecF &time) {
+                        if (time.empty())
+                            return -1.f;
+                        auto tail = ROOT::VecOps::Sum(time > tailStart);
+                        return float(tail) / time.size();
+                    },
+                    {"time"})
+            .Define("first_time",
+                    [](const RVecF &time) {
+                        return time.empty() ? -1.f : ROOT::VecOps::Min(time);
+                    },
+                    {"time"});
+    histograms.push_back(detected.Histo1D(
+        {"zns_fraction",
+         "ZnS deposit fraction (detected);E_{ZnS}/E_{total};Events", 100, 0.,
+         1.},
+        "zns_fraction"));
+    histograms.push_back(detected.Histo1D(
+        {"tail_fraction", "PSD tail fraction (detected);Tail fraction;Events",
+         100, 0., 1.},
+        "tail_fraction"));
+    maps.push_back(detected.Histo2D(
+        {"zns_fraction_vs_detected",
+         "ZnS deposit fraction;Detected photons;E_{ZnS}/E_{total}", 200, 0.,
+         photonMax, 100, 0., 1.},
+        "detected", "zns_fraction"));
+    maps.push_back(detected.Histo2D(
+        {"tail_fraction_vs_detected",
+         "PSD tail fraction;Detected photons;Tail fraction", 200, 0.,
+         photonMax, 100, 0., 1.},
+        "detected", "tail_fraction"));
+
+    // Separation variables by source, joined to the Input rows by the key
+    std::vector<ROOT::RDF::RResultPtr<TH1D>> bySource[2];
+    if (hasSource) {
+        auto labelled = detected.Define(
+            "source",
+            [&sources, key](int segment, int run, int event, int subevent) {
+                auto it = sources.find(key(segment, run, event, subevent));
+                return it == sources.end() ? -1 : it->second;
+            },
+            keyColumns);
+        const char *sourceNames[2] = {"alpha", "beta"};
+        for (int t = 0; t < 2; ++t) {
+            auto source = labelled.Filter(
+                [t](int type) { return type == t; }, {"source"});
+            for (const char *variable : variables) {
+                std::string name =
+                    std::string(variable) + "_" + sourceNames[t];
+                bySource[t].push_back(source.Histo1D(
+                    {name.c_str(),
+                     (std::string(variable) + " (" + sourceNames[t] +
+                      " sources, detected);" + variable + ";Events")
+                         .c_str(),
+                     1000, 0., 1.},
+                    variable));
+            }
+        }
+    }
+
+    // Arrival times
+    histograms.push_back(events.Histo1D(
+        {"time", "Arrival time of the detected photons;t [ns];Photons", 1000,
+         0., 0.},
+        "time"));
+    histograms.push_back(detected.Histo1D(
+        {"first_time", "Arrival time of the first photon;t [ns];Events", 1000,
+         0., 0.},
+        "first_time"));
+
+    // Primaries
+    auto inputEnergy = primaries.Histo1D(
+        {"input_energy", "Incident energy;E [MeV];Primaries", 500, 0., 0.},
+        "energy");
+    histograms.push_back(inputEnergy);
+    if (*xMin <= *xMax)
+        maps.push_back(primaries.Histo2D({"input_xy",
+                                          "Primary position;x [mm];y [mm]",
+                                          200, *xMin, *xMax + 1e-3, 200, *yMin,
+                                          *yMax + 1e-3},
+                                         "x", "y"));
+
+    // Second pass: every product of both trees in one loop per tree
+    ROOT::RDF::RunGraphs({nEvents, inputEnergy});
+
+    const double n = *nEvents;
+    if (n <= 0.) {
+        std::cerr << "Error: no event in the Optical tree of " << input
+                  << std::endl;
+        return 1;
+    }
+    const double efficiency = *nDetected / n;
+    std::cout << "Events : " << *nEvents << std::fixed
+              << std::setprecision(4) << "\nDetection efficiency (>= " << threshold
+              << " photons) : " << efficiency << " +/- "
+              << std::sqrt(efficiency * (1. - efficiency) / n) << std::endl;
+
+    const double generated = *generatedSum;
+    std::cout << "Photon fates (fraction of " << generated
+              << " generated):" << std::endl;
+    for (size_t f = 0; f < fateSums.size(); ++f)
+        std::cout << "   " << std::setw(13) << fates[f] << " : "
+                  << (generated > 0. ? *fateSums[f] / generated : 0.)
+                  << std::endl;
+
+    const size_t nVariables = hasSource ? std::size(variables) : 0;
+    TH1D fomHistogram("separation_fom",
+                      "Alpha/beta figure of merit;;|<a> - <b>| / "
+                      "(FWHM_{a} + FWHM_{b})",
+                      nVariables, 0., nVariables);
+    TH1D misidHistogram("separation_beta_misid",
+                        "Beta misidentification at the alpha efficiency;;"
+                        "Fraction of the betas",
+                        nVariables, 0., nVariables);
+    if (nVariables > 0)
+        std::cout << "Alpha/beta separation (" << bySource[0][0]->GetEntries()
+                  << " alpha, " << bySource[1][0]->GetEntries()
+                  << " beta detected):" << std::endl;
+    for (size_t v = 0; v < nVariables; ++v) {
+        double fom = 0., misid = 0.;
+        Separation(*bySource[0][v], *bySource[1][v], alphaEfficiency, fom,
+                   misid);
+        std::cout << "   " << std::setw(13) << variables[v]
+                  << " : FOM " << fom << ", beta misid " << misid
+                  << " at alpha efficiency " << alphaEfficiency << std::endl;
+        fomHistogram.GetXaxis()->SetBinLabel(v + 1, variables[v]);
+        fomHistogram.SetBinContent(v + 1, fom);
+        misidHistogram.GetXaxis()->SetBinLabel(v + 1, variables[v]);
+        misidHistogram.SetBinContent(v + 1, misid);
+    }
+
+    TFile output(outputName.c_str(), "RECREATE");
+    TH1D fateHistogram("fates", "Photon fates;;Fraction of generated",
+                       fateSums.size(), 0., fateSums.size());
+    for (size_t f = 0; f < fateSums.size(); ++f) {
+        fateHistogram.GetXaxis()->SetBinLabel(f + 1, fates[f]);
+        fateHistogram.SetBinContent(
+            f + 1, generated > 0. ? *fateSums[f] / generated : 0.);
+    }
+    fateHistogram.Write();
+    if (nVariables > 0) {
+        fomHistogram.Write();
+        misidHistogram.Write();
+    }
+    for (auto &h : histograms)
+        h->Write();
+    for (auto &source : bySource)
+        for (auto &h : source)
+            h->Write();
+    for (auto &h : maps)
+        h->Write();
+    output.Close();
+
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "Analysed in " << elapsed.count() << " s ("
+              << ROOT::GetThreadPoolSize() << " threads), saved in "
+              << outputName << std::endl;
+    return 0;
+}
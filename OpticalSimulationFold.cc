@@ -0,0 +1,246 @@
+/**
+ * @file OpticalSimulationFold.cc
+ * @brief Folds a source spectrum with a stored detector response matrix.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Usage:
+ *   ./OpticalSimulationFold [response ROOT file] [particle] [spectrum file]
+ *                           [output ROOT file]
+ *
+ * The response file is the output of a run with /OpticalSimulation/response/
+ * enabled. The spectrum file is a text file with one entry per line:
+ *  - `E I`      : tabulated emission density at energy E [keV] (linearly
+ *                 interpolated, integrated over the true energy bins);
+ *  - `line E I` : discrete emission of intensity I at energy E [keV].
+ * Lines starting with '#' are ignored. The spectrum is normalized to one
+ * emitted particle inside the matrix range.
+ *
+ * For every observable the folded distribution per emitted particle is
+ *   y_j = sum_b w_b k_bj / N_b
+ * with w_b the spectrum weight of the true bin b, N_b its thrown events and
+ * k_bj the counts in observable bin j. Rows being independent multinomial
+ * samples, the statistical variance is
+ *   var(y_j) = sum_b w_b^2 p_bj (1 - p_bj) / N_b,  p_bj = k_bj / N_b.
+ */
+
+#include "TFile.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//! Observables written by OpticalSimulationResponseMatrix
+static const char *observables[] = {"ZnS", "Sc", "photons", "class"};
+
+/**
+ * @brief Source spectrum made of a tabulated density and discrete lines.
+ */
+struct Spectrum {
+    std::vector<double> energy;  ///< Tabulated energies [keV]
+    std::vector<double> density; ///< Tabulated density
+    std::vector<double> lineE;   ///< Discrete line energies [keV]
+    std::vector<double> lineI;   ///< Discrete line intensities
+
+    /// Linear interpolation of the density (0 outside the table)
+    double Density(double e) const {
+        if (energy.size() < 2 || e < energy.front() || e > energy.back())
+            return 0.;
+        size_t i = std::upper_bound(energy.begin(), energy.end(), e) -
+                   energy.begin();
+        if (i == energy.size())
+            return density.back();
+        double t = (e - energy[i - 1]) / (energy[i] - energy[i - 1]);
+        return density[i - 1] + t * (density[i] - density[i - 1]);
+    }
+
+    /// Integral of the density over [a, b] (trapezoids on a fine grid)
+    double Integral(double a, double b) const {
+        const int n = 64;
+        double h = (b - a) / n, sum = 0.;
+        for (int i = 0; i <= n; ++i)
+            sum += (i == 0 || i == n ? 0.5 : 1.) * Density(a + i * h);
+        return sum * h;
+    }
+};
+
+static bool ReadSpectrum(const std::string &fileName, Spectrum &spectrum) {
+    std::ifstream in(fileName);
+    if (!in) {
+        std::cerr << "Error: cannot open spectrum file " << fileName
+                  << std::endl;
+        return false;
+    }
+
+    std::vector<std::pair<double, double>> table;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        std::istringstream is(line);
+        std::string first;
+        // Blank (CRLF included) and comment lines
+        if (!(is >> first) || first[0] == '#')
+            continue;
+        double e, i;
+        if (first == "line") {
+            if (is >> e >> i) {
+                spectrum.lineE.push_back(e);
+                spectrum.lineI.push_back(i);
+            }
+            continue;
+        }
+        try {
+            e = std::stod(first);
+        } catch (const std::invalid_argument &) {
+            std::cerr << "Warning: " << fileName << ":" << lineNumber
+                      << ": not a number, line skipped" << std::endl;
+            continue;
+        } catch (const std::out_of_range &) {
+            std::cerr << "Warning: " << fileName << ":" << lineNumber
+                      << ": energy out of range, line skipped" << std::endl;
+            continue;
+        }
+        if (is >> i)
+            table.push_back({e, i});
+    }
+
+    std::sort(table.begin(), table.end());
+    for (const auto &point : table) {
+        spectrum.energy.push_back(point.first);
+        spectrum.density.push_back(point.second);
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        std::cerr << "Usage: ./OpticalSimulationFold [response ROOT file] "
+                     "[particle] [spectrum file] [output ROOT file]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::string particle = argv[2];
+    std::string outputName = argc > 4 ? argv[4] : "folded.root";
+
+    TFile input(argv[1], "READ");
+    if (input.IsZombie())
+        return 1;
+
+    std::string thrownName = "response_thrown_" + particle;
+    TH1D *thrown = dynamic_cast<TH1D *>(input.Get(thrownName.c_str()));
+    if (!thrown) {
+        std::cerr << "Error: no response matrix for " << particle
+                  << " in " << argv[1] << std::endl;
+        return 1;
+    }
+
+    Spectrum spectrum;
+    if (!ReadSpectrum(argv[3], spectrum))
+        return 1;
+
+    auto start = std::chrono::steady_clock::now();
+
+    // Spectrum weights of the true energy bins
+    const int nTrue = thrown->GetNbinsX();
+    const TAxis *axis = thrown->GetXaxis();
+    std::vector<double> weight(nTrue, 0.);
+    for (int b = 0; b < nTrue; ++b)
+        weight[b] = spectrum.Integral(axis->GetBinLowEdge(b + 1),
+                                      axis->GetBinUpEdge(b + 1));
+    double outside = 0.;
+    for (size_t l = 0; l < spectrum.lineE.size(); ++l) {
+        int b = axis->FindFixBin(spectrum.lineE[l]) - 1;
+        if (b >= 0 && b < nTrue)
+            weight[b] += spectrum.lineI[l];
+        else
+            outside += spectrum.lineI[l];
+    }
+
+    double total = 0.;
+    for (double w : weight)
+        total += w;
+    if (total <= 0.) {
+        std::cerr << "Error: spectrum outside the matrix range" << std::endl;
+        return 1;
+    }
+    for (double &w : weight)
+        w /= total;
+    if (outside > 0.)
+        std::cerr << "Warning: " << outside / (total + outside) * 100.
+                  << " % of the line intensity is outside the matrix range"
+                  << std::endl;
+
+    TFile output(outputName.c_str(), "RECREATE");
+    double detection = 0., detectionVar = 0.;
+
+    for (const char *obs : observables) {
+        TH2D *matrix = dynamic_cast<TH2D *>(
+            input.Get(("response_" + particle + "_" + obs).c_str()));
+        if (!matrix)
+            continue;
+
+        const int nObs = matrix->GetNbinsY();
+        std::string name = "folded_" + std::string(obs);
+        TH1D *folded = matrix->ProjectionY(name.c_str());
+        folded->Reset();
+        folded->SetTitle(("Folded " + std::string(obs) + ";" + obs +
+                          ";Probability per emitted particle")
+                             .c_str());
+
+        for (int j = 1; j <= nObs; ++j) {
+            double y = 0., var = 0.;
+            for (int b = 0; b < nTrue; ++b) {
+                double n = thrown->GetBinContent(b + 1);
+                if (n <= 0. || weight[b] == 0.)
+                    continue;
+                double p = matrix->GetBinContent(b + 1, j) / n;
+                y += weight[b] * p;
+                var += weight[b] * weight[b] * p * (1. - p) / n;
+            }
+            folded->SetBinContent(j, y);
+            folded->SetBinError(j, std::sqrt(var));
+        }
+
+        if (std::string(obs) == "class") {
+            // Bin 1 is "undetected": detection = 1 - P(undetected)
+            detection = 1. - folded->GetBinContent(1);
+            detectionVar = std::pow(folded->GetBinError(1), 2);
+            std::cout << "Folded classification (" << particle << "):"
+                      << std::endl;
+            for (int j = 1; j <= nObs; ++j)
+                std::cout << "   " << folded->GetXaxis()->GetBinLabel(j)
+                          << " : " << folded->GetBinContent(j) << " +/- "
+                          << folded->GetBinError(j) << std::endl;
+        }
+        folded->Write();
+    }
+
+    // Weights of the bins without thrown events cannot be folded
+    double uncovered = 0.;
+    for (int b = 0; b < nTrue; ++b)
+        if (thrown->GetBinContent(b + 1) <= 0.)
+            uncovered += weight[b];
+    if (uncovered > 0.)
+        std::cerr << "Warning: " << uncovered * 100.
+                  << " % of the spectrum falls in bins without events"
+                  << std::endl;
+
+    std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "Detection efficiency : " << detection << " +/- "
+              << std::sqrt(detectionVar) << std::endl;
+    std::cout << "Folded in " << elapsed.count() << " ms, saved in "
+              << outputName << std::endl;
+
+    output.Close();
+    return 0;
+}
@@ -0,0 +1,245 @@
+/**
+ * @file OpticalSimulationPy.cc
+ * @brief Python module driving the simulation without ROOT file round-trips.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Usage from Python (module built when pybind11 is found):
+ * @code
+ *   import numpy as np
+ *   import opticalsimulation as osim
+ *   sim = osim.Simulation(threads=8)          # 0: sequential run manager
+ *   sim.apply("/OpticalSimulation/geometry/setZnSThickness 20 um")
+ *   sim.apply("/run/reinitializeGeometry")
+ *   sim.execute("vrml.mac")
+ *   sim.beam_on(10000)
+ *   counts = sim.classification_counts()     # (source, class) int64
+ * @endcode
+ *
+ * The accessors return read-only NumPy views on the run totals of the
+ * accumulators (no copy). The totals are reset in place and beam_on()
+ * raises while a view of the previous run is still referenced, so a view
+ * never outlives its buffer: delete the arrays (or keep copies) before the
+ * next run. Per-photon quantities stay in the ROOT trees
+ * (/OpticalSimulation/run/setWriteTrees false to skip them): as in batch
+ * mode, beam_on() merges the thread files of the run and moves the output
+ * to ../Resultats.
+ */
+
+#include "G4MTRunManager.hh"
+#include "G4RunManager.hh"
+#include "G4UIcommand.hh"
+#include "G4UImanager.hh"
+#include "OpticalSimulationActionInitialization.hh"
+#include "OpticalSimulationClassifier.hh"
+#include "OpticalSimulationGeometryConstruction.hh"
+#include "OpticalSimulationLightCollectionMap.hh"
+#include "OpticalSimulationOutput.hh"
+#include "OpticalSimulationPhysics.hh"
+#include "OpticalSimulationQuasiRandom.hh"
+#include "OpticalSimulationResponseMatrix.hh"
+#include "OpticalSimulationUniformityMap.hh"
+#include <pybind11/numpy.h>
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+
+namespace py = pybind11;
+using Uniformity = OpticalSimulationUniformityMap;
+using LightCollection = OpticalSimulationLightCollectionMap;
+
+namespace {
+//! Views on the run totals still referenced from Python (GIL held)
+G4int liveViews = 0;
+
+//! Read-only array over @p data, counted in liveViews until released
+template <typename T>
+py::array View(const T *data, std::vector<py::ssize_t> shape) {
+    ++liveViews;
+    py::capsule owner(&liveViews, [](void *) { --liveViews; });
+    py::array_t<T> array(shape, data, owner);
+    array.attr("setflags")(py::arg("write") = false);
+    return array;
+}
+
+//! Integer current value of a UI command
+G4int IntValue(const G4String &command) {
+    return G4UIcommand::ConvertToInt(
+        G4UImanager::GetUIpointer()->GetCurrentValues(command));
+}
+} // namespace
+
+/**
+ * @class Simulation
+ * @brief Run manager, geometry, physics and actions set up as in main.
+ *
+ * Geant4 allows one run manager per process: a second instance raises an
+ * error.
+ */
+class Simulation {
+  public:
+    Simulation(const std::string &name, G4int threads) {
+        if (G4RunManager::GetRunManager())
+            throw std::runtime_error("a simulation already exists");
+        flag_MT = threads > 0;
+        fThreads = threads;
+        if (flag_MT) {
+            fRunManager = new G4MTRunManager;
+            fRunManager->SetNumberOfThreads(threads);
+        } else
+            fRunManager = new G4RunManager;
+
+        auto *geometry = new OpticalSimulationGeometryConstruction;
+        fRunManager->SetUserInitialization(geometry);
+        fRunManager->SetUserInitialization(new OpticalSimulationPhysics);
+        fRunManager->SetUserInitialization(
+            new OpticalSimulationActionInitialization(
+                name.c_str(), 0, threads, flag_MT, geometry));
+        fRunManager->Initialize();
+    }
+
+    ~Simulation() { delete fRunManager; }
+
+    /// Apply a UI command (messenger API); returns the G4 status code
+    G4int Apply(const std::string &command) {
+        return G4UImanager::GetUIpointer()->ApplyCommand(command);
+    }
+
+    /// Execute a macro
+    G4int Execute(const std::string &macro) {
+        return Apply("/control/execute " + macro);
+    }
+
+    void BeamOn(G4long events) {
+        // The run resets the totals the views point to
+        if (liveViews > 0)
+            throw std::runtime_error(
+                "arrays of the previous run are still referenced: delete "
+                "them or keep copies before beam_on()");
+        py::gil_scoped_release release;
+        fRunManager->BeamOn(events);
+
+        // Outputs of the run, as main does after its beamOn
+        G4String name = G4UImanager::GetUIpointer()->GetCurrentValues(
+            "/OpticalSimulation/run/setOutputName");
+        if (flag_MT)
+            OpticalSimulationOutput::MergeThreadFiles(name, fThreads);
+        OpticalSimulationOutput::MoveToResults(name);
+    }
+
+    /// Events processed by the last run
+    G4long Events() const {
+        const G4Run *run = fRunManager->GetCurrentRun();
+        return run ? run->GetNumberOfEvent() : 0;
+    }
+
+  private:
+    G4RunManager *fRunManager = nullptr;
+    G4bool flag_MT = false;
+    size_t fThreads = 0;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+PYBIND11_MODULE(opticalsimulation, m) {
+    m.doc() = "ZnS:Ag / EJ-212 optical simulation";
+
+    py::class_<Simulation>(m, "Simulation")
+        .def(py::init<const std::string &, G4int>(),
+             py::arg("name") = "python", py::arg("threads") = 0)
+        .def("apply", &Simulation::Apply, py::arg("command"))
+        .def("execute", &Simulation::Execute, py::arg("macro"))
+        .def("beam_on", &Simulation::BeamOn, py::arg("events"))
+        .def("events", &Simulation::Events)
+
+        // --- Classifier: (source, class) counts and discriminants
+        .def("classification_counts",
+             [](const Simulation &) {
+                 const auto &r = OpticalSimulationClassifier::GetRunTotals();
+                 return View(&r.counts[0][0],
+                             {OpticalSimulationClassifier::kNSourceTypes,
+                              OpticalSimulationClassifier::kNEventClasses});
+             })
+        .def("discriminant",
+             [](const Simulation &) {
+                 const auto &r = OpticalSimulationClassifier::GetRunTotals();
+                 return View(&r.discriminant[0][0],
+                             {OpticalSimulationClassifier::kNSourceTypes,
+                              OpticalSimulationClassifier::kDiscriminantBins});
+             })
+
+        // --- Response matrix: thrown (particle, bin) and counts per
+        // observable (particle, bin, observable bin)
+        .def("response",
+             [](const Simulation &) {
+                 const auto &r =
+                     OpticalSimulationResponseMatrix::GetRunTotals();
+                 py::dict result;
+                 py::ssize_t nBins =
+                     IntValue("/OpticalSimulation/response/setEnergyBins");
+                 if (r.thrown.empty() || nBins <= 0)
+                     return result;
+                 py::ssize_t nParticles = r.thrown.size() / nBins;
+                 result["thrown"] = View(r.thrown.data(), {nParticles, nBins});
+                 for (G4int o = 0;
+                      o < OpticalSimulationResponseMatrix::kNObservables;
+                      ++o) {
+                     py::ssize_t nObs = r.counts[o].size() / r.thrown.size();
+                     result[OpticalSimulationResponseMatrix::ObservableName(
+                         o)] = View(r.counts[o].data(),
+                                    {nParticles, nBins, nObs});
+                 }
+                 return result;
+             })
+
+        // --- Uniformity map: (y, x) counts per tally (folded cells)
+        .def("uniformity",
+             [](const Simulation &) {
+                 const auto &r = Uniformity::GetRunTotals();
+                 static const char *names[] = {"thrown", "detected", "alpha",
+                                               "beta"};
+                 py::dict result;
+                 py::ssize_t nx =
+                     IntValue("/OpticalSimulation/uniformity/setBinsX");
+                 py::ssize_t ny =
+                     IntValue("/OpticalSimulation/uniformity/setBinsY");
+                 for (G4int t = 0; t < Uniformity::kNTallies; ++t)
+                     if (r.counts[t].size() == size_t(nx * ny))
+                         result[names[t]] =
+                             View(r.counts[t].data(), {ny, nx});
+                 return result;
+             })
+
+        // --- RQMC: per-replicate sums
+        .def("qmc",
+             [](const Simulation &) {
+                 const auto &r = OpticalSimulationQuasiRandom::GetRunTotals();
+                 static const char *names[] = {"events", "detected",
+                                               "fired"};
+                 py::dict result;
+                 for (G4int t = 0; t < OpticalSimulationQuasiRandom::kNTallies;
+                      ++t)
+                     result[names[t]] =
+                         View(r.sums[t].data(),
+                              {py::ssize_t(r.sums[t].size())});
+                 return result;
+             })
+
+        // --- Light collection: (volume, z, y, x) tallies and adjoint source
+        .def("lce", [](const Simulation &) {
+            const auto &r = LightCollection::GetRunTotals();
+            static const char *names[] = {"thrown", "detected", "flux",
+                                          "flux2"};
+            py::dict result;
+            py::ssize_t nx = IntValue("/OpticalSimulation/lce/setBinsX");
+            py::ssize_t ny = IntValue("/OpticalSimulation/lce/setBinsY");
+            py::ssize_t nz = IntValue("/OpticalSimulation/lce/setBinsZ");
+            py::ssize_t nv = LightCollection::kNVolumes;
+            for (G4int t = 0; t < LightCollection::kNTallies; ++t)
+                if (r.sums[t].size() == size_t(nv * nz * ny * nx))
+                    result[names[t]] =
+                        View(r.sums[t].data(), {nv, nz, ny, nx});
+            result["source"] =
+                View(r.source, {py::ssize_t(LightCollection::kNSource)});
+            return result;
+        });
+}
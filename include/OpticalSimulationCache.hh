@@ -0,0 +1,79 @@
+#ifndef OpticalSimulationCache_h
+#define OpticalSimulationCache_h 1
+
+/**
+ * @class OpticalSimulationCache
+ * @brief Content-addressed cache of batch simulation results.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * When enabled (off by default), the full configuration is written in a
+ * canonical text form before a batch run:
+ *  - the identity of the code (git commit at configure time and checksum
+ *    of the executable or Python module),
+ *  - the ordered UI commands applied since start-up (source definition,
+ *    physics, geometry...), without the commands that do not change the
+ *    results (visualization, verbosity, output names, ...),
+ *  - the current value of every /OpticalSimulation/ command, so that the
+ *    defaults are part of the configuration,
+ *  - the content of the material and optical input files,
+ *  - the seed policy; an explicit base seed is part of the commands, so
+ *    runs with different seeds never share an entry.
+ * The same text is embedded in every output (see the statistics top-up).
+ *
+ * Its 64-bit hash names an entry of the cache directory holding the merged
+ * output (with the chunk files and their manifest for a chunked output)
+ * and a manifest (number of events processed and configuration text). The
+ * event count is not hashed: a job asking for N events is served by any
+ * entry of the same configuration with at least N events, since runs are
+ * seeded independently. Only the largest run of a
+ * configuration is kept.
+ *
+ * Commands are available under /OpticalSimulation/cache/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+
+class OpticalSimulationCache {
+  public:
+    /**
+     * @brief Constructor.
+     * @param name Base name of the output file
+     */
+    explicit OpticalSimulationCache(const G4String &name);
+
+    /** Destructor */
+    ~OpticalSimulationCache();
+
+    /**
+     * @brief Copy the cached output of the current configuration.
+     * @param nEvents Number of events requested.
+     * @return True when `<name>.root` was restored from the cache.
+     */
+    G4bool Retrieve(G4long nEvents);
+
+    /// Store `<name>.root` for the current configuration (processed events)
+    void Store(G4long nEvents);
+
+    /// Canonical configuration text and its hash
+    static G4String Configuration();
+    static G4String Hash(const G4String &text);
+
+  private:
+    /// Number of events of a cache entry, -1 if absent or not matching
+    G4long CachedEvents(const G4String &hash,
+                        const G4String &configuration) const;
+
+    /// Copy the manifest-listed chunks of an output, renaming their prefix
+    void CopyChunks(const G4String &source, const G4String &from,
+                    const G4String &to) const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    G4String fName;
+    G4bool fEnabled = false;
+    G4String fDirectory = "../cache";
+};
+
+#endif
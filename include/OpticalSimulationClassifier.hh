@@ -0,0 +1,147 @@
+#ifndef OpticalSimulationClassifier_h
+#define OpticalSimulationClassifier_h 1
+
+/**
+ * @class OpticalSimulationClassifier
+ * @brief In-run alpha/beta classifier and run-level efficiency matrix.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Each event summary is classified as undetected, alpha-like or beta-like
+ * from either the ZnS/scintillator deposit sharing or, when detected photon
+ * arrival times are available, a pulse-shape (tail fraction) feature. Counts
+ * are accumulated per source type (alpha, beta, gamma, other) in thread-local
+ * storage and merged once per thread at the end of the run, so that the
+ * confusion matrix and detection efficiencies (with binomial errors) are
+ * available without writing any per-event tree.
+ *
+ * Commands are available under /OpticalSimulation/classifier/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationEventAction.hh"
+#include "OpticalSimulationRunTotals.hh"
+#include <array>
+
+class TFile;
+
+class OpticalSimulationClassifier {
+  public:
+    /// Source type deduced from the PDG code of the primary particle
+    enum SourceType {
+        kSourceAlpha = 0,
+        kSourceBeta,
+        kSourceGamma,
+        kSourceOther,
+        kNSourceTypes
+    };
+
+    /// Outcome of the classification of one event
+    enum EventClass {
+        kUndetected = 0,
+        kClassAlpha,
+        kClassBeta,
+        kNEventClasses
+    };
+
+    /// Number of bins of the discriminant distributions (range [0, 1])
+    static constexpr G4int kDiscriminantBins = 100;
+
+    /**
+     * @struct Results
+     * @brief Mergeable confusion matrix and discriminant distributions.
+     */
+    struct Results {
+        std::array<std::array<G4long, kNEventClasses>, kNSourceTypes> counts{};
+        std::array<std::array<G4long, kDiscriminantBins>, kNSourceTypes>
+            discriminant{};
+
+        void Clear() { *this = Results(); }
+        void Merge(const Results &other);
+
+        /// Number of events of a given source type
+        G4long Total(G4int source) const;
+        /// Fraction of events of a source type classified as @p cls
+        G4double Fraction(G4int source, G4int cls) const;
+        /// Binomial error on Fraction()
+        G4double FractionError(G4int source, G4int cls) const;
+        /// Fraction of events of a source type giving a detected signal
+        G4double DetectionEfficiency(G4int source) const;
+        /// Binomial error on DetectionEfficiency()
+        G4double DetectionEfficiencyError(G4int source) const;
+
+        /**
+         * @brief Fraction of detected betas above the discriminant cut that
+         * keeps a fraction @p alphaEfficiency of the detected alphas.
+         */
+        G4double BetaMisidAtAlphaEfficiency(G4double alphaEfficiency) const;
+    };
+
+    /** Constructor: declares the classifier UI commands */
+    OpticalSimulationClassifier();
+
+    /** Destructor */
+    ~OpticalSimulationClassifier();
+
+    /// Map a PDG code onto a source type
+    static G4int GetSourceType(G4int pdg);
+
+    /// Discriminant in [0, 1] (ZnS deposit fraction or PSD tail fraction)
+    G4double Discriminant(const RunTallyEvent &event) const;
+
+    /// Classify an event summary
+    G4int Classify(const RunTallyEvent &event) const;
+
+    /// Classify the event, store the class in the summary and accumulate it
+    void Fill(RunTallyEvent &event, const std::vector<float> &times);
+
+    /// Reset the thread-local accumulators at the start of a run
+    void BeginOfRun() { fLocal.Clear(); }
+
+    /// Fold the thread-local accumulators into the run totals (thread-safe)
+    void MergeIntoRunTotals() const;
+
+    /// Thread-local accumulators of the current run
+    const Results &GetLocalResults() const { return fLocal; }
+
+    /// Reset the run totals (master, at the start of a run)
+    static void ResetRunTotals();
+
+    /// Add the totals stored in a previous output (master, statistics top-up)
+    void LoadRunTotals(TFile *file) const;
+
+    /// Totals merged over all threads (valid after the end of the run)
+    static const Results &GetRunTotals() { return RunTotals::Get(); }
+
+    /// Print the confusion matrix and efficiencies of the run totals
+    void PrintRunTotals() const;
+
+    /// Write the run totals as count histograms in the given file
+    void WriteRunTotals(TFile *file) const;
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    /// Human readable names used in printouts and histogram labels
+    static const char *SourceName(G4int source);
+    static const char *ClassName(G4int cls);
+
+  private:
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    // --- Configuration ---
+    G4bool fEnabled = true;           ///< Enable the in-run classification
+    G4String fMethod = "deposit";     ///< "deposit" or "psd"
+    G4int fPhotonThreshold = 1;       ///< Min. detected photons for a signal
+    G4double fMinDeposit = 1.;        ///< Min. total deposit [keV]
+    G4double fZnSFractionCut = 0.8;   ///< ZnS deposit fraction for alpha
+    G4double fPSDTailStart = 50.;     ///< Start of the PSD tail window [ns]
+    G4double fPSDCut = 0.5;           ///< Tail fraction for alpha
+
+    Results fLocal; ///< Thread-local accumulators
+
+    /// Totals merged over threads
+    using RunTotals = OpticalSimulationRunTotals<Results>;
+};
+
+#endif
@@ -12,11 +12,30 @@
 #include "G4String.hh"
 #include "G4Types.hh"
 #include "G4UserEventAction.hh"
+#include "OpticalSimulationTrackTally.hh"
 #include <TBranch.h>
 #include <TTree.h>
+#include <unordered_map>
 #include <vector>
 
 class G4Event;
+class G4Track;
+class OpticalSimulationRunAction;
+
+/**
+ * @brief Key of an event, written in every tree
+ *
+ * The trees are filled conditionally and merged thread by thread: the key
+ * associates their entries. (segment, run, event) is unique in an output,
+ * event IDs being global over the threads of a run.
+ */
+struct RunTallyKey {
+    G4int segment = 0; ///< Seed segment (statistics top-up job)
+    G4int run = 0;     ///< Run ID
+    G4int thread = -1; ///< Worker thread (-1: sequential)
+    G4int event = 0;   ///< Event ID
+    G4int subevent = 0; ///< Primary of a batched event
+};
 
 /**
  * @brief Structure to store per-event input particle data
@@ -32,6 +51,7 @@ struct RunTallyInput {
     float z = 0.0;
     float zp = 0.0;
     float energy = 0.0;
+    G4int pdg = 0; ///< PDG code of the primary (source)
 };
 
 // This struct carries statistics OPTICAL part
@@ -77,10 +97,32 @@ struct RunTallyOptical {
     }
 };
 
+/**
+ * @brief Compact per-event summary used by the run-level accumulators
+ *
+ * Built at the end of each event from the input, ZnS, scintillator and
+ * optical tallies. It does not depend on the per-event trees being written.
+ */
+struct RunTallyEvent {
+    G4int sourcePDG = 0;       ///< PDG code of the primary particle
+    float energy = 0.0;        ///< Primary kinetic energy [MeV]
+    float x = 0.0;             ///< Primary position [mm]
+    float y = 0.0;             ///< Primary position [mm]
+    float z = 0.0;             ///< Primary position [mm]
+    float depositZnS = 0.0;    ///< Energy deposited in ZnS:Ag [keV]
+    float depositSc = 0.0;     ///< Energy deposited in EJ-212 [keV]
+    G4int generated = 0;       ///< Optical photons generated
+    G4int detected = 0;        ///< Optical photons detected
+    float tailFraction = -1.0; ///< PSD tail fraction (-1 if unavailable)
+    G4int eventClass = 0;      ///< Classifier outcome
+};
+
 /**
  * @brief Structure for YAG detector statistics
  *
- * Tracks exit coordinates, particle IDs, energies, deposited energy, and flags.
+ * One entry per charged track depositing energy in the volume (entrance,
+ * parent, particle, energy, deposit), written by OpticalSimulationTrackTally
+ * when the track ends, plus the deposit of the whole event.
  */
 struct RunTallySc {
     std::vector<float> x_entrance;
@@ -89,10 +131,8 @@ struct RunTallySc {
     std::vector<int> parentID;
     std::vector<int> particleID;
     std::vector<float> energy;
-    float deposited_energy = 0.0;
     float deposited_energy_event = 0.0;
     std::vector<float> total_deposited_energy;
-    G4bool flag = false;
 
     // Methods to add data
     void AddXEntrance(float d) { x_entrance.push_back(d); }
@@ -102,7 +142,6 @@ struct RunTallySc {
     void AddParticleID(int d) { particleID.push_back(d); }
     void AddEnergy(float d) { energy.push_back(d); }
     void AddDepositedEnergyEvent(float d) { deposited_energy_event += d; }
-    void AddDepositedEnergy(float d) { deposited_energy += d; }
     void AddTotalDepositedEnergy(float d) {
         total_deposited_energy.push_back(d);
     }
@@ -131,14 +170,19 @@ struct RunTallySc {
     float GetTotalDepositedEnergyEvent() const {
         return deposited_energy_event;
     }
+};
 
-    // Flags
-    void ActivateFlag() { flag = true; }
-    void ResetFlag() { flag = false; }
-    G4bool ReturnFlag() const { return flag; }
-
-    void ResetDepositedEnergy() { deposited_energy = 0; }
-    float GetDepositedEnergy() const { return deposited_energy; }
+/**
+ * @brief Tallies of one primary (sub-event) of an event
+ *
+ * An event holds one record per primary: one for the usual events, one per
+ * packed primary for the batched events. They are written in one batch.
+ */
+struct RunTallyRecord {
+    RunTallyInput input;
+    RunTallySc zns;
+    RunTallySc scintillator;
+    RunTallyOptical optical = {};
 };
 
 /**
@@ -249,7 +293,43 @@ class OpticalSimulationEventAction : public G4UserEventAction {
     RunTallySc &GetZnS() { return StatsZnS; }
     RunTallySc &GetScintillator() { return StatsScintillator; }
 
+    /** True when the event packs several primaries */
+    G4bool IsBatched() const { return fRecords.size() > 1; }
+
+    /** Direct the tallies to the sub-event of a new track (batched events) */
+    void EnterTrack(const G4Track *track);
+
+    /** Charged tracks of the event in ZnS and the scintillator */
+    OpticalSimulationTrackTally &GetTrackTally() { return fTrackTally; }
+
+    /** Sub-event being filled */
+    G4int GetSubEvent() const { return fSubEvent; }
+
+    /** Write the ZnS and scintillator entries of an ending track */
+    void EndTrack(G4int trackID) {
+        fTrackTally.EndTrack(trackID, StatsZnS, StatsScintillator);
+    }
+
   private:
+    /** Make sub-event @p index the one filled by the stepping action */
+    void SelectSubEvent(G4int index);
+
+    /** Exchange the working tallies with a stored record */
+    void SwapCurrent(RunTallyRecord &record);
+
+    /** PDG code of the primary of a sub-event (0 if none) */
+    static G4int SourcePDG(const G4Event *evt, G4int index);
+
+    /** Totals, summary and run-level accumulators of the current record */
+    void FinishSubEvent(const G4Event *evt, G4int index,
+                        OpticalSimulationRunAction *runac);
+
+    std::vector<RunTallyRecord> fRecords; ///< Stored sub-events
+    G4int fSubEvent = 0;                   ///< Sub-event being filled
+    std::vector<G4int> fPrimaryEnd; ///< Primaries up to each vertex
+    std::unordered_map<G4int, G4int> fTrackSubEvent; ///< Charged tracks
+    OpticalSimulationTrackTally fTrackTally; ///< Open charged tracks
+
     TTree *EventTree;         ///< ROOT tree for per-event data
     TBranch *EventBranch;     ///< ROOT branch for event tree
     RunTallyInput StatsInput; ///< Input particle statistics
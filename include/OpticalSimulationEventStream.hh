@@ -0,0 +1,128 @@
+#ifndef OpticalSimulationEventStream_h
+#define OpticalSimulationEventStream_h 1
+
+/**
+ * @class OpticalSimulationEventStream
+ * @brief Shared-memory ring buffer of finished event records.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * When enabled, every event summary (and optionally some columns of its
+ * detected photons) is published in a POSIX shared-memory segment, so that
+ * an analysis process on the same node can follow a run live, without
+ * waiting for the end of the run and the merge.
+ *
+ * Layout of the segment (native byte order, offsets in bytes):
+ *  - header (128 bytes), see StreamHeader;
+ *  - capacity slots of recordSize bytes (multiple of 64). Slot i holds the
+ *    record of sequence number s with s % capacity == i:
+ *      - 8 bytes: stamp (atomic), 2 s + 1 while written, 2 s + 2 when ready;
+ *      - StreamRecord (64 bytes);
+ *      - one float array of maxPhotons entries per selected column, in the
+ *        order time [ns], wavelength [nm], x, y, z [mm] (nPhotons valid).
+ *
+ * Consumer: keep the next sequence s to read (start at head if joining a
+ * running stream); wait for stamp == 2 s + 2, copy the slot, read the stamp
+ * again: if it changed the slot was overwritten (drop-oldest), restart from
+ * head - capacity. Publish s + 1 in tail after each record.
+ *
+ * Policies when the consumer is late:
+ *  - block: producers wait for free slots (back-pressure on the workers,
+ *    the run stalls while no consumer advances tail);
+ *  - drop: the oldest records are overwritten and counted in dropped.
+ *
+ * The segment is created by the master at its first run and unlinked at the
+ * end of the job; runID and running tell the consumer which run is
+ * streamed. Commands are available under /OpticalSimulation/stream/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationEventAction.hh"
+#include <atomic>
+#include <cstdint>
+
+/// Header of the shared-memory segment
+struct StreamHeader {
+    std::uint32_t magic;      ///< 0x5645534f ("OSEV" in memory order)
+    std::uint32_t version;    ///< Layout version (1)
+    std::uint32_t recordSize; ///< Bytes per slot, stamp included
+    std::uint32_t capacity;   ///< Number of slots
+    std::uint32_t maxPhotons; ///< Entries of each photon column
+    std::uint32_t columns;    ///< Bit mask: 1 time, 2 wavelength, 4 x, 8 y,
+                              ///< 16 z
+    std::uint32_t policy;     ///< 0 block, 1 drop oldest
+    std::atomic<std::uint32_t> running; ///< 1 while a run is streamed
+    std::atomic<std::int64_t> runID;    ///< Current run
+    std::atomic<std::uint64_t> head;    ///< Next sequence reserved
+    std::atomic<std::uint64_t> tail;    ///< Next sequence of the consumer
+    std::atomic<std::uint64_t> dropped; ///< Records overwritten unread
+    std::uint8_t reserved[64];
+};
+
+/// Fixed part of a record
+struct StreamRecord {
+    std::int64_t eventID;
+    std::int32_t thread; ///< Worker index (-1: sequential)
+    std::int32_t sourcePDG;
+    float energy; ///< [MeV]
+    float x, y, z; ///< Primary position [mm]
+    float depositZnS; ///< [keV]
+    float depositSc;  ///< [keV]
+    std::int32_t generated;
+    std::int32_t detected;
+    float tailFraction;
+    std::int32_t eventClass;
+    std::uint32_t nPhotons; ///< Valid entries of the photon columns
+    std::uint32_t reserved;
+};
+
+static_assert(sizeof(StreamHeader) == 128, "stream header layout");
+static_assert(sizeof(StreamRecord) == 64, "stream record layout");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "shared-memory atomics must be lock-free");
+
+class OpticalSimulationEventStream {
+  public:
+    /** Constructor: declares the stream UI commands */
+    OpticalSimulationEventStream();
+
+    /** Destructor */
+    ~OpticalSimulationEventStream();
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    /// Create (or reuse) the segment and mark the run as streamed (master)
+    void BeginOfRun(G4int runID) const;
+
+    /// Mark the end of the streamed run (master)
+    void EndOfRun() const;
+
+    /// Publish one finished event
+    void Publish(const RunTallyEvent &event, G4long eventID,
+                 const RunTallyOptical &optical) const;
+
+  private:
+    /// Bit mask of the selected photon columns
+    std::uint32_t Columns() const;
+
+    /// Unmap and unlink the segment
+    static void Close();
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    // --- Configuration ---
+    G4bool fEnabled = false;
+    G4String fName = "/OpticalSimulation";  ///< Shared-memory object name
+    G4int fCapacity = 65536;                ///< Number of slots
+    G4String fPolicy = "drop";              ///< block or drop
+    G4String fColumns = "time";             ///< Photon columns
+    G4int fMaxPhotons = 64;                 ///< Photons kept per event
+
+    // --- Segment shared by all the threads ---
+    static StreamHeader *fHeader;
+    static size_t fSize;
+    static G4String fOpenName;
+};
+
+#endif
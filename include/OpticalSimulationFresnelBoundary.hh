@@ -0,0 +1,147 @@
+#ifndef OpticalSimulationFresnelBoundary_h
+#define OpticalSimulationFresnelBoundary_h 1
+
+/**
+ * @class OpticalSimulationFresnelBoundary
+ * @brief Optical boundary process with tabulated Fresnel coefficients on
+ * registered interfaces.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Replaces G4OpBoundaryProcess (same name, OpBoundary) in the physics list.
+ * On an accelerated interface, a polished dielectric-dielectric boundary
+ * between two fixed materials, the photon is reflected or refracted from
+ * precomputed tables of the s and p amplitude coefficients over the cosine
+ * of the incidence angle and the photon energy, without the surface and
+ * material property lookups of the standard process; every other boundary
+ * is left to G4OpBoundaryProcess.
+ *
+ * Interfaces are selected by their two physical volumes (both directions):
+ *
+ *     /OpticalSimulation/boundary/accelerate ZnS Scintillator
+ *     /OpticalSimulation/boundary/accelerate Scintillator Holder
+ *
+ * An interface with a border or skin surface other than a polished
+ * dielectric-dielectric one (the photocathode, a wrapping) is refused.
+ * /OpticalSimulation/boundary/validate compares the tables with the
+ * Fresnel coefficients computed from RINDEX as the standard process does.
+ *
+ * With /OpticalSimulation/boundary/setCompare true, every photon reaching
+ * a registered interface goes through G4OpBoundaryProcess::PostStepDoIt,
+ * which moves it, and through the table decision, which is only counted:
+ * both see the same energy, incidence and polarization. At the end of the
+ * run, the master prints per interface the reflected and refracted
+ * fractions and the status histogram of both.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4MaterialPropertyVector.hh"
+#include "G4OpBoundaryProcess.hh"
+#include <map>
+#include <utility>
+#include <vector>
+
+class G4VPhysicalVolume;
+
+class OpticalSimulationFresnelBoundary : public G4OpBoundaryProcess {
+  public:
+    /** Constructor: declares the boundary UI commands */
+    OpticalSimulationFresnelBoundary();
+
+    /** Destructor */
+    ~OpticalSimulationFresnelBoundary() override;
+
+    /// Accelerated interfaces here, G4OpBoundaryProcess elsewhere
+    G4VParticleChange *PostStepDoIt(const G4Track &track,
+                                    const G4Step &step) override;
+
+    /// Status of the last boundary step, accelerated or not
+    G4OpBoundaryProcessStatus GetStatus() const;
+
+    /// Process of the calling thread (nullptr if not in the physics list)
+    static OpticalSimulationFresnelBoundary *GetInstance() {
+        return fInstance;
+    }
+
+    /// Add the comparison counts of the thread to the run totals
+    void MergeComparison();
+
+    /// Print and reset the comparison totals (master, end of run)
+    static void PrintComparison();
+
+  private:
+    friend class OpticalSimulationFresnelBoundaryTest; ///< Unit tests
+
+    /// Amplitude coefficients of one oriented interface
+    struct Table {
+        G4String name;                               ///< "pre -> post"
+        G4MaterialPropertyVector *rindex1 = nullptr; ///< Pre-step RINDEX
+        G4MaterialPropertyVector *rindex2 = nullptr; ///< Post-step RINDEX
+        G4double eMin = 0.;  ///< First energy of the grid
+        G4double eStep = 0.; ///< Energy step
+        G4int nE = 0;        ///< Energies
+        std::vector<G4float> ratio; ///< n1/n2 per energy
+        std::vector<G4float> rs;    ///< s amplitude [energy][cosine]
+        std::vector<G4float> rp;    ///< p amplitude [energy][cosine]
+
+        /// Grid of n1/n2 and amplitudes from rindex1 and rindex2
+        void Fill();
+
+        /// Interpolated n1/n2 and amplitudes at an energy and cosine
+        void Lookup(G4double energy, G4double cosine, G4double &n12,
+                    G4double &s, G4double &p) const;
+    };
+
+    using Interface =
+        std::pair<const G4VPhysicalVolume *, const G4VPhysicalVolume *>;
+
+    /// Boundary statuses of the standard process and of the table
+    struct Comparison {
+        std::map<G4int, G4long> base;  ///< G4OpBoundaryProcess
+        std::map<G4int, G4long> table; ///< Table decision
+    };
+
+    /// Register the interface between two physical volumes ("pre post")
+    void Accelerate(const G4String &volumes);
+
+    /// Forget the registered interfaces
+    void Clear();
+
+    /// Print the largest table errors on the reflectances
+    void Validate();
+
+    /// Tables of the registered interfaces in the current geometry
+    void BuildTables();
+
+    /// Table of an oriented interface; false if it cannot be accelerated
+    G4bool BuildTable(const G4VPhysicalVolume *pre,
+                      const G4VPhysicalVolume *post, Table &table) const;
+
+    /// Fresnel amplitudes for n1/n2 and the cosine of incidence
+    static void Fresnel(G4double n12, G4double cosine, G4double &s,
+                        G4double &p);
+
+    /// Reflection or refraction of a photon from the table
+    G4OpBoundaryProcessStatus Decide(const Table &table, const G4Track &track,
+                                     G4ThreeVector normal,
+                                     G4ThreeVector &newDirection,
+                                     G4ThreeVector &newPolarization) const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    /// Registered interfaces (volume names)
+    std::vector<std::pair<G4String, G4String>> fVolumes;
+
+    std::map<Interface, Table> fTables; ///< Tables of the current geometry
+    G4int fTableRun = -1;               ///< Run the tables were built for
+    G4bool fHandled = false; ///< Last boundary step was accelerated
+    G4OpBoundaryProcessStatus fAcceleratedStatus = Undefined;
+
+    G4bool fCompare = false; ///< Standard process moves, table is counted
+    std::map<G4String, Comparison> fComparison; ///< Per interface name
+
+    static std::map<G4String, Comparison> fComparisonTotals; ///< All threads
+    static G4ThreadLocal OpticalSimulationFresnelBoundary *fInstance;
+};
+
+#endif
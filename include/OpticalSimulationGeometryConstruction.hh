@@ -11,6 +11,16 @@
  *  - Building the world and detector components.
  *  - Setting visualization attributes.
  *  - Providing user control over geometry display.
+ *
+ * The faces of the ZnS/scintillator stack can be wrapped in Teflon or
+ * Mylar, face by face (/OpticalSimulation/geometry/setWrapping). Each
+ * wrapped face gets a thin sheet of the wrapping material and a border
+ * surface from the crystal to it. By default the surface is a look-up-table
+ * model (Geant4 LUT, measured angular distributions of the LBNL database,
+ * polished or ground crystal with an air gap), so that a reflection costs a
+ * table sampling instead of the unified microfacet model; the unified and
+ * glisur surfaces are kept for comparison (setWrappingModel unified). The
+ * LUT needs the G4REALSURFACEDATA data set.
  */
 
 #include "G4GeometryManager.hh"
@@ -60,11 +70,15 @@ class OpticalSimulationGeometryConstruction final
     /** @brief Construct PMT Glass Part. */
     void ConstructPMTGlass();
 
-    /** @brief Construct TeflonOpticalProperties. */
-    void CreateTeflonOpticalProperties();
+    /** @brief Construct TeflonOpticalProperties (LUT or unified). */
+    G4OpticalSurface *CreateTeflonOpticalProperties(G4bool lut,
+                                                    G4bool ground);
+
+    /** @brief Construct MylarOpticalProperties (LUT or glisur). */
+    G4OpticalSurface *CreateMylarOpticalProperties(G4bool lut, G4bool ground);
 
-    /** @brief Construct MylarOpticalProperties. */
-    void CreateMylarOpticalProperties();
+    /** @brief Construct the wrapping sheets and surfaces of the stack. */
+    void ConstructWrapping();
 
     /** @brief Construct DetectionOpticalProperties. */
     void CreateDetectionOpticalProperties();
@@ -107,17 +121,50 @@ class OpticalSimulationGeometryConstruction final
     const float GetZnSWidth() const { return fZnSWidth; }
     const float GetZnSThickness() const { return fZnSThickness; }
     const float GetDetectorDistance() const { return fDetectorDistance; }
+
+    /// Axis of the placed PMT (local z of the polycone) in the holder frame
+    G4ThreeVector GetPMTAxis() const;
+    /// Position of the placed PMT in the holder frame
+    G4ThreeVector GetPMTPosition() const;
+    /// Logical photocathode (carries the detection skin surface)
+    G4LogicalVolume *GetPhotocathode() const { return LogicalPhotocathode; }
+    /// Placement of the photocathode in the world frame
+    G4Transform3D GetPhotocathodeTransform() const;
     ///@}
 
     /** @name Geometry Parameters */
     ///@{
-    void SetScintillatorLY(const G4double LY) { fScintillatorLY = LY; };
-    void SetZnSLY(const G4double LY) { fZnSLY = LY; };
+    void SetScintillatorLY(const G4double LY);
+    void SetZnSLY(const G4double LY);
 
     const float GetScintillatorLY() const { return fScintillatorLY; }
     const float GetZnSLY() const { return fZnSLY; }
     ///@}
 
+    /** @name Wrapping */
+    ///@{
+    /// Wrapped faces: ZnS entrance (-z) and lateral faces of the stack
+    enum WrapFace { kEntrance = 0, kXMin, kXMax, kYMin, kYMax, kNWrapFaces };
+
+    /// Wrap a face (or all lateral faces: sides) in none, teflon or mylar,
+    /// on a polished or ground crystal surface
+    void SetWrapping(const G4String &face, const G4String &wrapping,
+                     const G4String &finish);
+    void SetWrappingModel(const G4String &model) { fWrapModel = model; }
+    void SetWrappingThickness(const G4double thickness) {
+        fWrapThickness = thickness;
+    }
+
+    /// Wrapping of every face, "face:wrapping/finish ..."
+    G4String GetWrapping() const;
+    /// Wrapping of one face, "wrapping/finish"
+    G4String GetWrapping(G4int face) const {
+        return fWrapping[face] + "/" + fWrapFinish[face];
+    }
+    const G4String &GetWrappingModel() const { return fWrapModel; }
+    G4double GetWrappingThickness() const { return fWrapThickness; }
+    ///@}
+
   private:
     static const G4String path;
 
@@ -144,6 +191,14 @@ class OpticalSimulationGeometryConstruction final
     G4double fScintillatorLY = 10000 / MeV;
     G4double fZnSLY = 44000 / MeV;
 
+    /** @brief Wrapping of the stack faces. */
+    G4String fWrapping[kNWrapFaces] = {"none", "none", "none", "none",
+                                       "none"};
+    G4String fWrapFinish[kNWrapFaces] = {"polished", "polished", "polished",
+                                         "polished", "polished"};
+    G4String fWrapModel = "LUT";                  ///< LUT or unified
+    G4double fWrapThickness = 0.1 * CLHEP::mm;   ///< Sheet thickness
+
     /** @brief Visualization attributes (colors). */
     G4VisAttributes *invis = nullptr; // init all the pointers
     G4VisAttributes *white = nullptr;
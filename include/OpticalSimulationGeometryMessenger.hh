@@ -8,10 +8,12 @@
  * @date 2026
  *
  * Provides UI commands to setup detector and readout geometry (prior to
- * initialization). Length, distance, gradients and display can be changed.
+ * initialization). Length, distance, gradients and display can be changed,
+ * as well as the Teflon/Mylar wrapping of each face of the stack.
  */
 
 #include "G4UIcmdWithADouble.hh"
+#include "G4UIcmdWithAString.hh"
 #include "G4UIcmdWithADoubleAndUnit.hh" // for G4UIcmdWithADoubleAndUnit
 #include "G4UIcmdWithAnInteger.hh"      // for G4UIcmdWithAnInteger
 #include "G4UIcmdWithoutParameter.hh"   // for G4UIcmdWithoutParameter
@@ -21,6 +23,8 @@
 class G4UIcmdWithADoubleAndUnit;
 class G4UIcmdWithADouble;
 class G4UIcmdWithAnInteger;
+class G4UIcmdWithAString;
+class G4UIcommand;
 class G4UIcmdWithoutParameter;
 class G4UIdirectory;
 class OpticalSimulationGeometryConstruction;
@@ -64,6 +68,12 @@ class OpticalSimulationGeometryMessenger : public G4UImessenger {
     G4UIcmdWithADoubleAndUnit *fGeometryZnSThicknessCmd = nullptr;
     /// Command to set the Detector Distance
     G4UIcmdWithADoubleAndUnit *fGeometryDetectorDistanceCmd = nullptr;
+    /// Command to wrap a face of the stack
+    G4UIcommand *fGeometryWrappingCmd = nullptr;
+    /// Command to set the wrapping surface model
+    G4UIcmdWithAString *fGeometryWrappingModelCmd = nullptr;
+    /// Command to set the wrapping sheet thickness
+    G4UIcmdWithADoubleAndUnit *fGeometryWrappingThicknessCmd = nullptr;
 
     /// MATERIALS
     ///  Command to set the Scintillator LY
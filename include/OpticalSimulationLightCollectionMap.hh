@@ -0,0 +1,178 @@
+#ifndef OpticalSimulationLightCollectionMap_h
+#define OpticalSimulationLightCollectionMap_h 1
+
+/**
+ * @class OpticalSimulationLightCollectionMap
+ * @brief Light-collection efficiency maps of the ZnS:Ag and EJ-212 volumes.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The light-collection efficiency (LCE) of a voxel is the probability that
+ * an optical photon emitted isotropically in it is detected by the PMT
+ * (quantum efficiency included). Two estimators are available on the same
+ * voxel grid:
+ *
+ *  - forward: optical photons are emitted uniformly in a volume (photon scan
+ *    of OpticalSimulationQuasiRandom) and the detected fraction is counted
+ *    per emission voxel. Most photons are lost since the LCE is a few
+ *    percent.
+ *  - adjoint: optical transport is reciprocal (reflections, refractions and
+ *    bulk absorption are the same both ways), so photons are started on the
+ *    glass side of the photocathode with a Lambertian (cosine) distribution,
+ *    weighted by the quantum efficiency, and traced through the same
+ *    surfaces and bulk properties. The track length per voxel (adjoint
+ *    flux phi) gives the LCE of every voxel crossed by a photon:
+ *
+ *        LCE = A_pc / (4 N) * phi * n_glass^2 / n_medium^2
+ *
+ *    with A_pc the photocathode area seen from the glass and N the number
+ *    of adjoint photons. Every adjoint photon contributes to the voxels it
+ *    crosses, whether or not it would have been detected forward.
+ *
+ * Both modes write hadd-mergeable raw tallies together with the LCE maps.
+ * An adjoint run can be checked against a forward reference file: the
+ * chi2 of the voxel-by-voxel differences and the mean adjoint/forward ratio
+ * are printed at the end of run.
+ *
+ * Commands are available under /OpticalSimulation/lce/.
+ */
+
+#include "G4AffineTransform.hh"
+#include "G4GenericMessenger.hh"
+#include "G4MaterialPropertyVector.hh"
+#include "G4Transform3D.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationEventAction.hh"
+#include "OpticalSimulationRunTotals.hh"
+#include <map>
+#include <vector>
+
+class G4Event;
+class G4Material;
+class G4Step;
+class G4VSolid;
+class TFile;
+class OpticalSimulationGeometryConstruction;
+
+class OpticalSimulationLightCollectionMap {
+  public:
+    /// Volumes with a map
+    enum Volume { kZnS = 0, kScintillator, kNVolumes };
+
+    /// Per-voxel tallies, flattened as [tally][volume * nVoxels + voxel]
+    enum Tally {
+        kThrown = 0, ///< Forward: photons emitted in the voxel
+        kDetected,   ///< Forward: detected photons emitted in the voxel
+        kFlux,       ///< Adjoint: weighted track length [mm]
+        kFlux2,      ///< Adjoint: sum over photons of squared track length
+        kNTallies
+    };
+
+    /// Normalisation of the adjoint estimator: photons, surface points
+    /// tried, and full photocathode area summed over the accepted points
+    enum Source { kPhotons = 0, kTried, kAcceptedArea, kNSource };
+
+    struct Results {
+        std::vector<G4double> sums[kNTallies];
+        G4double source[kNSource] = {0., 0., 0.};
+
+        void Reset(size_t nBins);
+        /// Empty the counts, keeping the buffers (Python views)
+        void Clear();
+        /// Add @p other (adopts its layout when this one is empty)
+        void Merge(const Results &other);
+    };
+
+    /** Constructor: declares the LCE UI commands */
+    OpticalSimulationLightCollectionMap();
+
+    /** Destructor */
+    ~OpticalSimulationLightCollectionMap();
+
+    /// Geometry providing the volumes and the photocathode
+    void SetGeometry(OpticalSimulationGeometryConstruction *geom) {
+        fGeometry = geom;
+    }
+
+    G4bool IsAdjoint() const { return fMode == "adjoint"; }
+
+    /// Replace the primary by an adjoint photon leaving the photocathode
+    void SamplePrimary(G4Event *event);
+
+    /// Score the track length of an adjoint photon in the mapped volumes
+    void Score(const G4Step *step);
+
+    /// Forward tallies and end of the adjoint photon of the event
+    void Fill(const RunTallyEvent &event);
+
+    /// Read the volumes, resolve the photocathode, the glass and the
+    /// spectra of the adjoint source, reset the thread-local sums
+    void BeginOfRun();
+
+    /// Fold the thread-local sums into the run totals (thread-safe)
+    void MergeIntoRunTotals() const;
+
+    /// Reset the run totals (master, at the start of a run)
+    static void ResetRunTotals();
+
+    /// Totals merged over all threads (valid after the end of the run)
+    static const Results &GetRunTotals() { return RunTotals::Get(); }
+
+    /// Add the totals stored in a previous output (master, statistics top-up)
+    void LoadRunTotals(TFile *file) const;
+
+    /// Print the mean LCE per volume and the comparison with the reference
+    void PrintRunTotals() const;
+
+    /// Write the raw tallies and the LCE maps in the given file
+    void WriteRunTotals(TFile *file) const;
+
+  private:
+    /// Voxel (flattened over the volumes) of a position, -1 if outside
+    G4int Voxel(G4double x, G4double y, G4double z) const;
+
+    /// LCE and its error for every voxel, from forward or adjoint totals
+    void Estimate(const Results &totals, G4bool adjoint,
+                  std::vector<G4double> &lce,
+                  std::vector<G4double> &error) const;
+
+    /// Photocathode area seen from the glass
+    G4double SourceArea(const Results &totals) const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+    OpticalSimulationGeometryConstruction *fGeometry = nullptr;
+
+    // --- Configuration ---
+    G4String fMode = "off";      ///< off, forward or adjoint
+    G4int fBinsX = 10;           ///< Voxels along x (length)
+    G4int fBinsY = 10;           ///< Voxels along y (width)
+    G4int fBinsZ = 4;            ///< Voxels along z (thickness)
+    G4String fSpectrum = "ZnS";  ///< Emission spectrum of adjoint photons
+    G4String fReference = "";    ///< Forward file to compare with
+
+    // --- Volumes of the current run (box centre and half sizes) ---
+    G4double fCentreZ[kNVolumes] = {0., 0.};
+    G4double fHalf[kNVolumes][3] = {{0., 0., 0.}, {0., 0., 0.}};
+    G4double fSubStep = 1.; ///< Sub-step length of the track-length scoring
+
+    // --- Adjoint source (resolved once per run) ---
+    G4VSolid *fSolid = nullptr;              ///< Photocathode solid
+    G4Transform3D fTransform;                ///< Photocathode to global
+    G4VSolid *fGlassSolid = nullptr;         ///< PMT glass solid
+    G4AffineTransform fGlassTransform;       ///< Global to glass frame
+    G4Material *fGlassMaterial = nullptr;
+    G4MaterialPropertyVector *fEmission = nullptr;   ///< Emission spectrum
+    G4MaterialPropertyVector *fEfficiency = nullptr; ///< QE (null: 1)
+    G4double fSurfaceArea = 0.;              ///< Full photocathode area
+    G4double fEnergyMin = 0.;                ///< Emission spectrum range
+    G4double fEnergyMax = 0.;
+    G4double fSpectrumMax = 0.;
+
+    std::map<G4int, G4double> fEvent; ///< Track length of the current photon
+    Results fLocal;                   ///< Thread-local accumulators
+
+    /// Totals merged over threads
+    using RunTotals = OpticalSimulationRunTotals<Results>;
+};
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef OpticalSimulationMonitor_h
+#define OpticalSimulationMonitor_h 1
+
+/**
+ * @class OpticalSimulationMonitor
+ * @brief Live progress of a run: periodic log line and local HTTP endpoint.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Every thread counts its events, classification outcomes, discriminant
+ * distribution and detected-photon distribution in its own slot of relaxed
+ * atomics (one writer per slot, no lock). A monitoring thread started by the
+ * master reads the slots while the workers keep running, and
+ *  - optionally prints a progress line (events, rate, ETA) at a fixed
+ *    interval;
+ *  - optionally answers HTTP requests on 127.0.0.1 only:
+ *      - `/`            plain-text progress and per-thread throughput;
+ *      - `/status.json` the same plus the classification counts, the
+ *        discriminant and detected-photon histograms of the running run.
+ *
+ * The snapshots are not synchronised between the counters of a slot: a
+ * snapshot may count an event in one histogram and not yet in another.
+ * The merged run-level results are still produced at the end of the run.
+ *
+ * Commands are available under /OpticalSimulation/monitor/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationClassifier.hh"
+#include "OpticalSimulationEventAction.hh"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+class G4Run;
+
+class OpticalSimulationMonitor {
+  public:
+    /// Bins of the detected-photon histogram (one per photon, last: overflow)
+    static constexpr G4int kPhotonBins = 200;
+
+    /** Constructor: declares the monitor UI commands */
+    OpticalSimulationMonitor();
+
+    /** Destructor */
+    ~OpticalSimulationMonitor();
+
+    /// Reset the slots and start the monitoring thread (master)
+    void BeginOfRun(const G4Run *run) const;
+
+    /// Count a finished event (or one more primary of a batched event when
+    /// @p newEvent is false) in the slot of the calling thread
+    void Fill(const RunTallyEvent &event, G4double discriminant,
+              G4bool newEvent = true) const;
+
+    /// Stop the monitoring thread and print the final line (master)
+    void EndOfRun() const;
+
+  private:
+    using Clock = std::chrono::steady_clock;
+    using Source = OpticalSimulationClassifier;
+
+    /// Counters of one thread
+    struct Slot {
+        std::atomic<G4long> events{0};
+        std::atomic<G4long> counts[Source::kNSourceTypes]
+                                  [Source::kNEventClasses] = {};
+        std::atomic<G4long> discriminant[Source::kNSourceTypes]
+                                        [Source::kDiscriminantBins] = {};
+        std::atomic<G4long> photons[kPhotonBins] = {};
+    };
+
+    /// Body of the monitoring thread
+    static void Run(G4bool http, G4int port, G4double interval);
+
+    /// Answer one HTTP connection
+    static void Respond(G4int connection);
+
+    /// Progress line of the current run
+    static G4String Progress();
+
+    /// Plain-text page: progress and per-thread throughput
+    static G4String Text();
+
+    /// JSON snapshot of all the counters
+    static G4String Json();
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    // --- Configuration ---
+    G4bool fHttp = false;        ///< Serve the HTTP endpoint
+    G4int fPort = 8765;          ///< Port on 127.0.0.1
+    G4double fInterval = 0.;     ///< Progress line interval [s] (0: off)
+
+    // --- State shared with the monitoring thread ---
+    static std::unique_ptr<Slot[]> fSlots;
+    static G4int fNSlots;
+    static G4int fRunID;
+    static G4long fEventsToProcess;
+    static Clock::time_point fStart;
+    static std::thread fThread;
+    static std::atomic<G4bool> fStop;
+};
+
+#endif
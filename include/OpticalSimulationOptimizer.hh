@@ -0,0 +1,143 @@
+#ifndef OpticalSimulationOptimizer_h
+#define OpticalSimulationOptimizer_h 1
+
+/**
+ * @class OpticalSimulationOptimizer
+ * @brief Simulation-in-the-loop Bayesian optimization of the design.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The parameters are UI commands with a range, e.g.
+ * `/OpticalSimulation/geometry/setZnSThickness 5 50 um`. Every evaluation
+ * applies the parameter values, rebuilds the geometry only when a geometry
+ * parameter has changed (light yields are applied to the materials
+ * directly), and runs a short simulation on all the threads, stopped by the
+ * precision monitor once the requested relative precision is reached.
+ *
+ * The objective (maximized) is read from the in-run classifier totals:
+ *  - separation: beta rejection (1 - beta misidentification) at a fixed
+ *    alpha efficiency,
+ *  - efficiency, efficiency_alpha, efficiency_beta: detection efficiencies.
+ *
+ * The objectives need the classifier enabled; the optimizer refuses to run
+ * without it.
+ *
+ * After an initial Latin hypercube design (drawn from setSeed, the same for
+ * a resumed run), the next point maximizes the
+ * expected improvement of a Gaussian-process model (squared exponential
+ * kernel on the normalized parameters, heteroscedastic noise taken from the
+ * statistical error of every evaluation).
+ *
+ * Every evaluation is appended to a CSV history; a new run with the same
+ * parameters reloads it and continues the search. The driver lives on the
+ * master thread and is created in main; commands are available under
+ * /OpticalSimulation/optimizer/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationClassifier.hh"
+#include <vector>
+
+class OpticalSimulationOptimizer {
+  public:
+    /**
+     * @brief Constructor.
+     * @param name Base name of the output files
+     * @param nThreads Number of worker threads
+     * @param pMT True if running with multithreading
+     */
+    OpticalSimulationOptimizer(const G4String &name, size_t nThreads,
+                               G4bool pMT);
+
+    /** Destructor */
+    ~OpticalSimulationOptimizer();
+
+    /// True once an optimization has been run (main skips its own beamOn)
+    G4bool HasRun() const { return fHasRun; }
+
+    /// Run the search until the number of evaluations is reached
+    void Run();
+
+  private:
+    /// Optimized UI command
+    struct Parameter {
+        G4String command; ///< UI command receiving the value
+        G4double min = 0.;
+        G4double max = 1.;
+        G4String unit; ///< Unit appended to the value (may be empty)
+    };
+
+    /// One evaluated point of the history
+    struct Evaluation {
+        std::vector<G4double> x; ///< Parameter values (in their units)
+        G4double objective = 0.;
+        G4double error = 0.;
+        G4long events = 0;
+        G4double seconds = 0.;
+    };
+
+    /// Add a parameter from "<command> <min> <max> [unit]"
+    void AddParameter(G4String definition);
+    void ClearParameters() { fParameters.clear(); }
+
+    /// Apply a point and simulate it
+    Evaluation Evaluate(const std::vector<G4double> &x);
+
+    /// Objective and its statistical error from classifier totals
+    void Objective(const OpticalSimulationClassifier::Results &results,
+                   G4double &value, G4double &error) const;
+
+    /// Next point: Latin hypercube first, then expected improvement
+    std::vector<G4double> Propose();
+
+    /// Gaussian-process posterior mean and standard deviation at @p u
+    void Predict(const std::vector<G4double> &u, G4double &mean,
+                 G4double &sigma) const;
+
+    /// Factorize the covariance of the history (after each evaluation)
+    void Fit();
+
+    /// Normalized coordinates of a point
+    std::vector<G4double> Normalize(const std::vector<G4double> &x) const;
+
+    /// History I/O
+    G4String HistoryName() const;
+    G4bool LoadHistory();
+    void AppendHistory(const Evaluation &evaluation) const;
+
+    /// Print the best point
+    void Report() const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    G4String fName;
+    size_t fNThreads = 0;
+    G4bool flag_MT = false;
+    G4bool fHasRun = false;
+
+    // --- Configuration ---
+    G4String fObjective = "separation"; ///< Maximized quantity
+    G4double fAlphaEfficiency = 0.9;    ///< Working point of separation
+    G4int fEvaluations = 30;            ///< Total evaluations (with history)
+    G4int fInitialPoints = 0;           ///< Latin hypercube size (0: 2d+1)
+    G4long fSeed = 12345;               ///< Seed of the Latin hypercube
+    G4long fMaxEvents = 100000;         ///< Events cap of one evaluation
+    G4double fPrecision = 0.02;         ///< Relative precision per run
+    G4double fLengthScale = 0.3;        ///< Kernel length (normalized)
+    G4int fCandidates = 5000;           ///< Random candidates for EI
+    G4String fHistory = "";             ///< CSV file (default from name)
+
+    std::vector<Parameter> fParameters;
+    std::vector<Evaluation> fEvaluationsDone;
+    std::vector<G4double> fApplied; ///< Values of the last applied point
+
+    // --- Gaussian-process state (normalized inputs, standardized outputs)
+    std::vector<std::vector<G4double>> fChol; ///< Cholesky factor
+    std::vector<G4double> fAlpha;             ///< K^-1 (y - mean)
+    G4double fMean = 0.;
+    G4double fScale = 1.;
+    std::vector<std::vector<G4double>> fLatin; ///< Initial design
+};
+
+#endif
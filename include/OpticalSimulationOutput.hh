@@ -0,0 +1,80 @@
+#ifndef OpticalSimulationOutput_h
+#define OpticalSimulationOutput_h 1
+
+/**
+ * @class OpticalSimulationOutput
+ * @brief Helpers to merge and move the ROOT output files.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * In MT mode every thread writes its own file `<name>_<i>.root` (i = 0 for
+ * the master, 1..N for the workers). These helpers merge them with hadd and
+ * move the final file into the Resultats folder, for the single run of the
+ * batch mode as well as for the multiple runs of a scan, and append the
+ * events of a statistics top-up to an existing output.
+ *
+ * Every merged file gets an index of its event trees on the event key
+ * (major: segment * 65536 + run, minor: event * 1024 + subevent), so that
+ * the entries of an event are found directly in each tree:
+ *
+ *     Optical->GetEntryNumberWithIndex(segment * 65536 + run,
+ *                                      event * 1024 + subevent);
+ *     Optical->AddFriend(ZnS);  // friend entries matched through the index
+ *
+ * Batched events (several primaries per G4Event, at most 1024) write one
+ * entry per primary, told apart by the subevent branch (0 without
+ * batching). Trees without a subevent branch are indexed on the event.
+ *
+ * With /OpticalSimulation/run/setChunkEvents or setChunkSize, the event
+ * trees of each thread roll over to chunk files `<name>[_<i>]_c<k>.root`
+ * listed in `<name>.manifest`, one line per completed chunk:
+ * `file thread segment run first_event last_event events md5`, after a
+ * header giving the configuration hash. `<name>.root` then only holds the
+ * run-level results.
+ */
+
+#include "G4String.hh"
+#include "G4Types.hh"
+#include <vector>
+
+class TTree;
+
+class OpticalSimulationOutput {
+  public:
+    /// Names of the per-event trees
+    static const std::vector<G4String> &TreeNames();
+
+    /// Index a tree on the event key (no-op for an empty tree)
+    static void BuildIndex(TTree *tree);
+
+    /// Rebuild the index of every event tree of a file (after a merge)
+    static void BuildIndices(const G4String &file);
+
+    /// File written by one thread for a given output name
+    static G4String ThreadFileName(const G4String &name, G4int index);
+
+    /// Merge the per-thread files of one run into `<name>.root`
+    static void MergeThreadFiles(const G4String &name, size_t nThreads);
+
+    /// Merge ROOT files into @p target and optionally remove the inputs
+    static void Merge(const G4String &target,
+                      const std::vector<G4String> &inputs,
+                      G4bool removeInputs = true);
+
+    /**
+     * @brief Append the events of @p addition to @p target.
+     *
+     * The trees of both files are merged; the other objects (run-level
+     * results, bookkeeping) are taken from @p addition, which already
+     * includes the results of @p target. @p addition is removed.
+     */
+    static G4bool Extend(const G4String &target, const G4String &addition);
+
+    /// Move `<name>.root` (and its chunks and manifest) into Resultats
+    static void MoveToResults(const G4String &name);
+
+    /// Chunk lines of a manifest (empty when the output is not chunked)
+    static std::vector<G4String> ManifestEntries(const G4String &manifest);
+};
+
+#endif
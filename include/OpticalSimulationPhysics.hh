@@ -94,6 +94,9 @@ class OpticalSimulationPhysics final : public G4VModularPhysicsList {
 
     /// Destructor
     ~OpticalSimulationPhysics() override;
+
+    /// Processes of the modules, with the tabulated Fresnel boundary
+    void ConstructProcess() override;
 };
 
 #endif // OpticalSimulationPhysics_h
@@ -0,0 +1,114 @@
+#ifndef OpticalSimulationPrecisionMonitor_h
+#define OpticalSimulationPrecisionMonitor_h 1
+
+/**
+ * @class OpticalSimulationPrecisionMonitor
+ * @brief Stops a run once the monitored quantities reach a target precision.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Each thread groups its events into batches of fixed size and publishes the
+ * batch means of the monitored quantities. The uncertainty of each quantity
+ * is estimated online from the spread of the batch means over all threads
+ * (method of batch means). Once every monitored quantity reaches the target
+ * relative uncertainty, a shared flag is raised and every worker performs a
+ * soft abort at the end of its current event. The /run/beamOn count remains
+ * the maximum number of events.
+ *
+ * Monitored quantities:
+ *  - **efficiency**       : detection efficiency over all events
+ *  - **efficiency_alpha** : detection efficiency for alpha primaries
+ *  - **efficiency_beta**  : detection efficiency for beta primaries
+ *  - **photons**          : mean number of detected photons
+ *
+ * Commands are available under /OpticalSimulation/precision/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationEventAction.hh"
+#include <array>
+#include <atomic>
+
+class OpticalSimulationPrecisionMonitor {
+  public:
+    /// Quantities that can be monitored
+    enum Quantity {
+        kEfficiency = 0,
+        kEfficiencyAlpha,
+        kEfficiencyBeta,
+        kPhotons,
+        kNQuantities
+    };
+
+    /// Online batch means statistics of one quantity, merged over threads
+    struct BatchStatistics {
+        G4long nBatches = 0;
+        G4double sum = 0.;  ///< Sum of the batch means
+        G4double sum2 = 0.; ///< Sum of the squared batch means
+
+        G4double Mean() const { return nBatches > 0 ? sum / nBatches : 0.; }
+        /// Standard error of the mean of the batch means
+        G4double Error() const;
+        /// Relative standard error (infinite while the mean is null)
+        G4double RelativeError() const;
+    };
+
+    /** Constructor: declares the precision UI commands */
+    OpticalSimulationPrecisionMonitor();
+
+    /** Destructor */
+    ~OpticalSimulationPrecisionMonitor();
+
+    /// True when a target precision has been set
+    G4bool IsEnabled() const { return fTarget > 0.; }
+
+    /// Reset the thread-local batches at the start of a run
+    void BeginOfRun();
+
+    /// Reset the shared statistics and stop flag (master, start of a run)
+    static void ResetRunTotals();
+
+    /**
+     * @brief Add one classified event and abort the run once the target is
+     * reached.
+     */
+    void Fill(const RunTallyEvent &event);
+
+    /// Print the reached precision of the monitored quantities
+    void PrintRunTotals() const;
+
+    /// True once the target precision has been reached in the current run
+    static G4bool TargetReached() { return fStop.load(); }
+
+    static const char *QuantityName(G4int q);
+
+    /// Space separated list of the monitored quantities
+    const G4String &GetQuantities() const { return fQuantityList; }
+
+  private:
+    /// Decode the space separated list of monitored quantities
+    void SetQuantities(G4String list);
+
+    /// Publish a complete batch and check the convergence (thread-safe)
+    void PublishBatch(G4int q, G4double mean);
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    // --- Configuration ---
+    G4double fTarget = 0.;   ///< Target relative uncertainty (0 = disabled)
+    G4int fBatchSize = 1000; ///< Events per batch and per thread
+    G4int fMinBatches = 10;  ///< Batches required before stopping
+    G4String fQuantityList = "efficiency";
+    std::array<G4bool, kNQuantities> fMonitored{};
+
+    // --- Thread-local batch in progress ---
+    std::array<G4double, kNQuantities> fBatchSum{};
+    std::array<G4int, kNQuantities> fBatchEvents{};
+    G4bool fAborted = false;
+
+    static std::array<BatchStatistics, kNQuantities> fRunTotals;
+    static std::atomic<G4bool> fStop; ///< Shared stop flag
+};
+
+#endif
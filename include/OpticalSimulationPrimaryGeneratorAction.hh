@@ -9,27 +9,38 @@
  *
  * This class controls the generation of primary particles in the Geant4
  * simulation.
+ *
+ * For cheap events (low-energy gamma/beta backgrounds) several independent
+ * GPS primaries can be packed in one G4Event with
+ * /OpticalSimulation/generator/setPrimariesPerEvent: each primary is a
+ * sub-event with its own tallies and tree entries (subevent branch), so the
+ * per-event overhead is paid once per batch. The sampling modes acting on
+ * the primary (response matrix, uniformity map, QMC, adjoint LCE, step
+ * replay) keep one primary per event.
  */
 
 #include "G4GeneralParticleSource.hh"
+#include "G4GenericMessenger.hh"
 #include "G4VUserPrimaryGeneratorAction.hh"
 #include "OpticalSimulationRunAction.hh"
 
 // Forward declarations
 class G4ParticleGun;
 class G4Event;
+class OpticalSimulationResponseMatrix;
+class OpticalSimulationUniformityMap;
+class OpticalSimulationQuasiRandom;
+class OpticalSimulationLightCollectionMap;
+class OpticalSimulationStepReplay;
+class OpticalSimulationWatchdog;
 
 class OpticalSimulationPrimaryGeneratorAction
     : public G4VUserPrimaryGeneratorAction {
   public:
     /**
      * @brief Constructor.
-     * @param N Number of events to generate.
-     * @param numThreads Number of threads in multithreaded mode.
-     * @param pMT Flag to enable multithreading.
      */
-    OpticalSimulationPrimaryGeneratorAction(size_t N, size_t numThreads,
-                                            bool pMT);
+    OpticalSimulationPrimaryGeneratorAction();
 
     /**
      * @brief Destructor.
@@ -42,33 +53,58 @@ class OpticalSimulationPrimaryGeneratorAction
      */
     void GeneratePrimaries(G4Event *anEvent) override;
 
+    /// Response matrix overriding the GPS particle and energy when enabled
+    void SetResponseMatrix(OpticalSimulationResponseMatrix *matrix) {
+        fResponseMatrix = matrix;
+    }
+
+    /// Uniformity map moving the GPS source over the ZnS face when enabled
+    void SetUniformityMap(OpticalSimulationUniformityMap *map) {
+        fUniformityMap = map;
+    }
+
+    /// Sobol sampler overriding the direction or the whole primary
+    void SetQuasiRandom(OpticalSimulationQuasiRandom *qmc) {
+        fQuasiRandom = qmc;
+    }
+
+    /// Light-collection map replacing the primary by adjoint photons
+    void SetLightCollectionMap(OpticalSimulationLightCollectionMap *map) {
+        fLightCollectionMap = map;
+    }
+
+    /// Step replay replacing GPS by the photons of recorded steps
+    void SetStepReplay(OpticalSimulationStepReplay *replay) {
+        fStepReplay = replay;
+    }
+
+    /// Watchdog restoring the random status of a replayed outlier
+    void SetWatchdog(OpticalSimulationWatchdog *watchdog) {
+        fWatchdog = watchdog;
+    }
+
+    /// Primaries (sub-events) of the last generated event
+    G4int GetBatchSize() const { return fBatchSize; }
+
   private:
     G4GeneralParticleSource *particleSource =
         nullptr; /**< General particle source */
+    OpticalSimulationResponseMatrix *fResponseMatrix =
+        nullptr; /**< Response matrix mode */
+    OpticalSimulationUniformityMap *fUniformityMap =
+        nullptr; /**< Uniformity map mode */
+    OpticalSimulationQuasiRandom *fQuasiRandom =
+        nullptr; /**< Quasi-Monte-Carlo mode */
+    OpticalSimulationLightCollectionMap *fLightCollectionMap =
+        nullptr; /**< Adjoint light-collection mode */
+    OpticalSimulationStepReplay *fStepReplay =
+        nullptr; /**< Ionisation step replay mode */
+    OpticalSimulationWatchdog *fWatchdog =
+        nullptr; /**< Replay of watchdog outliers */
 
-    /**
-     * @brief Display progress of event generation.
-     * @param progress Current progress (0.0–1.0).
-     * @param startTime Time when event generation started.
-     */
-    static void
-    ShowProgress(double progress,
-                 std::chrono::high_resolution_clock::time_point startTime);
-
-    size_t NEventsGenerated = 0; /**< Number of events already generated */
-    size_t currentEvent = 0;     /**< Current event index */
-    size_t numThreads = 0;       /**< Number of threads */
-    bool flag_MT = false;        /**< Flag indicating multithreading mode */
-    int threadID = 0;            /**< Thread ID */
-    int eventID = 0;             /**< Event ID */
-    int nEvent = 0;              /**< Number of events processed */
-    std::chrono::duration<double> elapsedTime; /**< Elapsed time since start */
-    bool isStartTimeInitialized =
-        false; /**< Flag indicating start time initialized */
-    std::chrono::high_resolution_clock::time_point startTime; /**< Start time */
-    double progressRemaining = 0.;      /**< Remaining progress fraction */
-    double averageTimePerProgress = 0.; /**< Average time per progress step */
-    double estimatedRemainingTime = 0.; /**< Estimated remaining time (s) */
+    G4GenericMessenger *fMessenger = nullptr; /**< UI commands */
+    G4int fPrimariesPerEvent = 1; /**< Requested primaries per event */
+    G4int fBatchSize = 1;         /**< Primaries of the current event */
 };
 
 #endif
@@ -0,0 +1,154 @@
+#ifndef OpticalSimulationQuasiRandom_h
+#define OpticalSimulationQuasiRandom_h 1
+
+/**
+ * @class OpticalSimulationQuasiRandom
+ * @brief Scrambled Sobol sampling with randomized-QMC error estimates.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Events are shared between R independent replicates (replicate =
+ * eventID % R). Every replicate uses its own nested uniform (Owen-type)
+ * scrambling of the Sobol sequence and walks through the points with index
+ * eventID / R. Since event IDs are unique over the run, the threads draw
+ * disjoint points of every stream whatever the scheduling. An event offset
+ * continues the sequences of a previous run (statistics top-up).
+ *
+ * Dimensions are assigned as follows: position (u, v, w), direction
+ * (cos theta, phi), wavelength, polarization angle.
+ *
+ * The sampler is used by:
+ *  - the primary generator: direction override (isotropic or forward
+ *    hemisphere) and photon-emission scans, where the primary becomes an
+ *    optical photon emitted in the ZnS:Ag or in the scintillator with a
+ *    wavelength drawn from the emission spectrum of the material;
+ *  - the uniformity map (sampling "sobol") for the source position.
+ *
+ * Each replicate accumulates the detected photons and the events with at
+ * least one detected photon; the spread of the replicate means gives the
+ * randomized-QMC uncertainty.
+ *
+ * Commands are available under /OpticalSimulation/qmc/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4ThreeVector.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationEventAction.hh"
+#include "OpticalSimulationRunTotals.hh"
+#include <cstdint>
+#include <vector>
+
+class G4Event;
+class TFile;
+class OpticalSimulationGeometryConstruction;
+
+class OpticalSimulationQuasiRandom {
+  public:
+    /// Dimensions of the Sobol sequence
+    enum Dimension {
+        kPositionU = 0,
+        kPositionV,
+        kPositionW,
+        kDirectionCosTheta,
+        kDirectionPhi,
+        kWavelength,
+        kPolarization,
+        kNDimensions
+    };
+
+    /// Per-replicate sums, flattened as [tally][replicate]
+    enum Tally { kEvents = 0, kDetected, kFired, kNTallies };
+
+    struct Results {
+        std::vector<G4double> sums[kNTallies];
+
+        void Reset(size_t nReplicates);
+        /// Empty the counts, keeping the buffers (Python views)
+        void Clear();
+        /// Add @p other (adopts its layout when this one is empty)
+        void Merge(const Results &other);
+    };
+
+    /** Constructor: declares the QMC UI commands */
+    OpticalSimulationQuasiRandom();
+
+    /** Destructor */
+    ~OpticalSimulationQuasiRandom();
+
+    /// Geometry providing the emission volumes of the photon scans
+    void SetGeometry(OpticalSimulationGeometryConstruction *geom) {
+        fGeometry = geom;
+    }
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    /// Scrambled Sobol coordinate in (0, 1) of an event
+    G4double Sample(G4long eventID, G4int dimension) const;
+
+    /// Replicate of an event
+    G4int Replicate(G4long eventID) const {
+        return (eventID + fEventOffset) % fReplicates;
+    }
+
+    /// Override the direction and, in photon scans, the whole primary
+    void SamplePrimary(G4Event *event) const;
+
+    /// Prepare the emission spectrum and reset the replicate sums
+    void BeginOfRun();
+
+    /// Accumulate one event in its replicate
+    void Fill(const RunTallyEvent &event, G4long eventID);
+
+    /// Fold the thread-local sums into the run totals (thread-safe)
+    void MergeIntoRunTotals() const;
+
+    /// Reset the run totals (master, at the start of a run)
+    static void ResetRunTotals();
+
+    /// Totals merged over all threads (valid after the end of the run)
+    static const Results &GetRunTotals() { return RunTotals::Get(); }
+
+    /// Add the totals stored in a previous output (master, statistics top-up)
+    void LoadRunTotals(TFile *file) const;
+
+    /// Print the replicate means and the randomized-QMC uncertainties
+    void PrintRunTotals() const;
+
+    /// Write the per-replicate sums in the given file
+    void WriteRunTotals(TFile *file) const;
+
+  private:
+    friend class OpticalSimulationQuasiRandomTest; ///< Unit tests
+
+    /// Unscrambled Sobol coordinate (32-bit integer) of point @p index
+    static std::uint32_t Sobol(std::uint32_t index, G4int dimension);
+
+    /// Nested uniform scrambling of a 32-bit coordinate
+    static std::uint32_t Scramble(std::uint32_t x, std::uint32_t seed);
+
+    /// Isotropic or forward direction from two coordinates
+    G4ThreeVector Direction(G4double u, G4double v) const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+    OpticalSimulationGeometryConstruction *fGeometry = nullptr;
+
+    // --- Configuration ---
+    G4bool fEnabled = false;
+    G4int fReplicates = 8;        ///< Number of independent scramblings
+    G4int fSeed = 12345;          ///< Seed of the scramblings
+    G4long fEventOffset = 0;      ///< Events already sampled (top-up)
+    G4String fDirection = "gps";  ///< gps, isotropic or forward
+    G4String fPhotonScan = "off"; ///< off, ZnS or Scintillator
+
+    // --- Emission spectrum of the photon scans (inverse CDF) ---
+    std::vector<G4double> fEmissionEnergy;
+    std::vector<G4double> fEmissionCDF;
+
+    Results fLocal; ///< Thread-local accumulators
+
+    /// Totals merged over threads
+    using RunTotals = OpticalSimulationRunTotals<Results>;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef OpticalSimulationQuenching_h
+#define OpticalSimulationQuenching_h 1
+
+/**
+ * @class OpticalSimulationQuenching
+ * @brief Precomputed particle-dependent light yield of ZnS:Ag and EJ-212.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * With the scintillation by particle type of Geant4
+ * (/process/optical/scintillation/setByParticleType true, before
+ * /run/initialize), G4Scintillation takes the light of a step from a table
+ * of the light L(E) of a particle fully stopped from the kinetic energy E:
+ * L(pre-step energy) - L(pre-step energy - deposit), a lookup instead of
+ * a Birks correction on the step. This class fills those tables
+ * (ELECTRON, PROTON, DEUTERON, TRITON, ALPHA and ION SCINTILLATIONYIELD)
+ * at the start of each run, from the SCINTILLATIONYIELD of the material:
+ *
+ *  - Birks/Chou parameters: L(E) = Y int_0^E dE / (1 + kB S + C S^2), with
+ *    S the electronic stopping power of the particle (G4EmCalculator);
+ *  - or a measured quenching factor Q(E) (light relative to Y E) for one
+ *    particle: L(E) = Y Q(E) E.
+ *
+ * The other scintillation constants (component yields and time constants)
+ * are copied to every particle. Ions heavier than the alpha use the alpha
+ * stopping power.
+ *
+ * Commands are available under /OpticalSimulation/quenching/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include <map>
+#include <vector>
+
+class G4Material;
+class G4ParticleDefinition;
+
+class OpticalSimulationQuenching {
+  public:
+    /// Particle types of the G4Scintillation yields
+    enum Particle {
+        kElectron = 0,
+        kProton,
+        kDeuteron,
+        kTriton,
+        kAlpha,
+        kIon,
+        kNParticles
+    };
+
+    /// Shared instance (created with the physics list)
+    static OpticalSimulationQuenching *getInstance();
+
+    /** Destructor */
+    ~OpticalSimulationQuenching();
+
+    /// Fill the light tables of the scintillators (master, start of run)
+    void BuildTables();
+
+    /// Particle type of a PDG code, as chosen by G4Scintillation
+    static Particle ParticleOf(G4int pdg);
+
+    /// Material property holding the light table L(E) of a particle type
+    static G4String YieldProperty(G4int particle);
+
+  private:
+    /** Constructor: default parameters and UI commands */
+    OpticalSimulationQuenching();
+
+    /// Quenching parameters of one material
+    struct Parameters {
+        G4double birks = 0.; ///< kB
+        G4double chou = 0.;  ///< C
+        G4String measured[kNParticles]; ///< Quenching factor files
+    };
+
+    /// Set the Birks/Chou parameters ("material kB [C]", mm/MeV)
+    void SetBirks(const G4String &value);
+
+    /// Use a measured quenching factor ("material particle file")
+    void SetMeasured(const G4String &value);
+
+    /// Print the light of each particle relative to the electron
+    void Print();
+
+    /// Fill the tables of one material
+    void BuildTables(G4Material *material, const Parameters &parameters);
+
+    /// Light L(E) on the energy grid from the Birks/Chou integral
+    std::vector<G4double> Integrate(const G4ParticleDefinition *particle,
+                                    const G4Material *material,
+                                    const Parameters &parameters,
+                                    G4double yield) const;
+
+    /// Light L(E) on the energy grid from a quenching factor file
+    std::vector<G4double> ReadMeasured(const G4String &file,
+                                       G4double yield) const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    std::map<G4String, Parameters> fParameters; ///< Per material name
+    std::vector<G4double> fEnergies;           ///< Energy grid
+};
+
+#endif
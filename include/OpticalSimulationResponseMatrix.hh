@@ -0,0 +1,131 @@
+#ifndef OpticalSimulationResponseMatrix_h
+#define OpticalSimulationResponseMatrix_h 1
+
+/**
+ * @class OpticalSimulationResponseMatrix
+ * @brief Detector response matrix builder.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * In response-matrix mode the primary generator keeps the GPS position and
+ * direction but overrides the particle and its energy: events are shared
+ * evenly between the requested particles (alpha, e-, gamma) and between the
+ * true energy bins, the energy being uniform (or log-uniform) inside the bin.
+ * For every particle and true energy bin the number of thrown events and the
+ * distributions of the ZnS deposit, scintillator deposit, detected photons
+ * and event class are accumulated.
+ *
+ * Accumulation is thread-local and merged at the end of the run like the
+ * classifier; the master writes raw-count histograms which are folded with
+ * any source spectrum by the OpticalSimulationFold tool.
+ *
+ * Commands are available under /OpticalSimulation/response/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationEventAction.hh"
+#include "OpticalSimulationRunTotals.hh"
+#include <vector>
+
+class G4Event;
+class TFile;
+
+class OpticalSimulationResponseMatrix {
+  public:
+    /// Observables stored for every true energy bin
+    enum Observable {
+        kDepositZnS = 0,
+        kDepositSc,
+        kPhotons,
+        kClass,
+        kNObservables
+    };
+
+    /**
+     * @struct Results
+     * @brief Mergeable counts, flattened as [particle][true bin][obs bin].
+     */
+    struct Results {
+        std::vector<G4long> thrown;                ///< [particle][true bin]
+        std::vector<G4long> counts[kNObservables]; ///< Response counts
+
+        void Reset(size_t nParticles, size_t nTrue,
+                   const std::vector<G4int> &nObs);
+        /// Empty the counts, keeping the buffers (Python views)
+        void Clear();
+        /// Add @p other (adopts its layout when this one is empty)
+        void Merge(const Results &other);
+    };
+
+    /** Constructor: declares the response UI commands */
+    OpticalSimulationResponseMatrix();
+
+    /** Destructor */
+    ~OpticalSimulationResponseMatrix();
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    /// Override the particle and energy of the GPS primary
+    void SamplePrimary(G4Event *event) const;
+
+    /// Accumulate one classified event
+    void Fill(const RunTallyEvent &event);
+
+    /// Reset the thread-local accumulators at the start of a run
+    void BeginOfRun();
+
+    /// Fold the thread-local accumulators into the run totals (thread-safe)
+    void MergeIntoRunTotals() const;
+
+    /// Reset the run totals (master, at the start of a run)
+    static void ResetRunTotals();
+
+    /// Totals merged over all threads (valid after the end of the run)
+    static const Results &GetRunTotals() { return RunTotals::Get(); }
+
+    /// Add the totals stored in a previous output (master, statistics top-up)
+    void LoadRunTotals(TFile *file) const;
+
+    /// Write the run totals as count histograms in the given file
+    void WriteRunTotals(TFile *file) const;
+
+    static const char *ObservableName(G4int obs);
+
+  private:
+    /// Decode the space separated list of particles
+    void SetParticles(G4String list);
+
+    /// Lower edges of the true energy bins (nTrue + 1 values) [keV]
+    std::vector<G4double> TrueEdges() const;
+
+    /// Number of bins and upper edge of each observable
+    std::vector<G4int> ObservableBins() const;
+    G4double ObservableMax(G4int obs) const;
+
+    /// Index of the particle / true bin of an event, -1 if outside
+    G4int ParticleIndex(G4int pdg) const;
+    G4int TrueBin(G4double energy) const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    // --- Configuration ---
+    G4bool fEnabled = false;
+    G4String fParticleList = "alpha e- gamma";
+    std::vector<G4String> fParticles;
+    std::vector<G4int> fParticlePDG;
+    G4double fMinEnergy;         ///< Lower edge of the true energy range
+    G4double fMaxEnergy;         ///< Upper edge of the true energy range
+    G4int fEnergyBins = 50;      ///< Number of true energy bins
+    G4bool fLogBins = true;      ///< Logarithmic true energy binning
+    G4int fDepositBins = 500;    ///< Bins of the deposit observables
+    G4double fMaxDeposit;        ///< Upper edge of the deposit observables
+    G4int fPhotonBins = 500;     ///< Bins (and upper edge) of the photons
+
+    Results fLocal; ///< Thread-local accumulators
+
+    /// Totals merged over threads
+    using RunTotals = OpticalSimulationRunTotals<Results>;
+};
+
+#endif
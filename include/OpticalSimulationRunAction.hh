@@ -32,10 +32,22 @@
 #include "G4RunManager.hh"
 #include "G4UImanager.hh"     // UI manager (for commands)
 #include "G4UserRunAction.hh" // Base class for user-defined run actions
+#include "G4GenericMessenger.hh" // UI commands for the output control
 #include "G4VVisManager.hh"   // Visualization manager
+#include "OpticalSimulationClassifier.hh"
 #include "OpticalSimulationEventAction.hh"
+#include "OpticalSimulationEventStream.hh"
 #include "OpticalSimulationGeometryConstruction.hh"
+#include "OpticalSimulationLightCollectionMap.hh"
+#include "OpticalSimulationMonitor.hh"
+#include "OpticalSimulationPrecisionMonitor.hh"
 #include "OpticalSimulationPrimaryGeneratorAction.hh"
+#include "OpticalSimulationQuasiRandom.hh"
+#include "OpticalSimulationResponseMatrix.hh"
+#include "OpticalSimulationStepReplay.hh"
+#include "OpticalSimulationSymmetry.hh"
+#include "OpticalSimulationUniformityMap.hh"
+#include "OpticalSimulationWatchdog.hh"
 #include "TBranch.h"
 #include "TFile.h" // ROOT file I/O
 #include "TTree.h"
@@ -69,15 +81,19 @@ class OpticalSimulationRunAction : public G4UserRunAction {
     /// Called at the end of each run
     void EndOfRunAction(const G4Run *run) override;
 
-    /// Generic template to update cumulative statistics in a ROOT tree
-    template <typename T>
-    static void UpdateStatistics(T &stats, const T &newStats, TTree *tree);
+    /// Fill the trees with the records (sub-events) of an event, under one
+    /// lock; the records are emptied. The optical records are left out
+    /// for an aborted event.
+    void UpdateStatisticsRecords(std::vector<RunTallyRecord> &records,
+                                 G4bool optical = true);
 
-    // --- Specific statistics update methods ---
-    void UpdateStatisticsInput(RunTallyInput);
-    void UpdateStatisticsZnS(RunTallySc);
-    void UpdateStatisticsScintillator(RunTallySc);
-    void UpdateStatisticsOptical(RunTallyOptical);
+    void UpdateStatisticsSteps(const RunTallyInput &, G4int sourcePDG);
+
+    /// Log a watchdog outlier and fill the Outliers tree with it
+    void UpdateStatisticsOutlier(const G4Event *event);
+
+    /// Key written with the tree entries of the current event
+    void SetEventKey(const G4Event *event);
 
     /// Set the primary generator reference
     void SetPrimaryGenerator(OpticalSimulationPrimaryGeneratorAction *gen);
@@ -85,7 +101,74 @@ class OpticalSimulationRunAction : public G4UserRunAction {
     /// Set the geometry reference
     void SetGeometry(OpticalSimulationGeometryConstruction *geom);
 
+    /// Thread-local in-run classifier
+    OpticalSimulationClassifier &GetClassifier() { return fClassifier; }
+
+    /// Thread-local precision monitor (early run termination)
+    OpticalSimulationPrecisionMonitor &GetPrecisionMonitor() {
+        return fPrecisionMonitor;
+    }
+
+    /// Thread-local response matrix builder
+    OpticalSimulationResponseMatrix &GetResponseMatrix() {
+        return fResponseMatrix;
+    }
+
+    /// Thread-local efficiency map over the ZnS face
+    OpticalSimulationUniformityMap &GetUniformityMap() {
+        return fUniformityMap;
+    }
+
+    /// Thread-local scrambled Sobol sampler (RQMC replicates)
+    OpticalSimulationQuasiRandom &GetQuasiRandom() { return fQuasiRandom; }
+
+    /// Thread-local forward/adjoint light-collection maps
+    OpticalSimulationLightCollectionMap &GetLightCollectionMap() {
+        return fLightCollectionMap;
+    }
+
+    /// Thread-local ionisation step record and replay
+    OpticalSimulationStepReplay &GetStepReplay() { return fStepReplay; }
+
+    /// Thread-local per-event watchdog
+    OpticalSimulationWatchdog &GetWatchdog() { return fWatchdog; }
+
+    /// Shared-memory stream of the finished events
+    const OpticalSimulationEventStream &GetEventStream() const {
+        return fEventStream;
+    }
+
+    /// Live progress and online histograms
+    const OpticalSimulationMonitor &GetMonitor() const { return fMonitor; }
+
   private:
+    /// Refuse a run with more than one mode overriding the primary
+    void CheckSamplers() const;
+
+    /// Seed the engine with an independent stream for this run and thread
+    void SeedRun(const G4Run *run, G4int index);
+
+    /// Read the bookkeeping and run totals of the output being extended
+    void LoadTopUpInput();
+
+    /// Write the configuration and seed bookkeeping (master)
+    void WriteBookkeeping(const G4Run *run);
+
+    /// Create the event trees in the current directory
+    void CreateTrees();
+
+    /// Event trees of this thread (Steps only when recording)
+    std::vector<TTree *> Trees() const;
+
+    /// Open the next chunk file of this thread
+    void OpenChunk(const G4Run *run);
+
+    /// Write the current chunk and list it in the manifest
+    void CloseChunk();
+
+    /// Count an event in the current chunk, rolling over when it is full
+    void RollOverChunk(G4int eventID);
+
     // --- Output configuration ---
     G4String suffixe;  ///< File suffix for ROOT outputs
     G4String fileName; ///< Base file name for ROOT outputs
@@ -95,22 +178,57 @@ class OpticalSimulationRunAction : public G4UserRunAction {
     RunTallySc StatsZnS;
     RunTallySc StatsScintillator;
     RunTallyOptical StatsOptical;
+    RunTallyKey StatsKey;
 
     size_t NEventsGenerated; ///< Number of events generated in the run
     G4bool flag_MT;          ///< Multithreading enabled flag
 
+    // --- Run-level results ---
+    G4GenericMessenger *fMessenger = nullptr; ///< /OpticalSimulation/run/
+    G4bool WriteTrees = true; ///< Fill the per-event trees
+    OpticalSimulationClassifier fClassifier; ///< In-run classifier
+    OpticalSimulationPrecisionMonitor fPrecisionMonitor; ///< Early stop
+    OpticalSimulationResponseMatrix fResponseMatrix;     ///< Response matrix
+    OpticalSimulationUniformityMap fUniformityMap;       ///< Uniformity map
+    OpticalSimulationSymmetry fSymmetry; ///< Symmetry of position studies
+    OpticalSimulationQuasiRandom fQuasiRandom; ///< Sobol sampling
+    OpticalSimulationLightCollectionMap fLightCollectionMap; ///< LCE maps
+    OpticalSimulationStepReplay fStepReplay;   ///< Step record and replay
+    OpticalSimulationWatchdog fWatchdog;       ///< Per-event budgets
+    OpticalSimulationEventStream fEventStream; ///< Live event stream
+    OpticalSimulationMonitor fMonitor;         ///< Progress and HTTP endpoint
+
+    // --- Seeds and statistics top-up ---
+    G4long fSeed = 0;              ///< Base seed (0: CPU clock, first run)
+    G4int fSeedSegment = 0;        ///< Job index within an extended output
+    G4String fTopUpInput = "none"; ///< Output extended by the next runs
+    G4String fConfiguration;       ///< Configuration of the extended output
+    G4String fSeedRecord;          ///< Seeds of the extended output
+
+    // --- Chunked output ---
+    G4int fChunkMaxEvents = 0;     ///< Events per chunk (0: no limit)
+    G4int fChunkMaxSize = 0;       ///< Compressed MB per chunk (0: no limit)
+    TFile *fChunkFile = nullptr;   ///< Current chunk of this thread
+    G4String fChunkName;           ///< File name of the current chunk
+    G4int fChunkIndex = 0;         ///< Index of the next chunk
+    G4int fChunkRun = 0;           ///< Run of the current chunk
+    G4long fChunkEntries = 0;      ///< Events in the current chunk
+    G4int fChunkFirstEvent = -1;   ///< First event of the current chunk
+    G4int fChunkLastEvent = -1;    ///< Last event of the current chunk
+
     // --- ROOT file and trees ---
     TFile *f = nullptr;
     TTree *Tree_Input = nullptr;
     TTree *Tree_ZnS = nullptr;
     TTree *Tree_Scintillator = nullptr;
     TTree *Tree_Optical = nullptr;
+    TTree *Tree_Steps = nullptr;
+    TTree *Tree_Outliers = nullptr; ///< Watchdog outliers (run file)
     TBranch *RunBranch = nullptr;
 
     time_t start; ///< Start time of the run
 
     // --- Thread-safety ---
-    static std::atomic<int> activeThreads;
     static G4Mutex fileMutex;
 
   protected:
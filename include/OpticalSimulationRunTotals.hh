@@ -0,0 +1,84 @@
+#ifndef OpticalSimulationRunTotals_h
+#define OpticalSimulationRunTotals_h 1
+
+/**
+ * @class OpticalSimulationRunTotals
+ * @brief Run totals of an accumulator, merged over the threads.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The run-level accumulators (classifier, response matrix, uniformity map,
+ * QMC replicates, light-collection maps) fill thread-local Results during
+ * the run. Every thread merges them into one static total at the end of
+ * the run, the master reads, prints and writes it. This class holds that
+ * total and its mutex for one Results type, which provides:
+ *  - Merge(const Results &): add other results,
+ *  - Clear(): empty the results (start of a run).
+ *
+ * AddTally() and AddTallies() implement Merge() for results flattened in
+ * vectors: an empty result adopts the layout of the added one, results of
+ * different layouts are not added.
+ */
+
+#include "G4AutoLock.hh"
+#include "G4Types.hh"
+#include <vector>
+
+template <typename Results> class OpticalSimulationRunTotals {
+  public:
+    /// Add thread-local (or stored) results to the totals (thread-safe)
+    static void Merge(const Results &results) {
+        G4AutoLock lock(&fMutex);
+        fTotals.Merge(results);
+    }
+
+    /// Empty the totals (master, at the start of a run)
+    static void Clear() {
+        G4AutoLock lock(&fMutex);
+        fTotals.Clear();
+    }
+
+    /// Totals merged over all threads (valid after the end of the run)
+    static const Results &Get() { return fTotals; }
+
+  private:
+    static Results fTotals; ///< Totals merged over threads
+    static G4Mutex fMutex;  ///< Protects the totals during the merges
+};
+
+template <typename Results>
+Results OpticalSimulationRunTotals<Results>::fTotals;
+
+template <typename Results>
+G4Mutex OpticalSimulationRunTotals<Results>::fMutex = G4MUTEX_INITIALIZER;
+
+/**
+ * @brief Add @p from to @p into element by element.
+ *
+ * An empty @p into adopts the length of @p from.
+ * @return False, nothing added, when the lengths differ
+ */
+template <typename T>
+G4bool AddTally(std::vector<T> &into, const std::vector<T> &from) {
+    if (into.empty())
+        into.assign(from.size(), T());
+    if (into.size() != from.size())
+        return false;
+    for (size_t i = 0; i < into.size(); ++i)
+        into[i] += from[i];
+    return true;
+}
+
+/// AddTally() over an array of tallies, nothing added unless every
+/// non-empty tally has the length of the added one
+template <typename T, size_t N>
+G4bool AddTallies(std::vector<T> (&into)[N], const std::vector<T> (&from)[N]) {
+    for (size_t t = 0; t < N; ++t)
+        if (!into[t].empty() && into[t].size() != from[t].size())
+            return false;
+    for (size_t t = 0; t < N; ++t)
+        AddTally(into[t], from[t]);
+    return true;
+}
+
+#endif
@@ -0,0 +1,94 @@
+#ifndef OpticalSimulationScanDriver_h
+#define OpticalSimulationScanDriver_h 1
+
+/**
+ * @class OpticalSimulationScanDriver
+ * @brief Energy/position scans with adaptive event allocation.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * A scan point is a list of UI commands (typically /gps/... commands) applied
+ * before its runs. The driver first simulates a pilot batch at every point
+ * to estimate the per-event variance of the detection efficiency and the CPU
+ * cost per event, then shares the remaining budget between the points:
+ *  - **equalize**: n_i proportional to the variance, so that all points end
+ *    with the same relative uncertainty;
+ *  - **minimize**: n_i proportional to sigma_i / sqrt(c_i) (Neyman
+ *    allocation), which minimizes the sum of the squared relative
+ *    uncertainties for the given budget.
+ *
+ * The geometry initialized by the run manager is reused for every point.
+ * The driver lives on the master thread and is created in main; commands
+ * are available under /OpticalSimulation/scan/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationClassifier.hh"
+#include <vector>
+
+class OpticalSimulationScanDriver {
+  public:
+    /**
+     * @brief Constructor.
+     * @param name Base name of the output files
+     * @param nThreads Number of worker threads
+     * @param pMT True if running with multithreading
+     */
+    OpticalSimulationScanDriver(const G4String &name, size_t nThreads,
+                                G4bool pMT);
+
+    /** Destructor */
+    ~OpticalSimulationScanDriver();
+
+    /// True once a scan has been run (main then skips its own beamOn)
+    G4bool HasRun() const { return fHasRun; }
+
+    /// Run the pilot and adaptive passes over all the points
+    void Run();
+
+  private:
+    /// State of one scan point
+    struct ScanPoint {
+        std::vector<G4String> commands; ///< UI commands defining the point
+        OpticalSimulationClassifier::Results results; ///< Summed over runs
+        G4long events = 0;     ///< Events simulated so far
+        G4double seconds = 0.; ///< Wall time spent so far
+        G4long allocated = 0;  ///< Events allocated to the second pass
+    };
+
+    /// Add a point from a ';' separated list of UI commands
+    void AddPoint(G4String commands);
+    void ClearPoints() { fPoints.clear(); }
+
+    /// Apply the point commands and simulate @p nEvents events
+    void Simulate(size_t index, G4long nEvents, const G4String &pass);
+
+    /// Monitored efficiency and its relative variance per simulated event
+    G4double Efficiency(const ScanPoint &point) const;
+    G4double RelativeVariance(const ScanPoint &point) const;
+
+    /// Share the budget between the points after the pilot pass
+    void Allocate();
+
+    /// Print the scan summary and write it as a CSV file
+    void Report() const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    G4String fName;
+    size_t fNThreads = 0;
+    G4bool flag_MT = false;
+    G4bool fHasRun = false;
+
+    // --- Configuration ---
+    G4int fPilotEvents = 1000;         ///< Pilot events per point
+    G4double fBudget = 3600.;          ///< Wall time budget after pilot [s]
+    G4long fMaxEvents = 100000000;     ///< Cap on the events of one point
+    G4String fAllocation = "equalize"; ///< "equalize" or "minimize"
+    G4String fQuantity = "efficiency"; ///< Monitored efficiency
+
+    std::vector<ScanPoint> fPoints;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef OpticalSimulationServer_h
+#define OpticalSimulationServer_h 1
+
+/**
+ * @class OpticalSimulationServer
+ * @brief Warm simulation server accepting jobs over a Unix-domain socket.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The executable is initialized once (materials, geometry, physics tables,
+ * threads), then jobs are read from a local socket and run back-to-back on
+ * the same run manager. A job is a text block, one keyword per line:
+ *
+ *     output <name>         output name (moved to ../Resultats)
+ *     events <N>            number of events
+ *     command <UI command>  any number, applied in order
+ *     run                   start the job
+ *
+ * Each `run` is answered by one line, `ok <name> <events> <seconds>` or
+ * `error <message>`. `ping` is answered by `ok ready` and `shutdown` stops
+ * the server after the current connection.
+ *
+ * Between jobs, the /OpticalSimulation/ commands changed by a job are set
+ * back to their value at server start, and the geometry is rebuilt only
+ * when the geometry parameters of a job differ from the built ones. A job
+ * using /gps/ commands is followed by a reset of the GPS sources and the
+ * replay of the /gps/ commands applied before the server start. Any other
+ * command (/run/, /process/, /control/...), or an /OpticalSimulation/
+ * command whose current value cannot be applied back (methods, per-face
+ * setWrapping), makes the job fail before anything is applied. Output names
+ * are restricted to [A-Za-z0-9_.-].
+ *
+ * The server lives on the master thread and is created in main; commands
+ * are available under /OpticalSimulation/server/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include <map>
+#include <vector>
+
+class OpticalSimulationServer {
+  public:
+    /**
+     * @brief Constructor.
+     * @param nThreads Number of worker threads
+     * @param pMT True if running with multithreading
+     */
+    OpticalSimulationServer(size_t nThreads, G4bool pMT);
+
+    /** Destructor */
+    ~OpticalSimulationServer();
+
+    /// True once the server has been run (main skips its own beamOn)
+    G4bool HasRun() const { return fHasRun; }
+
+    /// Listen on the socket until a shutdown request
+    void Start();
+
+  private:
+    /// Job read from the socket
+    struct Job {
+        G4String output = "job";
+        G4long events = 0;
+        std::vector<G4String> commands;
+    };
+
+    /// Run one job and return the reply line
+    G4String Run(const Job &job);
+
+    /// Handle the requests of one connection; false on shutdown
+    G4bool Serve(G4int connection);
+
+    /// Current values of the commands of a directory
+    static std::map<G4String, G4String> CurrentValues(const G4String &path);
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    size_t fNThreads = 0;
+    G4bool flag_MT = false;
+    G4bool fHasRun = false;
+
+    G4String fSocket = "/tmp/OpticalSimulation.sock"; ///< Socket path
+
+    std::map<G4String, G4String> fBaseline; ///< Values at server start
+    std::map<G4String, G4String> fBuiltGeometry; ///< Geometry of the world
+    std::vector<G4String> fSourceHistory; ///< /gps/ commands before start
+};
+
+#endif
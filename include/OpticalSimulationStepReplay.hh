@@ -0,0 +1,153 @@
+#ifndef OpticalSimulationStepReplay_h
+#define OpticalSimulationStepReplay_h 1
+
+/**
+ * @class OpticalSimulationStepReplay
+ * @brief Ionisation steps recorded once, replayed as optical photons.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The transport of the charged particles does not depend on the optical
+ * settings (light yield, Birks constant, emission spectra and time
+ * constants, surfaces). Two modes split the simulation accordingly:
+ *
+ *  - record: every energy-depositing step of a charged particle in ZnS:Ag
+ *    or EJ-212 is stored in a per-event `Steps` tree (volume, particle,
+ *    parent, pre/post positions and times, deposit, step length, pre-step
+ *    kinetic energy), together with the primary of the event. The
+ *    Scintillation process of the thread is inactivated for the run, so
+ *    that no optical photon is created (it is activated again by the next
+ *    run in another mode).
+ *  - replay: the GPS primary is replaced by the scintillation photons of
+ *    the recorded steps, generated from the material properties of the
+ *    current run as G4Scintillation does: Birks-quenched deposit times the
+ *    yield, or with the scintillation by particle type the light
+ *    L(E) - L(E - deposit) of the OpticalSimulationQuenching tables
+ *    (Poisson or Gaussian with RESOLUTIONSCALE), emission point and time
+ *    uniform along the step, exponential decay of the component drawn
+ *    from SCINTILLATIONYIELDk, wavelength from SCINTILLATIONCOMPONENTk.
+ *    The photons are counted as scintillation of their volume and the
+ *    primary and deposits of the recorded event are restored, so that the
+ *    Optical tree and the run-level results keep their meaning.
+ *
+ * Replay event i reads the recorded event i (modulo the number of recorded
+ * events). The replay input, a file or glob of recorded outputs, is loaded
+ * in memory by the master and shared read-only by the workers.
+ *
+ * Commands are available under /OpticalSimulation/replay/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4MaterialPropertyVector.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationEventAction.hh"
+#include "OpticalSimulationQuenching.hh"
+#include <vector>
+
+class G4Event;
+class G4Step;
+class TTree;
+
+class OpticalSimulationStepReplay {
+  public:
+    /// Volumes where the steps are recorded
+    enum Volume { kZnS = 0, kScintillator, kNVolumes };
+
+    /// One ionisation step (positions [mm], times [ns], deposit [keV])
+    struct Step {
+        G4int volume = 0;
+        G4int particle = 0; ///< PDG code
+        G4int parent = 0;   ///< Parent track ID
+        G4float pre[3] = {0.f, 0.f, 0.f};
+        G4float post[3] = {0.f, 0.f, 0.f};
+        G4float timePre = 0.f;
+        G4float timePost = 0.f;
+        G4float deposit = 0.f;
+        G4float length = 0.f; ///< Step length [mm]
+        G4float kinetic = 0.f; ///< Pre-step kinetic energy [keV]
+    };
+
+    /// Primary and steps of one recorded event
+    struct Event {
+        RunTallyInput input;
+        G4int sourcePDG = 0;
+        std::vector<Step> steps;
+    };
+
+    /** Constructor: declares the replay UI commands */
+    OpticalSimulationStepReplay();
+
+    /** Destructor */
+    ~OpticalSimulationStepReplay();
+
+    G4bool IsRecording() const { return fMode == "record"; }
+    G4bool IsReplaying() const { return fMode == "replay"; }
+
+    /// Create the Steps tree in the current directory (record mode)
+    TTree *CreateTree();
+
+    /// Switch the scintillation for the mode and read the scintillation
+    /// properties of the current materials
+    void BeginOfRun();
+
+    /// Load the recorded events of the replay input (master)
+    void LoadReplayInput() const;
+
+    /// Store an energy-depositing step of a charged particle
+    void Record(const G4Step *step, Volume volume);
+
+    /// Set the primary of the recorded event before the tree is filled
+    void SetEventInput(const RunTallyInput &input, G4int sourcePDG);
+
+    /// Forget the steps of the event once the tree is filled
+    void Clear();
+
+    /// Photons of the recorded steps as primaries (instead of GPS)
+    void SamplePrimary(G4Event *event);
+
+    /// Restore the primary and deposits of the replayed event
+    void RestoreEvent(RunTallyInput &input, RunTallySc &zns,
+                      RunTallySc &scintillator, G4int &sourcePDG) const;
+
+  private:
+    /// Scintillation properties of one material
+    struct Emission {
+        G4double yield = 0.;      ///< Photons per unit energy
+        G4double resolution = 1.; ///< RESOLUTIONSCALE
+        G4double birks = 0.;      ///< Birks constant
+        G4int nComponents = 0;
+        G4double fraction[3] = {0., 0., 0.}; ///< Cumulative component yield
+        G4double tau[3] = {0., 0., 0.};      ///< Decay time constants
+        G4MaterialPropertyVector *spectrum[3] = {nullptr, nullptr, nullptr};
+        G4double spectrumMax[3] = {0., 0., 0.};
+        /// Light tables L(E) by particle type (setByParticleType only)
+        G4MaterialPropertyVector
+            *light[OpticalSimulationQuenching::kNParticles] = {};
+        G4bool byParticle = false;
+    };
+
+    /// Add the photons of one recorded step to the event
+    void GeneratePhotons(const Step &step, G4Event *event) const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    // --- Configuration ---
+    G4String fMode = "off";   ///< off, record or replay
+    G4String fInput = "";     ///< Recorded output(s) replayed (glob)
+    G4bool fScintillationOff = false; ///< Inactivated by the record mode
+
+    Emission fEmission[kNVolumes]; ///< Properties of the current run
+
+    // --- Steps tree of the recorded event ---
+    RunTallyInput fInputRecord;
+    G4int fSourcePDG = 0;
+    std::vector<int> fVolume, fParticle, fParent;
+    std::vector<float> fPre[3], fPost[3], fTimePre, fTimePost, fDeposit,
+        fLength, fKinetic;
+
+    const Event *fCurrent = nullptr; ///< Event replayed by this thread
+
+    static std::vector<Event> fReplayEvents; ///< Replay input (master)
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef OpticalSimulationSymmetry_h
+#define OpticalSimulationSymmetry_h 1
+
+/**
+ * @class OpticalSimulationSymmetry
+ * @brief Transverse (x/y) symmetry group of the detector configuration.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The group is either declared or detected from the geometry:
+ *  - ZnS:Ag and scintillator centred on the z axis,
+ *  - PMT body of revolution: its axis and position decide which mirrors
+ *    of the holder frame leave it unchanged,
+ *  - wrapping: a mirror needs the same wrapping/finish on the two lateral
+ *    faces it exchanges,
+ *  - square layers (length == width) with the same wrapping on all four
+ *    lateral faces add the diagonal mirrors.
+ *
+ * Supported groups: none (order 1), mirror_x / mirror_y (order 2), d2
+ * (both mirrors, order 4) and d4 (square symmetry, order 8). Studies over
+ * emission or source positions only sample the fundamental domain and
+ * unfold their results over the orbits of the group.
+ *
+ * Commands are available under /OpticalSimulation/symmetry/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include <vector>
+
+class OpticalSimulationGeometryConstruction;
+
+class OpticalSimulationSymmetry {
+  public:
+    enum Group { kNone = 0, kMirrorX, kMirrorY, kD2, kD4, kNGroups };
+
+    /** Constructor: declares the symmetry UI commands */
+    OpticalSimulationSymmetry();
+
+    /** Destructor */
+    ~OpticalSimulationSymmetry();
+
+    /// Geometry used by the detection
+    void SetGeometry(OpticalSimulationGeometryConstruction *geom) {
+        fGeometry = geom;
+    }
+
+    /// Resolve the group of the current geometry (start of a run)
+    void Update();
+
+    /// Group detected from the geometry
+    G4int Detect() const;
+
+    G4int GetGroup() const { return fGroup; }
+    /// Number of elements of the group
+    G4int Order() const { return fElements.size(); }
+
+    /// Apply the k-th element of the group to (x, y)
+    void Apply(G4int k, G4double &x, G4double &y) const;
+
+    /// Move (x, y) into the fundamental domain
+    void Fold(G4double &x, G4double &y) const;
+
+    /**
+     * @brief Restrict the group to the one compatible with a grid of
+     * nx x ny cells centred on the axis (d4 needs a square grid).
+     */
+    void RestrictToGrid(G4int nx, G4int ny);
+
+    static const char *GroupName(G4int group);
+
+  private:
+    /// Signed permutation matrix acting on (x, y)
+    struct Element {
+        G4int xx, xy, yx, yy;
+    };
+
+    /// Elements of a group
+    static std::vector<Element> Elements(G4int group);
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+    OpticalSimulationGeometryConstruction *fGeometry = nullptr;
+
+    G4String fRequested = "none"; ///< auto, none, mirror_x, ... or d4
+    G4int fGroup = kNone;         ///< Group in use for the current run
+    std::vector<Element> fElements = Elements(kNone);
+};
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef OpticalSimulationTopUp_h
+#define OpticalSimulationTopUp_h 1
+
+/**
+ * @class OpticalSimulationTopUp
+ * @brief Statistics top-up: extend an existing result with more events.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Every output embeds its configuration (the canonical text of the result
+ * cache) and the seeds of its runs. A top-up of `../Resultats/<name>.root`:
+ *  - replays the embedded commands when the macro has not configured the
+ *    simulation itself, then requires the current configuration (commands,
+ *    parameters and input files) to be identical to the embedded one,
+ *  - simulates the additional events in a new seed segment: the base seed is
+ *    kept and the segment index follows those of the output, so that every
+ *    run draws a MixMax stream never used before,
+ *  - continues the QMC sequences after the events already simulated,
+ *  - adds the run-level results of the output to the new totals and appends
+ *    the new events to its trees.
+ *
+ * The driver lives on the master thread and is created in main; commands
+ * are available under /OpticalSimulation/topup/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+
+class OpticalSimulationTopUp {
+  public:
+    /**
+     * @brief Constructor.
+     * @param name Base name of the output files
+     * @param nThreads Number of worker threads
+     * @param pMT True if running with multithreading
+     * @param nEvents Events of the command line (default top-up size)
+     */
+    OpticalSimulationTopUp(const G4String &name, size_t nThreads, G4bool pMT,
+                           G4long nEvents);
+
+    /** Destructor */
+    ~OpticalSimulationTopUp();
+
+    /// True once a top-up has been run (main skips its own beamOn)
+    G4bool HasRun() const { return fHasRun; }
+
+    /// Add events to the output `<input>` of the results directory
+    void Extend(G4String input);
+
+  private:
+    /// Section `[name]` of a configuration text
+    static G4String Section(const G4String &configuration,
+                            const G4String &name);
+
+    /// Apply the commands of a configuration text
+    void Replay(const G4String &configuration) const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    G4String fName;
+    size_t fNThreads = 0;
+    G4bool flag_MT = false;
+    G4long fDefaultEvents = 0;
+    G4bool fHasRun = false;
+
+    G4long fEvents = 0;                  ///< Additional events (0: default)
+    G4String fDirectory = "../Resultats"; ///< Location of the outputs
+};
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef OpticalSimulationTrackTally_h
+#define OpticalSimulationTrackTally_h 1
+
+/**
+ * @class OpticalSimulationTrackTally
+ * @brief Per-track accumulation of the charged particles in ZnS and EJ-212.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Every charged track depositing energy in a volume gets one entry of the
+ * volume tree: entrance point, parent, particle and kinetic energy at its
+ * first step in the volume, and the energy it deposited there over its
+ * whole life. Interleaved tracks (delta rays, backscattered betas) are kept
+ * apart, and the entry is written when the track ends.
+ *
+ * The open tracks of the event are held in a small open-addressing table
+ * (linear probing, keyed on the track ID) pointing to pooled entries; the
+ * table and the pool keep their memory from one event to the next.
+ */
+
+#include "G4Types.hh"
+#include <vector>
+
+struct RunTallySc;
+
+class OpticalSimulationTrackTally {
+  public:
+    /// Volumes of the tallies
+    enum Volume { kZnS = 0, kScintillator, kNVolumes };
+
+    /// Forget the open tracks (start of event)
+    void Clear();
+
+    /**
+     * @brief Accumulate a step of a charged track in a volume.
+     * @param trackID Track ID
+     * @param volume Volume of the step
+     * @param subEvent Sub-event of the track
+     * @param parentID Parent track ID
+     * @param particleID PDG code
+     * @param x,y,z Pre-step position [mm]
+     * @param energy Pre-step kinetic energy [MeV]
+     * @param deposit Energy deposited by the step [keV]
+     */
+    void Step(G4int trackID, Volume volume, G4int subEvent, G4int parentID,
+              G4int particleID, G4float x, G4float y, G4float z,
+              G4float energy, G4float deposit);
+
+    /// Write the entries of an ending track to the volume tallies
+    void EndTrack(G4int trackID, RunTallySc &zns, RunTallySc &scintillator);
+
+    /// Write the tracks of a sub-event still open at the end of the event
+    void Flush(G4int subEvent, RunTallySc &zns, RunTallySc &scintillator);
+
+  private:
+    /// First step and deposit of a track in one volume
+    struct Crossing {
+        G4bool active = false;
+        G4float x = 0.f, y = 0.f, z = 0.f;
+        G4float energy = 0.f;
+        G4float deposit = 0.f;
+    };
+
+    /// Open track
+    struct Entry {
+        G4int trackID = 0;
+        G4int subEvent = 0;
+        G4int parentID = 0;
+        G4int particleID = 0;
+        Crossing crossing[kNVolumes];
+    };
+
+    /// Slot of a track ID in the table (empty slot if absent)
+    size_t Find(G4int trackID) const;
+
+    /// Pool entry of a track, created when absent
+    Entry &Acquire(G4int trackID);
+
+    /// Remove the slot of a track, shifting back its probe sequence
+    void Erase(size_t slot);
+
+    /// Double the table capacity
+    void Grow();
+
+    /// Append the crossings of an entry to the tallies
+    static void Write(const Entry &entry, RunTallySc &zns,
+                      RunTallySc &scintillator);
+
+    std::vector<G4int> fSlots; ///< Pool index per slot (-1: empty)
+    size_t fSize = 0;          ///< Open tracks
+    std::vector<Entry> fPool;  ///< Entries, reused over the events
+    std::vector<G4int> fFree;  ///< Free pool entries
+};
+
+#endif
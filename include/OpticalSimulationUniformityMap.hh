@@ -0,0 +1,148 @@
+#ifndef OpticalSimulationUniformityMap_h
+#define OpticalSimulationUniformityMap_h 1
+
+/**
+ * @class OpticalSimulationUniformityMap
+ * @brief Detection efficiency map over the ZnS:Ag face from a single run.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * In uniformity mode the primary generator keeps the GPS particle, energy
+ * and direction but moves the source over the entrance face of the ZnS:Ag
+ * layer, on a plane located at a given stand-off in front of it. Positions
+ * are stratified on a grid of cells (one cell per event in turn, uniform
+ * inside the cell), drawn uniformly over the face, or taken from the
+ * scrambled Sobol sequence of OpticalSimulationQuasiRandom.
+ *
+ * For every cell the thrown, detected, alpha-classified and beta-classified
+ * events are accumulated in thread-local arrays, merged at the end of the
+ * run, and written by the master as raw-count maps together with the
+ * efficiency maps and their binomial errors.
+ *
+ * With a symmetry group (see OpticalSimulationSymmetry) only the cells of
+ * the fundamental domain are sampled and every cell is unfolded from the
+ * counts of its orbit, dividing the number of events needed by the order of
+ * the group.
+ *
+ * Commands are available under /OpticalSimulation/uniformity/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include "OpticalSimulationEventAction.hh"
+#include "OpticalSimulationRunTotals.hh"
+#include <vector>
+
+class G4Event;
+class TFile;
+class OpticalSimulationGeometryConstruction;
+class OpticalSimulationQuasiRandom;
+class OpticalSimulationSymmetry;
+
+class OpticalSimulationUniformityMap {
+  public:
+    /// Quantities accumulated per cell
+    enum Tally { kThrown = 0, kDetected, kAlpha, kBeta, kNTallies };
+
+    /**
+     * @struct Results
+     * @brief Mergeable per-cell counts, flattened as [tally][cell].
+     */
+    struct Results {
+        std::vector<G4long> counts[kNTallies];
+
+        void Reset(size_t nCells);
+        /// Empty the counts, keeping the buffers (Python views)
+        void Clear();
+        /// Add @p other (adopts its layout when this one is empty)
+        void Merge(const Results &other);
+    };
+
+    /** Constructor: declares the uniformity UI commands */
+    OpticalSimulationUniformityMap();
+
+    /** Destructor */
+    ~OpticalSimulationUniformityMap();
+
+    /// Geometry providing the ZnS:Ag face dimensions
+    void SetGeometry(OpticalSimulationGeometryConstruction *geom) {
+        fGeometry = geom;
+    }
+
+    /// Symmetry used to sample the fundamental domain only
+    void SetSymmetry(OpticalSimulationSymmetry *symmetry) {
+        fSymmetry = symmetry;
+    }
+
+    /// Sobol sampler used by the "sobol" sampling
+    void SetQuasiRandom(const OpticalSimulationQuasiRandom *qmc) {
+        fQuasiRandom = qmc;
+    }
+
+    G4bool IsEnabled() const { return fEnabled; }
+
+    /// Move the GPS primary vertex over the ZnS:Ag face
+    void SamplePosition(G4Event *event) const;
+
+    /// Accumulate one classified event
+    void Fill(const RunTallyEvent &event);
+
+    /// Read the face dimensions and reset the thread-local arrays
+    void BeginOfRun();
+
+    /// Fold the thread-local arrays into the run totals (thread-safe)
+    void MergeIntoRunTotals() const;
+
+    /// Reset the run totals (master, at the start of a run)
+    static void ResetRunTotals();
+
+    /// Totals merged over all threads (valid after the end of the run)
+    static const Results &GetRunTotals() { return RunTotals::Get(); }
+
+    /// Add the totals stored in a previous output (master, statistics top-up)
+    void LoadRunTotals(TFile *file) const;
+
+    /// Print the mean efficiency and its non-uniformity
+    void PrintRunTotals() const;
+
+    /// Write the count and efficiency maps in the given file
+    void WriteRunTotals(TFile *file) const;
+
+  private:
+    /// Cell index of a position on the face, -1 if outside
+    G4int Cell(G4double x, G4double y) const;
+
+    /// Centre of a cell
+    void CellCentre(G4int cell, G4double &x, G4double &y) const;
+
+    /// Distinct cells of the orbit of a cell under the symmetry group
+    std::vector<G4int> Orbit(G4int cell) const;
+
+    /// Run totals summed over the orbit of every cell
+    Results Unfold() const;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+    OpticalSimulationGeometryConstruction *fGeometry = nullptr;
+    OpticalSimulationSymmetry *fSymmetry = nullptr;
+    const OpticalSimulationQuasiRandom *fQuasiRandom = nullptr;
+
+    // --- Configuration ---
+    G4bool fEnabled = false;
+    G4int fBinsX = 20;                 ///< Cells along x (ZnS length)
+    G4int fBinsY = 20;                 ///< Cells along y (ZnS width)
+    G4double fStandoff;                ///< Source distance to the ZnS face
+    G4String fSampling = "stratified"; ///< stratified, random or sobol
+
+    // --- Face of the current run ---
+    G4double fHalfX = 0.;
+    G4double fHalfY = 0.;
+    G4double fFaceZ = 0.;
+    std::vector<G4int> fRepresentatives; ///< Cells of the fundamental domain
+
+    Results fLocal; ///< Thread-local accumulators
+
+    /// Totals merged over threads
+    using RunTotals = OpticalSimulationRunTotals<Results>;
+};
+
+#endif
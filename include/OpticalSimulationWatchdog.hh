@@ -0,0 +1,127 @@
+#ifndef OpticalSimulationWatchdog_h
+#define OpticalSimulationWatchdog_h 1
+
+/**
+ * @class OpticalSimulationWatchdog
+ * @brief Per-event budgets on steps, optical photons and wall time.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * A pathological event (photons trapped between a polished surface and the
+ * PMT glass, for instance) can run for minutes and stall the tail of an MT
+ * run. Each thread counts the steps, the optical photons started and the
+ * wall time of its current event. When a budget is exceeded the event is
+ *
+ *  - downgraded (default): its remaining optical photons are killed and
+ *    counted as killed, the event is kept; it is aborted anyway at twice
+ *    the budget;
+ *  - or aborted: its optical record and its run-level results (built on
+ *    the light) are dropped; its input and deposit records are kept.
+ *
+ * Aborted events are counted per source particle in the run totals,
+ * printed at the end of the run and written to the seed record.
+ *
+ * Every such event is logged and written to the Outliers tree of the run
+ * file (key, budgets exceeded, counts, action) with the random status saved
+ * before its primaries, in `<name>_run<r>_evt<e>.rndm`. It is replayed
+ * with /OpticalSimulation/watchdog/setReplay <file> and /run/beamOn 1.
+ *
+ * Commands are available under /OpticalSimulation/watchdog/.
+ */
+
+#include "G4GenericMessenger.hh"
+#include "G4Types.hh"
+#include <chrono>
+#include <map>
+#include <string>
+
+class G4Event;
+class G4Track;
+class TTree;
+
+class OpticalSimulationWatchdog {
+  public:
+    /// Budgets (bit mask of the exceeded ones)
+    enum Budget { kSteps = 1, kPhotons = 2, kTime = 4 };
+
+    /** Constructor: declares the watchdog UI commands */
+    OpticalSimulationWatchdog();
+
+    /** Destructor */
+    ~OpticalSimulationWatchdog();
+
+    /// True when at least one budget is set
+    G4bool IsEnabled() const {
+        return fMaxSteps > 0 || fMaxPhotons > 0 || fMaxTime > 0.;
+    }
+
+    /// Request the random status of the events (before their primaries)
+    void BeginOfRun();
+
+    /// Create the Outliers tree in the current directory
+    TTree *CreateTree();
+
+    /// Reset the counters of the event
+    void BeginOfEvent();
+
+    /// Count a step, check the budgets and apply the action when exceeded
+    void Step(const G4Track *track);
+
+    /// True once the remaining optical photons of the event are killed
+    G4bool KillsPhotons() const { return fExceeded != 0; }
+
+    /// Count an optical photon killed by the downgrade
+    void CountKilled() { fKilled++; }
+
+    /// True when the current event exceeded a budget
+    G4bool IsOutlier() const { return fExceeded != 0; }
+
+    /// Log the outlier, save its random status and set the tree entry
+    void EndOfEvent(const G4Event *event, const G4String &outputName);
+
+    /// Restore the random status of the replayed event (generator)
+    void RestoreReplayStatus();
+
+    /// Count an aborted (sub-)event of a source particle (PDG code)
+    void CountAborted(G4int sourcePDG) { fLocalAborted[sourcePDG]++; }
+
+    /// Add the aborted events of the thread to the run totals
+    void MergeIntoRunTotals();
+
+    /// Clear the run totals (master, start of run)
+    static void ResetRunTotals();
+
+    /// Aborted events of the run, all sources
+    static G4long GetRunAborted();
+
+    /// Print the aborted events per source (master, end of run)
+    static void PrintRunTotals();
+
+  private:
+    using Clock = std::chrono::steady_clock;
+
+    G4GenericMessenger *fMessenger = nullptr; ///< UI commands
+
+    // --- Configuration ---
+    G4long fMaxSteps = 0;        ///< Steps per event (0: no limit)
+    G4long fMaxPhotons = 0;      ///< Optical photons per event (0: none)
+    G4double fMaxTime = 0.;      ///< Wall time per event [s] (0: none)
+    G4String fAction = "downgrade"; ///< downgrade or abort
+    G4String fReplay = "";       ///< Random status of a replayed event
+
+    // --- Current event (also the Outliers tree entry) ---
+    Clock::time_point fStart;
+    G4long fSteps = 0;
+    G4long fPhotons = 0;
+    G4long fKilled = 0;
+    G4int fExceeded = 0;     ///< Budgets exceeded
+    G4int fAborted = 0;      ///< 1 if the event was aborted
+    G4float fWallTime = 0.f; ///< Wall time of the event [s]
+    std::string fStatusFile; ///< Saved random status
+    G4bool fReplayed = false; ///< Replay status already restored
+
+    std::map<G4int, G4long> fLocalAborted; ///< Aborted events per source
+    static std::map<G4int, G4long> fRunAborted; ///< Merged over threads
+};
+
+#endif
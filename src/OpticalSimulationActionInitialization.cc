@@ -59,8 +59,10 @@ OpticalSimulationActionInitialization::
  * that are executed only in the master thread, such as RunAction.
  */
 void OpticalSimulationActionInitialization::BuildForMaster() const {
-    SetUserAction(
-        new OpticalSimulationRunAction(suffixe, NEventsGenerated, flag_MT));
+    auto *runAction =
+        new OpticalSimulationRunAction(suffixe, NEventsGenerated, flag_MT);
+    runAction->SetGeometry(fGeometry);
+    SetUserAction(runAction);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -77,8 +79,7 @@ void OpticalSimulationActionInitialization::BuildForMaster() const {
  */
 void OpticalSimulationActionInitialization::Build() const {
     // Create primary generator action
-    auto *generator = new OpticalSimulationPrimaryGeneratorAction(
-        NEventsGenerated, numThreads, flag_MT);
+    auto *generator = new OpticalSimulationPrimaryGeneratorAction();
 
     // Create run action
     auto *runAction =
@@ -91,6 +92,12 @@ void OpticalSimulationActionInitialization::Build() const {
     // geometry
     runAction->SetPrimaryGenerator(generator);
     runAction->SetGeometry(fGeometry);
+    generator->SetResponseMatrix(&runAction->GetResponseMatrix());
+    generator->SetUniformityMap(&runAction->GetUniformityMap());
+    generator->SetQuasiRandom(&runAction->GetQuasiRandom());
+    generator->SetLightCollectionMap(&runAction->GetLightCollectionMap());
+    generator->SetStepReplay(&runAction->GetStepReplay());
+    generator->SetWatchdog(&runAction->GetWatchdog());
 
     // Assign user actions to the simulation
     SetUserAction(generator);
@@ -0,0 +1,303 @@
+/**
+ * @file OpticalSimulationCache.cc
+ * @brief Implementation of the content-addressed result cache.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * An entry is a directory `<cache>/<hash>/` with `output.root` and
+ * `manifest.txt` (first line `events <N>`, then the configuration text,
+ * compared on retrieval to rule out hash collisions). Files are copied
+ * through /control/shell like the other output helpers. Entries are never
+ * evicted: the cache is off by default and its directory is managed by
+ * the user.
+ */
+
+#include "OpticalSimulationCache.hh"
+#include "G4UIcommand.hh"
+#include "G4UIcommandTree.hh"
+#include "G4UImanager.hh"
+#include <algorithm>
+#include <cstdint>
+#include <dlfcn.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#ifndef OPTICALSIMULATION_GIT_HASH
+#define OPTICALSIMULATION_GIT_HASH "unknown"
+#endif
+
+namespace {
+//! Input files (materials, optical properties, quantum efficiency)
+const G4String inputDirectory = "../simulation_input_files/";
+
+//! Commands that do not change the simulated results
+const std::vector<G4String> ignoredCommands = {
+    "/control/",
+    "/vis/",
+    "/tracking/verbose",
+    "/event/verbose",
+    "/run/verbose",
+    "/run/printProgress",
+    "/run/beamOn",
+    "/OpticalSimulation/print",
+    "/OpticalSimulation/cache/",
+    "/OpticalSimulation/scan/",
+    "/OpticalSimulation/optimizer/",
+    "/OpticalSimulation/topup/",
+    "/OpticalSimulation/server/",
+    "/OpticalSimulation/stream/",
+    "/OpticalSimulation/monitor/",
+    "/OpticalSimulation/qmc/setEventOffset",
+    "/OpticalSimulation/run/setOutputName",
+    "/OpticalSimulation/run/setSeedSegment",
+    "/OpticalSimulation/run/setTopUpInput",
+    "/OpticalSimulation/step/setVerbose"};
+
+//! Current values left out of the state: the base seed becomes the clock
+//! at the first run when 0, an explicit seed is in the applied commands
+const std::vector<G4String> ignoredValues = {
+    "/OpticalSimulation/run/setSeed"};
+
+G4bool Matches(const G4String &command,
+               const std::vector<G4String> &prefixes) {
+    for (const auto &prefix : prefixes)
+        if (command.compare(0, prefix.size(), prefix) == 0)
+            return true;
+    return false;
+}
+
+G4bool Ignored(const G4String &command) {
+    return Matches(command, ignoredCommands);
+}
+
+/**
+ * @brief Identity of the running code: git commit at configure time and
+ * checksum of the binary holding this code (the executable, or the Python
+ * module), so that a rebuild never reuses results of another build.
+ */
+G4String CodeIdentity() {
+    static const G4String identity = [] {
+        G4String binary = "/proc/self/exe";
+        Dl_info info;
+        if (dladdr(reinterpret_cast<void *>(&CodeIdentity), &info) &&
+            info.dli_fname && *info.dli_fname)
+            binary = info.dli_fname;
+        std::ifstream in(binary, std::ios::binary);
+        std::ostringstream content;
+        content << in.rdbuf();
+        return G4String(OPTICALSIMULATION_GIT_HASH) + " " +
+               OpticalSimulationCache::Hash(content.str());
+    }();
+    return identity;
+}
+
+//! Current values of all the commands of a directory, sorted by path
+void CurrentValues(const G4UIcommandTree *tree,
+                   std::vector<G4String> &lines) {
+    if (!tree)
+        return;
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    for (G4int i = 1; i <= tree->GetCommandEntry(); ++i) {
+        G4String path = tree->GetCommand(i)->GetCommandPath();
+        if (!Ignored(path) && !Matches(path, ignoredValues))
+            lines.push_back(path + " = " + UI->GetCurrentValues(path));
+    }
+    for (G4int i = 1; i <= tree->GetTreeEntry(); ++i)
+        CurrentValues(tree->GetTree(i), lines);
+}
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationCache::OpticalSimulationCache(const G4String &name)
+    : fName(name) {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/cache/",
+                                        "Content-addressed result cache");
+
+    fMessenger->DeclareProperty("setEnabled", fEnabled)
+        .SetGuidance("Reuse cached results of identical configurations and "
+                     "store new ones.")
+        .SetParameterName("Enabled", false)
+        .SetDefaultValue("false");
+
+    fMessenger->DeclareProperty("setDirectory", fDirectory)
+        .SetGuidance("Cache directory.")
+        .SetParameterName("Directory", false)
+        .SetDefaultValue("../cache");
+
+    // The command history is part of the configuration: keep all of it
+    G4UImanager::GetUIpointer()->SetMaxHistSize(1000000);
+}
+
+OpticalSimulationCache::~OpticalSimulationCache() { delete fMessenger; }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String OpticalSimulationCache::Hash(const G4String &text) {
+    // 64-bit FNV-1a
+    std::uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    std::ostringstream os;
+    os << std::hex << std::setw(16) << std::setfill('0') << h;
+    return os.str();
+}
+
+/**
+ * @brief Canonical text of the current configuration (events excluded).
+ */
+G4String OpticalSimulationCache::Configuration() {
+    std::ostringstream os;
+    os << "[cache] version 2\n";
+    os << "[code] " << CodeIdentity() << "\n";
+    os << "[seed] MixMax stream (seed, segment, run, thread), independent "
+          "per run; explicit base seed in the commands\n";
+
+    // Applied commands, in order (source definitions are order dependent)
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    os << "[commands]\n";
+    for (G4int i = 0; i < UI->GetNumberOfHistory(); ++i) {
+        std::istringstream is(UI->GetPreviousCommand(i));
+        G4String word, command;
+        while (is >> word)
+            command += (command.empty() ? "" : " ") + word;
+        if (!command.empty() && !Ignored(command))
+            os << command << "\n";
+    }
+
+    // Current values, defaults included
+    os << "[state]\n";
+    std::vector<G4String> lines;
+    CurrentValues(UI->GetTree()->FindCommandTree("/OpticalSimulation/"),
+                  lines);
+    std::sort(lines.begin(), lines.end());
+    for (const auto &line : lines)
+        os << line << "\n";
+
+    // Input files
+    os << "[files]\n";
+    std::vector<std::filesystem::path> files;
+    std::error_code ec;
+    for (const auto &entry :
+         std::filesystem::directory_iterator(inputDirectory, ec))
+        if (entry.is_regular_file())
+            files.push_back(entry.path());
+    std::sort(files.begin(), files.end());
+    for (const auto &file : files) {
+        std::ifstream in(file, std::ios::binary);
+        std::ostringstream content;
+        content << in.rdbuf();
+        os << file.filename().string() << " " << Hash(content.str())
+           << "\n";
+    }
+    return os.str();
+}
+
+G4long OpticalSimulationCache::CachedEvents(
+    const G4String &hash, const G4String &configuration) const {
+    std::ifstream manifest(fDirectory + "/" + hash + "/manifest.txt");
+    G4String key;
+    G4long events = -1;
+    if (!(manifest >> key >> events) || key != "events")
+        return -1;
+    manifest.ignore(1);
+    std::ostringstream stored;
+    stored << manifest.rdbuf();
+    return stored.str() == configuration ? events : -1;
+}
+
+/**
+ * @brief Copy the chunks and the manifest of a chunked output.
+ *
+ * Chunk files are named after the output (`<name>_c<k>.root`,
+ * `<name>_<thread>_c<k>.root`); the copies take the name prefix @p to
+ * instead of @p from, in the files and in the manifest.
+ * @param source Output whose `<source>.manifest` lists the chunks
+ * @param from Name prefix of the listed chunks
+ * @param to Output (path and name) of the copies
+ */
+void OpticalSimulationCache::CopyChunks(const G4String &source,
+                                        const G4String &from,
+                                        const G4String &to) const {
+    std::ifstream in(source + ".manifest");
+    if (!in)
+        return;
+    G4String directory = source.substr(0, source.find_last_of('/') + 1);
+    G4String target = to.substr(0, to.find_last_of('/') + 1);
+    std::ofstream out(to + ".manifest");
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    G4String line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            out << line << "\n";
+            continue;
+        }
+        G4String file = line.substr(0, line.find(' '));
+        G4String copy = file;
+        if (file.compare(0, from.size(), from) == 0)
+            copy = to.substr(target.size()) + file.substr(from.size());
+        UI->ApplyCommand("/control/shell cp " + directory + file + " " +
+                         target + copy);
+        out << copy << line.substr(file.size()) << "\n";
+    }
+}
+
+/**
+ * @brief Restore the output of an identical configuration with enough
+ * events.
+ */
+G4bool OpticalSimulationCache::Retrieve(G4long nEvents) {
+    G4String configuration = Configuration();
+    G4String hash = Hash(configuration);
+    G4cout << "Configuration hash: " << hash << G4endl;
+    if (!fEnabled)
+        return false;
+
+    G4long cached = CachedEvents(hash, configuration);
+    if (cached < nEvents)
+        return false;
+
+    G4String entry = fDirectory + "/" + hash;
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    UI->ApplyCommand("/control/shell cp " + entry + "/output.root " + fName +
+                     ".root");
+    // No chunk of an earlier output listed with the cached ones
+    std::error_code ec;
+    std::filesystem::remove(fName + ".manifest", ec);
+    CopyChunks(entry + "/output", "output", fName);
+    G4cout << "Cached result " << hash << " reused (" << cached
+           << " events for " << nEvents << " requested)" << G4endl;
+    return true;
+}
+
+/**
+ * @brief Store the merged output of the run, unless the entry already holds
+ * at least as many events.
+ */
+void OpticalSimulationCache::Store(G4long nEvents) {
+    if (!fEnabled)
+        return;
+
+    G4String configuration = Configuration();
+    G4String hash = Hash(configuration);
+    if (CachedEvents(hash, configuration) >= nEvents)
+        return;
+
+    G4String entry = fDirectory + "/" + hash;
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    UI->ApplyCommand("/control/shell mkdir -p " + entry);
+    UI->ApplyCommand("/control/shell cp " + fName + ".root " + entry +
+                     "/output.root");
+    std::error_code ec;
+    std::filesystem::remove(entry + "/output.manifest", ec);
+    CopyChunks(fName, fName, entry + "/output");
+
+    std::ofstream manifest(entry + "/manifest.txt");
+    manifest << "events " << nEvents << "\n" << configuration;
+    G4cout << "Result stored in cache entry " << hash << G4endl;
+}
@@ -0,0 +1,336 @@
+/**
+ * @file OpticalSimulationClassifier.cc
+ * @brief Implementation of the in-run alpha/beta classifier.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The classifier works on the per-event summary (RunTallyEvent) built by
+ * OpticalSimulationEventAction:
+ *  - **deposit** method: the event is alpha-like when the fraction of the
+ *    visible deposit located in ZnS:Ag exceeds a cut, beta-like otherwise;
+ *  - **psd** method: the event is alpha-like when the fraction of detected
+ *    photons arriving after the tail start exceeds a cut (slow ZnS:Ag light
+ *    versus fast EJ-212 light). Events without arrival times fall back on the
+ *    deposit method.
+ *
+ * In both cases an event is undetected when fewer than the photon threshold
+ * photons are detected or when the total deposit is below the minimum.
+ *
+ * Accumulation is thread-local and merged once per worker at the end of the
+ * run under a mutex; the master prints and writes the merged matrix.
+ */
+
+#include "OpticalSimulationClassifier.hh"
+#include "TFile.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include <cmath>
+#include <iomanip>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationClassifier::Results::Merge(const Results &other) {
+    for (G4int s = 0; s < kNSourceTypes; ++s) {
+        for (G4int c = 0; c < kNEventClasses; ++c)
+            counts[s][c] += other.counts[s][c];
+        for (G4int b = 0; b < kDiscriminantBins; ++b)
+            discriminant[s][b] += other.discriminant[s][b];
+    }
+}
+
+G4long OpticalSimulationClassifier::Results::Total(G4int source) const {
+    G4long n = 0;
+    for (G4int c = 0; c < kNEventClasses; ++c)
+        n += counts[source][c];
+    return n;
+}
+
+G4double OpticalSimulationClassifier::Results::Fraction(G4int source,
+                                                        G4int cls) const {
+    G4long n = Total(source);
+    return n > 0 ? G4double(counts[source][cls]) / n : 0.;
+}
+
+G4double OpticalSimulationClassifier::Results::FractionError(G4int source,
+                                                             G4int cls) const {
+    G4long n = Total(source);
+    if (n == 0)
+        return 0.;
+    G4double p = Fraction(source, cls);
+    return std::sqrt(p * (1. - p) / n);
+}
+
+G4double
+OpticalSimulationClassifier::Results::DetectionEfficiency(G4int source) const {
+    return Total(source) > 0 ? 1. - Fraction(source, kUndetected) : 0.;
+}
+
+G4double OpticalSimulationClassifier::Results::DetectionEfficiencyError(
+    G4int source) const {
+    return FractionError(source, kUndetected);
+}
+
+G4double OpticalSimulationClassifier::Results::BetaMisidAtAlphaEfficiency(
+    G4double alphaEfficiency) const {
+    const auto &alpha = discriminant[kSourceAlpha];
+    const auto &beta = discriminant[kSourceBeta];
+
+    G4long nAlpha = 0, nBeta = 0;
+    for (G4int b = 0; b < kDiscriminantBins; ++b) {
+        nAlpha += alpha[b];
+        nBeta += beta[b];
+    }
+    if (nAlpha == 0 || nBeta == 0)
+        return 1.;
+
+    // Lower the cut bin by bin until the requested alpha efficiency is reached
+    G4long aboveAlpha = 0, aboveBeta = 0;
+    for (G4int b = kDiscriminantBins - 1; b >= 0; --b) {
+        aboveAlpha += alpha[b];
+        aboveBeta += beta[b];
+        if (aboveAlpha >= alphaEfficiency * nAlpha)
+            break;
+    }
+    return G4double(aboveBeta) / nBeta;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Constructor.
+ *
+ * Declares the classifier commands under /OpticalSimulation/classifier/.
+ */
+OpticalSimulationClassifier::OpticalSimulationClassifier() {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/classifier/",
+                                        "In-run alpha/beta classification");
+
+    fMessenger->DeclareProperty("setEnabled", fEnabled)
+        .SetGuidance("Enable the in-run classification.")
+        .SetParameterName("Enabled", false)
+        .SetDefaultValue("true");
+
+    fMessenger->DeclareProperty("setMethod", fMethod)
+        .SetGuidance("Classification method: deposit or psd.")
+        .SetParameterName("Method", false)
+        .SetCandidates("deposit psd")
+        .SetDefaultValue("deposit");
+
+    fMessenger->DeclareProperty("setPhotonThreshold", fPhotonThreshold)
+        .SetGuidance("Minimum number of detected photons for a signal.")
+        .SetParameterName("PhotonThreshold", false)
+        .SetDefaultValue("1");
+
+    fMessenger->DeclareProperty("setMinDeposit", fMinDeposit)
+        .SetGuidance("Minimum total deposit (ZnS + Sc) in keV.")
+        .SetParameterName("MinDeposit", false)
+        .SetDefaultValue("1.");
+
+    fMessenger->DeclareProperty("setZnSFractionCut", fZnSFractionCut)
+        .SetGuidance("ZnS deposit fraction above which an event is alpha.")
+        .SetParameterName("ZnSFractionCut", false)
+        .SetDefaultValue("0.8");
+
+    fMessenger->DeclareProperty("setPSDTailStart", fPSDTailStart)
+        .SetGuidance("Start of the PSD tail window in ns.")
+        .SetParameterName("PSDTailStart", false)
+        .SetDefaultValue("50.");
+
+    fMessenger->DeclareProperty("setPSDCut", fPSDCut)
+        .SetGuidance("PSD tail fraction above which an event is alpha.")
+        .SetParameterName("PSDCut", false)
+        .SetDefaultValue("0.5");
+}
+
+/**
+ * @brief Destructor.
+ */
+OpticalSimulationClassifier::~OpticalSimulationClassifier() {
+    delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int OpticalSimulationClassifier::GetSourceType(G4int pdg) {
+    switch (pdg) {
+    case 1000020040: // alpha
+        return kSourceAlpha;
+    case 11: // e-
+    case -11: // e+
+        return kSourceBeta;
+    case 22: // gamma
+        return kSourceGamma;
+    default:
+        return kSourceOther;
+    }
+}
+
+G4double
+OpticalSimulationClassifier::Discriminant(const RunTallyEvent &event) const {
+    if (fMethod == "psd" && event.tailFraction >= 0.)
+        return event.tailFraction;
+
+    G4double total = event.depositZnS + event.depositSc;
+    return total > 0. ? event.depositZnS / total : 0.;
+}
+
+G4int OpticalSimulationClassifier::Classify(const RunTallyEvent &event) const {
+    if (event.detected < fPhotonThreshold ||
+        event.depositZnS + event.depositSc < fMinDeposit)
+        return kUndetected;
+
+    G4bool usePSD = (fMethod == "psd" && event.tailFraction >= 0.);
+    G4double cut = usePSD ? fPSDCut : fZnSFractionCut;
+
+    return Discriminant(event) >= cut ? kClassAlpha : kClassBeta;
+}
+
+/**
+ * @brief Classify one event and accumulate it in the thread-local matrix.
+ * @param event Event summary; its tailFraction and eventClass fields are
+ * updated.
+ * @param times Arrival times of the detected photons [ns].
+ */
+void OpticalSimulationClassifier::Fill(RunTallyEvent &event,
+                                       const std::vector<float> &times) {
+    if (fMethod == "psd" && !times.empty()) {
+        G4int tail = 0;
+        for (float t : times)
+            if (t > fPSDTailStart)
+                tail++;
+        event.tailFraction = float(tail) / times.size();
+    }
+
+    // The class is always stored: other run-level monitors rely on it
+    event.eventClass = Classify(event);
+    if (!fEnabled)
+        return;
+
+    G4int source = GetSourceType(event.sourcePDG);
+    fLocal.counts[source][event.eventClass]++;
+
+    if (event.eventClass != kUndetected) {
+        G4int bin = G4int(Discriminant(event) * kDiscriminantBins);
+        if (bin >= kDiscriminantBins)
+            bin = kDiscriminantBins - 1;
+        fLocal.discriminant[source][bin]++;
+    }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationClassifier::MergeIntoRunTotals() const {
+    RunTotals::Merge(fLocal);
+}
+
+void OpticalSimulationClassifier::ResetRunTotals() {
+    RunTotals::Clear();
+}
+
+/**
+ * @brief Add the counts written by WriteRunTotals() in a previous output.
+ */
+void OpticalSimulationClassifier::LoadRunTotals(TFile *file) const {
+    if (!fEnabled || !file)
+        return;
+
+    auto *hCounts = file->Get<TH2D>("classification_counts");
+    if (!hCounts) {
+        G4cerr << "Warning: no classification counts in " << file->GetName()
+               << G4endl;
+        return;
+    }
+
+    Results stored;
+    for (G4int s = 0; s < kNSourceTypes; ++s)
+        for (G4int c = 0; c < kNEventClasses; ++c)
+            stored.counts[s][c] =
+                std::llround(hCounts->GetBinContent(s + 1, c + 1));
+    for (G4int s = 0; s < kNSourceTypes; ++s) {
+        G4String name = G4String("discriminant_") + SourceName(s);
+        auto *hDisc = file->Get<TH1D>(name.c_str());
+        if (!hDisc)
+            continue;
+        for (G4int b = 0; b < kDiscriminantBins; ++b)
+            stored.discriminant[s][b] =
+                std::llround(hDisc->GetBinContent(b + 1));
+    }
+
+    RunTotals::Merge(stored);
+}
+
+const char *OpticalSimulationClassifier::SourceName(G4int source) {
+    static const char *names[kNSourceTypes] = {"alpha", "beta", "gamma",
+                                               "other"};
+    return names[source];
+}
+
+const char *OpticalSimulationClassifier::ClassName(G4int cls) {
+    static const char *names[kNEventClasses] = {"undetected", "alpha", "beta"};
+    return names[cls];
+}
+
+/**
+ * @brief Print the merged confusion matrix with binomial errors.
+ */
+void OpticalSimulationClassifier::PrintRunTotals() const {
+    if (!fEnabled)
+        return;
+
+    const Results &r = GetRunTotals();
+
+    G4cout << "\n---------------- Alpha/Beta classification (" << fMethod
+           << ") ----------------" << G4endl;
+    for (G4int s = 0; s < kNSourceTypes; ++s) {
+        if (r.Total(s) == 0)
+            continue;
+        G4cout << std::setw(6) << SourceName(s) << " source: " << r.Total(s)
+               << " events" << G4endl;
+        G4cout << "     Detection efficiency :      " << std::fixed
+               << std::setprecision(4) << r.DetectionEfficiency(s) << " +/- "
+               << r.DetectionEfficiencyError(s) << G4endl;
+        for (G4int c = kClassAlpha; c < kNEventClasses; ++c)
+            G4cout << "     Classified " << std::setw(6) << ClassName(c)
+                   << " :       " << r.Fraction(s, c) << " +/- "
+                   << r.FractionError(s, c) << G4endl;
+    }
+    G4cout << std::defaultfloat
+           << "------------------------------------------------------------"
+           << G4endl;
+}
+
+/**
+ * @brief Write the merged counts in the given ROOT file.
+ *
+ * Only raw counts are written so that outputs can be added with hadd;
+ * efficiencies and errors are derived from them.
+ */
+void OpticalSimulationClassifier::WriteRunTotals(TFile *file) const {
+    if (!fEnabled || !file)
+        return;
+
+    const Results &r = GetRunTotals();
+    file->cd();
+
+    TH2D hCounts("classification_counts",
+                 "Classification counts;Source type;Event class",
+                 kNSourceTypes, 0, kNSourceTypes, kNEventClasses, 0,
+                 kNEventClasses);
+    for (G4int s = 0; s < kNSourceTypes; ++s) {
+        hCounts.GetXaxis()->SetBinLabel(s + 1, SourceName(s));
+        for (G4int c = 0; c < kNEventClasses; ++c)
+            hCounts.SetBinContent(s + 1, c + 1, r.counts[s][c]);
+    }
+    for (G4int c = 0; c < kNEventClasses; ++c)
+        hCounts.GetYaxis()->SetBinLabel(c + 1, ClassName(c));
+    hCounts.Write();
+
+    for (G4int s = 0; s < kNSourceTypes; ++s) {
+        G4String name = G4String("discriminant_") + SourceName(s);
+        TH1D hDisc(name.c_str(), (name + ";Discriminant;Events").c_str(),
+                   kDiscriminantBins, 0., 1.);
+        for (G4int b = 0; b < kDiscriminantBins; ++b)
+            hDisc.SetBinContent(b + 1, r.discriminant[s][b]);
+        hDisc.Write();
+    }
+}
@@ -17,6 +17,10 @@
 #include "OpticalSimulationEventAction.hh" ///< Event action header
 #include "OpticalSimulationRunAction.hh" ///< Run action header (for statistics accumulation)
 #include "OpticalSimulationSteppingAction.hh" ///< Stepping action header (per-step updates)
+#include "G4Event.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4PrimaryVertex.hh"
+#include <algorithm>
 
 /**
  * @brief Constructor for OpticalSimulationEventAction
@@ -44,6 +48,9 @@ OpticalSimulationEventAction::~OpticalSimulationEventAction() {}
  * - Optical statistics
  * - Zns Statistics
  * - Scintillator statistics
+ *
+ * One record is prepared per primary of a batched event; the working
+ * tallies above always belong to the sub-event being filled.
  */
 void OpticalSimulationEventAction::BeginOfEventAction(const G4Event *evt) {
     /** Reset input statistics */
@@ -53,16 +60,81 @@ void OpticalSimulationEventAction::BeginOfEventAction(const G4Event *evt) {
     /** Reset Beam Stop (BS) and BSPEC YAG detector statistics */
     StatsZnS = {};
     StatsScintillator = {};
+
+    /** Sub-events of the event (primaries packed by the generator) */
+    auto *generator =
+        static_cast<const OpticalSimulationPrimaryGeneratorAction *>(
+            G4RunManager::GetRunManager()->GetUserPrimaryGeneratorAction());
+    G4int nSubEvents = generator ? generator->GetBatchSize() : 1;
+    fRecords.assign(nSubEvents, RunTallyRecord());
+    fSubEvent = 0;
+    fTrackSubEvent.clear();
+    fPrimaryEnd.clear();
+    fTrackTally.Clear();
+
+    /** Per-event budgets of the watchdog */
+    auto *runac = static_cast<OpticalSimulationRunAction *>(
+        G4RunManager::GetRunManager()->GetUserRunAction());
+    runac->GetWatchdog().BeginOfEvent();
+
+    if (nSubEvents > 1) {
+        // Primary track IDs follow the vertices and their particles
+        G4int end = 0;
+        for (G4int v = 0; v < evt->GetNumberOfPrimaryVertex(); ++v) {
+            end += evt->GetPrimaryVertex(v)->GetNumberOfParticle();
+            fPrimaryEnd.push_back(end);
+        }
+    }
+}
+
+/**
+ * @brief Direct the tallies to the sub-event of a track starting.
+ *
+ * Primaries belong to the sub-event of their vertex and secondaries to the
+ * sub-event of their parent. Tracks are processed one at a time, so the
+ * sub-event only changes between tracks. Optical photons have no
+ * descendants and are not stored.
+ * @param track Track at its first step
+ */
+void OpticalSimulationEventAction::EnterTrack(const G4Track *track) {
+    G4int index = 0;
+    if (track->GetParentID() == 0)
+        index = std::upper_bound(fPrimaryEnd.begin(), fPrimaryEnd.end(),
+                                 track->GetTrackID() - 1) -
+                fPrimaryEnd.begin();
+    else {
+        auto parent = fTrackSubEvent.find(track->GetParentID());
+        if (parent != fTrackSubEvent.end())
+            index = parent->second;
+    }
+    index = std::min(index, G4int(fRecords.size()) - 1);
+    if (track->GetDefinition() != G4OpticalPhoton::Definition())
+        fTrackSubEvent[track->GetTrackID()] = index;
+    SelectSubEvent(index);
+}
+
+void OpticalSimulationEventAction::SelectSubEvent(G4int index) {
+    if (index == fSubEvent)
+        return;
+    SwapCurrent(fRecords[fSubEvent]);
+    SwapCurrent(fRecords[index]);
+    fSubEvent = index;
+}
+
+void OpticalSimulationEventAction::SwapCurrent(RunTallyRecord &record) {
+    std::swap(StatsInput, record.input);
+    std::swap(StatsZnS, record.zns);
+    std::swap(StatsScintillator, record.scintillator);
+    std::swap(StatsOptical, record.optical);
 }
 
 /**
  * @brief Called at the end of each event
  * @param evt Pointer to the current G4Event
  *
- * Updates run-level statistics by passing the per-event data to the
- * OpticalSimulationRunAction. Only non-empty or relevant data are updated
- * for input, BS YAG, and BSPEC YAG statistics, while quadrupole and
- * collimator statistics are always updated.
+ * Every sub-event (one per primary) is completed and passed to the
+ * run-level accumulators, then all the records of the event are written to
+ * the trees by the OpticalSimulationRunAction in one batch.
  */
 void OpticalSimulationEventAction::EndOfEventAction(const G4Event *evt) {
     /** Get pointer to current run action */
@@ -70,34 +142,103 @@ void OpticalSimulationEventAction::EndOfEventAction(const G4Event *evt) {
         (OpticalSimulationRunAction *)(G4RunManager::GetRunManager()
                                            ->GetUserRunAction());
 
-    /** Update input energy statistics if valid */
-    if (StatsInput.energy > 0)
-        runac->UpdateStatisticsInput(StatsInput);
+    /** Key of the tree entries of this event */
+    runac->SetEventKey(evt);
 
-    /** Update Beam Stop YAG statistics if not empty */
-    if (!StatsZnS.energy.empty())
-        runac->UpdateStatisticsZnS(StatsZnS);
+    /** Watchdog outlier; an aborted event keeps its input and deposit
+     *  records and is counted per source, without optical record nor
+     *  run-level results */
+    runac->UpdateStatisticsOutlier(evt);
+    if (evt->IsAborted()) {
+        for (G4int s = 0; s < G4int(fRecords.size()); ++s) {
+            SelectSubEvent(s);
+            fTrackTally.Flush(s, StatsZnS, StatsScintillator);
+            StatsInput.pdg = SourcePDG(evt, s);
+            runac->GetWatchdog().CountAborted(StatsInput.pdg);
+        }
+        SwapCurrent(fRecords[fSubEvent]);
+        runac->GetStepReplay().Clear();
+        runac->UpdateStatisticsRecords(fRecords, false);
+        return;
+    }
 
-    /** Update Beam Stop SPEC YAG statistics if not empty */
-    if (!StatsScintillator.energy.empty())
-        runac->UpdateStatisticsScintillator(StatsScintillator);
+    for (G4int s = 0; s < G4int(fRecords.size()); ++s) {
+        SelectSubEvent(s);
+        FinishSubEvent(evt, s, runac);
+    }
+    SwapCurrent(fRecords[fSubEvent]);
 
-    if (StatsOptical.ScintillationSc < 0) {
-        StatsOptical.IncidentE = StatsInput.energy;
-        StatsOptical.DepositTotal = StatsScintillator.deposited_energy_event +
-                                    StatsZnS.deposited_energy_event;
-        StatsOptical.DepositSc = StatsScintillator.deposited_energy_event;
-        StatsOptical.DepositZnS = StatsZnS.deposited_energy_event;
-        StatsOptical.GeneratedSc =
-            StatsOptical.ScintillationSc + StatsOptical.CerenkovSc;
-        StatsOptical.GeneratedZnS =
-            StatsOptical.ScintillationZnS + StatsOptical.CerenkovZnS;
-        StatsOptical.GeneratedTotal =
-            StatsOptical.GeneratedSc + StatsOptical.GeneratedZnS;
-
-        StatsOptical.BulkAbsTotal =
-            StatsOptical.BulkAbsSc + StatsOptical.BulkAbsZnS;
+    /** Input (if valid), ZnS and scintillator (if not empty), optical */
+    runac->UpdateStatisticsRecords(fRecords);
+}
+
+/**
+ * @brief PDG code of the primary of a sub-event (0 if none).
+ */
+G4int OpticalSimulationEventAction::SourcePDG(const G4Event *evt,
+                                              G4int index) {
+    if (evt->GetNumberOfPrimaryVertex() > index &&
+        evt->GetPrimaryVertex(index)->GetPrimary(0))
+        return evt->GetPrimaryVertex(index)->GetPrimary(0)->GetPDGcode();
+    return 0;
+}
 
+/**
+ * @brief Complete the current sub-event and fill the run-level results.
+ * @param evt Pointer to the current G4Event
+ * @param index Sub-event (primary vertex) index
+ * @param runac Run action of this thread
+ */
+void OpticalSimulationEventAction::FinishSubEvent(
+    const G4Event *evt, G4int index, OpticalSimulationRunAction *runac) {
+    /** Charged tracks still open (never ended in this event) */
+    fTrackTally.Flush(index, StatsZnS, StatsScintillator);
+
+    /** Replayed steps: primary and deposits of the recorded event */
+    G4int sourcePDG = SourcePDG(evt, index);
+    runac->GetStepReplay().RestoreEvent(StatsInput, StatsZnS,
+                                        StatsScintillator, sourcePDG);
+    StatsInput.pdg = sourcePDG;
+
+    /** Event totals, also needed by the run-level accumulators */
+    StatsOptical.IncidentE = StatsInput.energy;
+    StatsOptical.DepositTotal = StatsScintillator.deposited_energy_event +
+                                StatsZnS.deposited_energy_event;
+    StatsOptical.DepositSc = StatsScintillator.deposited_energy_event;
+    StatsOptical.DepositZnS = StatsZnS.deposited_energy_event;
+    StatsOptical.GeneratedSc =
+        StatsOptical.ScintillationSc + StatsOptical.CerenkovSc;
+    StatsOptical.GeneratedZnS =
+        StatsOptical.ScintillationZnS + StatsOptical.CerenkovZnS;
+    StatsOptical.GeneratedTotal =
+        StatsOptical.GeneratedSc + StatsOptical.GeneratedZnS;
+    StatsOptical.BulkAbsTotal = StatsOptical.BulkAbsSc + StatsOptical.BulkAbsZnS;
+
+    /** Build the event summary and classify it */
+    RunTallyEvent summary;
+    summary.sourcePDG = sourcePDG;
+    summary.energy = StatsInput.energy;
+    summary.x = StatsInput.x;
+    summary.y = StatsInput.y;
+    summary.z = StatsInput.z;
+    summary.depositZnS = StatsOptical.DepositZnS;
+    summary.depositSc = StatsOptical.DepositSc;
+    summary.generated = StatsOptical.GeneratedTotal;
+    summary.detected = StatsOptical.Detected;
+    runac->GetClassifier().Fill(summary, StatsOptical.Time);
+    runac->GetPrecisionMonitor().Fill(summary);
+    runac->GetResponseMatrix().Fill(summary);
+    runac->GetUniformityMap().Fill(summary);
+    runac->GetQuasiRandom().Fill(summary, evt->GetEventID());
+    runac->GetLightCollectionMap().Fill(summary);
+    if (runac->GetStepReplay().IsRecording())
+        runac->UpdateStatisticsSteps(StatsInput, sourcePDG);
+    runac->GetEventStream().Publish(summary, evt->GetEventID(), StatsOptical);
+    runac->GetMonitor().Fill(summary,
+                             runac->GetClassifier().Discriminant(summary),
+                             index == 0);
+
+    if (StatsOptical.ScintillationSc < 0) {
         float Absfrac =
             100 * StatsOptical.Absorbed / StatsOptical.GeneratedTotal;
         float BulkfracZnS =
@@ -170,5 +311,4 @@ void OpticalSimulationEventAction::EndOfEventAction(const G4Event *evt) {
             << G4endl;
         G4cout << "" << G4endl;
     }
-    runac->UpdateStatisticsOptical(StatsOptical);
 }
@@ -0,0 +1,271 @@
+/**
+ * @file OpticalSimulationEventStream.cc
+ * @brief Implementation of the shared-memory event stream.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Producers reserve a sequence number with one atomic increment on head, so
+ * workers never serialise on a lock. A slot is claimed by a compare-exchange
+ * on its stamp, which also resolves the rare case of two producers one ring
+ * apart targeting the same slot in drop mode: the older record is dropped.
+ */
+
+#include "OpticalSimulationEventStream.hh"
+#include "G4AutoLock.hh"
+#include "G4Threading.hh"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sstream>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+StreamHeader *OpticalSimulationEventStream::fHeader = nullptr;
+size_t OpticalSimulationEventStream::fSize = 0;
+G4String OpticalSimulationEventStream::fOpenName;
+
+namespace {
+//! Mutex protecting the creation of the segment
+G4Mutex eventStreamMutex = G4MUTEX_INITIALIZER;
+
+const std::uint32_t streamMagic = 0x5645534f;
+const std::uint32_t streamVersion = 1;
+const char *columnNames[] = {"time", "wavelength", "x", "y", "z"};
+const G4int nColumns = 5;
+
+//! Slot size: stamp, fixed record and photon columns, cache-line aligned
+std::uint32_t RecordSize(std::uint32_t columns, std::uint32_t maxPhotons) {
+    std::uint32_t bytes = sizeof(std::uint64_t) + sizeof(StreamRecord);
+    for (G4int c = 0; c < nColumns; ++c)
+        if (columns & (1u << c))
+            bytes += maxPhotons * sizeof(float);
+    return (bytes + 63) / 64 * 64;
+}
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationEventStream::OpticalSimulationEventStream() {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/stream/",
+                                        "Shared-memory event stream");
+
+    fMessenger->DeclareProperty("setEnabled", fEnabled)
+        .SetGuidance("Publish the finished events in shared memory.")
+        .SetParameterName("Enabled", false)
+        .SetDefaultValue("false");
+
+    fMessenger->DeclareProperty("setName", fName)
+        .SetGuidance("Name of the shared-memory object (/dev/shm).")
+        .SetParameterName("Name", false)
+        .SetDefaultValue("/OpticalSimulation");
+
+    fMessenger->DeclareProperty("setCapacity", fCapacity)
+        .SetGuidance("Number of records of the ring buffer.")
+        .SetParameterName("Capacity", false)
+        .SetRange("Capacity>=2")
+        .SetDefaultValue("65536");
+
+    fMessenger->DeclareProperty("setPolicy", fPolicy)
+        .SetGuidance("When the consumer is late: block the producers or "
+                     "drop the oldest records.")
+        .SetParameterName("Policy", false)
+        .SetCandidates("block drop")
+        .SetDefaultValue("drop");
+
+    fMessenger->DeclareProperty("setColumns", fColumns)
+        .SetGuidance("Detected-photon columns, among time wavelength x y z "
+                     "(none for the summaries only).")
+        .SetParameterName("Columns", false)
+        .SetDefaultValue("time");
+
+    fMessenger->DeclareProperty("setMaxPhotons", fMaxPhotons)
+        .SetGuidance("Detected photons kept per record (the others are "
+                     "truncated).")
+        .SetParameterName("MaxPhotons", false)
+        .SetRange("MaxPhotons>=0")
+        .SetDefaultValue("64");
+}
+
+OpticalSimulationEventStream::~OpticalSimulationEventStream() {
+    delete fMessenger;
+    if (G4Threading::IsMasterThread())
+        Close();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::uint32_t OpticalSimulationEventStream::Columns() const {
+    std::uint32_t mask = 0;
+    std::istringstream is(fColumns);
+    G4String column;
+    while (is >> column) {
+        G4int c = 0;
+        while (c < nColumns && column != columnNames[c])
+            ++c;
+        if (c < nColumns)
+            mask |= 1u << c;
+        else if (column != "none")
+            G4cerr << "Warning: unknown stream column " << column << G4endl;
+    }
+    return mask;
+}
+
+void OpticalSimulationEventStream::Close() {
+    if (!fHeader)
+        return;
+    munmap(fHeader, fSize);
+    shm_unlink(fOpenName.c_str());
+    fHeader = nullptr;
+    fSize = 0;
+}
+
+void OpticalSimulationEventStream::BeginOfRun(G4int runID) const {
+    G4AutoLock lock(&eventStreamMutex);
+    if (!fEnabled) {
+        Close();
+        return;
+    }
+
+    std::uint32_t columns = Columns();
+    std::uint32_t maxPhotons = columns ? fMaxPhotons : 0;
+    std::uint32_t recordSize = RecordSize(columns, maxPhotons);
+    std::uint32_t policy = fPolicy == "block" ? 0 : 1;
+
+    // Same layout: the sequence numbers continue across the runs
+    G4bool reuse = fHeader && fOpenName == fName &&
+                   fHeader->capacity == std::uint32_t(fCapacity) &&
+                   fHeader->columns == columns &&
+                   fHeader->maxPhotons == maxPhotons;
+    if (!reuse) {
+        Close();
+        size_t size = sizeof(StreamHeader) + size_t(fCapacity) * recordSize;
+        G4int fd = shm_open(fName.c_str(), O_CREAT | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, size) < 0) {
+            G4cerr << "Error: cannot create the shared-memory stream "
+                   << fName << G4endl;
+            if (fd >= 0)
+                close(fd);
+            return;
+        }
+        void *address =
+            mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED) {
+            G4cerr << "Error: cannot map the shared-memory stream " << fName
+                   << G4endl;
+            shm_unlink(fName.c_str());
+            return;
+        }
+        // Every stamp starts at 0 (empty slot), also over a stale segment
+        std::memset(address, 0, size);
+        fHeader = new (address) StreamHeader();
+        fHeader->magic = streamMagic;
+        fHeader->version = streamVersion;
+        fHeader->recordSize = recordSize;
+        fHeader->capacity = fCapacity;
+        fHeader->maxPhotons = maxPhotons;
+        fHeader->columns = columns;
+        fSize = size;
+        fOpenName = fName;
+        G4cout << "Event stream on " << fName << ": " << fCapacity
+               << " records of " << recordSize << " bytes" << G4endl;
+    }
+    fHeader->policy = policy;
+    fHeader->runID.store(runID, std::memory_order_relaxed);
+    fHeader->running.store(1, std::memory_order_release);
+}
+
+void OpticalSimulationEventStream::EndOfRun() const {
+    if (!fHeader)
+        return;
+    fHeader->running.store(0, std::memory_order_release);
+    G4cout << "Event stream: "
+           << fHeader->head.load(std::memory_order_relaxed) << " records, "
+           << fHeader->dropped.load(std::memory_order_relaxed)
+           << " dropped" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Copy an event into the next slot of the ring.
+ *
+ * Seqlock protocol: the stamp is odd while the slot is written and becomes
+ * 2 s + 2 once record s is complete.
+ */
+void OpticalSimulationEventStream::Publish(
+    const RunTallyEvent &event, G4long eventID,
+    const RunTallyOptical &optical) const {
+    StreamHeader *header = fHeader;
+    if (!fEnabled || !header)
+        return;
+
+    const std::uint64_t capacity = header->capacity;
+    const std::uint64_t s =
+        header->head.fetch_add(1, std::memory_order_relaxed);
+    if (header->policy == 0)
+        while (s - header->tail.load(std::memory_order_acquire) >= capacity)
+            std::this_thread::yield();
+
+    auto *slot = reinterpret_cast<char *>(header + 1) +
+                 (s % capacity) * header->recordSize;
+    auto *stamp = reinterpret_cast<std::atomic<std::uint64_t> *>(slot);
+
+    // Claim the slot unless a more recent record already holds it
+    std::uint64_t previous = stamp->load(std::memory_order_relaxed);
+    do {
+        if (previous >= 2 * s + 2) {
+            header->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (previous & 1) {
+            std::this_thread::yield();
+            previous = stamp->load(std::memory_order_relaxed);
+            continue;
+        }
+        if (stamp->compare_exchange_weak(previous, 2 * s + 1,
+                                         std::memory_order_acquire))
+            break;
+    } while (true);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // An unread record is overwritten (drop policy)
+    if (previous != 0 &&
+        header->tail.load(std::memory_order_relaxed) <= previous / 2 - 1)
+        header->dropped.fetch_add(1, std::memory_order_relaxed);
+
+    StreamRecord record{};
+    record.eventID = eventID;
+    record.thread = G4Threading::G4GetThreadId();
+    record.sourcePDG = event.sourcePDG;
+    record.energy = event.energy;
+    record.x = event.x;
+    record.y = event.y;
+    record.z = event.z;
+    record.depositZnS = event.depositZnS;
+    record.depositSc = event.depositSc;
+    record.generated = event.generated;
+    record.detected = event.detected;
+    record.tailFraction = event.tailFraction;
+    record.eventClass = event.eventClass;
+
+    const std::vector<float> *columns[nColumns] = {
+        &optical.Time, &optical.BirthWavelengthDetected,
+        &optical.DetectorPositionX, &optical.DetectorPositionY,
+        &optical.DetectorPositionZ};
+    size_t nPhotons = 0;
+    char *data = slot + sizeof(std::uint64_t) + sizeof(StreamRecord);
+    for (G4int c = 0; c < nColumns; ++c) {
+        if (!(header->columns & (1u << c)))
+            continue;
+        nPhotons = std::min<size_t>(columns[c]->size(), header->maxPhotons);
+        std::memcpy(data, columns[c]->data(), nPhotons * sizeof(float));
+        data += header->maxPhotons * sizeof(float);
+    }
+    record.nPhotons = nPhotons;
+    std::memcpy(slot + sizeof(std::uint64_t), &record, sizeof(record));
+
+    stamp->store(2 * s + 2, std::memory_order_release);
+}
@@ -0,0 +1,448 @@
+/**
+ * @file OpticalSimulationFresnelBoundary.cc
+ * @brief Implementation of the tabulated Fresnel boundary process.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The tables hold the signed amplitudes
+ *
+ *     rs = (n1 cos1 - n2 cos2) / (n1 cos1 + n2 cos2)
+ *     rp = (n2 cos1 - n1 cos2) / (n2 cos1 + n1 cos2)
+ *
+ * on 513 cosines of incidence (0 to 1) times 64 energies spanning the
+ * RINDEX of both materials, interpolated bilinearly. The transmitted
+ * amplitudes follow as ts = 1 + rs and tp = n1/n2 (1 + rp). A photon of
+ * polarization components (as, ap) is reflected with probability
+ * as^2 rs^2 + ap^2 rp^2, as in G4OpBoundaryProcess; beyond the critical
+ * angle it is totally reflected.
+ */
+
+#include "OpticalSimulationFresnelBoundary.hh"
+#include "G4AutoLock.hh"
+#include "G4GeometryTolerance.hh"
+#include "G4LogicalBorderSurface.hh"
+#include "G4LogicalSkinSurface.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4Navigator.hh"
+#include "G4OpticalSurface.hh"
+#include "G4PhysicalVolumeStore.hh"
+#include "G4Run.hh"
+#include "G4RunManager.hh"
+#include "G4TransportationManager.hh"
+#include "Randomize.hh"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+std::map<G4String, OpticalSimulationFresnelBoundary::Comparison>
+    OpticalSimulationFresnelBoundary::fComparisonTotals;
+G4ThreadLocal OpticalSimulationFresnelBoundary
+    *OpticalSimulationFresnelBoundary::fInstance = nullptr;
+
+namespace {
+G4Mutex comparisonMutex = G4MUTEX_INITIALIZER;
+
+//! Cosine intervals of the tables
+const G4int nCosines = 512;
+//! Energies of the tables
+const G4int nEnergies = 64;
+//! Samples of the validation
+const G4int nValidation = 100000;
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationFresnelBoundary::OpticalSimulationFresnelBoundary()
+    : G4OpBoundaryProcess() {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/boundary/",
+                                        "Tabulated Fresnel boundaries");
+
+    fMessenger->DeclareMethod("accelerate",
+                              &OpticalSimulationFresnelBoundary::Accelerate)
+        .SetGuidance("Tabulate the polished dielectric interface between two "
+                     "physical volumes (both directions).")
+        .SetParameterName("Volumes", false);
+
+    fMessenger->DeclareMethod("clear", &OpticalSimulationFresnelBoundary::Clear)
+        .SetGuidance("Back to the standard process on every interface.");
+
+    fMessenger
+        ->DeclareMethod("validate", &OpticalSimulationFresnelBoundary::Validate)
+        .SetGuidance("Compare the tables with the Fresnel coefficients of the "
+                     "standard process.");
+
+    fMessenger->DeclareProperty("setCompare", fCompare)
+        .SetGuidance("Move the photons of the registered interfaces with the "
+                     "standard process and count the table decisions for "
+                     "the same photons (printed at the end of the run).")
+        .SetParameterName("Compare", false)
+        .SetDefaultValue("false");
+
+    fInstance = this;
+}
+
+OpticalSimulationFresnelBoundary::~OpticalSimulationFresnelBoundary() {
+    if (fInstance == this)
+        fInstance = nullptr;
+    delete fMessenger;
+}
+
+G4OpBoundaryProcessStatus OpticalSimulationFresnelBoundary::GetStatus() const {
+    return fHandled ? fAcceleratedStatus : G4OpBoundaryProcess::GetStatus();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationFresnelBoundary::Accelerate(const G4String &volumes) {
+    std::istringstream is(volumes);
+    G4String pre, post;
+    if (!(is >> pre >> post)) {
+        G4cerr << "Error: accelerate needs two physical volumes" << G4endl;
+        return;
+    }
+    fVolumes.emplace_back(pre, post);
+    fTableRun = -1;
+}
+
+void OpticalSimulationFresnelBoundary::Clear() {
+    fVolumes.clear();
+    fTables.clear();
+    fTableRun = -1;
+}
+
+void OpticalSimulationFresnelBoundary::Fresnel(G4double n12, G4double cosine,
+                                               G4double &s, G4double &p) {
+    G4double sin2 = n12 * n12 * (1. - cosine * cosine);
+    if (sin2 >= 1.) {
+        s = 1.;
+        p = 1.;
+        return;
+    }
+    G4double cos2 = std::sqrt(1. - sin2);
+    G4double n21 = 1. / n12;
+    s = (cosine - n21 * cos2) / (cosine + n21 * cos2);
+    p = (n21 * cosine - cos2) / (n21 * cosine + cos2);
+}
+
+void OpticalSimulationFresnelBoundary::Table::Fill() {
+    // Energy grid over both refractive indices
+    eMin = std::min(rindex1->GetMinEnergy(), rindex2->GetMinEnergy());
+    G4double eMax = std::max(rindex1->GetMaxEnergy(), rindex2->GetMaxEnergy());
+    nE = nEnergies;
+    eStep = (eMax - eMin) / (nEnergies - 1);
+    if (eStep <= 0.)
+        eStep = 1.;
+
+    ratio.resize(nEnergies);
+    rs.resize(size_t(nEnergies) * (nCosines + 1));
+    rp.resize(rs.size());
+    for (G4int j = 0; j < nEnergies; ++j) {
+        G4double energy = eMin + j * eStep;
+        G4double n12 = rindex1->Value(energy) / rindex2->Value(energy);
+        ratio[j] = n12;
+        for (G4int i = 0; i <= nCosines; ++i) {
+            G4double s, p;
+            Fresnel(n12, G4double(i) / nCosines, s, p);
+            rs[size_t(j) * (nCosines + 1) + i] = s;
+            rp[size_t(j) * (nCosines + 1) + i] = p;
+        }
+    }
+}
+
+void OpticalSimulationFresnelBoundary::Table::Lookup(G4double energy,
+                                                     G4double cosine,
+                                                     G4double &n12,
+                                                     G4double &s,
+                                                     G4double &p) const {
+    G4double v = std::clamp((energy - eMin) / eStep, 0., nE - 1.);
+    G4int j = std::min(G4int(v), nE - 2);
+    G4double g = v - j;
+    G4double u = std::clamp(cosine, 0., 1.) * nCosines;
+    G4int i = std::min(G4int(u), nCosines - 1);
+    G4double f = u - i;
+
+    n12 = (1. - g) * ratio[j] + g * ratio[j + 1];
+    size_t k0 = size_t(j) * (nCosines + 1) + i;
+    size_t k1 = k0 + nCosines + 1;
+    s = (1. - g) * ((1. - f) * rs[k0] + f * rs[k0 + 1]) +
+        g * ((1. - f) * rs[k1] + f * rs[k1 + 1]);
+    p = (1. - g) * ((1. - f) * rp[k0] + f * rp[k0 + 1]) +
+        g * ((1. - f) * rp[k1] + f * rp[k1 + 1]);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Build the table of an oriented interface.
+ *
+ * The interface is accepted when both materials have a RINDEX and the
+ * standard process would apply plain Fresnel optics to it: no skin surface
+ * and, if there is a border surface, a polished dielectric_dielectric one
+ * (glisur or unified) without reflectivity or transmittance.
+ */
+G4bool OpticalSimulationFresnelBoundary::BuildTable(
+    const G4VPhysicalVolume *pre, const G4VPhysicalVolume *post,
+    Table &table) const {
+    table.name = pre->GetName() + " -> " + post->GetName();
+    auto *mpt1 =
+        pre->GetLogicalVolume()->GetMaterial()->GetMaterialPropertiesTable();
+    auto *mpt2 =
+        post->GetLogicalVolume()->GetMaterial()->GetMaterialPropertiesTable();
+    table.rindex1 = mpt1 ? mpt1->GetProperty(kRINDEX) : nullptr;
+    table.rindex2 = mpt2 ? mpt2->GetProperty(kRINDEX) : nullptr;
+    if (!table.rindex1 || !table.rindex2) {
+        G4cerr << "Boundary " << table.name << ": no RINDEX, not accelerated"
+               << G4endl;
+        return false;
+    }
+
+    if (G4LogicalSkinSurface::GetSurface(pre->GetLogicalVolume()) ||
+        G4LogicalSkinSurface::GetSurface(post->GetLogicalVolume())) {
+        G4cerr << "Boundary " << table.name
+               << ": skin surface, not accelerated" << G4endl;
+        return false;
+    }
+    if (auto *border = G4LogicalBorderSurface::GetSurface(pre, post)) {
+        auto *surface =
+            dynamic_cast<G4OpticalSurface *>(border->GetSurfaceProperty());
+        auto *mpt = surface ? surface->GetMaterialPropertiesTable() : nullptr;
+        G4bool plain = surface && surface->GetType() == dielectric_dielectric &&
+                       surface->GetFinish() == polished &&
+                       (surface->GetModel() == glisur ||
+                        surface->GetModel() == unified) &&
+                       !(mpt && (mpt->GetProperty(kREFLECTIVITY) ||
+                                 mpt->GetProperty(kTRANSMITTANCE)));
+        if (!plain) {
+            G4cerr << "Boundary " << table.name << ": surface "
+                   << border->GetName() << " is not a polished dielectric, "
+                   << "not accelerated" << G4endl;
+            return false;
+        }
+    }
+
+    table.Fill();
+    return true;
+}
+
+void OpticalSimulationFresnelBoundary::BuildTables() {
+    fTables.clear();
+    G4PhysicalVolumeStore *store = G4PhysicalVolumeStore::GetInstance();
+    for (const auto &volumes : fVolumes) {
+        for (const G4VPhysicalVolume *a : *store) {
+            if (a->GetName() != volumes.first)
+                continue;
+            for (const G4VPhysicalVolume *b : *store) {
+                if (b->GetName() != volumes.second)
+                    continue;
+                for (const Interface &interface :
+                     {Interface(a, b), Interface(b, a)}) {
+                    Table table;
+                    if (BuildTable(interface.first, interface.second, table))
+                        fTables[interface] = std::move(table);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Largest differences between the tabulated reflectances and the
+ * ones computed from RINDEX at random energies and angles.
+ */
+void OpticalSimulationFresnelBoundary::Validate() {
+    BuildTables();
+    fTableRun = -1;
+    if (fTables.empty())
+        G4cout << "No accelerated boundary" << G4endl;
+    for (const auto &entry : fTables) {
+        const Table &table = entry.second;
+        G4double eMax = table.eMin + (table.nE - 1) * table.eStep;
+        G4double maxS = 0., maxP = 0.;
+        for (G4int k = 0; k < nValidation; ++k) {
+            G4double energy =
+                table.eMin + G4UniformRand() * (eMax - table.eMin);
+            G4double cosine = G4UniformRand();
+            G4double n12, s, p, s0, p0;
+            table.Lookup(energy, cosine, n12, s, p);
+            Fresnel(table.rindex1->Value(energy) /
+                        table.rindex2->Value(energy),
+                    cosine, s0, p0);
+            maxS = std::max(maxS, std::abs(s * s - s0 * s0));
+            maxP = std::max(maxP, std::abs(p * p - p0 * p0));
+        }
+        G4cout << "Boundary " << table.name << ": max |dR| s " << maxS
+               << ", p " << maxP << " (" << nValidation << " samples)"
+               << G4endl;
+    }
+}
+
+void OpticalSimulationFresnelBoundary::MergeComparison() {
+    if (fComparison.empty())
+        return;
+    G4AutoLock lock(&comparisonMutex);
+    for (const auto &entry : fComparison) {
+        Comparison &total = fComparisonTotals[entry.first];
+        for (const auto &count : entry.second.base)
+            total.base[count.first] += count.second;
+        for (const auto &count : entry.second.table)
+            total.table[count.first] += count.second;
+    }
+    fComparison.clear();
+}
+
+/**
+ * @brief Reflected (Fresnel and total internal) and refracted fractions,
+ * then the count of every status, standard process vs table.
+ */
+void OpticalSimulationFresnelBoundary::PrintComparison() {
+    G4AutoLock lock(&comparisonMutex);
+    auto count = [](const std::map<G4int, G4long> &counts, G4int status) {
+        auto found = counts.find(status);
+        return found == counts.end() ? 0L : found->second;
+    };
+    auto total = [](const std::map<G4int, G4long> &counts) {
+        G4long n = 0;
+        for (const auto &entry : counts)
+            n += entry.second;
+        return n;
+    };
+    for (const auto &entry : fComparisonTotals) {
+        const Comparison &c = entry.second;
+        G4double nBase = std::max<G4long>(total(c.base), 1);
+        G4double nTable = std::max<G4long>(total(c.table), 1);
+        G4cout << "Boundary " << entry.first << ": " << total(c.base)
+               << " photons, standard / table" << G4endl;
+        G4cout << "  reflected "
+               << (count(c.base, FresnelReflection) +
+                   count(c.base, TotalInternalReflection)) /
+                      nBase
+               << " / "
+               << (count(c.table, FresnelReflection) +
+                   count(c.table, TotalInternalReflection)) /
+                      nTable
+               << ", refracted " << count(c.base, FresnelRefraction) / nBase
+               << " / " << count(c.table, FresnelRefraction) / nTable
+               << G4endl;
+        std::map<G4int, G4long> statuses = c.base;
+        statuses.insert(c.table.begin(), c.table.end());
+        for (const auto &status : statuses)
+            G4cout << "  status " << status.first << ": "
+                   << count(c.base, status.first) << " / "
+                   << count(c.table, status.first) << G4endl;
+    }
+    fComparisonTotals.clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4VParticleChange *
+OpticalSimulationFresnelBoundary::PostStepDoIt(const G4Track &track,
+                                               const G4Step &step) {
+    fHandled = false;
+    const G4StepPoint *post = step.GetPostStepPoint();
+    if (fVolumes.empty() || post->GetStepStatus() != fGeomBoundary ||
+        track.GetStepLength() <=
+            G4GeometryTolerance::GetInstance()->GetSurfaceTolerance())
+        return G4OpBoundaryProcess::PostStepDoIt(track, step);
+
+    // Tables of the geometry of the current run
+    G4int run = G4RunManager::GetRunManager()->GetCurrentRun()->GetRunID();
+    if (run != fTableRun) {
+        BuildTables();
+        fTableRun = run;
+    }
+    auto found = fTables.find(Interface(
+        step.GetPreStepPoint()->GetPhysicalVolume(),
+        post->GetPhysicalVolume()));
+    if (found == fTables.end())
+        return G4OpBoundaryProcess::PostStepDoIt(track, step);
+
+    G4bool valid = false;
+    G4ThreeVector normal = G4TransportationManager::GetTransportationManager()
+                               ->GetNavigatorForTracking()
+                               ->GetGlobalExitNormal(post->GetPosition(),
+                                                     &valid);
+    if (!valid)
+        return G4OpBoundaryProcess::PostStepDoIt(track, step);
+
+    // Comparison: the standard process moves the photon, the table decision
+    // for the same photon is only counted
+    if (fCompare) {
+        G4VParticleChange *change =
+            G4OpBoundaryProcess::PostStepDoIt(track, step);
+        G4ThreeVector direction, polarization;
+        Comparison &counts = fComparison[found->second.name];
+        counts.base[G4OpBoundaryProcess::GetStatus()]++;
+        counts.table[Decide(found->second, track, normal, direction,
+                            polarization)]++;
+        return change;
+    }
+
+    G4ThreeVector newDirection, newPolarization;
+    fAcceleratedStatus = Decide(found->second, track, normal, newDirection,
+                                newPolarization);
+    fHandled = true;
+
+    aParticleChange.Initialize(track);
+    aParticleChange.ProposeMomentumDirection(newDirection);
+    aParticleChange.ProposePolarization(newPolarization);
+    return &aParticleChange;
+}
+
+/**
+ * @brief Reflection or refraction of a photon from the table.
+ * @param table Table of the interface
+ * @param track Photon at the boundary
+ * @param normal Exit normal of the navigator at the boundary
+ * @param newDirection Direction after the boundary
+ * @param newPolarization Polarization after the boundary (unit)
+ * @return Status of the standard process for the same outcome
+ */
+G4OpBoundaryProcessStatus OpticalSimulationFresnelBoundary::Decide(
+    const Table &table, const G4Track &track, G4ThreeVector normal,
+    G4ThreeVector &newDirection, G4ThreeVector &newPolarization) const {
+    // Normal against the photon, as in G4OpBoundaryProcess
+    const G4ThreeVector &direction = track.GetMomentumDirection();
+    const G4ThreeVector &polarization = track.GetPolarization();
+    normal = -normal;
+    if (direction * normal > 0.)
+        normal = -normal;
+    G4double cos1 = -(direction * normal);
+
+    G4double n12, rs, rp;
+    table.Lookup(track.GetDynamicParticle()->GetTotalMomentum(), cos1, n12,
+                 rs, rp);
+
+    // s (perpendicular) and p (in the incidence plane) components
+    G4ThreeVector sAxis = direction.cross(normal);
+    sAxis = sAxis.mag2() > 1e-12 ? sAxis.unit() : polarization;
+    G4double as = polarization * sAxis;
+    G4double ap = polarization * direction.cross(sAxis);
+
+    G4OpBoundaryProcessStatus status;
+    G4double sin2 = n12 * n12 * (1. - cos1 * cos1);
+    if (sin2 >= 1.) {
+        status = TotalInternalReflection;
+        newDirection = direction + 2. * cos1 * normal;
+        newPolarization =
+            -polarization + 2. * (polarization * normal) * normal;
+    } else {
+        G4double es, ep;
+        if (G4UniformRand() < as * as * rs * rs + ap * ap * rp * rp) {
+            status = FresnelReflection;
+            newDirection = direction + 2. * cos1 * normal;
+            es = rs * as;
+            ep = rp * ap;
+        } else {
+            status = FresnelRefraction;
+            G4double cos2 = std::sqrt(1. - sin2);
+            newDirection = n12 * direction + (n12 * cos1 - cos2) * normal;
+            es = (1. + rs) * as;
+            ep = n12 * (1. + rp) * ap;
+        }
+        newDirection = newDirection.unit();
+        newPolarization = es * sAxis + ep * newDirection.cross(sAxis);
+    }
+    newPolarization = newPolarization.unit();
+    return status;
+}
@@ -35,6 +35,7 @@
  */
 
 #include "OpticalSimulationGeometryConstruction.hh"
+#include <map>
 
 using namespace CLHEP;
 
@@ -64,6 +65,34 @@ OpticalSimulationGeometryConstruction::OpticalSimulationGeometryConstruction()
 OpticalSimulationGeometryConstruction::
     ~OpticalSimulationGeometryConstruction() = default;
 
+/**
+ * @brief Set the ZnS:Ag light yield.
+ *
+ * The yield is also written in the material table right away:
+ * G4Scintillation reads it at every step, so a change between two runs does
+ * not need a geometry rebuild.
+ */
+void OpticalSimulationGeometryConstruction::SetZnSLY(const G4double LY) {
+    fZnSLY = LY;
+    auto ZnS = OpticalSimulationMaterials::getInstance()->getMaterial("ZnS");
+    if (ZnS && ZnS->GetMaterialPropertiesTable())
+        ZnS->GetMaterialPropertiesTable()->AddConstProperty(
+            "SCINTILLATIONYIELD", fZnSLY / MeV, true);
+}
+
+/**
+ * @brief Set the EJ-212 light yield (applied as for the ZnS:Ag).
+ */
+void OpticalSimulationGeometryConstruction::SetScintillatorLY(
+    const G4double LY) {
+    fScintillatorLY = LY;
+    auto EJ212 =
+        OpticalSimulationMaterials::getInstance()->getMaterial("EJ212");
+    if (EJ212 && EJ212->GetMaterialPropertiesTable())
+        EJ212->GetMaterialPropertiesTable()->AddConstProperty(
+            "SCINTILLATIONYIELD", fScintillatorLY / MeV, true);
+}
+
 /**
  * @brief Print a summary of the current geometry setup.
  */
@@ -248,25 +277,56 @@ void OpticalSimulationGeometryConstruction::ConstructPMTGlass() {
         LogicalPMTGlass, "PMT_Glass", LogicalHolder, false, 0);
 }
 
+G4ThreeVector OpticalSimulationGeometryConstruction::GetPMTAxis() const {
+    if (PhysicalPMTGlass)
+        return PhysicalPMTGlass->GetObjectRotationValue() *
+               G4ThreeVector(0., 0., 1.);
+    return Flip * G4ThreeVector(0., 0., 1.);
+}
+
+G4ThreeVector OpticalSimulationGeometryConstruction::GetPMTPosition() const {
+    return PhysicalPMTGlass ? PhysicalPMTGlass->GetObjectTranslation()
+                            : G4ThreeVector();
+}
+
+G4Transform3D
+OpticalSimulationGeometryConstruction::GetPhotocathodeTransform() const {
+    if (!PhysicalPhotocathode || !PhysicalHolder)
+        return G4Transform3D();
+    return G4Transform3D(PhysicalHolder->GetObjectRotationValue(),
+                         PhysicalHolder->GetObjectTranslation()) *
+           G4Transform3D(PhysicalPhotocathode->GetObjectRotationValue(),
+                         PhysicalPhotocathode->GetObjectTranslation());
+}
+
 /**
  * @brief Construct the TeflonOpticalProperties.
+ *
+ * The measured reflectance (teflon_reverse.dat, increasing energies) sets
+ * the REFLECTIVITY of both models; the LUT then samples the direction of the reflected photon.
+ *
+ * @param lut LUT surface (else unified, ground front painted)
+ * @param ground Ground crystal surface (LUT only)
+ * @return Surface to attach to the wrapped faces
  */
-void OpticalSimulationGeometryConstruction::CreateTeflonOpticalProperties() {
+G4OpticalSurface *
+OpticalSimulationGeometryConstruction::CreateTeflonOpticalProperties(
+    G4bool lut, G4bool ground) {
     auto TeflonMPT = new G4MaterialPropertiesTable();
     // Define Teflon properties
     // Properties are read in from data file
     std::ifstream Read_teflon;
-    G4String teflon_file = path + "teflon.dat";
+    // Increasing energies (decreasing wavelengths) for the property vector
+    G4String teflon_file = path + "teflon_reverse.dat";
     std::vector<G4double> Teflon_Energy;
     std::vector<G4double> Teflon_Reflectivity;
     std::vector<G4double> Teflon_Zero;
     G4double wavelength;       // x values
     G4double teflon_ref_coeff; // y values
-                               // Read_teflon.open(teflon_file);
+    Read_teflon.open(teflon_file);
     if (Read_teflon.is_open()) {
-        while (!Read_teflon.eof()) {
-            G4String filler; // This just skips the coma and space in data files
-            Read_teflon >> wavelength >> filler >> teflon_ref_coeff;
+        G4String filler; // This just skips the coma and space in data files
+        while (Read_teflon >> wavelength >> filler >> teflon_ref_coeff) {
             Teflon_Energy.push_back((1240 / wavelength) * eV);
             Teflon_Reflectivity.push_back(1. * teflon_ref_coeff);
             Teflon_Zero.push_back(1e-6);
@@ -276,6 +336,17 @@ void OpticalSimulationGeometryConstruction::CreateTeflonOpticalProperties() {
                << G4endl; // throw an error if file is not found
     Read_teflon.close();
 
+    // Measured angular distributions of the wrapping (air gap)
+    if (lut) {
+        auto OpticalTeflon = new G4OpticalSurface(
+            "OpticalTeflonLUT", LUT,
+            ground ? groundteflonair : polishedteflonair, dielectric_LUT);
+        TeflonMPT->AddProperty("REFLECTIVITY", Teflon_Energy,
+                               Teflon_Reflectivity);
+        OpticalTeflon->SetMaterialPropertiesTable(TeflonMPT);
+        return OpticalTeflon;
+    }
+
     // Define Teflon optical boundary surface properties
     auto OpticalTeflon = new G4OpticalSurface("OpticalTeflon");
     OpticalTeflon->SetModel(unified); // Either glisur (GEANT3 model) or unified
@@ -294,20 +365,28 @@ void OpticalSimulationGeometryConstruction::CreateTeflonOpticalProperties() {
     TeflonMPT->AddProperty("BACKSCATTERCONSTANT", Teflon_Energy, Teflon_Zero);
     // Geometrical implementation of boundary surface
     OpticalTeflon->SetMaterialPropertiesTable(TeflonMPT);
-    // auto SSTeflon = new
-    // G4LogicalSkinSurface("b_Teflon",LogicalTeflon,OpticalTeflon); // Applies
-    // optical Teflon properties to ogical Teflon surface
+    return OpticalTeflon;
 }
 
 /**
  * @brief Construct the MylarOpticalProperties.
+ *
+ * Mylar is a PET film: its LUT is the one of Lumirror (PET) with an air
+ * gap. The measured reflectance (mylar_reverse.dat, increasing energies)
+ * sets the REFLECTIVITY.
+ *
+ * @param lut LUT surface (else glisur, polished metal-like mirror)
+ * @param ground Ground crystal surface (LUT only)
+ * @return Surface to attach to the wrapped faces
  */
-void OpticalSimulationGeometryConstruction::CreateMylarOpticalProperties() {
+G4OpticalSurface *
+OpticalSimulationGeometryConstruction::CreateMylarOpticalProperties(
+    G4bool lut, G4bool ground) {
     auto MylarMPT = new G4MaterialPropertiesTable();
     // Define Mylar properties
     std::ifstream Read_mylar;
     G4double wavelength; // x values
-    G4String mylar_file = path + "mylar.dat";
+    G4String mylar_file = path + "mylar_reverse.dat"; // Increasing energies
     std::vector<G4double> Mylar_Energy;
     std::vector<G4double> Mylar_Reflectivity;
     std::vector<G4double> Mylar_Zero;
@@ -315,9 +394,8 @@ void OpticalSimulationGeometryConstruction::CreateMylarOpticalProperties() {
     G4double mylar_ref_coeff;
     Read_mylar.open(mylar_file);
     if (Read_mylar.is_open()) {
-        while (!Read_mylar.eof()) {
-            G4String filler;
-            Read_mylar >> wavelength >> filler >> mylar_ref_coeff;
+        G4String filler;
+        while (Read_mylar >> wavelength >> filler >> mylar_ref_coeff) {
             Mylar_Energy.push_back((1240 / wavelength) * eV);
             Mylar_Reflectivity.push_back(1. * mylar_ref_coeff);
             Mylar_Zero.push_back(0.0);
@@ -327,6 +405,17 @@ void OpticalSimulationGeometryConstruction::CreateMylarOpticalProperties() {
         G4cout << "Error opening file: " << mylar_file << G4endl;
     Read_mylar.close();
 
+    // Measured angular distributions of the wrapping (air gap)
+    if (lut) {
+        auto OpticalMylar = new G4OpticalSurface(
+            "OpticalMylarLUT", LUT,
+            ground ? groundlumirrorair : polishedlumirrorair, dielectric_LUT);
+        MylarMPT->AddProperty("REFLECTIVITY", Mylar_Energy,
+                              Mylar_Reflectivity);
+        OpticalMylar->SetMaterialPropertiesTable(MylarMPT);
+        return OpticalMylar;
+    }
+
     // Define Mylar optical boundary surface properties
     auto OpticalMylar = new G4OpticalSurface("OpticalMylar");
     OpticalMylar->SetModel(glisur);
@@ -342,11 +431,108 @@ void OpticalSimulationGeometryConstruction::CreateMylarOpticalProperties() {
 
     // Geometrical implementation of boundary surface
     OpticalMylar->SetMaterialPropertiesTable(MylarMPT);
+    return OpticalMylar;
+}
 
-    // SSMylar = new G4LogicalSkinSurface("SSMylar", LogicalMylar,OpticalMylar);
-    // // Applies Mylar properties to logical mylar surface
-    // auto SSAlu = new G4LogicalSkinSurface("SSAlu", LogicalBoitierAlu,
-    // OpticalMylar); // Applies Mylar properties to logical Alu surface
+namespace {
+//! Names of the wrapped faces (WrapFace order)
+const char *wrapFaceNames[] = {"entrance", "xmin", "xmax", "ymin", "ymax"};
+} // namespace
+
+/**
+ * @brief Set the wrapping of a face, or of the four lateral faces (sides).
+ */
+void OpticalSimulationGeometryConstruction::SetWrapping(
+    const G4String &face, const G4String &wrapping, const G4String &finish) {
+    for (G4int f = 0; f < kNWrapFaces; ++f) {
+        if (face == wrapFaceNames[f] || (face == "sides" && f != kEntrance)) {
+            fWrapping[f] = wrapping;
+            fWrapFinish[f] = finish;
+        }
+    }
+}
+
+G4String OpticalSimulationGeometryConstruction::GetWrapping() const {
+    G4String value;
+    for (G4int f = 0; f < kNWrapFaces; ++f)
+        value += G4String(f ? " " : "") + wrapFaceNames[f] + ":" +
+                 fWrapping[f] + "/" + fWrapFinish[f];
+    return value;
+}
+
+/**
+ * @brief Construct the wrapping sheets and their surfaces.
+ *
+ * A wrapped face gets a sheet of Teflon or Mylar (fWrapThickness) against
+ * the crystal, one per layer for the lateral faces (the ZnS and the
+ * scintillator may differ in size), and a border surface from the crystal
+ * to the sheet. Photons are reflected or absorbed by the surface and never
+ * enter the sheet; the entrance sheet also acts as the window seen by the
+ * particles.
+ */
+void OpticalSimulationGeometryConstruction::ConstructWrapping() {
+    struct Layer {
+        G4VPhysicalVolume *physical;
+        const char *name;
+        G4double length, width, thickness, z;
+    };
+    const Layer layers[] = {
+        {PhysicalZnS, "ZnS", fZnSLength, fZnSWidth, fZnSThickness, 0.},
+        {PhysicalScintillator, "Scintillator", fScintillatorLength,
+         fScintillatorWidth, fScintillatorThickness,
+         fScintillatorThickness / 2 + fZnSThickness / 2}};
+
+    G4bool lut = fWrapModel == "LUT";
+    std::map<G4String, G4OpticalSurface *> surfaces; // One per kind
+    const G4double t = fWrapThickness;
+
+    for (G4int face = 0; face < kNWrapFaces; ++face) {
+        if (fWrapping[face] == "none")
+            continue;
+        G4bool teflon = fWrapping[face] == "teflon";
+        G4bool ground = fWrapFinish[face] == "ground";
+        G4String kind = fWrapping[face] + "_" + fWrapFinish[face];
+        if (!surfaces.count(kind))
+            surfaces[kind] = teflon
+                                 ? CreateTeflonOpticalProperties(lut, ground)
+                                 : CreateMylarOpticalProperties(lut, ground);
+        auto material = OpticalSimulationMaterials::getInstance()->getMaterial(
+            teflon ? "G4_TEFLON" : "G4_MYLAR");
+
+        for (const Layer &layer : layers) {
+            if (face == kEntrance && layer.physical != PhysicalZnS)
+                continue;
+            G4double dx = layer.length, dy = layer.width, dz = layer.thickness;
+            G4ThreeVector position(0., 0., layer.z);
+            switch (face) {
+            case kEntrance:
+                dz = t;
+                position.setZ(layer.z - layer.thickness / 2 - t / 2);
+                break;
+            case kXMin:
+            case kXMax:
+                dx = t;
+                position.setX((face == kXMin ? -1 : 1) *
+                              (layer.length / 2 + t / 2));
+                break;
+            default:
+                dy = t;
+                position.setY((face == kYMin ? -1 : 1) *
+                              (layer.width / 2 + t / 2));
+                break;
+            }
+
+            G4String name =
+                G4String("Wrap_") + wrapFaceNames[face] + "_" + layer.name;
+            auto logical = Geom->GetBoxVolume(name, material, dx, dy, dz);
+            SetLogicalVolumeColor(logical, "white");
+            auto physical = new G4PVPlacement(
+                G4Transform3D(DontRotate, position), logical, name,
+                LogicalHolder, false, 0);
+            new G4LogicalBorderSurface("Surf" + name, layer.physical,
+                                       physical, surfaces[kind]);
+        }
+    }
 }
 
 /**
@@ -432,7 +618,7 @@ void OpticalSimulationGeometryConstruction::CreateDetectionOpticalProperties() {
  * - Create the world volume and geometry holder.
  * - Create Zns & Scintillator part
  * - Create PMT Glass part
- * - Create Teflon, Mylar & Detection part
+ * - Create Detection part and the Teflon/Mylar wrapping
  * - Create Optical Surface
  * - Return the fully initialized world volume.
  *
@@ -445,8 +631,13 @@ G4VPhysicalVolume *OpticalSimulationGeometryConstruction::Construct() {
     G4PhysicalVolumeStore::GetInstance()->Clean();
     G4LogicalVolumeStore::GetInstance()->Clean();
     G4SolidStore::GetInstance()->Clean();
+    G4LogicalSkinSurface::CleanSurfaceTable();
+    G4LogicalBorderSurface::CleanSurfaceTable();
 
     // --- Define common rotation matrices -------------------------------------
+    // Reset first: Construct() runs again at every /run/reinitializeGeometry
+    DontRotate = G4RotationMatrix();
+    Flip = G4RotationMatrix();
     DontRotate.rotateX(0.0 * deg);
     Flip.rotateZ(0 * deg);
     Flip.rotateX(90 * deg);
@@ -467,6 +658,8 @@ G4VPhysicalVolume *OpticalSimulationGeometryConstruction::Construct() {
 
     CreateDetectionOpticalProperties();
 
+    ConstructWrapping();
+
     G4OpticalSurface *surface = new G4OpticalSurface("ScintillatorToHolder");
     surface->SetType(dielectric_dielectric);
     surface->SetFinish(polished);
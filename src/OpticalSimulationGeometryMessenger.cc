@@ -1,4 +1,5 @@
 #include "OpticalSimulationGeometryMessenger.hh"
+#include <sstream>
 
 /**
  * @file OpticalSimulationGeometryMessenger.cc
@@ -163,6 +164,60 @@ OpticalSimulationGeometryMessenger::OpticalSimulationGeometryMessenger(
                                                      G4State_Idle);
     fGeometryDetectorDistanceCmd->SetToBeBroadcasted(false);
 
+    /**
+     * @brief Command to wrap a face of the ZnS/scintillator stack.
+     *
+     * Parameters: face (entrance, xmin, xmax, ymin, ymax or sides),
+     * wrapping (none, teflon, mylar), crystal finish (polished, ground)
+     */
+    fGeometryWrappingCmd =
+        new G4UIcommand("/OpticalSimulation/geometry/setWrapping", this);
+    fGeometryWrappingCmd->SetGuidance(
+        "Wrap a face of the stack (sides: the four lateral faces)");
+    auto wrapFace = new G4UIparameter("Face", 's', false);
+    wrapFace->SetParameterCandidates("entrance xmin xmax ymin ymax sides");
+    fGeometryWrappingCmd->SetParameter(wrapFace);
+    auto wrapping = new G4UIparameter("Wrapping", 's', false);
+    wrapping->SetParameterCandidates("none teflon mylar");
+    fGeometryWrappingCmd->SetParameter(wrapping);
+    auto wrapFinish = new G4UIparameter("Finish", 's', true);
+    wrapFinish->SetParameterCandidates("polished ground");
+    wrapFinish->SetDefaultValue("polished");
+    fGeometryWrappingCmd->SetParameter(wrapFinish);
+    fGeometryWrappingCmd->AvailableForStates(G4State_PreInit, G4State_Idle);
+    fGeometryWrappingCmd->SetToBeBroadcasted(false);
+
+    /**
+     * @brief Command to set the surface model of the wrapping.
+     *
+     * Parameter: LUT (measured tables) or unified (unified/glisur models)
+     */
+    fGeometryWrappingModelCmd = new G4UIcmdWithAString(
+        "/OpticalSimulation/geometry/setWrappingModel", this);
+    fGeometryWrappingModelCmd->SetGuidance("Set the wrapping surface model");
+    fGeometryWrappingModelCmd->SetParameterName("WrappingModel", false);
+    fGeometryWrappingModelCmd->SetCandidates("LUT unified");
+    fGeometryWrappingModelCmd->AvailableForStates(G4State_PreInit,
+                                                  G4State_Idle);
+    fGeometryWrappingModelCmd->SetToBeBroadcasted(false);
+
+    /**
+     * @brief Command to set the thickness of the wrapping sheets.
+     *
+     * Parameter: WrappingThickness (double) unit
+     */
+    fGeometryWrappingThicknessCmd = new G4UIcmdWithADoubleAndUnit(
+        "/OpticalSimulation/geometry/setWrappingThickness", this);
+    fGeometryWrappingThicknessCmd->SetGuidance(
+        "Set the thickness of the wrapping sheets");
+    fGeometryWrappingThicknessCmd->SetParameterName("WrappingThickness",
+                                                    false);
+    fGeometryWrappingThicknessCmd->SetRange("WrappingThickness>0.");
+    fGeometryWrappingThicknessCmd->SetUnitCategory("Length");
+    fGeometryWrappingThicknessCmd->AvailableForStates(G4State_PreInit,
+                                                      G4State_Idle);
+    fGeometryWrappingThicknessCmd->SetToBeBroadcasted(false);
+
     //=====================================
     // Materials Commands
     //=====================================
@@ -210,6 +265,9 @@ OpticalSimulationGeometryMessenger::~OpticalSimulationGeometryMessenger() {
     delete fGeometryZnSWidthCmd;
     delete fGeometryZnSThicknessCmd;
     delete fGeometryDetectorDistanceCmd;
+    delete fGeometryWrappingCmd;
+    delete fGeometryWrappingModelCmd;
+    delete fGeometryWrappingThicknessCmd;
     delete fGeometryScintillatorLYCmd;
     delete fGeometryZnSLYCmd;
 }
@@ -249,6 +307,16 @@ void OpticalSimulationGeometryMessenger::SetNewValue(G4UIcommand *aCommand,
     } else if (aCommand == fGeometryDetectorDistanceCmd) {
         fGeometry->SetDetectorDistance(
             fGeometryDetectorDistanceCmd->GetNewDoubleValue(aNewValue));
+    } else if (aCommand == fGeometryWrappingCmd) {
+        std::istringstream is(aNewValue);
+        G4String face, wrapping, finish = "polished";
+        is >> face >> wrapping >> finish;
+        fGeometry->SetWrapping(face, wrapping, finish);
+    } else if (aCommand == fGeometryWrappingModelCmd) {
+        fGeometry->SetWrappingModel(aNewValue);
+    } else if (aCommand == fGeometryWrappingThicknessCmd) {
+        fGeometry->SetWrappingThickness(
+            fGeometryWrappingThicknessCmd->GetNewDoubleValue(aNewValue));
     } else if (aCommand == fGeometryScintillatorLYCmd) {
         fGeometry->SetScintillatorLY(
             fGeometryScintillatorLYCmd->GetNewDoubleValue(aNewValue));
@@ -292,6 +360,13 @@ OpticalSimulationGeometryMessenger::GetCurrentValue(G4UIcommand *aCommand) {
     } else if (aCommand == fGeometryDetectorDistanceCmd) {
         cv = fGeometryDetectorDistanceCmd->ConvertToString(
             fGeometry->GetDetectorDistance(), "m");
+    } else if (aCommand == fGeometryWrappingCmd) {
+        cv = fGeometry->GetWrapping();
+    } else if (aCommand == fGeometryWrappingModelCmd) {
+        cv = fGeometry->GetWrappingModel();
+    } else if (aCommand == fGeometryWrappingThicknessCmd) {
+        cv = fGeometryWrappingThicknessCmd->ConvertToString(
+            fGeometry->GetWrappingThickness(), "mm");
     } else if (aCommand == fGeometryScintillatorLYCmd) {
         cv = fGeometryScintillatorLYCmd->ConvertToString(
             fGeometry->GetScintillatorLY());
@@ -0,0 +1,599 @@
+/**
+ * @file OpticalSimulationLightCollectionMap.cc
+ * @brief Implementation of the forward and adjoint light-collection maps.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Adjoint normalisation: a Lambertian source of N photons over the area A
+ * has a radiance N / (pi A). Radiance over n^2 is conserved along the path
+ * (Fresnel coefficients and absorption are reciprocal), so the scalar flux
+ * at a point is phi = 4 N / A * LCE * n_medium^2 / n_glass^2, where LCE is
+ * the detection probability of an isotropic emission at that point. The
+ * glass index and the quantum efficiency are carried by the track weight,
+ * the index of the medium is divided out at scoring.
+ */
+
+#include "OpticalSimulationLightCollectionMap.hh"
+#include "G4Event.hh"
+#include "G4LogicalSkinSurface.hh"
+#include "G4Material.hh"
+#include "G4Navigator.hh"
+#include "G4OpticalSurface.hh"
+#include "G4ParticleTable.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4TransportationManager.hh"
+#include "OpticalSimulationGeometryConstruction.hh"
+#include "Randomize.hh"
+#include "TFile.h"
+#include "TH1D.h"
+#include "TH3D.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace {
+const char *volumeNames[OpticalSimulationLightCollectionMap::kNVolumes] = {
+    "ZnS", "Scintillator"};
+
+//! Prefixes of the raw tally histograms (followed by the volume name)
+const char *tallyNames[OpticalSimulationLightCollectionMap::kNTallies] = {
+    "lce_forward_thrown_", "lce_forward_detected_", "lce_adjoint_flux_",
+    "lce_adjoint_flux2_"};
+
+//! Refractive index of a material at a photon energy (1 if undefined)
+G4double RefractiveIndex(const G4Material *material, G4double energy) {
+    G4MaterialPropertiesTable *mpt =
+        material ? material->GetMaterialPropertiesTable() : nullptr;
+    G4MaterialPropertyVector *rindex =
+        mpt ? mpt->GetProperty(kRINDEX) : nullptr;
+    return rindex ? rindex->Value(energy) : 1.;
+}
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationLightCollectionMap::Results::Reset(size_t nBins) {
+    for (G4int t = 0; t < kNTallies; ++t)
+        sums[t].assign(nBins, 0.);
+    std::fill(source, source + kNSource, 0.);
+}
+
+void OpticalSimulationLightCollectionMap::Results::Clear() {
+    for (auto &s : sums)
+        s.clear();
+    for (G4double &s : source)
+        s = 0.;
+}
+
+void OpticalSimulationLightCollectionMap::Results::Merge(
+    const Results &other) {
+    if (!AddTallies(sums, other.sums))
+        return;
+    for (G4int s = 0; s < kNSource; ++s)
+        source[s] += other.source[s];
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Constructor.
+ *
+ * Declares the commands under /OpticalSimulation/lce/.
+ */
+OpticalSimulationLightCollectionMap::OpticalSimulationLightCollectionMap() {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/lce/",
+                                        "Light-collection efficiency maps");
+
+    fMessenger->DeclareProperty("setMode", fMode)
+        .SetGuidance("off, forward (photon scan, see /OpticalSimulation/qmc/) "
+                     "or adjoint (photons started on the photocathode).")
+        .SetParameterName("Mode", false)
+        .SetCandidates("off forward adjoint")
+        .SetDefaultValue("off");
+
+    fMessenger->DeclareProperty("setBinsX", fBinsX)
+        .SetGuidance("Number of voxels along x.")
+        .SetParameterName("BinsX", false)
+        .SetRange("BinsX>0")
+        .SetDefaultValue("10");
+
+    fMessenger->DeclareProperty("setBinsY", fBinsY)
+        .SetGuidance("Number of voxels along y.")
+        .SetParameterName("BinsY", false)
+        .SetRange("BinsY>0")
+        .SetDefaultValue("10");
+
+    fMessenger->DeclareProperty("setBinsZ", fBinsZ)
+        .SetGuidance("Number of voxels along z.")
+        .SetParameterName("BinsZ", false)
+        .SetRange("BinsZ>0")
+        .SetDefaultValue("4");
+
+    fMessenger->DeclareProperty("setSpectrum", fSpectrum)
+        .SetGuidance("Emission spectrum of the adjoint photons.")
+        .SetParameterName("Spectrum", false)
+        .SetCandidates("ZnS Scintillator")
+        .SetDefaultValue("ZnS");
+
+    fMessenger->DeclareProperty("setReference", fReference)
+        .SetGuidance("Forward LCE file compared with the adjoint maps at the "
+                     "end of run (empty: no comparison).")
+        .SetParameterName("Reference", true)
+        .SetDefaultValue("");
+}
+
+/**
+ * @brief Destructor.
+ */
+OpticalSimulationLightCollectionMap::~OpticalSimulationLightCollectionMap() {
+    delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Read the volumes, the photocathode and the spectrum of the run.
+ */
+void OpticalSimulationLightCollectionMap::BeginOfRun() {
+    G4int nVoxels = fBinsX * fBinsY * fBinsZ;
+    fLocal.Reset(kNVolumes * nVoxels);
+    fEvent.clear();
+
+    if (fMode == "off" || !fGeometry)
+        return;
+
+    fHalf[kZnS][0] = 0.5 * fGeometry->GetZnSLength() * mm;
+    fHalf[kZnS][1] = 0.5 * fGeometry->GetZnSWidth() * mm;
+    fHalf[kZnS][2] = 0.5 * fGeometry->GetZnSThickness() * mm;
+    fHalf[kScintillator][0] = 0.5 * fGeometry->GetScintillatorLength() * mm;
+    fHalf[kScintillator][1] = 0.5 * fGeometry->GetScintillatorWidth() * mm;
+    fHalf[kScintillator][2] = 0.5 * fGeometry->GetScintillatorThickness() * mm;
+    fCentreZ[kZnS] = 0.;
+    fCentreZ[kScintillator] = fHalf[kZnS][2] + fHalf[kScintillator][2];
+
+    // Track-length scoring: sub-steps of half the smallest voxel side
+    fSubStep = DBL_MAX;
+    const G4int bins[3] = {fBinsX, fBinsY, fBinsZ};
+    for (G4int v = 0; v < kNVolumes; ++v)
+        for (G4int a = 0; a < 3; ++a)
+            fSubStep = std::min(fSubStep, fHalf[v][a] / bins[a]);
+
+    if (fMode != "adjoint")
+        return;
+
+    // Photocathode, its quantum efficiency and the emission spectrum
+    fSpectrumMax = 0.;
+    fGlassSolid = nullptr;
+    G4LogicalVolume *photocathode = fGeometry->GetPhotocathode();
+    if (!photocathode) {
+        G4cerr << "Error: no photocathode for the adjoint photons" << G4endl;
+        return;
+    }
+    fSolid = photocathode->GetSolid();
+    fTransform = fGeometry->GetPhotocathodeTransform();
+    fSurfaceArea = fSolid->GetSurfaceArea();
+
+    fEfficiency = nullptr;
+    auto *skin = G4LogicalSkinSurface::GetSurface(photocathode);
+    auto *surface =
+        skin ? dynamic_cast<G4OpticalSurface *>(skin->GetSurfaceProperty())
+             : nullptr;
+    if (surface && surface->GetMaterialPropertiesTable())
+        fEfficiency =
+            surface->GetMaterialPropertiesTable()->GetProperty(kEFFICIENCY);
+
+    G4Material *material =
+        G4Material::GetMaterial(fSpectrum == "ZnS" ? "ZnS" : "EJ212");
+    G4MaterialPropertiesTable *mpt =
+        material ? material->GetMaterialPropertiesTable() : nullptr;
+    fEmission = mpt ? mpt->GetProperty("SCINTILLATIONCOMPONENT1") : nullptr;
+    if (!fEmission) {
+        G4cerr << "Error: no emission spectrum for the adjoint photons"
+               << G4endl;
+        return;
+    }
+
+    // Glass in front of the photocathode, located once: the side of every
+    // source point is then a test on the glass solid, without navigation
+    G4VPhysicalVolume *world = G4TransportationManager::
+                                   GetTransportationManager()
+                                       ->GetNavigatorForTracking()
+                                       ->GetWorldVolume();
+    G4Navigator navigator;
+    navigator.SetWorldVolume(world);
+    for (G4int attempt = 0; attempt < 1000 && !fGlassSolid; ++attempt) {
+        G4ThreeVector local = fSolid->GetPointOnSurface();
+        G4ThreeVector normal =
+            (fTransform.getRotation() * fSolid->SurfaceNormal(local)).unit();
+        G4ThreeVector position =
+            fTransform * HepGeom::Point3D<G4double>(local);
+        G4VPhysicalVolume *volume = navigator.LocateGlobalPointAndSetup(
+            position + 1. * um * normal, nullptr, false, true);
+        if (volume && volume->GetName() == "PMT_Glass") {
+            fGlassSolid = volume->GetLogicalVolume()->GetSolid();
+            fGlassMaterial = volume->GetLogicalVolume()->GetMaterial();
+            fGlassTransform = navigator.GetGlobalToLocalTransform();
+        }
+    }
+    if (!fGlassSolid) {
+        G4cerr << "Error: no PMT glass in front of the photocathode"
+               << G4endl;
+        return;
+    }
+
+    fEnergyMin = fEmission->GetMinEnergy();
+    fEnergyMax = fEmission->GetMaxEnergy();
+    fSpectrumMax = fEmission->GetMaxValue();
+}
+
+/**
+ * @brief Replace the GPS primary by an adjoint photon.
+ *
+ * A point is drawn uniformly on the photocathode surface and kept when the
+ * glass solid, resolved at the start of the run, lies in front of it; the
+ * photon leaves with a cosine distribution around the surface normal. Its
+ * weight is QE(E) * n_glass(E)^2.
+ *
+ * @param event Event whose first primary vertex has been filled by GPS.
+ */
+void OpticalSimulationLightCollectionMap::SamplePrimary(G4Event *event) {
+    if (!IsAdjoint() || !event->GetPrimaryVertex(0) || !fGlassSolid ||
+        fSpectrumMax <= 0.)
+        return;
+
+    // Point drawn on the whole surface, kept on the glass side (about half
+    // of the surface of the photocathode shell)
+    G4ThreeVector position, normal;
+    G4bool glass = false;
+    for (G4int attempt = 0; attempt < 1000 && !glass; ++attempt) {
+        G4ThreeVector local = fSolid->GetPointOnSurface();
+        normal =
+            (fTransform.getRotation() * fSolid->SurfaceNormal(local)).unit();
+        position = fTransform * HepGeom::Point3D<G4double>(local);
+        fLocal.source[kTried]++;
+        glass = fGlassSolid->Inside(fGlassTransform.TransformPoint(
+                    position + 1. * um * normal)) == kInside;
+    }
+    if (!glass)
+        return;
+    fLocal.source[kAcceptedArea] += fSurfaceArea / (mm * mm);
+
+    // Wavelength from the emission spectrum
+    G4double energy;
+    do {
+        energy = fEnergyMin + (fEnergyMax - fEnergyMin) * G4UniformRand();
+    } while (G4UniformRand() * fSpectrumMax > fEmission->Value(energy));
+
+    // Quantum efficiency of the detection surface
+    G4double efficiency = fEfficiency ? fEfficiency->Value(energy) : 1.;
+    G4double nGlass = RefractiveIndex(fGlassMaterial, energy);
+
+    // Lambertian emission into the glass
+    G4double cosTheta = std::sqrt(G4UniformRand());
+    G4double sinTheta = std::sqrt(1. - cosTheta * cosTheta);
+    G4double phi = twopi * G4UniformRand();
+    G4ThreeVector u = normal.orthogonal().unit();
+    G4ThreeVector v = normal.cross(u);
+    G4ThreeVector direction =
+        (sinTheta * std::cos(phi) * u + sinTheta * std::sin(phi) * v +
+         cosTheta * normal)
+            .unit();
+    G4ThreeVector polarization = direction.orthogonal().unit();
+    polarization.rotate(twopi * G4UniformRand(), direction);
+
+    G4PrimaryVertex *vertex = event->GetPrimaryVertex(0);
+    G4PrimaryParticle *primary = vertex->GetPrimary(0);
+    vertex->SetPosition(position.x(), position.y(), position.z());
+    primary->SetParticleDefinition(
+        G4ParticleTable::GetParticleTable()->FindParticle("opticalphoton"));
+    primary->SetKineticEnergy(energy);
+    primary->SetMomentumDirection(direction);
+    primary->SetPolarization(polarization);
+    primary->SetWeight(efficiency * nGlass * nGlass);
+    fLocal.source[kPhotons]++;
+}
+
+/**
+ * @brief Add the track length of an adjoint photon step to its voxels.
+ * @param step Current step; only optical photons in ZnS or EJ-212 count.
+ */
+void OpticalSimulationLightCollectionMap::Score(const G4Step *step) {
+    if (!IsAdjoint())
+        return;
+    const G4StepPoint *pre = step->GetPreStepPoint();
+    const G4String &name = pre->GetPhysicalVolume()->GetName();
+    if (name != volumeNames[kZnS] && name != volumeNames[kScintillator])
+        return;
+
+    G4double nMedium = RefractiveIndex(pre->GetMaterial(),
+                                       step->GetTrack()->GetTotalEnergy());
+    G4double weight = step->GetTrack()->GetWeight() / (nMedium * nMedium);
+
+    // Straight segment split in sub-steps, credited at their middle
+    G4ThreeVector start = pre->GetPosition();
+    G4ThreeVector delta = step->GetPostStepPoint()->GetPosition() - start;
+    G4double length = delta.mag();
+    G4int nSub = std::max(1, G4int(std::ceil(length / fSubStep)));
+    for (G4int i = 0; i < nSub; ++i) {
+        G4ThreeVector point = start + (i + 0.5) / nSub * delta;
+        G4int voxel = Voxel(point.x(), point.y(), point.z());
+        if (voxel >= 0)
+            fEvent[voxel] += weight * length / nSub / mm;
+    }
+}
+
+/**
+ * @brief Forward tallies, or close the adjoint photon of the event.
+ * @param event Event summary (emission point and detected photons).
+ */
+void OpticalSimulationLightCollectionMap::Fill(const RunTallyEvent &event) {
+    if (fMode == "forward") {
+        G4int voxel = Voxel(event.x * mm, event.y * mm, event.z * mm);
+        if (voxel < 0)
+            return;
+        fLocal.sums[kThrown][voxel]++;
+        fLocal.sums[kDetected][voxel] += event.detected;
+    } else if (IsAdjoint()) {
+        for (const auto &[voxel, flux] : fEvent) {
+            fLocal.sums[kFlux][voxel] += flux;
+            fLocal.sums[kFlux2][voxel] += flux * flux;
+        }
+        fEvent.clear();
+    }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4int OpticalSimulationLightCollectionMap::Voxel(G4double x, G4double y,
+                                                 G4double z) const {
+    const G4int bins[3] = {fBinsX, fBinsY, fBinsZ};
+    for (G4int v = 0; v < kNVolumes; ++v) {
+        const G4double pos[3] = {x, y, z - fCentreZ[v]};
+        G4int index[3];
+        G4bool inside = true;
+        for (G4int a = 0; a < 3 && inside; ++a) {
+            inside = fHalf[v][a] > 0. && std::abs(pos[a]) < fHalf[v][a];
+            index[a] = std::min(
+                G4int((pos[a] + fHalf[v][a]) / (2. * fHalf[v][a]) * bins[a]),
+                bins[a] - 1);
+        }
+        if (inside)
+            return (v * fBinsZ + index[2]) * fBinsX * fBinsY +
+                   index[1] * fBinsX + index[0];
+    }
+    return -1;
+}
+
+G4double OpticalSimulationLightCollectionMap::SourceArea(
+    const Results &totals) const {
+    if (totals.source[kTried] <= 0.)
+        return 0.;
+    return totals.source[kAcceptedArea] / totals.source[kTried] * mm * mm;
+}
+
+void OpticalSimulationLightCollectionMap::Estimate(
+    const Results &totals, G4bool adjoint, std::vector<G4double> &lce,
+    std::vector<G4double> &error) const {
+    size_t nBins = totals.sums[kThrown].size();
+    lce.assign(nBins, 0.);
+    error.assign(nBins, 0.);
+    G4int nVoxels = fBinsX * fBinsY * fBinsZ;
+
+    for (size_t i = 0; i < nBins; ++i) {
+        if (!adjoint) {
+            G4double n = totals.sums[kThrown][i];
+            if (n <= 0.)
+                continue;
+            lce[i] = totals.sums[kDetected][i] / n;
+            error[i] = std::sqrt(std::max(lce[i] * (1. - lce[i]), 0.) / n);
+            continue;
+        }
+        G4double n = totals.source[kPhotons];
+        if (n <= 0.)
+            continue;
+        G4int v = i / nVoxels;
+        G4double volume = 8. * fHalf[v][0] * fHalf[v][1] * fHalf[v][2] /
+                          nVoxels / (mm * mm * mm);
+        G4double norm = SourceArea(totals) / (mm * mm) / (4. * n * volume);
+        G4double sum = totals.sums[kFlux][i];
+        G4double var = std::max(totals.sums[kFlux2][i] - sum * sum / n, 0.);
+        lce[i] = norm * sum;
+        error[i] = norm * std::sqrt(var);
+    }
+}
+
+void OpticalSimulationLightCollectionMap::MergeIntoRunTotals() const {
+    if (fMode == "off")
+        return;
+    RunTotals::Merge(fLocal);
+}
+
+void OpticalSimulationLightCollectionMap::ResetRunTotals() {
+    RunTotals::Clear();
+}
+
+/**
+ * @brief Add the raw tallies written by WriteRunTotals() in a previous
+ * output (same mode and binning).
+ */
+void OpticalSimulationLightCollectionMap::LoadRunTotals(TFile *file) const {
+    if (fMode == "off" || !file)
+        return;
+
+    G4int nVoxels = fBinsX * fBinsY * fBinsZ;
+    G4int first = IsAdjoint() ? kFlux : kThrown;
+    Results stored;
+    stored.Reset(kNVolumes * nVoxels);
+
+    for (G4int v = 0; v < kNVolumes; ++v) {
+        for (G4int t = first; t < first + 2; ++t) {
+            auto *h = file->Get<TH3D>(
+                (G4String(tallyNames[t]) + volumeNames[v]).c_str());
+            if (!h || h->GetNbinsX() != fBinsX || h->GetNbinsY() != fBinsY ||
+                h->GetNbinsZ() != fBinsZ) {
+                G4cerr << "Warning: no matching " << fMode
+                       << " LCE tallies in " << file->GetName() << G4endl;
+                return;
+            }
+            for (G4int i = 0; i < nVoxels; ++i)
+                stored.sums[t][v * nVoxels + i] = h->GetBinContent(
+                    h->GetBin(i % fBinsX + 1, i / fBinsX % fBinsY + 1,
+                              i / (fBinsX * fBinsY) + 1));
+        }
+    }
+
+    if (IsAdjoint()) {
+        auto *source = file->Get<TH1D>("lce_adjoint_source");
+        if (!source)
+            return;
+        for (G4int s = 0; s < kNSource; ++s)
+            stored.source[s] = source->GetBinContent(s + 1);
+    }
+
+    RunTotals::Merge(stored);
+}
+
+/**
+ * @brief Print the volume-averaged LCE and the comparison with the
+ * forward reference.
+ */
+void OpticalSimulationLightCollectionMap::PrintRunTotals() const {
+    if (fMode == "off" || GetRunTotals().sums[kThrown].empty())
+        return;
+
+    std::vector<G4double> lce, error;
+    Estimate(GetRunTotals(), IsAdjoint(), lce, error);
+    G4int nVoxels = fBinsX * fBinsY * fBinsZ;
+
+    G4cout << "\n---------------- Light collection (" << fMode
+           << ") ----------------" << G4endl;
+    if (IsAdjoint())
+        G4cout << "     Adjoint photons      : "
+               << GetRunTotals().source[kPhotons] << "  (photocathode area "
+               << SourceArea(GetRunTotals()) / cm2 << " cm2)" << G4endl;
+    for (G4int v = 0; v < kNVolumes; ++v) {
+        G4double mean = 0., var = 0.;
+        for (G4int i = v * nVoxels; i < (v + 1) * nVoxels; ++i) {
+            mean += lce[i] / nVoxels;
+            var += error[i] * error[i] / nVoxels / nVoxels;
+        }
+        G4cout << "     Mean LCE " << volumeNames[v] << " : " << mean
+               << " +/- " << std::sqrt(var) << G4endl;
+    }
+
+    // Validation of the adjoint maps against a forward run
+    if (IsAdjoint() && !fReference.empty()) {
+        TFile reference(fReference.c_str(), "READ");
+        Results forward;
+        forward.Reset(kNVolumes * nVoxels);
+        G4bool ok = !reference.IsZombie();
+        for (G4int v = 0; v < kNVolumes && ok; ++v) {
+            auto *thrown = reference.Get<TH3D>(
+                (G4String("lce_forward_thrown_") + volumeNames[v]).c_str());
+            auto *detected = reference.Get<TH3D>(
+                (G4String("lce_forward_detected_") + volumeNames[v]).c_str());
+            ok = thrown && detected && thrown->GetNbinsX() == fBinsX &&
+                 thrown->GetNbinsY() == fBinsY &&
+                 thrown->GetNbinsZ() == fBinsZ;
+            for (G4int i = 0; ok && i < nVoxels; ++i) {
+                G4int bin = thrown->GetBin(i % fBinsX + 1,
+                                           i / fBinsX % fBinsY + 1,
+                                           i / (fBinsX * fBinsY) + 1);
+                forward.sums[kThrown][v * nVoxels + i] =
+                    thrown->GetBinContent(bin);
+                forward.sums[kDetected][v * nVoxels + i] =
+                    detected->GetBinContent(bin);
+            }
+        }
+        if (!ok) {
+            G4cerr << "Error: no forward LCE maps with the same binning in "
+                   << fReference << G4endl;
+        } else {
+            std::vector<G4double> lceForward, errorForward;
+            Estimate(forward, false, lceForward, errorForward);
+            for (G4int v = 0; v < kNVolumes; ++v) {
+                G4double chi2 = 0., sumAdjoint = 0., sumForward = 0.;
+                G4int ndf = 0;
+                for (G4int i = v * nVoxels; i < (v + 1) * nVoxels; ++i) {
+                    G4double sigma2 = error[i] * error[i] +
+                                      errorForward[i] * errorForward[i];
+                    if (forward.sums[kThrown][i] <= 0. || sigma2 <= 0.)
+                        continue;
+                    chi2 += std::pow(lce[i] - lceForward[i], 2) / sigma2;
+                    sumAdjoint += lce[i];
+                    sumForward += lceForward[i];
+                    ndf++;
+                }
+                if (ndf == 0)
+                    continue;
+                G4cout << "     " << volumeNames[v]
+                       << " adjoint/forward : "
+                       << (sumForward > 0. ? sumAdjoint / sumForward : 0.)
+                       << "  chi2/ndf = " << chi2 << "/" << ndf << G4endl;
+            }
+        }
+    }
+    G4cout << "------------------------------------------------------------"
+           << G4endl;
+}
+
+/**
+ * @brief Write the raw tallies (hadd-mergeable) and the LCE maps.
+ */
+void OpticalSimulationLightCollectionMap::WriteRunTotals(TFile *file) const {
+    if (fMode == "off" || !file || GetRunTotals().sums[kThrown].empty())
+        return;
+
+    file->cd();
+    std::vector<G4double> lce, error;
+    Estimate(GetRunTotals(), IsAdjoint(), lce, error);
+    G4int nVoxels = fBinsX * fBinsY * fBinsZ;
+
+    G4int first = IsAdjoint() ? kFlux : kThrown;
+
+    for (G4int v = 0; v < kNVolumes; ++v) {
+        auto book = [&](const G4String &name, const char *title) {
+            return new TH3D(name.c_str(), title, fBinsX, -fHalf[v][0] / mm,
+                            fHalf[v][0] / mm, fBinsY, -fHalf[v][1] / mm,
+                            fHalf[v][1] / mm, fBinsZ,
+                            (fCentreZ[v] - fHalf[v][2]) / mm,
+                            (fCentreZ[v] + fHalf[v][2]) / mm);
+        };
+        std::vector<TH3D *> histograms;
+        for (G4int t = first; t < first + 2; ++t)
+            histograms.push_back(
+                book(G4String(tallyNames[t]) + volumeNames[v],
+                     ";x [mm];y [mm];z [mm]"));
+        TH3D *map = book(G4String("lce_") + volumeNames[v],
+                         ";x [mm];y [mm];z [mm]");
+
+        for (G4int i = 0; i < nVoxels; ++i) {
+            G4int bin = map->GetBin(i % fBinsX + 1, i / fBinsX % fBinsY + 1,
+                                    i / (fBinsX * fBinsY) + 1);
+            for (G4int t = 0; t < 2; ++t)
+                histograms[t]->SetBinContent(
+                    bin, GetRunTotals().sums[first + t][v * nVoxels + i]);
+            map->SetBinContent(bin, lce[v * nVoxels + i]);
+            map->SetBinError(bin, error[v * nVoxels + i]);
+        }
+        for (TH3D *h : histograms) {
+            h->Write();
+            delete h;
+        }
+        map->Write();
+        delete map;
+    }
+
+    if (IsAdjoint()) {
+        TH1D source("lce_adjoint_source",
+                    ";;Photons, tried points, accepted area sum [mm2]",
+                    kNSource, 0, kNSource);
+        for (G4int s = 0; s < kNSource; ++s)
+            source.SetBinContent(s + 1, GetRunTotals().source[s]);
+        source.Write();
+    }
+}
@@ -0,0 +1,312 @@
+/**
+ * @file OpticalSimulationMonitor.cc
+ * @brief Implementation of the live run monitor.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The HTTP side is deliberately minimal: one request per connection, GET
+ * only, answered and closed by the monitoring thread. The socket is bound
+ * to the loopback interface; use an SSH tunnel to follow a remote run.
+ */
+
+#include "OpticalSimulationMonitor.hh"
+#include "G4Run.hh"
+#include "G4RunManager.hh"
+#include "G4Threading.hh"
+#include <algorithm>
+#include <arpa/inet.h>
+#include "G4ios.hh"
+#include <iomanip>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <unistd.h>
+
+std::unique_ptr<OpticalSimulationMonitor::Slot[]>
+    OpticalSimulationMonitor::fSlots;
+G4int OpticalSimulationMonitor::fNSlots = 0;
+G4int OpticalSimulationMonitor::fRunID = 0;
+G4long OpticalSimulationMonitor::fEventsToProcess = 0;
+OpticalSimulationMonitor::Clock::time_point OpticalSimulationMonitor::fStart;
+std::thread OpticalSimulationMonitor::fThread;
+std::atomic<G4bool> OpticalSimulationMonitor::fStop{false};
+
+namespace {
+//! Relaxed read of a counter
+G4long Get(const std::atomic<G4long> &counter) {
+    return counter.load(std::memory_order_relaxed);
+}
+
+//! Increment of a counter with a single writer (no locked instruction)
+void Increment(std::atomic<G4long> &counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+}
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationMonitor::OpticalSimulationMonitor() {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/monitor/",
+                                        "Live run monitor");
+
+    fMessenger->DeclareProperty("setHttp", fHttp)
+        .SetGuidance("Serve the progress and online histograms over HTTP "
+                     "on 127.0.0.1.")
+        .SetParameterName("Http", false)
+        .SetDefaultValue("false");
+
+    fMessenger->DeclareProperty("setPort", fPort)
+        .SetGuidance("Port of the HTTP endpoint.")
+        .SetParameterName("Port", false)
+        .SetRange("Port>0 && Port<65536")
+        .SetDefaultValue("8765");
+
+    fMessenger->DeclareProperty("setInterval", fInterval)
+        .SetGuidance("Seconds between two progress lines (0: none).")
+        .SetParameterName("Interval", false)
+        .SetRange("Interval>=0")
+        .SetDefaultValue("0");
+}
+
+OpticalSimulationMonitor::~OpticalSimulationMonitor() {
+    delete fMessenger;
+    if (G4Threading::IsMasterThread())
+        EndOfRun();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationMonitor::BeginOfRun(const G4Run *run) const {
+    EndOfRun();
+
+    // Slot 0 also serves the sequential run manager (thread ID -1)
+    G4int nThreads = G4RunManager::GetRunManager()->GetNumberOfThreads();
+    fNSlots = std::max(1, nThreads);
+    fSlots.reset(new Slot[fNSlots]);
+    fRunID = run->GetRunID();
+    fEventsToProcess = run->GetNumberOfEventToBeProcessed();
+    fStart = Clock::now();
+
+    if (!fHttp && fInterval <= 0.)
+        return;
+    fStop = false;
+    fThread = std::thread(&OpticalSimulationMonitor::Run, fHttp, fPort,
+                          fInterval);
+}
+
+void OpticalSimulationMonitor::Fill(const RunTallyEvent &event,
+                                    G4double discriminant,
+                                    G4bool newEvent) const {
+    G4int thread = std::max(0, G4Threading::G4GetThreadId());
+    if (!fSlots || thread >= fNSlots)
+        return;
+    Slot &slot = fSlots[thread];
+
+    G4int source = Source::GetSourceType(event.sourcePDG);
+    Increment(slot.counts[source][event.eventClass]);
+    if (event.eventClass != Source::kUndetected) {
+        G4int bin = std::min(G4int(discriminant * Source::kDiscriminantBins),
+                             Source::kDiscriminantBins - 1);
+        Increment(slot.discriminant[source][std::max(bin, 0)]);
+    }
+    Increment(slot.photons[std::min(event.detected, kPhotonBins - 1)]);
+    if (newEvent)
+        Increment(slot.events);
+}
+
+void OpticalSimulationMonitor::EndOfRun() const {
+    if (!fThread.joinable())
+        return;
+    fStop = true;
+    fThread.join();
+    if (fInterval > 0.)
+        G4cerr << Progress() << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationMonitor::Run(G4bool http, G4int port,
+                                   G4double interval) {
+    G4int server = -1;
+    if (http) {
+        server = socket(AF_INET, SOCK_STREAM, 0);
+        G4int yes = 1;
+        setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (server < 0 ||
+            bind(server, reinterpret_cast<sockaddr *>(&address),
+                 sizeof(address)) < 0 ||
+            listen(server, 8) < 0) {
+            G4cerr << "Warning: monitor cannot listen on 127.0.0.1:" << port
+                   << G4endl;
+            if (server >= 0)
+                close(server);
+            server = -1;
+        } else
+            G4cerr << "Monitor on http://127.0.0.1:" << port << "/" << G4endl;
+    }
+
+    Clock::time_point lastPrint = Clock::now();
+    while (!fStop) {
+        if (server >= 0) {
+            pollfd request{server, POLLIN, 0};
+            if (poll(&request, 1, 200) > 0) {
+                G4int connection = accept(server, nullptr, nullptr);
+                if (connection >= 0) {
+                    Respond(connection);
+                    close(connection);
+                }
+            }
+        } else
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        std::chrono::duration<double> sincePrint = Clock::now() - lastPrint;
+        if (interval > 0. && sincePrint.count() >= interval) {
+            G4cerr << Progress() << G4endl;
+            lastPrint = Clock::now();
+        }
+    }
+
+    if (server >= 0)
+        close(server);
+}
+
+void OpticalSimulationMonitor::Respond(G4int connection) {
+    // A silent client must not hold the monitoring thread
+    timeval timeout{1, 0};
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+               sizeof(timeout));
+
+    G4String request;
+    char buffer[1024];
+    ssize_t n;
+    while (request.find("\r\n\r\n") == std::string::npos &&
+           request.size() < 8192 &&
+           (n = recv(connection, buffer, sizeof(buffer), 0)) > 0)
+        request.append(buffer, n);
+
+    std::istringstream is(request);
+    G4String method, path;
+    is >> method >> path;
+
+    G4String status = "200 OK", type = "text/plain", body;
+    if (method != "GET") {
+        status = "405 Method Not Allowed";
+        body = "GET only\n";
+    } else if (path == "/")
+        body = Text();
+    else if (path == "/status.json") {
+        type = "application/json";
+        body = Json();
+    } else {
+        status = "404 Not Found";
+        body = "Pages: / /status.json\n";
+    }
+
+    std::ostringstream os;
+    os << "HTTP/1.1 " << status << "\r\nContent-Type: " << type
+       << "; charset=utf-8\r\nContent-Length: " << body.size()
+       << "\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n"
+       << body;
+    G4String reply = os.str();
+    send(connection, reply.data(), reply.size(), MSG_NOSIGNAL);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String OpticalSimulationMonitor::Progress() {
+    G4long events = 0;
+    for (G4int t = 0; t < fNSlots; ++t)
+        events += Get(fSlots[t].events);
+    std::chrono::duration<double> elapsed = Clock::now() - fStart;
+    G4double rate = elapsed.count() > 0. ? events / elapsed.count() : 0.;
+
+    std::ostringstream os;
+    os << "Run " << fRunID << ": " << events << "/" << fEventsToProcess
+       << " events";
+    if (fEventsToProcess > 0)
+        os << " (" << std::fixed << std::setprecision(1)
+           << 100. * events / fEventsToProcess << " %)";
+    os << " | " << std::fixed << std::setprecision(1) << rate << " ev/s";
+    if (rate > 0. && fEventsToProcess > events)
+        os << " | ETA = " << (fEventsToProcess - events) / rate / 60.
+           << " min";
+    return os.str();
+}
+
+G4String OpticalSimulationMonitor::Text() {
+    std::chrono::duration<double> elapsed = Clock::now() - fStart;
+    std::ostringstream os;
+    os << Progress() << "\n\nthread      events      ev/s\n";
+    for (G4int t = 0; t < fNSlots; ++t) {
+        G4long events = Get(fSlots[t].events);
+        os << std::setw(6) << t << std::setw(12) << events << std::setw(10)
+           << std::fixed << std::setprecision(1)
+           << (elapsed.count() > 0. ? events / elapsed.count() : 0.)
+           << "\n";
+    }
+    return os.str();
+}
+
+G4String OpticalSimulationMonitor::Json() {
+    std::chrono::duration<double> elapsed = Clock::now() - fStart;
+    G4long total = 0;
+    std::ostringstream threads;
+    for (G4int t = 0; t < fNSlots; ++t) {
+        G4long events = Get(fSlots[t].events);
+        total += events;
+        threads << (t ? "," : "") << events;
+    }
+    G4double rate = elapsed.count() > 0. ? total / elapsed.count() : 0.;
+    G4double eta = rate > 0. && fEventsToProcess > total
+                       ? (fEventsToProcess - total) / rate
+                       : 0.;
+
+    std::ostringstream os;
+    os << "{\"run\":" << fRunID << ",\"events\":" << total
+       << ",\"eventsToProcess\":" << fEventsToProcess
+       << ",\"elapsed\":" << elapsed.count() << ",\"rate\":" << rate
+       << ",\"eta\":" << eta << ",\"threadEvents\":[" << threads.str()
+       << "]";
+
+    // Sums over the slots of one counter array
+    auto sum = [](auto member) {
+        G4long value = 0;
+        for (G4int t = 0; t < fNSlots; ++t)
+            value += Get(member(fSlots[t]));
+        return value;
+    };
+
+    os << ",\"classification\":{";
+    for (G4int s = 0; s < Source::kNSourceTypes; ++s) {
+        os << (s ? "," : "") << "\"" << Source::SourceName(s) << "\":{";
+        for (G4int c = 0; c < Source::kNEventClasses; ++c)
+            os << (c ? "," : "") << "\"" << Source::ClassName(c)
+               << "\":" << sum([&](Slot &slot) -> std::atomic<G4long> & {
+                      return slot.counts[s][c];
+                  });
+        os << "}";
+    }
+    os << "},\"discriminant\":{";
+    for (G4int s = 0; s < Source::kNSourceTypes; ++s) {
+        os << (s ? "," : "") << "\"" << Source::SourceName(s) << "\":[";
+        for (G4int b = 0; b < Source::kDiscriminantBins; ++b)
+            os << (b ? "," : "")
+               << sum([&](Slot &slot) -> std::atomic<G4long> & {
+                      return slot.discriminant[s][b];
+                  });
+        os << "]";
+    }
+    os << "},\"detectedPhotons\":[";
+    for (G4int b = 0; b < kPhotonBins; ++b)
+        os << (b ? "," : "") << sum([&](Slot &slot) -> std::atomic<G4long> & {
+            return slot.photons[b];
+        });
+    os << "]}\n";
+    return os.str();
+}
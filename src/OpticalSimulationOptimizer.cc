@@ -0,0 +1,529 @@
+/**
+ * @file OpticalSimulationOptimizer.cc
+ * @brief Implementation of the Bayesian design optimizer.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Gaussian-process model on the normalized parameters u in [0, 1]^d:
+ *   k(u, u') = exp(-|u - u'|^2 / (2 l^2)),
+ *   K = k(U, U) + diag(sigma_i^2),
+ * with the outputs standardized by their mean and spread. The next point
+ * maximizes the expected improvement over the best evaluation, searched on
+ * random candidates and on perturbations of the best point.
+ *
+ * Each evaluation writes `<name>_eval<i>.root` (moved to ../Resultats) and
+ * one line of the history `<name>_optimizer.csv`.
+ */
+
+#include "OpticalSimulationOptimizer.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "OpticalSimulationOutput.hh"
+#include "OpticalSimulationRunAction.hh"
+#include "Randomize.hh"
+#include "CLHEP/Random/MixMaxRng.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationOptimizer::OpticalSimulationOptimizer(const G4String &name,
+                                                       size_t nThreads,
+                                                       G4bool pMT)
+    : fName(name), fNThreads(nThreads), flag_MT(pMT) {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/optimizer/",
+                                        "Simulation-in-the-loop optimization");
+
+    fMessenger
+        ->DeclareMethod("addParameter",
+                        &OpticalSimulationOptimizer::AddParameter)
+        .SetGuidance("Add an optimized parameter: <command> <min> <max> "
+                     "[unit] (e.g. /OpticalSimulation/geometry/"
+                     "setZnSThickness 5 50 um).")
+        .SetParameterName("Definition", false);
+
+    fMessenger
+        ->DeclareMethod("clearParameters",
+                        &OpticalSimulationOptimizer::ClearParameters)
+        .SetGuidance("Remove all the optimized parameters.");
+
+    fMessenger->DeclareProperty("setObjective", fObjective)
+        .SetGuidance("Maximized quantity: separation (beta rejection at a "
+                     "fixed alpha efficiency), efficiency, efficiency_alpha "
+                     "or efficiency_beta.")
+        .SetParameterName("Objective", false)
+        .SetCandidates("separation efficiency efficiency_alpha "
+                       "efficiency_beta")
+        .SetDefaultValue("separation");
+
+    fMessenger->DeclareProperty("setAlphaEfficiency", fAlphaEfficiency)
+        .SetGuidance("Alpha efficiency at which the separation is computed.")
+        .SetParameterName("AlphaEfficiency", false)
+        .SetRange("AlphaEfficiency>0. && AlphaEfficiency<=1.")
+        .SetDefaultValue("0.9");
+
+    fMessenger->DeclareProperty("setEvaluations", fEvaluations)
+        .SetGuidance("Total number of evaluations, history included.")
+        .SetParameterName("Evaluations", false)
+        .SetRange("Evaluations>0")
+        .SetDefaultValue("30");
+
+    fMessenger->DeclareProperty("setInitialPoints", fInitialPoints)
+        .SetGuidance("Size of the initial Latin hypercube (0: 2 d + 1).")
+        .SetParameterName("InitialPoints", false)
+        .SetRange("InitialPoints>=0")
+        .SetDefaultValue("0");
+
+    fMessenger->DeclareProperty("setSeed", fSeed)
+        .SetGuidance("Seed of the initial Latin hypercube: the same seed "
+                     "draws the same design, so that a resumed run "
+                     "completes the design of the interrupted one.")
+        .SetParameterName("Seed", false)
+        .SetRange("Seed>0")
+        .SetDefaultValue("12345");
+
+    fMessenger->DeclareProperty("setMaxEvents", fMaxEvents)
+        .SetGuidance("Maximum number of events of one evaluation.")
+        .SetParameterName("MaxEvents", false)
+        .SetDefaultValue("100000");
+
+    fMessenger->DeclareProperty("setPrecision", fPrecision)
+        .SetGuidance("Relative precision stopping each evaluation (see "
+                     "/OpticalSimulation/precision/); 0 runs MaxEvents.")
+        .SetParameterName("Precision", false)
+        .SetDefaultValue("0.02");
+
+    fMessenger->DeclareProperty("setLengthScale", fLengthScale)
+        .SetGuidance("Kernel length scale on the normalized parameters.")
+        .SetParameterName("LengthScale", false)
+        .SetRange("LengthScale>0.")
+        .SetDefaultValue("0.3");
+
+    fMessenger->DeclareProperty("setCandidates", fCandidates)
+        .SetGuidance("Number of candidates of the expected improvement "
+                     "search.")
+        .SetParameterName("Candidates", false)
+        .SetRange("Candidates>0")
+        .SetDefaultValue("5000");
+
+    fMessenger->DeclareProperty("setHistory", fHistory)
+        .SetGuidance("History file (default ../Resultats/<name>_optimizer."
+                     "csv); an existing history is resumed.")
+        .SetParameterName("History", false);
+
+    fMessenger->DeclareMethod("run", &OpticalSimulationOptimizer::Run)
+        .SetGuidance("Run (or resume) the optimization.");
+}
+
+OpticalSimulationOptimizer::~OpticalSimulationOptimizer() {
+    delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationOptimizer::AddParameter(G4String definition) {
+    std::istringstream is(definition);
+    Parameter parameter;
+    if (!(is >> parameter.command >> parameter.min >> parameter.max) ||
+        parameter.max <= parameter.min) {
+        G4cerr << "Error: optimizer parameter must be <command> <min> <max> "
+                  "[unit], got "
+               << definition << G4endl;
+        return;
+    }
+    is >> parameter.unit;
+    fParameters.push_back(parameter);
+}
+
+G4String OpticalSimulationOptimizer::HistoryName() const {
+    return fHistory.empty() ? "../Resultats/" + fName + "_optimizer.csv"
+                            : fHistory;
+}
+
+/**
+ * @brief Reload the evaluations of a previous optimization.
+ * @return False when the history was written for other parameters.
+ */
+G4bool OpticalSimulationOptimizer::LoadHistory() {
+    fEvaluationsDone.clear();
+    std::ifstream csv(HistoryName());
+    if (!csv.is_open())
+        return true;
+
+    std::string line;
+    std::getline(csv, line);
+    std::string expected = "evaluation";
+    for (const auto &p : fParameters)
+        expected += "," + p.command;
+    expected += ",objective,error,events,seconds";
+    if (line != expected) {
+        G4cerr << "Error: " << HistoryName()
+               << " was written for other parameters" << G4endl;
+        return false;
+    }
+
+    while (std::getline(csv, line)) {
+        std::istringstream is(line);
+        std::string field;
+        std::vector<G4double> values;
+        try {
+            while (std::getline(is, field, ','))
+                values.push_back(std::stod(field));
+        } catch (const std::exception &) {
+            // Line truncated by an interrupted optimization
+            G4cerr << "Warning: malformed line skipped in " << HistoryName()
+                   << G4endl;
+            continue;
+        }
+        if (values.size() != fParameters.size() + 5)
+            continue;
+        Evaluation e;
+        e.x.assign(values.begin() + 1, values.begin() + 1 + fParameters.size());
+        e.objective = values[fParameters.size() + 1];
+        e.error = values[fParameters.size() + 2];
+        e.events = G4long(values[fParameters.size() + 3]);
+        e.seconds = values[fParameters.size() + 4];
+        fEvaluationsDone.push_back(e);
+    }
+    G4cout << "### Optimizer: " << fEvaluationsDone.size()
+           << " evaluations reloaded from " << HistoryName() << G4endl;
+    return true;
+}
+
+void OpticalSimulationOptimizer::AppendHistory(
+    const Evaluation &evaluation) const {
+    G4bool header = !std::ifstream(HistoryName()).good();
+    std::ofstream csv(HistoryName(), std::ios::app);
+    if (header) {
+        csv << "evaluation";
+        for (const auto &p : fParameters)
+            csv << "," << p.command;
+        csv << ",objective,error,events,seconds\n";
+    }
+    csv << std::setprecision(10) << fEvaluationsDone.size() - 1;
+    for (G4double x : evaluation.x)
+        csv << "," << x;
+    csv << "," << evaluation.objective << "," << evaluation.error << ","
+        << evaluation.events << "," << evaluation.seconds << "\n";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationOptimizer::Objective(
+    const OpticalSimulationClassifier::Results &results, G4double &value,
+    G4double &error) const {
+    using C = OpticalSimulationClassifier;
+    if (fObjective == "separation") {
+        G4double misid = results.BetaMisidAtAlphaEfficiency(fAlphaEfficiency);
+        G4long nBeta = std::max<G4long>(results.Total(C::kSourceBeta), 1);
+        value = 1. - misid;
+        error = std::sqrt(std::max(misid * (1. - misid), 1. / nBeta) / nBeta);
+    } else if (fObjective == "efficiency_alpha") {
+        value = results.DetectionEfficiency(C::kSourceAlpha);
+        error = results.DetectionEfficiencyError(C::kSourceAlpha);
+    } else if (fObjective == "efficiency_beta") {
+        value = results.DetectionEfficiency(C::kSourceBeta);
+        error = results.DetectionEfficiencyError(C::kSourceBeta);
+    } else {
+        G4long n = 0, undetected = 0;
+        for (G4int s = 0; s < C::kNSourceTypes; ++s) {
+            n += results.Total(s);
+            undetected += results.counts[s][C::kUndetected];
+        }
+        n = std::max<G4long>(n, 1);
+        value = 1. - G4double(undetected) / n;
+        error = std::sqrt(std::max(value * (1. - value), 1. / n) / n);
+    }
+}
+
+/**
+ * @brief Apply the parameter values of a point and simulate it.
+ *
+ * The geometry is rebuilt only when one of its parameters has changed since
+ * the previous evaluation.
+ */
+OpticalSimulationOptimizer::Evaluation
+OpticalSimulationOptimizer::Evaluate(const std::vector<G4double> &x) {
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+
+    G4bool rebuild = false;
+    for (size_t i = 0; i < fParameters.size(); ++i) {
+        const Parameter &p = fParameters[i];
+        std::ostringstream command;
+        command << std::setprecision(10) << p.command << " " << x[i] << " "
+                << p.unit;
+        UI->ApplyCommand(command.str());
+        if (p.command.find("/OpticalSimulation/geometry/") == 0 &&
+            (fApplied.size() != x.size() || fApplied[i] != x[i]))
+            rebuild = true;
+    }
+    fApplied = x;
+    if (rebuild)
+        UI->ApplyCommand("/run/reinitializeGeometry");
+
+    // Short run stopped by the precision monitor
+    std::ostringstream target;
+    target << "/OpticalSimulation/precision/setTarget " << fPrecision;
+    UI->ApplyCommand(target.str());
+    UI->ApplyCommand("/OpticalSimulation/precision/setQuantities " +
+                     G4String(fObjective == "separation"
+                                  ? "efficiency_alpha efficiency_beta"
+                                  : fObjective));
+
+    G4String name = fName + "_eval" + std::to_string(fEvaluationsDone.size());
+    UI->ApplyCommand("/OpticalSimulation/run/setOutputName " + name);
+
+    auto start = std::chrono::steady_clock::now();
+    G4RunManager::GetRunManager()->BeamOn(fMaxEvents);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    if (flag_MT)
+        OpticalSimulationOutput::MergeThreadFiles(name, fNThreads);
+    OpticalSimulationOutput::MoveToResults(name);
+
+    Evaluation e;
+    e.x = x;
+    Objective(OpticalSimulationClassifier::GetRunTotals(), e.objective,
+              e.error);
+    const G4Run *run = G4RunManager::GetRunManager()->GetCurrentRun();
+    e.events = run ? run->GetNumberOfEvent() : fMaxEvents;
+    e.seconds = elapsed.count();
+    return e;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::vector<G4double>
+OpticalSimulationOptimizer::Normalize(const std::vector<G4double> &x) const {
+    std::vector<G4double> u(x.size());
+    for (size_t i = 0; i < x.size(); ++i)
+        u[i] = (x[i] - fParameters[i].min) /
+               (fParameters[i].max - fParameters[i].min);
+    return u;
+}
+
+void OpticalSimulationOptimizer::Fit() {
+    size_t n = fEvaluationsDone.size();
+    fChol.assign(n, std::vector<G4double>(n, 0.));
+    fAlpha.assign(n, 0.);
+    if (n == 0)
+        return;
+
+    // Standardized outputs
+    fMean = 0.;
+    for (const auto &e : fEvaluationsDone)
+        fMean += e.objective / n;
+    G4double var = 0.;
+    for (const auto &e : fEvaluationsDone)
+        var += std::pow(e.objective - fMean, 2) / n;
+    fScale = var > 0. ? std::sqrt(var) : 1.;
+
+    // Covariance and its Cholesky factor
+    auto kernel = [this](const std::vector<G4double> &a,
+                         const std::vector<G4double> &b) {
+        G4double d2 = 0.;
+        for (size_t i = 0; i < a.size(); ++i)
+            d2 += (a[i] - b[i]) * (a[i] - b[i]);
+        return std::exp(-0.5 * d2 / (fLengthScale * fLengthScale));
+    };
+    std::vector<std::vector<G4double>> u;
+    for (const auto &e : fEvaluationsDone)
+        u.push_back(Normalize(e.x));
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j <= i; ++j) {
+            G4double s = kernel(u[i], u[j]);
+            if (i == j)
+                s += std::pow(fEvaluationsDone[i].error / fScale, 2) + 1e-6;
+            for (size_t k = 0; k < j; ++k)
+                s -= fChol[i][k] * fChol[j][k];
+            fChol[i][j] = (i == j) ? std::sqrt(std::max(s, 1e-12))
+                                   : s / fChol[j][j];
+        }
+    }
+
+    // alpha = K^-1 (y - mean) / scale by forward and backward substitution
+    std::vector<G4double> z(n);
+    for (size_t i = 0; i < n; ++i) {
+        G4double s = (fEvaluationsDone[i].objective - fMean) / fScale;
+        for (size_t k = 0; k < i; ++k)
+            s -= fChol[i][k] * z[k];
+        z[i] = s / fChol[i][i];
+    }
+    for (size_t i = n; i-- > 0;) {
+        G4double s = z[i];
+        for (size_t k = i + 1; k < n; ++k)
+            s -= fChol[k][i] * fAlpha[k];
+        fAlpha[i] = s / fChol[i][i];
+    }
+}
+
+void OpticalSimulationOptimizer::Predict(const std::vector<G4double> &u,
+                                         G4double &mean,
+                                         G4double &sigma) const {
+    size_t n = fEvaluationsDone.size();
+    std::vector<G4double> k(n), v(n);
+    for (size_t i = 0; i < n; ++i) {
+        std::vector<G4double> ui = Normalize(fEvaluationsDone[i].x);
+        G4double d2 = 0.;
+        for (size_t a = 0; a < u.size(); ++a)
+            d2 += (u[a] - ui[a]) * (u[a] - ui[a]);
+        k[i] = std::exp(-0.5 * d2 / (fLengthScale * fLengthScale));
+    }
+    G4double m = 0., var = 1.;
+    for (size_t i = 0; i < n; ++i) {
+        m += k[i] * fAlpha[i];
+        G4double s = k[i];
+        for (size_t j = 0; j < i; ++j)
+            s -= fChol[i][j] * v[j];
+        v[i] = s / fChol[i][i];
+        var -= v[i] * v[i];
+    }
+    mean = fMean + fScale * m;
+    sigma = fScale * std::sqrt(std::max(var, 1e-12));
+}
+
+/**
+ * @brief Next point to evaluate.
+ */
+std::vector<G4double> OpticalSimulationOptimizer::Propose() {
+    size_t d = fParameters.size();
+    size_t nInitial = fInitialPoints > 0 ? fInitialPoints : 2 * d + 1;
+    auto denormalize = [this](const std::vector<G4double> &u) {
+        std::vector<G4double> x(u.size());
+        for (size_t i = 0; i < u.size(); ++i)
+            x[i] = fParameters[i].min +
+                   u[i] * (fParameters[i].max - fParameters[i].min);
+        return x;
+    };
+
+    // Initial Latin hypercube, drawn from its own engine seeded by fSeed:
+    // a resumed run redraws the same design and skips its done part
+    if (fEvaluationsDone.size() < nInitial) {
+        if (fLatin.size() != nInitial) {
+            CLHEP::MixMaxRng engine(fSeed);
+            fLatin.assign(nInitial, std::vector<G4double>(d));
+            for (size_t a = 0; a < d; ++a) {
+                std::vector<size_t> strata(nInitial);
+                std::iota(strata.begin(), strata.end(), 0);
+                for (size_t i = nInitial; i > 1; --i)
+                    std::swap(strata[i - 1],
+                              strata[size_t(engine.flat() * i) % i]);
+                for (size_t i = 0; i < nInitial; ++i)
+                    fLatin[i][a] = (strata[i] + engine.flat()) / nInitial;
+            }
+        }
+        return denormalize(fLatin[fEvaluationsDone.size()]);
+    }
+
+    // Expected improvement over the best evaluation
+    Fit();
+    const Evaluation *best = &fEvaluationsDone.front();
+    for (const auto &e : fEvaluationsDone)
+        if (e.objective > best->objective)
+            best = &e;
+    std::vector<G4double> bestU = Normalize(best->x);
+    G4double xi = 0.01 * fScale;
+
+    std::vector<G4double> proposal = bestU;
+    G4double bestEI = -1.;
+    for (G4int c = 0; c < fCandidates; ++c) {
+        std::vector<G4double> u(d);
+        for (size_t a = 0; a < d; ++a) {
+            u[a] = (c % 2 == 0) ? G4UniformRand()
+                                : bestU[a] + 0.05 * G4RandGauss::shoot();
+            u[a] = std::min(std::max(u[a], 0.), 1.);
+        }
+        G4double mean, sigma;
+        Predict(u, mean, sigma);
+        G4double z = (mean - best->objective - xi) / sigma;
+        G4double ei = (mean - best->objective - xi) * 0.5 *
+                          std::erfc(-z / std::sqrt(2.)) +
+                      sigma * std::exp(-0.5 * z * z) / std::sqrt(twopi);
+        if (ei > bestEI) {
+            bestEI = ei;
+            proposal = u;
+        }
+    }
+    return denormalize(proposal);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Run or resume the optimization.
+ */
+void OpticalSimulationOptimizer::Run() {
+    if (fParameters.empty()) {
+        G4cerr << "Error: no optimizer parameter defined" << G4endl;
+        return;
+    }
+    // Every objective is read from the in-run classifier totals
+    auto *runAction = static_cast<OpticalSimulationRunAction *>(
+        G4RunManager::GetRunManager()->GetUserRunAction());
+    if (!runAction->GetClassifier().IsEnabled()) {
+        G4cerr << "Error: the optimizer objective " << fObjective
+               << " needs the classifier (/OpticalSimulation/classifier/"
+                  "setEnabled true)"
+               << G4endl;
+        return;
+    }
+    if (!LoadHistory())
+        return;
+    fHasRun = true;
+    fApplied.clear();
+    fLatin.clear();
+
+    // Precision configuration of the macro, restored at the end
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    G4String target =
+        UI->GetCurrentValues("/OpticalSimulation/precision/setTarget");
+    G4String quantities = runAction->GetPrecisionMonitor().GetQuantities();
+
+    while (G4int(fEvaluationsDone.size()) < fEvaluations) {
+        std::vector<G4double> x = Propose();
+        G4cout << "\n### Optimizer: evaluation " << fEvaluationsDone.size()
+               << " / " << fEvaluations << G4endl;
+        fEvaluationsDone.push_back(Evaluate(x));
+        AppendHistory(fEvaluationsDone.back());
+
+        const Evaluation &e = fEvaluationsDone.back();
+        G4cout << "### Optimizer: " << fObjective << " = " << e.objective
+               << " +/- " << e.error << " (" << e.events << " events, "
+               << e.seconds << " s)" << G4endl;
+    }
+
+    // The precision settings of the evaluations only apply to them
+    UI->ApplyCommand("/OpticalSimulation/precision/setTarget " + target);
+    UI->ApplyCommand("/OpticalSimulation/precision/setQuantities " +
+                     quantities);
+
+    Report();
+}
+
+void OpticalSimulationOptimizer::Report() const {
+    if (fEvaluationsDone.empty())
+        return;
+    const Evaluation *best = &fEvaluationsDone.front();
+    for (const auto &e : fEvaluationsDone)
+        if (e.objective > best->objective)
+            best = &e;
+
+    G4cout << "\n---------------- Optimizer summary (" << fObjective
+           << ") ----------------" << G4endl;
+    G4cout << "     Evaluations : " << fEvaluationsDone.size() << G4endl;
+    G4cout << "     Best        : " << best->objective << " +/- "
+           << best->error << G4endl;
+    for (size_t i = 0; i < fParameters.size(); ++i)
+        G4cout << "       " << fParameters[i].command << " " << best->x[i]
+               << " " << fParameters[i].unit << G4endl;
+    G4cout << "     History     : " << HistoryName() << G4endl;
+    G4cout << "------------------------------------------------------------"
+           << G4endl;
+}
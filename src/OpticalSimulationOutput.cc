@@ -0,0 +1,159 @@
+/**
+ * @file OpticalSimulationOutput.cc
+ * @brief Implementation of the ROOT output file helpers.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Files are handled through /control/shell so that the behaviour is the same
+ * as in the original batch mode (hadd -k -f, rm -f, mv ../Resultats). The
+ * top-up extension needs to merge the trees only and uses TFileMerger. The
+ * event-key indices are rebuilt on the merged trees.
+ */
+
+#include "OpticalSimulationOutput.hh"
+#include "G4UImanager.hh"
+#include "G4ios.hh"
+#include "TClass.h"
+#include "TFile.h"
+#include "TFileMerger.h"
+#include "TKey.h"
+#include "TTree.h"
+#include <fstream>
+
+const std::vector<G4String> &OpticalSimulationOutput::TreeNames() {
+    static const std::vector<G4String> names = {
+        "Input", "ZnS", "Scintillator", "Optical", "Steps", "Outliers"};
+    return names;
+}
+
+void OpticalSimulationOutput::BuildIndex(TTree *tree) {
+    if (!tree || tree->GetEntries() == 0)
+        return;
+    // Sub-events of a batched event (at most 1024) get their own key
+    if (tree->GetBranch("subevent"))
+        tree->BuildIndex("segment * 65536 + run", "event * 1024 + subevent");
+    else
+        tree->BuildIndex("segment * 65536 + run", "event");
+}
+
+void OpticalSimulationOutput::BuildIndices(const G4String &file) {
+    TFile output(file.c_str(), "UPDATE");
+    if (output.IsZombie())
+        return;
+    for (const auto &name : TreeNames()) {
+        auto *tree = output.Get<TTree>(name.c_str());
+        if (!tree || !tree->GetBranch("event"))
+            continue;
+        BuildIndex(tree);
+        tree->Write("", TObject::kOverwrite);
+    }
+}
+
+G4String OpticalSimulationOutput::ThreadFileName(const G4String &name,
+                                                 G4int index) {
+    return name + "_" + std::to_string(index) + ".root";
+}
+
+void OpticalSimulationOutput::MergeThreadFiles(const G4String &name,
+                                               size_t nThreads) {
+    // File _0 (master) holds the run-level results
+    std::vector<G4String> inputs;
+    for (size_t i = 0; i <= nThreads; ++i)
+        inputs.push_back(ThreadFileName(name, i));
+    Merge(name + ".root", inputs);
+    // Entries of the threads follow each other: index the merged trees
+    BuildIndices(name + ".root");
+}
+
+void OpticalSimulationOutput::Merge(const G4String &target,
+                                    const std::vector<G4String> &inputs,
+                                    G4bool removeInputs) {
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+
+    G4String mergeCommand = "/control/shell hadd -k -f " + target;
+    for (const auto &input : inputs)
+        mergeCommand += " " + input;
+    UI->ApplyCommand(mergeCommand);
+
+    if (!removeInputs)
+        return;
+    for (const auto &input : inputs)
+        UI->ApplyCommand("/control/shell rm -f " + input);
+}
+
+G4bool OpticalSimulationOutput::Extend(const G4String &target,
+                                       const G4String &addition) {
+    G4String merged = addition + ".extended";
+    {
+        TFile input(addition.c_str(), "READ");
+        if (input.IsZombie()) {
+            G4cerr << "Error: cannot open " << addition << G4endl;
+            return false;
+        }
+
+        // Trees from both files
+        TFileMerger merger(kFALSE);
+        merger.OutputFile(merged.c_str(), "RECREATE");
+        merger.AddFile(target.c_str());
+        merger.AddFile(addition.c_str());
+        std::vector<TKey *> others;
+        for (TObject *object : *input.GetListOfKeys()) {
+            auto *key = static_cast<TKey *>(object);
+            TClass *cl = TClass::GetClass(key->GetClassName());
+            if (cl && cl->InheritsFrom(TTree::Class()))
+                merger.AddObjectNames(key->GetName());
+            else
+                others.push_back(key);
+        }
+        if (!merger.PartialMerge(TFileMerger::kAll | TFileMerger::kRegular |
+                                 TFileMerger::kOnlyListed)) {
+            G4cerr << "Error: merging " << addition << " into " << target
+                   << " failed" << G4endl;
+            return false;
+        }
+
+        // Run-level results and bookkeeping from the addition only
+        TFile output(merged.c_str(), "UPDATE");
+        for (TKey *key : others) {
+            TObject *object = key->ReadObj();
+            output.cd();
+            object->Write(key->GetName(), TObject::kOverwrite);
+            delete object;
+        }
+    }
+    BuildIndices(merged);
+
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    UI->ApplyCommand("/control/shell mv " + merged + " " + target);
+    UI->ApplyCommand("/control/shell rm -f " + addition);
+    return true;
+}
+
+void OpticalSimulationOutput::MoveToResults(const G4String &name) {
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    UI->ApplyCommand("/control/shell mv " + name + ".root ../Resultats");
+    G4cout << "Output saved in Resultats folder to file " << name << ".root"
+           << G4endl;
+
+    // Chunked output: the chunks listed in the manifest follow it
+    if (!std::ifstream(name + ".manifest"))
+        return;
+    auto entries = ManifestEntries(name + ".manifest");
+    for (const auto &entry : entries)
+        UI->ApplyCommand("/control/shell mv " +
+                         entry.substr(0, entry.find(' ')) + " ../Resultats");
+    UI->ApplyCommand("/control/shell mv " + name + ".manifest ../Resultats");
+    G4cout << entries.size() << " chunk files listed in " << name
+           << ".manifest" << G4endl;
+}
+
+std::vector<G4String>
+OpticalSimulationOutput::ManifestEntries(const G4String &manifest) {
+    std::vector<G4String> entries;
+    std::ifstream in(manifest);
+    G4String line;
+    while (std::getline(in, line))
+        if (!line.empty() && line[0] != '#')
+            entries.push_back(line);
+    return entries;
+}
@@ -32,6 +32,9 @@
  */
 
 #include "OpticalSimulationPhysics.hh"
+#include "G4OpticalPhoton.hh"
+#include "OpticalSimulationFresnelBoundary.hh"
+#include "OpticalSimulationQuenching.hh"
 
 // ============================================================
 // Constructor
@@ -106,6 +109,10 @@ OpticalSimulationPhysics::OpticalSimulationPhysics() {
     // opticalParams->SetVerboseLevel(2);
 
     RegisterPhysics(new G4OpticalPhysics());
+
+    // Light tables of the scintillation by particle type (commands needed
+    // before /run/initialize)
+    OpticalSimulationQuenching::getInstance();
 }
 
 // ============================================================
@@ -116,3 +123,31 @@ OpticalSimulationPhysics::OpticalSimulationPhysics() {
  * constructors).
  */
 OpticalSimulationPhysics::~OpticalSimulationPhysics() {}
+
+// ============================================================
+// Processes
+// ============================================================
+/**
+ * @brief Constructs the processes of the registered modules, then replaces
+ * the OpBoundary process of the optical photon by
+ * OpticalSimulationFresnelBoundary.
+ *
+ * Without registered interfaces the replacement behaves exactly as
+ * G4OpBoundaryProcess.
+ */
+void OpticalSimulationPhysics::ConstructProcess() {
+    G4VModularPhysicsList::ConstructProcess();
+
+    G4ProcessManager *manager =
+        G4OpticalPhoton::Definition()->GetProcessManager();
+    G4ProcessVector *processes = manager->GetProcessList();
+    for (size_t i = 0; i < processes->size(); ++i) {
+        G4VProcess *process = (*processes)[i];
+        if (process->GetProcessName() == "OpBoundary") {
+            manager->RemoveProcess(process);
+            delete process;
+            break;
+        }
+    }
+    manager->AddDiscreteProcess(new OpticalSimulationFresnelBoundary());
+}
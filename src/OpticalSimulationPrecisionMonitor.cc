@@ -0,0 +1,225 @@
+/**
+ * @file OpticalSimulationPrecisionMonitor.cc
+ * @brief Implementation of the precision-targeted run termination.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Batches are filled per thread without locking; the shared statistics are
+ * only touched once per completed batch. The stop decision is taken under
+ * the same mutex and exposed through an atomic flag read at every event.
+ */
+
+#include "OpticalSimulationPrecisionMonitor.hh"
+#include "G4RunManager.hh"
+#include "OpticalSimulationClassifier.hh"
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+std::array<OpticalSimulationPrecisionMonitor::BatchStatistics,
+           OpticalSimulationPrecisionMonitor::kNQuantities>
+    OpticalSimulationPrecisionMonitor::fRunTotals;
+std::atomic<G4bool> OpticalSimulationPrecisionMonitor::fStop(false);
+
+namespace {
+//! Mutex protecting the shared batch statistics
+G4Mutex precisionMutex = G4MUTEX_INITIALIZER;
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double OpticalSimulationPrecisionMonitor::BatchStatistics::Error() const {
+    if (nBatches < 2)
+        return std::numeric_limits<G4double>::infinity();
+    G4double mean = Mean();
+    G4double var = (sum2 - nBatches * mean * mean) / (nBatches - 1);
+    return var > 0. ? std::sqrt(var / nBatches) : 0.;
+}
+
+G4double
+OpticalSimulationPrecisionMonitor::BatchStatistics::RelativeError() const {
+    G4double mean = Mean();
+    if (mean <= 0.)
+        return std::numeric_limits<G4double>::infinity();
+    return Error() / mean;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Constructor.
+ *
+ * Declares the commands under /OpticalSimulation/precision/.
+ */
+OpticalSimulationPrecisionMonitor::OpticalSimulationPrecisionMonitor() {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/precision/",
+                                        "Precision-targeted run termination");
+
+    fMessenger->DeclareProperty("setTarget", fTarget)
+        .SetGuidance("Target relative uncertainty (e.g. 0.005); 0 disables "
+                     "the early termination.")
+        .SetParameterName("Target", false)
+        .SetDefaultValue("0.");
+
+    fMessenger->DeclareProperty("setBatchSize", fBatchSize)
+        .SetGuidance("Number of events per batch and per thread.")
+        .SetParameterName("BatchSize", false)
+        .SetRange("BatchSize>0")
+        .SetDefaultValue("1000");
+
+    fMessenger->DeclareProperty("setMinBatches", fMinBatches)
+        .SetGuidance("Minimum number of batches before stopping.")
+        .SetParameterName("MinBatches", false)
+        .SetRange("MinBatches>1")
+        .SetDefaultValue("10");
+
+    fMessenger
+        ->DeclareMethod("setQuantities",
+                        &OpticalSimulationPrecisionMonitor::SetQuantities)
+        .SetGuidance("Space separated list of monitored quantities among "
+                     "efficiency, efficiency_alpha, efficiency_beta, "
+                     "photons.")
+        .SetParameterName("Quantities", false)
+        .SetDefaultValue("efficiency");
+
+    SetQuantities(fQuantityList);
+}
+
+/**
+ * @brief Destructor.
+ */
+OpticalSimulationPrecisionMonitor::~OpticalSimulationPrecisionMonitor() {
+    delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char *OpticalSimulationPrecisionMonitor::QuantityName(G4int q) {
+    static const char *names[kNQuantities] = {
+        "efficiency", "efficiency_alpha", "efficiency_beta", "photons"};
+    return names[q];
+}
+
+void OpticalSimulationPrecisionMonitor::SetQuantities(G4String list) {
+    fQuantityList = list;
+    fMonitored.fill(false);
+
+    std::istringstream is(list);
+    G4String name;
+    while (is >> name) {
+        G4bool found = false;
+        for (G4int q = 0; q < kNQuantities; ++q) {
+            if (name == QuantityName(q)) {
+                fMonitored[q] = true;
+                found = true;
+            }
+        }
+        if (!found)
+            G4cerr << "Warning: unknown precision quantity " << name
+                   << G4endl;
+    }
+}
+
+void OpticalSimulationPrecisionMonitor::BeginOfRun() {
+    fBatchSum.fill(0.);
+    fBatchEvents.fill(0);
+    fAborted = false;
+}
+
+void OpticalSimulationPrecisionMonitor::ResetRunTotals() {
+    G4AutoLock lock(&precisionMutex);
+    fRunTotals.fill(BatchStatistics());
+    fStop = false;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Accumulate one event in the thread-local batches.
+ * @param event Event summary already processed by the classifier.
+ */
+void OpticalSimulationPrecisionMonitor::Fill(const RunTallyEvent &event) {
+    if (!IsEnabled())
+        return;
+
+    G4bool detected =
+        event.eventClass != OpticalSimulationClassifier::kUndetected;
+    G4int source = OpticalSimulationClassifier::GetSourceType(event.sourcePDG);
+
+    std::array<G4bool, kNQuantities> concerned{};
+    std::array<G4double, kNQuantities> value{};
+    concerned[kEfficiency] = true;
+    value[kEfficiency] = detected;
+    concerned[kEfficiencyAlpha] =
+        source == OpticalSimulationClassifier::kSourceAlpha;
+    value[kEfficiencyAlpha] = detected;
+    concerned[kEfficiencyBeta] =
+        source == OpticalSimulationClassifier::kSourceBeta;
+    value[kEfficiencyBeta] = detected;
+    concerned[kPhotons] = true;
+    value[kPhotons] = event.detected;
+
+    for (G4int q = 0; q < kNQuantities; ++q) {
+        if (!fMonitored[q] || !concerned[q])
+            continue;
+        fBatchSum[q] += value[q];
+        if (++fBatchEvents[q] == fBatchSize) {
+            PublishBatch(q, fBatchSum[q] / fBatchSize);
+            fBatchSum[q] = 0.;
+            fBatchEvents[q] = 0;
+        }
+    }
+
+    // Soft abort: the current event is completed, no new event is started
+    if (fStop.load(std::memory_order_relaxed) && !fAborted) {
+        fAborted = true;
+        G4RunManager::GetRunManager()->AbortRun(true);
+    }
+}
+
+void OpticalSimulationPrecisionMonitor::PublishBatch(G4int q, G4double mean) {
+    G4AutoLock lock(&precisionMutex);
+
+    BatchStatistics &stats = fRunTotals[q];
+    stats.nBatches++;
+    stats.sum += mean;
+    stats.sum2 += mean * mean;
+
+    if (fStop)
+        return;
+
+    for (G4int i = 0; i < kNQuantities; ++i) {
+        if (!fMonitored[i])
+            continue;
+        if (fRunTotals[i].nBatches < fMinBatches ||
+            fRunTotals[i].RelativeError() > fTarget)
+            return;
+    }
+    fStop = true;
+}
+
+/**
+ * @brief Print the estimates and reached precision (master, end of run).
+ */
+void OpticalSimulationPrecisionMonitor::PrintRunTotals() const {
+    if (!IsEnabled())
+        return;
+
+    G4cout << "\n---------------- Precision monitor (target "
+           << fTarget * 100. << " %) ----------------" << G4endl;
+    G4cout << (fStop ? "Target reached, run stopped early"
+                     : "Target not reached within the event cap")
+           << G4endl;
+    for (G4int q = 0; q < kNQuantities; ++q) {
+        if (!fMonitored[q])
+            continue;
+        const BatchStatistics &s = fRunTotals[q];
+        G4cout << "     " << std::setw(17) << std::left << QuantityName(q)
+               << std::right << ": " << s.Mean() << " +/- " << s.Error()
+               << " (" << s.RelativeError() * 100. << " %, " << s.nBatches
+               << " batches of " << fBatchSize << ")" << G4endl;
+    }
+    G4cout << "------------------------------------------------------------"
+           << G4endl;
+}
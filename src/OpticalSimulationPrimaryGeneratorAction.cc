@@ -8,46 +8,46 @@
  * optical simulation.
  *
  *  1. **Geant4 GeneralParticleSource (GPS)**: Standard Geant4 particle
- * generation.
+ * generation, optionally several independent primaries per event.
  *
  * Features:
- *  - Thread-safe generation using atomic counters and per-thread UI handling.
- *  - Progress display with estimated remaining simulation time.
+ *  - One generator per thread, no state shared between the threads.
+ *  - Progress is reported by OpticalSimulationMonitor (run action).
  *
  * Usage:
  *  - Instantiate the class and assign it to the Geant4 run manager via
  * `SetUserAction`.
  *
- * @note Multithreading is supported; thread 0 handles progress display.
+ * @note Multithreading is supported.
  *
  * @authors Arnaud HUBER <huber@lp2ib.in2p3.fr>
  * @date 2026
  */
 
 #include "OpticalSimulationPrimaryGeneratorAction.hh"
-
-/// Global counter of generated particles (atomic to support multithreading).
-std::atomic<size_t> currentParticleNumber{0};
-
-/// Global pointer to the Geant4 UI manager.
-G4UImanager *UI = G4UImanager::GetUIpointer();
+#include "G4Event.hh"
 
 /**
  * @brief Constructor for the primary generator action.
  *
  * Initializes the particle source, and
  * the associated UI messenger.
- *
- * @param N Total number of events to generate.
- * @param numThreads Number of threads used for multithreaded execution.
- * @param pMT Flag indicating whether multithreading is enabled.
  */
 OpticalSimulationPrimaryGeneratorAction::
-    OpticalSimulationPrimaryGeneratorAction(size_t N, size_t numThreads,
-                                            G4bool pMT)
-    : NEventsGenerated(N), numThreads(numThreads),
-      G4VUserPrimaryGeneratorAction(), flag_MT(pMT) {
+    OpticalSimulationPrimaryGeneratorAction()
+    : G4VUserPrimaryGeneratorAction() {
     particleSource = new G4GeneralParticleSource();
+
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/generator/",
+                                        "Primary generation");
+
+    fMessenger->DeclareProperty("setPrimariesPerEvent", fPrimariesPerEvent)
+        .SetGuidance("Independent GPS primaries packed in one event, each "
+                     "written as a sub-event (GPS sampling only, at most "
+                     "1024).")
+        .SetParameterName("Primaries", false)
+        .SetRange("Primaries>=1 && Primaries<=1024")
+        .SetDefaultValue("1");
 }
 
 /**
@@ -58,49 +58,7 @@ OpticalSimulationPrimaryGeneratorAction::
 OpticalSimulationPrimaryGeneratorAction::
     ~OpticalSimulationPrimaryGeneratorAction() {
     delete particleSource;
-}
-
-/**
- * @brief Display the progress of event generation.
- *
- * Prints a progress bar along with an estimate of the remaining simulation
- * time.
- *
- * @param progress Fraction of events completed (between 0 and 1).
- * @param startTime Start time of the simulation.
- */
-void OpticalSimulationPrimaryGeneratorAction::ShowProgress(
-    const double progress,
-    std::chrono::high_resolution_clock::time_point startTime) {
-    int barWidth = 70;
-    std::ostringstream oss;
-
-    oss << "\r["; // retour chariot pour écraser la ligne
-    int pos = static_cast<int>(barWidth * progress);
-    for (int i = 0; i < barWidth; ++i) {
-        if (i < pos)
-            oss << "=";
-        else if (i == pos)
-            oss << ">";
-        else
-            oss << " ";
-    }
-    oss << "] " << int(progress * 100.0) << " %";
-
-    auto currentTime = std::chrono::high_resolution_clock::now();
-    auto elapsedTime = std::chrono::duration_cast<std::chrono::seconds>(
-                           currentTime - startTime)
-                           .count();
-
-    double averageTimePerProgress =
-        (progress > 0.0) ? (elapsedTime / progress) : 0.0;
-    double estimatedRemainingTime = (1.0 - progress) * averageTimePerProgress;
-
-    oss << " | ETA = " << std::fixed << std::setprecision(1)
-        << estimatedRemainingTime / 60.0 << " min";
-
-    if (progress > 0.01)
-        std::cerr << oss.str() << std::flush;
+    delete fMessenger;
 }
 
 /**
@@ -113,19 +71,36 @@ void OpticalSimulationPrimaryGeneratorAction::ShowProgress(
  */
 void OpticalSimulationPrimaryGeneratorAction::GeneratePrimaries(
     G4Event *anEvent) {
-    if (!isStartTimeInitialized) {
-        startTime = std::chrono::high_resolution_clock::now();
-        isStartTimeInitialized = true;
+    fBatchSize = 1;
+
+    // Replay of a watchdog outlier: random status saved before its primaries
+    if (fWatchdog)
+        fWatchdog->RestoreReplayStatus();
+
+    // Replay of recorded ionisation steps: their photons are the primaries
+    if (fStepReplay && fStepReplay->IsReplaying()) {
+        fStepReplay->SamplePrimary(anEvent);
+        return;
     }
 
+    // Batches only for plain GPS: the sampling modes set the first primary
+    G4bool sampled = (fResponseMatrix && fResponseMatrix->IsEnabled()) ||
+                     (fUniformityMap && fUniformityMap->IsEnabled()) ||
+                     (fQuasiRandom && fQuasiRandom->IsEnabled()) ||
+                     (fLightCollectionMap && fLightCollectionMap->IsAdjoint());
+    if (fPrimariesPerEvent > 1 && !sampled)
+        fBatchSize = fPrimariesPerEvent;
+
     // ############################ CASE 1 : GENERATION FROM GPS
     // ############################
-    particleSource->GeneratePrimaryVertex(anEvent);
-    ++currentParticleNumber;
-
-    if (threadID == 0) {
-        ShowProgress(static_cast<double>(currentParticleNumber) /
-                         double(NEventsGenerated),
-                     startTime);
-    }
+    for (G4int k = 0; k < fBatchSize; ++k)
+        particleSource->GeneratePrimaryVertex(anEvent);
+    if (fResponseMatrix)
+        fResponseMatrix->SamplePrimary(anEvent);
+    if (fUniformityMap)
+        fUniformityMap->SamplePosition(anEvent);
+    if (fQuasiRandom)
+        fQuasiRandom->SamplePrimary(anEvent);
+    if (fLightCollectionMap)
+        fLightCollectionMap->SamplePrimary(anEvent);
 }
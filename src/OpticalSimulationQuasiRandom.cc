@@ -0,0 +1,415 @@
+/**
+ * @file OpticalSimulationQuasiRandom.cc
+ * @brief Implementation of the scrambled Sobol sampler.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The Sobol direction numbers are those of Joe and Kuo (new-joe-kuo-6.21201)
+ * for the first dimensions. Scrambling follows the hash-based nested uniform
+ * scrambling of Burley (2020): bit reversal, Laine-Karras permutation, bit
+ * reversal. Each (replicate, dimension) pair has its own scrambling seed.
+ */
+
+#include "OpticalSimulationQuasiRandom.hh"
+#include "G4Event.hh"
+#include "G4Material.hh"
+#include "G4ParticleTable.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4SystemOfUnits.hh"
+#include "OpticalSimulationGeometryConstruction.hh"
+#include "TFile.h"
+#include "TH1D.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+//! Joe-Kuo primitive polynomials (degree s, coefficients a) and initial m_k
+struct SobolParameters {
+    G4int s;
+    G4int a;
+    std::uint32_t m[5];
+};
+
+const SobolParameters sobolParameters[] = {
+    {0, 0, {0}},                // dimension 0: van der Corput
+    {1, 0, {1}},                // dimension 1
+    {2, 1, {1, 3}},             // dimension 2
+    {3, 1, {1, 3, 1}},          // dimension 3
+    {3, 2, {1, 1, 1}},          // dimension 4
+    {4, 1, {1, 1, 3, 3}},       // dimension 5
+    {4, 4, {1, 3, 5, 13}},      // dimension 6
+    {5, 2, {1, 1, 5, 5, 17}}};  // dimension 7
+
+//! Direction numbers v_k (k = 0..31) of every dimension
+struct DirectionNumbers {
+    std::uint32_t v[OpticalSimulationQuasiRandom::kNDimensions][32];
+
+    DirectionNumbers() {
+        for (G4int d = 0; d < OpticalSimulationQuasiRandom::kNDimensions;
+             ++d) {
+            const SobolParameters &p = sobolParameters[d];
+            if (d == 0) {
+                for (G4int k = 0; k < 32; ++k)
+                    v[d][k] = 1u << (31 - k);
+                continue;
+            }
+            for (G4int k = 0; k < p.s; ++k)
+                v[d][k] = p.m[k] << (31 - k);
+            for (G4int k = p.s; k < 32; ++k) {
+                v[d][k] = v[d][k - p.s] ^ (v[d][k - p.s] >> p.s);
+                for (G4int j = 1; j < p.s; ++j)
+                    if ((p.a >> (p.s - 1 - j)) & 1)
+                        v[d][k] ^= v[d][k - j];
+            }
+        }
+    }
+};
+
+const DirectionNumbers directionNumbers;
+
+std::uint32_t ReverseBits(std::uint32_t x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+std::uint32_t Hash(std::uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationQuasiRandom::Results::Reset(size_t nReplicates) {
+    for (G4int t = 0; t < kNTallies; ++t)
+        sums[t].assign(nReplicates, 0.);
+}
+
+void OpticalSimulationQuasiRandom::Results::Clear() {
+    for (auto &s : sums)
+        s.clear();
+}
+
+void OpticalSimulationQuasiRandom::Results::Merge(const Results &other) {
+    AddTallies(sums, other.sums);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Constructor.
+ *
+ * Declares the commands under /OpticalSimulation/qmc/.
+ */
+OpticalSimulationQuasiRandom::OpticalSimulationQuasiRandom() {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/qmc/",
+                                        "Quasi-Monte-Carlo (Sobol) sampling");
+
+    fMessenger->DeclareProperty("setEnabled", fEnabled)
+        .SetGuidance("Use scrambled Sobol points in the primary generator.")
+        .SetParameterName("Enabled", false)
+        .SetDefaultValue("true");
+
+    fMessenger->DeclareProperty("setReplicates", fReplicates)
+        .SetGuidance("Number of independent scramblings (error estimate).")
+        .SetParameterName("Replicates", false)
+        .SetRange("Replicates>1")
+        .SetDefaultValue("8");
+
+    fMessenger->DeclareProperty("setSeed", fSeed)
+        .SetGuidance("Seed of the scramblings.")
+        .SetParameterName("Seed", false)
+        .SetDefaultValue("12345");
+
+    fMessenger->DeclareProperty("setEventOffset", fEventOffset)
+        .SetGuidance("Number of events of previous runs: the points "
+                     "continue their sequences (statistics top-up).")
+        .SetParameterName("EventOffset", false)
+        .SetRange("EventOffset>=0")
+        .SetDefaultValue("0");
+
+    fMessenger->DeclareProperty("setDirection", fDirection)
+        .SetGuidance("Primary direction: gps (unchanged), isotropic or "
+                     "forward (hemisphere towards +z).")
+        .SetParameterName("Direction", false)
+        .SetCandidates("gps isotropic forward")
+        .SetDefaultValue("gps");
+
+    fMessenger->DeclareProperty("setPhotonScan", fPhotonScan)
+        .SetGuidance("Photon-emission scan: the primary is an optical photon "
+                     "emitted uniformly in the given volume.")
+        .SetParameterName("PhotonScan", false)
+        .SetCandidates("off ZnS Scintillator")
+        .SetDefaultValue("off");
+}
+
+/**
+ * @brief Destructor.
+ */
+OpticalSimulationQuasiRandom::~OpticalSimulationQuasiRandom() {
+    delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::uint32_t OpticalSimulationQuasiRandom::Sobol(std::uint32_t index,
+                                                  G4int dimension) {
+    std::uint32_t x = 0;
+    for (G4int k = 0; index != 0; ++k, index >>= 1)
+        if (index & 1)
+            x ^= directionNumbers.v[dimension][k];
+    return x;
+}
+
+std::uint32_t OpticalSimulationQuasiRandom::Scramble(std::uint32_t x,
+                                                     std::uint32_t seed) {
+    x = ReverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return ReverseBits(x);
+}
+
+G4double OpticalSimulationQuasiRandom::Sample(G4long eventID,
+                                              G4int dimension) const {
+    std::uint32_t replicate = Replicate(eventID);
+    std::uint32_t index = (eventID + fEventOffset) / fReplicates;
+    std::uint32_t seed =
+        Hash(fSeed ^ Hash(replicate * kNDimensions + dimension + 1));
+    std::uint32_t x = Scramble(Sobol(index, dimension), seed);
+    return (x + 0.5) / 4294967296.;
+}
+
+G4ThreeVector OpticalSimulationQuasiRandom::Direction(G4double u,
+                                                      G4double v) const {
+    G4double cosTheta = (fDirection == "forward") ? u : 2. * u - 1.;
+    G4double sinTheta = std::sqrt(std::max(0., 1. - cosTheta * cosTheta));
+    G4double phi = twopi * v;
+    return G4ThreeVector(sinTheta * std::cos(phi), sinTheta * std::sin(phi),
+                         cosTheta);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Build the inverse CDF of the emission spectrum and reset the sums.
+ */
+void OpticalSimulationQuasiRandom::BeginOfRun() {
+    fLocal.Reset(fReplicates);
+    fEmissionEnergy.clear();
+    fEmissionCDF.clear();
+
+    if (!fEnabled || fPhotonScan == "off")
+        return;
+
+    G4Material *material =
+        G4Material::GetMaterial(fPhotonScan == "ZnS" ? "ZnS" : "EJ212");
+    G4MaterialPropertiesTable *mpt =
+        material ? material->GetMaterialPropertiesTable() : nullptr;
+    G4MaterialPropertyVector *spectrum =
+        mpt ? mpt->GetProperty("SCINTILLATIONCOMPONENT1") : nullptr;
+    if (!spectrum || spectrum->GetVectorLength() < 2) {
+        G4cerr << "Error: no emission spectrum for the photon scan"
+               << G4endl;
+        return;
+    }
+
+    // Piecewise linear CDF (trapezoids between the tabulated points)
+    G4double sum = 0.;
+    fEmissionEnergy.push_back(spectrum->Energy(0));
+    fEmissionCDF.push_back(0.);
+    for (size_t i = 1; i < spectrum->GetVectorLength(); ++i) {
+        sum += 0.5 * ((*spectrum)[i] + (*spectrum)[i - 1]) *
+               (spectrum->Energy(i) - spectrum->Energy(i - 1));
+        fEmissionEnergy.push_back(spectrum->Energy(i));
+        fEmissionCDF.push_back(sum);
+    }
+    for (auto &c : fEmissionCDF)
+        c /= sum;
+}
+
+/**
+ * @brief Override the primary generated by GPS.
+ * @param event Event whose first primary vertex has been filled by GPS.
+ */
+void OpticalSimulationQuasiRandom::SamplePrimary(G4Event *event) const {
+    if (!fEnabled || !event->GetPrimaryVertex(0))
+        return;
+
+    G4long id = event->GetEventID();
+    G4PrimaryVertex *vertex = event->GetPrimaryVertex(0);
+    G4PrimaryParticle *primary = vertex->GetPrimary(0);
+
+    if (fPhotonScan == "off" || !fGeometry || fEmissionCDF.empty()) {
+        if (fDirection != "gps")
+            primary->SetMomentumDirection(
+                Direction(Sample(id, kDirectionCosTheta),
+                          Sample(id, kDirectionPhi)));
+        return;
+    }
+
+    // Emission point uniform in the ZnS:Ag or scintillator box
+    G4bool zns = (fPhotonScan == "ZnS");
+    G4double length = (zns ? fGeometry->GetZnSLength()
+                           : fGeometry->GetScintillatorLength()) * mm;
+    G4double width = (zns ? fGeometry->GetZnSWidth()
+                          : fGeometry->GetScintillatorWidth()) * mm;
+    G4double thickness = (zns ? fGeometry->GetZnSThickness()
+                              : fGeometry->GetScintillatorThickness()) * mm;
+    G4double zCentre =
+        zns ? 0.
+            : 0.5 * (fGeometry->GetZnSThickness() +
+                     fGeometry->GetScintillatorThickness()) * mm;
+    vertex->SetPosition((Sample(id, kPositionU) - 0.5) * length,
+                        (Sample(id, kPositionV) - 0.5) * width,
+                        zCentre + (Sample(id, kPositionW) - 0.5) * thickness);
+
+    // Isotropic emission
+    G4double cosTheta = 2. * Sample(id, kDirectionCosTheta) - 1.;
+    G4double sinTheta = std::sqrt(std::max(0., 1. - cosTheta * cosTheta));
+    G4double phi = twopi * Sample(id, kDirectionPhi);
+    G4ThreeVector direction(sinTheta * std::cos(phi),
+                            sinTheta * std::sin(phi), cosTheta);
+
+    // Wavelength from the inverse CDF of the emission spectrum
+    G4double u = Sample(id, kWavelength);
+    size_t i = std::upper_bound(fEmissionCDF.begin(), fEmissionCDF.end(), u) -
+               fEmissionCDF.begin();
+    i = std::min(std::max<size_t>(i, 1), fEmissionCDF.size() - 1);
+    G4double t = (u - fEmissionCDF[i - 1]) /
+                 std::max(fEmissionCDF[i] - fEmissionCDF[i - 1], 1e-300);
+    G4double energy = fEmissionEnergy[i - 1] +
+                      t * (fEmissionEnergy[i] - fEmissionEnergy[i - 1]);
+
+    // Random linear polarization perpendicular to the direction
+    G4ThreeVector perpendicular = direction.orthogonal().unit();
+    perpendicular.rotate(twopi * Sample(id, kPolarization), direction);
+
+    primary->SetParticleDefinition(
+        G4ParticleTable::GetParticleTable()->FindParticle("opticalphoton"));
+    primary->SetMomentumDirection(direction);
+    primary->SetKineticEnergy(energy);
+    primary->SetPolarization(perpendicular);
+}
+
+/**
+ * @brief Accumulate one event in its replicate.
+ * @param event Event summary.
+ * @param eventID Global event ID, which selects the replicate.
+ */
+void OpticalSimulationQuasiRandom::Fill(const RunTallyEvent &event,
+                                        G4long eventID) {
+    if (!fEnabled)
+        return;
+
+    G4int r = Replicate(eventID);
+    fLocal.sums[kEvents][r] += 1.;
+    fLocal.sums[kDetected][r] += event.detected;
+    fLocal.sums[kFired][r] += (event.detected > 0);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationQuasiRandom::MergeIntoRunTotals() const {
+    if (!fEnabled)
+        return;
+    RunTotals::Merge(fLocal);
+}
+
+void OpticalSimulationQuasiRandom::ResetRunTotals() {
+    RunTotals::Clear();
+}
+
+/**
+ * @brief Add the per-replicate sums written by WriteRunTotals() in a
+ * previous output (same number of replicates).
+ */
+void OpticalSimulationQuasiRandom::LoadRunTotals(TFile *file) const {
+    if (!fEnabled || !file)
+        return;
+
+    const char *names[kNTallies] = {"qmc_replicate_events",
+                                    "qmc_replicate_detected",
+                                    "qmc_replicate_fired"};
+    Results stored;
+    stored.Reset(fReplicates);
+    for (G4int t = 0; t < kNTallies; ++t) {
+        auto *h = file->Get<TH1D>(names[t]);
+        if (!h || h->GetNbinsX() != fReplicates) {
+            G4cerr << "Warning: no matching QMC replicates in "
+                   << file->GetName() << G4endl;
+            return;
+        }
+        for (G4int r = 0; r < fReplicates; ++r)
+            stored.sums[t][r] = h->GetBinContent(r + 1);
+    }
+
+    RunTotals::Merge(stored);
+}
+
+/**
+ * @brief Print the means over replicates and their RQMC uncertainties.
+ */
+void OpticalSimulationQuasiRandom::PrintRunTotals() const {
+    const auto &events = GetRunTotals().sums[kEvents];
+    if (!fEnabled || events.empty())
+        return;
+
+    G4cout << "\n---------------- Randomized QMC (" << events.size()
+           << " replicates) ----------------" << G4endl;
+    const char *names[kNTallies] = {"", "Detected photons / event",
+                                    "Events with detection   "};
+    for (G4int t = kDetected; t < kNTallies; ++t) {
+        G4double sum = 0., sum2 = 0.;
+        G4int n = 0;
+        for (size_t r = 0; r < events.size(); ++r) {
+            if (events[r] == 0.)
+                continue;
+            G4double mean = GetRunTotals().sums[t][r] / events[r];
+            sum += mean;
+            sum2 += mean * mean;
+            n++;
+        }
+        if (n < 2)
+            continue;
+        G4double mean = sum / n;
+        G4double error =
+            std::sqrt(std::max(0., (sum2 - n * mean * mean) / (n - 1) / n));
+        G4cout << "     " << names[t] << " : " << mean << " +/- " << error
+               << G4endl;
+    }
+    G4cout << "------------------------------------------------------------"
+           << G4endl;
+}
+
+/**
+ * @brief Write the per-replicate sums (hadd-mergeable).
+ */
+void OpticalSimulationQuasiRandom::WriteRunTotals(TFile *file) const {
+    const auto &events = GetRunTotals().sums[kEvents];
+    if (!fEnabled || !file || events.empty())
+        return;
+
+    file->cd();
+    const char *names[kNTallies] = {"qmc_replicate_events",
+                                    "qmc_replicate_detected",
+                                    "qmc_replicate_fired"};
+    for (G4int t = 0; t < kNTallies; ++t) {
+        TH1D h(names[t], (G4String(names[t]) + ";Replicate;Sum").c_str(),
+               events.size(), 0, events.size());
+        for (size_t r = 0; r < events.size(); ++r)
+            h.SetBinContent(r + 1, GetRunTotals().sums[t][r]);
+        h.Write();
+    }
+}
@@ -0,0 +1,317 @@
+/**
+ * @file OpticalSimulationQuenching.cc
+ * @brief Implementation of the particle-dependent light yield tables.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The tables share one energy grid: 0, then 20 points per decade from
+ * 100 eV to 100 MeV. The Birks/Chou integral uses Simpson's rule on each
+ * interval of the grid.
+ */
+
+#include "OpticalSimulationQuenching.hh"
+#include "G4Alpha.hh"
+#include "G4Deuteron.hh"
+#include "G4Electron.hh"
+#include "G4EmCalculator.hh"
+#include "G4Material.hh"
+#include "G4MaterialPropertiesTable.hh"
+#include "G4OpticalParameters.hh"
+#include "G4Proton.hh"
+#include "G4SystemOfUnits.hh"
+#include "G4Triton.hh"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+namespace {
+//! Prefixes of the G4Scintillation properties
+const char *prefixes[OpticalSimulationQuenching::kNParticles] = {
+    "ELECTRON", "PROTON", "DEUTERON", "TRITON", "ALPHA", "ION"};
+
+//! Names of the particles in the commands
+const char *particleNames[OpticalSimulationQuenching::kNParticles] = {
+    "electron", "proton", "deuteron", "triton", "alpha", "ion"};
+
+//! Energy grid: first non-zero energy, decades and points per decade
+const G4double gridMin = 100 * eV;
+const G4int gridDecades = 6;
+const G4int gridPerDecade = 20;
+
+//! Stopping power source of each particle type (ions: alpha)
+const G4ParticleDefinition *Definition(G4int particle) {
+    switch (particle) {
+    case OpticalSimulationQuenching::kElectron:
+        return G4Electron::Definition();
+    case OpticalSimulationQuenching::kProton:
+        return G4Proton::Definition();
+    case OpticalSimulationQuenching::kDeuteron:
+        return G4Deuteron::Definition();
+    case OpticalSimulationQuenching::kTriton:
+        return G4Triton::Definition();
+    default:
+        return G4Alpha::Definition();
+    }
+}
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationQuenching *OpticalSimulationQuenching::getInstance() {
+    static OpticalSimulationQuenching *instance =
+        new OpticalSimulationQuenching();
+    return instance;
+}
+
+OpticalSimulationQuenching::OpticalSimulationQuenching() {
+    // 0.126 mm/MeV: base value of EJ-212 (see OpticalSimulationMaterials);
+    // no default for ZnS:Ag, to be set from measurements
+    fParameters["EJ212"].birks = 0.126 * mm / MeV;
+    fParameters["ZnS"];
+
+    fEnergies.push_back(0.);
+    for (G4int i = 0; i <= gridDecades * gridPerDecade; ++i)
+        fEnergies.push_back(gridMin *
+                            std::pow(10., G4double(i) / gridPerDecade));
+
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/quenching/",
+                                        "Particle-dependent light yield");
+
+    fMessenger->DeclareMethod("setBirks", &OpticalSimulationQuenching::SetBirks)
+        .SetGuidance("Birks and Chou parameters of a material: "
+                     "\"material kB [C]\", kB in mm/MeV, C in (mm/MeV)^2.")
+        .SetParameterName("Parameters", false);
+
+    fMessenger
+        ->DeclareMethod("setMeasured", &OpticalSimulationQuenching::SetMeasured)
+        .SetGuidance("Measured quenching factor of a particle: \"material "
+                     "particle file\" (columns: energy [MeV], light / (Y E)); "
+                     "particle: electron proton deuteron triton alpha ion; "
+                     "file none: back to Birks/Chou.")
+        .SetParameterName("Table", false);
+
+    fMessenger->DeclareMethod("print", &OpticalSimulationQuenching::Print)
+        .SetGuidance("Print the light of each particle relative to the "
+                     "electron (after the first run).");
+}
+
+OpticalSimulationQuenching::~OpticalSimulationQuenching() {
+    delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationQuenching::Particle
+OpticalSimulationQuenching::ParticleOf(G4int pdg) {
+    switch (pdg) {
+    case 2212:
+        return kProton;
+    case 1000010020:
+        return kDeuteron;
+    case 1000010030:
+        return kTriton;
+    case 1000020040:
+        return kAlpha;
+    default:
+        // Nuclei are ions, every other particle uses the electron table
+        return pdg > 1000000000 ? kIon : kElectron;
+    }
+}
+
+G4String OpticalSimulationQuenching::YieldProperty(G4int particle) {
+    return G4String(prefixes[particle]) + "SCINTILLATIONYIELD";
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationQuenching::SetBirks(const G4String &value) {
+    std::istringstream is(value);
+    G4String material;
+    G4double birks = 0., chou = 0.;
+    if (!(is >> material >> birks) || birks < 0.) {
+        G4cerr << "Error: setBirks needs a material and kB >= 0" << G4endl;
+        return;
+    }
+    is >> chou;
+    fParameters[material].birks = birks * mm / MeV;
+    fParameters[material].chou = chou * (mm / MeV) * (mm / MeV);
+}
+
+void OpticalSimulationQuenching::SetMeasured(const G4String &value) {
+    std::istringstream is(value);
+    G4String material, particle, file;
+    if (!(is >> material >> particle >> file)) {
+        G4cerr << "Error: setMeasured needs a material, a particle and a file"
+               << G4endl;
+        return;
+    }
+    for (G4int p = 0; p < kNParticles; ++p) {
+        if (particle == particleNames[p]) {
+            fParameters[material].measured[p] = file == "none" ? "" : file;
+            return;
+        }
+    }
+    G4cerr << "Error: unknown particle " << particle << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Fill the tables of every configured material, when the
+ * scintillation by particle type is active. Called by the master before
+ * the workers start, so the shared property tables are not modified while
+ * they are read.
+ */
+void OpticalSimulationQuenching::BuildTables() {
+    if (!G4OpticalParameters::Instance()->GetScintByParticleType())
+        return;
+    for (const auto &entry : fParameters) {
+        G4Material *material = G4Material::GetMaterial(entry.first, false);
+        if (material)
+            BuildTables(material, entry.second);
+    }
+}
+
+void OpticalSimulationQuenching::BuildTables(G4Material *material,
+                                             const Parameters &parameters) {
+    G4MaterialPropertiesTable *mpt = material->GetMaterialPropertiesTable();
+    if (!mpt || !mpt->ConstPropertyExists("SCINTILLATIONYIELD")) {
+        G4cerr << "Warning: no scintillation yield for "
+               << material->GetName() << ", no quenching table" << G4endl;
+        return;
+    }
+    G4double yield = mpt->GetConstProperty("SCINTILLATIONYIELD");
+
+    for (G4int p = 0; p < kNParticles; ++p) {
+        std::vector<G4double> light;
+        if (!parameters.measured[p].empty())
+            light = ReadMeasured(parameters.measured[p], yield);
+        if (light.empty())
+            light = Integrate(Definition(p), material, parameters, yield);
+
+        // Tables kept from one run to the next, refilled in place
+        G4String prefix = prefixes[p];
+        G4MaterialPropertyVector *table =
+            mpt->GetProperty(prefix + "SCINTILLATIONYIELD");
+        if (table && table->GetVectorLength() == fEnergies.size()) {
+            for (size_t i = 0; i < light.size(); ++i)
+                table->PutValue(i, light[i]);
+        } else {
+            mpt->AddProperty(prefix + "SCINTILLATIONYIELD", fEnergies, light);
+        }
+
+        for (G4int c = 1; c <= 3; ++c) {
+            for (G4String name : {"SCINTILLATIONYIELD",
+                                  "SCINTILLATIONTIMECONSTANT"}) {
+                name += std::to_string(c);
+                if (mpt->ConstPropertyExists(name))
+                    mpt->AddConstProperty(prefix + name,
+                                          mpt->GetConstProperty(name));
+            }
+        }
+    }
+}
+
+std::vector<G4double> OpticalSimulationQuenching::Integrate(
+    const G4ParticleDefinition *particle, const G4Material *material,
+    const Parameters &parameters, G4double yield) const {
+    G4EmCalculator calculator;
+    auto dLdE = [&](G4double energy) {
+        G4double dedx =
+            calculator.ComputeElectronicDEDX(energy, particle, material);
+        return 1. / (1. + parameters.birks * dedx +
+                     parameters.chou * dedx * dedx);
+    };
+
+    std::vector<G4double> light(fEnergies.size(), 0.);
+    G4double previous = dLdE(fEnergies[1]);
+    light[1] = yield * fEnergies[1] * previous;
+    for (size_t i = 2; i < fEnergies.size(); ++i) {
+        G4double a = fEnergies[i - 1], b = fEnergies[i];
+        G4double next = dLdE(b);
+        light[i] = light[i - 1] + yield * (b - a) / 6. *
+                                      (previous + 4. * dLdE(0.5 * (a + b)) +
+                                       next);
+        previous = next;
+    }
+    return light;
+}
+
+std::vector<G4double>
+OpticalSimulationQuenching::ReadMeasured(const G4String &file,
+                                         G4double yield) const {
+    std::ifstream input(file);
+    std::vector<std::pair<G4double, G4double>> points;
+    G4String line;
+    while (std::getline(input, line)) {
+        std::istringstream is(line);
+        G4double energy, factor;
+        if (line.empty() || line[0] == '#' || !(is >> energy >> factor))
+            continue;
+        points.emplace_back(energy * MeV, factor);
+    }
+    if (points.empty()) {
+        G4cerr << "Error: no quenching factor in " << file
+               << ", Birks/Chou used" << G4endl;
+        return {};
+    }
+    std::sort(points.begin(), points.end());
+
+    // Linear interpolation, constant beyond the measured range
+    std::vector<G4double> light(fEnergies.size(), 0.);
+    for (size_t i = 1; i < fEnergies.size(); ++i) {
+        G4double energy = fEnergies[i];
+        auto upper = std::upper_bound(
+            points.begin(), points.end(), energy,
+            [](G4double e, const std::pair<G4double, G4double> &point) {
+                return e < point.first;
+            });
+        G4double factor;
+        if (upper == points.begin())
+            factor = upper->second;
+        else if (upper == points.end())
+            factor = points.back().second;
+        else {
+            auto lower = upper - 1;
+            factor = lower->second + (upper->second - lower->second) *
+                                         (energy - lower->first) /
+                                         (upper->first - lower->first);
+        }
+        light[i] = yield * factor * energy;
+    }
+    return light;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationQuenching::Print() {
+    const G4double energies[] = {0.1 * MeV, 0.5 * MeV, 1 * MeV, 2 * MeV,
+                                 5 * MeV};
+    for (const auto &entry : fParameters) {
+        G4Material *material = G4Material::GetMaterial(entry.first, false);
+        G4MaterialPropertiesTable *mpt =
+            material ? material->GetMaterialPropertiesTable() : nullptr;
+        G4MaterialPropertyVector *electron =
+            mpt ? mpt->GetProperty("ELECTRONSCINTILLATIONYIELD") : nullptr;
+        if (!electron) {
+            G4cout << entry.first << ": no table (run with "
+                   << "/process/optical/scintillation/setByParticleType "
+                   << "true)" << G4endl;
+            continue;
+        }
+        G4cout << entry.first << ": kB " << entry.second.birks / (mm / MeV)
+               << " mm/MeV, C "
+               << entry.second.chou / ((mm / MeV) * (mm / MeV))
+               << " (mm/MeV)^2; light / electron light" << G4endl;
+        for (G4int p = kProton; p < kNParticles; ++p) {
+            G4MaterialPropertyVector *table =
+                mpt->GetProperty(G4String(prefixes[p]) + "SCINTILLATIONYIELD");
+            G4cout << "  " << particleNames[p] << ":";
+            for (G4double energy : energies)
+                G4cout << " " << energy / MeV << " MeV "
+                       << table->Value(energy) / electron->Value(energy);
+            G4cout << G4endl;
+        }
+    }
+}
@@ -0,0 +1,358 @@
+/**
+ * @file OpticalSimulationResponseMatrix.cc
+ * @brief Implementation of the detector response matrix builder.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Events are stratified on their (global) event ID: the particle is
+ * eventID % nParticles and the true energy bin (eventID / nParticles) %
+ * nBins, so that every particle and bin receives the same number of events
+ * whatever the number of threads.
+ *
+ * Histograms written by the master (raw counts, hadd-mergeable):
+ *  - response_thrown_<particle>        : thrown events per true energy bin
+ *  - response_<particle>_<observable>  : true energy vs observable
+ * with observable in ZnS (deposit, keV), Sc (deposit, keV), photons
+ * (detected) and class (undetected/alpha/beta).
+ */
+
+#include "OpticalSimulationResponseMatrix.hh"
+#include "G4Event.hh"
+#include "G4ParticleTable.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4SystemOfUnits.hh"
+#include "OpticalSimulationClassifier.hh"
+#include "Randomize.hh"
+#include "TFile.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include <cmath>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationResponseMatrix::Results::Reset(
+    size_t nParticles, size_t nTrue, const std::vector<G4int> &nObs) {
+    thrown.assign(nParticles * nTrue, 0);
+    for (G4int o = 0; o < kNObservables; ++o)
+        counts[o].assign(nParticles * nTrue * nObs[o], 0);
+}
+
+void OpticalSimulationResponseMatrix::Results::Clear() {
+    for (auto &c : counts)
+        c.clear();
+    thrown.clear();
+}
+
+void OpticalSimulationResponseMatrix::Results::Merge(const Results &other) {
+    if ((!thrown.empty() && thrown.size() != other.thrown.size()) ||
+        !AddTallies(counts, other.counts)) {
+        G4cerr << "Error: response matrices with different binnings"
+               << G4endl;
+        return;
+    }
+    AddTally(thrown, other.thrown);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Constructor.
+ *
+ * Declares the commands under /OpticalSimulation/response/.
+ */
+OpticalSimulationResponseMatrix::OpticalSimulationResponseMatrix()
+    : fMinEnergy(1. * keV), fMaxEnergy(10. * MeV), fMaxDeposit(10. * MeV) {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/response/",
+                                        "Detector response matrix");
+
+    fMessenger->DeclareProperty("setEnabled", fEnabled)
+        .SetGuidance("Override the GPS particle and energy to build the "
+                     "response matrix.")
+        .SetParameterName("Enabled", false)
+        .SetDefaultValue("true");
+
+    fMessenger
+        ->DeclareMethod("setParticles",
+                        &OpticalSimulationResponseMatrix::SetParticles)
+        .SetGuidance("Space separated list of particles (e.g. alpha e- "
+                     "gamma).")
+        .SetParameterName("Particles", false)
+        .SetDefaultValue("alpha e- gamma");
+
+    fMessenger->DeclarePropertyWithUnit("setMinEnergy", "keV", fMinEnergy)
+        .SetGuidance("Lower edge of the true energy range.")
+        .SetParameterName("MinEnergy", false)
+        .SetRange("MinEnergy>0.");
+
+    fMessenger->DeclarePropertyWithUnit("setMaxEnergy", "keV", fMaxEnergy)
+        .SetGuidance("Upper edge of the true energy range.")
+        .SetParameterName("MaxEnergy", false)
+        .SetRange("MaxEnergy>0.");
+
+    fMessenger->DeclareProperty("setEnergyBins", fEnergyBins)
+        .SetGuidance("Number of true energy bins.")
+        .SetParameterName("EnergyBins", false)
+        .SetDefaultValue("50");
+
+    fMessenger->DeclareProperty("setLogBins", fLogBins)
+        .SetGuidance("Logarithmic true energy binning.")
+        .SetParameterName("LogBins", false)
+        .SetDefaultValue("true");
+
+    fMessenger->DeclareProperty("setDepositBins", fDepositBins)
+        .SetGuidance("Number of bins of the deposit observables.")
+        .SetParameterName("DepositBins", false)
+        .SetDefaultValue("500");
+
+    fMessenger->DeclarePropertyWithUnit("setMaxDeposit", "keV", fMaxDeposit)
+        .SetGuidance("Upper edge of the deposit observables.")
+        .SetParameterName("MaxDeposit", false)
+        .SetRange("MaxDeposit>0.");
+
+    fMessenger->DeclareProperty("setPhotonBins", fPhotonBins)
+        .SetGuidance("Number of bins (one photon wide) of the detected "
+                     "photons.")
+        .SetParameterName("PhotonBins", false)
+        .SetDefaultValue("500");
+
+    SetParticles(fParticleList);
+}
+
+/**
+ * @brief Destructor.
+ */
+OpticalSimulationResponseMatrix::~OpticalSimulationResponseMatrix() {
+    delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char *OpticalSimulationResponseMatrix::ObservableName(G4int obs) {
+    static const char *names[kNObservables] = {"ZnS", "Sc", "photons",
+                                               "class"};
+    return names[obs];
+}
+
+void OpticalSimulationResponseMatrix::SetParticles(G4String list) {
+    fParticleList = list;
+    fParticles.clear();
+    fParticlePDG.clear();
+
+    std::istringstream is(list);
+    G4String name;
+    while (is >> name) {
+        G4ParticleDefinition *particle =
+            G4ParticleTable::GetParticleTable()->FindParticle(name);
+        if (!particle) {
+            G4cerr << "Warning: unknown particle " << name << G4endl;
+            continue;
+        }
+        fParticles.push_back(name);
+        fParticlePDG.push_back(particle->GetPDGEncoding());
+    }
+}
+
+std::vector<G4double> OpticalSimulationResponseMatrix::TrueEdges() const {
+    std::vector<G4double> edges(fEnergyBins + 1);
+    for (G4int b = 0; b <= fEnergyBins; ++b) {
+        G4double u = G4double(b) / fEnergyBins;
+        edges[b] = fLogBins
+                       ? fMinEnergy * std::pow(fMaxEnergy / fMinEnergy, u)
+                       : fMinEnergy + u * (fMaxEnergy - fMinEnergy);
+    }
+    return edges;
+}
+
+std::vector<G4int> OpticalSimulationResponseMatrix::ObservableBins() const {
+    return {fDepositBins, fDepositBins, fPhotonBins,
+            OpticalSimulationClassifier::kNEventClasses};
+}
+
+G4double OpticalSimulationResponseMatrix::ObservableMax(G4int obs) const {
+    switch (obs) {
+    case kDepositZnS:
+    case kDepositSc:
+        return fMaxDeposit / keV;
+    case kPhotons:
+        return fPhotonBins;
+    default:
+        return OpticalSimulationClassifier::kNEventClasses;
+    }
+}
+
+G4int OpticalSimulationResponseMatrix::ParticleIndex(G4int pdg) const {
+    for (size_t i = 0; i < fParticlePDG.size(); ++i)
+        if (fParticlePDG[i] == pdg)
+            return i;
+    return -1;
+}
+
+G4int OpticalSimulationResponseMatrix::TrueBin(G4double energy) const {
+    if (energy < fMinEnergy || energy >= fMaxEnergy)
+        return -1;
+    G4double u = fLogBins ? std::log(energy / fMinEnergy) /
+                                std::log(fMaxEnergy / fMinEnergy)
+                          : (energy - fMinEnergy) / (fMaxEnergy - fMinEnergy);
+    return std::min(G4int(u * fEnergyBins), fEnergyBins - 1);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Override the particle and energy of the primary generated by GPS.
+ * @param event Event whose first primary vertex has been filled by GPS.
+ */
+void OpticalSimulationResponseMatrix::SamplePrimary(G4Event *event) const {
+    if (!fEnabled || fParticles.empty() || !event->GetPrimaryVertex(0))
+        return;
+
+    G4int id = event->GetEventID();
+    G4int nParticles = fParticles.size();
+    G4int particle = id % nParticles;
+    G4int bin = (id / nParticles) % fEnergyBins;
+
+    std::vector<G4double> edges = TrueEdges();
+    G4double u = G4UniformRand();
+    G4double energy =
+        fLogBins ? edges[bin] * std::pow(edges[bin + 1] / edges[bin], u)
+                 : edges[bin] + u * (edges[bin + 1] - edges[bin]);
+
+    G4PrimaryParticle *primary = event->GetPrimaryVertex(0)->GetPrimary(0);
+    primary->SetParticleDefinition(
+        G4ParticleTable::GetParticleTable()->FindParticle(
+            fParticles[particle]));
+    primary->SetKineticEnergy(energy);
+}
+
+void OpticalSimulationResponseMatrix::BeginOfRun() {
+    fLocal.Reset(fParticles.size(), fEnergyBins, ObservableBins());
+}
+
+/**
+ * @brief Accumulate one event in the thread-local matrix.
+ * @param event Event summary already processed by the classifier.
+ */
+void OpticalSimulationResponseMatrix::Fill(const RunTallyEvent &event) {
+    if (!fEnabled)
+        return;
+
+    G4int particle = ParticleIndex(event.sourcePDG);
+    G4int bin = TrueBin(event.energy * MeV);
+    if (particle < 0 || bin < 0)
+        return;
+
+    size_t row = size_t(particle) * fEnergyBins + bin;
+    fLocal.thrown[row]++;
+
+    std::vector<G4int> nObs = ObservableBins();
+    G4double value[kNObservables] = {event.depositZnS, event.depositSc,
+                                     G4double(event.detected),
+                                     G4double(event.eventClass)};
+    for (G4int o = 0; o < kNObservables; ++o) {
+        G4int obsBin = G4int(value[o] / ObservableMax(o) * nObs[o]);
+        // Overflows are kept in the last bin so that rows stay normalized
+        obsBin = std::max(0, std::min(obsBin, nObs[o] - 1));
+        fLocal.counts[o][row * nObs[o] + obsBin]++;
+    }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationResponseMatrix::MergeIntoRunTotals() const {
+    if (!fEnabled)
+        return;
+    RunTotals::Merge(fLocal);
+}
+
+void OpticalSimulationResponseMatrix::ResetRunTotals() {
+    RunTotals::Clear();
+}
+
+/**
+ * @brief Add the counts written by WriteRunTotals() in a previous output.
+ *
+ * The binning of the stored histograms must match the current one.
+ */
+void OpticalSimulationResponseMatrix::LoadRunTotals(TFile *file) const {
+    if (!fEnabled || !file)
+        return;
+
+    std::vector<G4int> nObs = ObservableBins();
+    Results stored;
+    stored.Reset(fParticles.size(), fEnergyBins, nObs);
+
+    for (size_t p = 0; p < fParticles.size(); ++p) {
+        auto *hThrown = file->Get<TH1D>(
+            ("response_thrown_" + fParticles[p]).c_str());
+        if (!hThrown || hThrown->GetNbinsX() != fEnergyBins) {
+            G4cerr << "Warning: no matching response matrix for "
+                   << fParticles[p] << " in " << file->GetName() << G4endl;
+            return;
+        }
+        for (G4int b = 0; b < fEnergyBins; ++b)
+            stored.thrown[p * fEnergyBins + b] =
+                std::llround(hThrown->GetBinContent(b + 1));
+
+        for (G4int o = 0; o < kNObservables; ++o) {
+            auto *h = file->Get<TH2D>(
+                ("response_" + fParticles[p] + "_" + ObservableName(o))
+                    .c_str());
+            if (!h || h->GetNbinsY() != nObs[o])
+                return;
+            for (G4int b = 0; b < fEnergyBins; ++b) {
+                size_t row = p * fEnergyBins + b;
+                for (G4int j = 0; j < nObs[o]; ++j)
+                    stored.counts[o][row * nObs[o] + j] =
+                        std::llround(h->GetBinContent(b + 1, j + 1));
+            }
+        }
+    }
+
+    RunTotals::Merge(stored);
+}
+
+/**
+ * @brief Write the merged matrix as raw-count histograms.
+ */
+void OpticalSimulationResponseMatrix::WriteRunTotals(TFile *file) const {
+    const Results &r = GetRunTotals();
+    if (!fEnabled || !file || r.thrown.empty())
+        return;
+
+    file->cd();
+    std::vector<G4double> edges = TrueEdges();
+    for (auto &edge : edges)
+        edge /= keV;
+    std::vector<G4int> nObs = ObservableBins();
+
+    for (size_t p = 0; p < fParticles.size(); ++p) {
+        G4String thrownName = "response_thrown_" + fParticles[p];
+        TH1D hThrown(thrownName.c_str(),
+                     (thrownName + ";True energy [keV];Events").c_str(),
+                     fEnergyBins, edges.data());
+        for (G4int b = 0; b < fEnergyBins; ++b)
+            hThrown.SetBinContent(b + 1, r.thrown[p * fEnergyBins + b]);
+        hThrown.Write();
+
+        for (G4int o = 0; o < kNObservables; ++o) {
+            G4String name = "response_" + fParticles[p] + "_" +
+                            ObservableName(o);
+            TH2D h(name.c_str(),
+                   (name + ";True energy [keV];" + ObservableName(o)).c_str(),
+                   fEnergyBins, edges.data(), nObs[o], 0., ObservableMax(o));
+            for (G4int b = 0; b < fEnergyBins; ++b) {
+                size_t row = p * fEnergyBins + b;
+                for (G4int j = 0; j < nObs[o]; ++j)
+                    h.SetBinContent(b + 1, j + 1,
+                                    r.counts[o][row * nObs[o] + j]);
+            }
+            if (o == kClass)
+                for (G4int c = 0; c < nObs[o]; ++c)
+                    h.GetYaxis()->SetBinLabel(
+                        c + 1, OpticalSimulationClassifier::ClassName(c));
+            h.Write();
+        }
+    }
+}
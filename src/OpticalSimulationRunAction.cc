@@ -22,14 +22,17 @@
  *      - Defines ROOT branches for run-wide parameters and measurements
  *      - Initializes the random seed
  *  - **During the run**:
- *      - Updates statistics via `UpdateStatistics()` and specialized variants
+ *      - Fills the trees with the records of each event via
+ *        `UpdateStatisticsRecords()` (one lock per event)
  *  - **EndOfRunAction**:
  *      - Finalizes statistics
+ *      - Merges the thread-local classifier results and, on the master,
+ *        prints and writes the run-level classification counts
  *      - Writes all TTrees to the ROOT file
  *      - Closes the file and releases resources
  *
  * Thread safety is ensured via:
- *  - `std::atomic<int> activeThreads` for counting active threads
+ *  - One file per thread indexed by its Geant4 thread ID
  *  - `G4Mutex fileMutex` for synchronized file access
  *
  * @note This class uses Geant4's ROOT integration to structure physics
@@ -38,20 +41,75 @@
 
 // Include class header
 #include "OpticalSimulationRunAction.hh"
+#include "G4Event.hh"
+#include "G4Threading.hh"
+#include "OpticalSimulationCache.hh"
+#include "OpticalSimulationFresnelBoundary.hh"
+#include "OpticalSimulationOutput.hh"
+#include "OpticalSimulationQuenching.hh"
+#include "Randomize.hh"
+#include "TMD5.h"
+#include "TNamed.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
 
 // --- Static member initialization ---
-std::atomic<int> OpticalSimulationRunAction::activeThreads(
-    0); ///< Counter for active threads
 G4Mutex OpticalSimulationRunAction::fileMutex =
     G4MUTEX_INITIALIZER; ///< Mutex for file protection
 
 // --- Constructor ---
 OpticalSimulationRunAction::OpticalSimulationRunAction(const char *suff,
                                                        size_t N, G4bool pMT)
-    : suffixe(suff), NEventsGenerated(N), flag_MT(pMT) {}
+    : suffixe(suff), NEventsGenerated(N), flag_MT(pMT) {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/run/",
+                                        "Run output control");
+
+    fMessenger->DeclareProperty("setWriteTrees", WriteTrees)
+        .SetGuidance("Fill the per-event Input/ZnS/Scintillator/Optical "
+                     "trees (run-level results are always written).")
+        .SetParameterName("WriteTrees", false)
+        .SetDefaultValue("true");
+
+    fMessenger->DeclareProperty("setOutputName", suffixe)
+        .SetGuidance("Base name of the ROOT output of the next runs.")
+        .SetParameterName("OutputName", false);
+
+    fMessenger->DeclareProperty("setSeed", fSeed)
+        .SetGuidance("Base seed of the runs (0: CPU clock at the first run).")
+        .SetParameterName("Seed", false)
+        .SetRange("Seed>=0")
+        .SetDefaultValue("0");
+
+    fMessenger->DeclareProperty("setSeedSegment", fSeedSegment)
+        .SetGuidance("Index of the job within an output extended by "
+                     "statistics top-ups (independent seeds per segment).")
+        .SetParameterName("Segment", false)
+        .SetRange("Segment>=0")
+        .SetDefaultValue("0");
+
+    fMessenger->DeclareProperty("setTopUpInput", fTopUpInput)
+        .SetGuidance("Output whose run-level results are extended by the next "
+                     "runs (none to disable).")
+        .SetParameterName("Input", false)
+        .SetDefaultValue("none");
+
+    fMessenger->DeclareProperty("setChunkEvents", fChunkMaxEvents)
+        .SetGuidance("Events per chunk file of each thread (0: no limit); "
+                     "chunks are listed in <name>.manifest.")
+        .SetParameterName("ChunkEvents", false)
+        .SetRange("ChunkEvents>=0")
+        .SetDefaultValue("0");
+
+    fMessenger->DeclareProperty("setChunkSize", fChunkMaxSize)
+        .SetGuidance("Compressed size of a chunk file in MB (0: no limit).")
+        .SetParameterName("ChunkSize", false)
+        .SetRange("ChunkSize>=0")
+        .SetDefaultValue("0");
+}
 
 // --- Destructor ---
-OpticalSimulationRunAction::~OpticalSimulationRunAction() {}
+OpticalSimulationRunAction::~OpticalSimulationRunAction() { delete fMessenger; }
 
 // --- Primary generator reference setter ---
 void OpticalSimulationRunAction::SetPrimaryGenerator(
@@ -63,6 +121,12 @@ void OpticalSimulationRunAction::SetPrimaryGenerator(
 void OpticalSimulationRunAction::SetGeometry(
     OpticalSimulationGeometryConstruction *geom) {
     fGeometry = geom;
+    fSymmetry.SetGeometry(geom);
+    fUniformityMap.SetGeometry(geom);
+    fUniformityMap.SetSymmetry(&fSymmetry);
+    fUniformityMap.SetQuasiRandom(&fQuasiRandom);
+    fQuasiRandom.SetGeometry(geom);
+    fLightCollectionMap.SetGeometry(geom);
 }
 
 /**
@@ -85,6 +149,21 @@ CreateBranches(TTree *tree,
     }
 }
 
+/**
+ * @brief Creates the event-key branches shared by all the trees.
+ * @param tree ROOT tree to populate
+ * @param key Event key of the run action
+ */
+static void CreateKeyBranches(TTree *tree, RunTallyKey &key) {
+    std::vector<std::pair<const char *, int *>> keyBranches = {
+        {"segment", &key.segment},
+        {"run", &key.run},
+        {"thread", &key.thread},
+        {"event", &key.event},
+        {"subevent", &key.subevent}};
+    CreateBranches(tree, keyBranches);
+}
+
 /**
  * @brief Creates ROOT branches specific to YAG detector statistics.
  * @param tree ROOT tree to populate
@@ -152,64 +231,190 @@ static void CreateOpticalBranches(TTree *tree, RunTallyOptical &stats) {
 }
 
 //---------------------------------------------------------
-//  Generic statistics update function
+//  Tree filling
 //---------------------------------------------------------
 /**
- * @brief Thread-safe update of statistics and ROOT tree filling.
- * @tparam T Type of the statistics structure
- * @param stats Destination statistics object (persistent in the run)
- * @param newStats Source statistics (new values)
- * @param tree ROOT tree to fill
+ * @brief Thread-safe filling of the trees with all the records of an event.
+ *
+ * The file mutex is taken once per event whatever the number of records
+ * (sub-events); the records are swapped into the branch buffers rather than
+ * copied. The input entry is written if valid, the ZnS and scintillator
+ * entries if not empty, the optical entry always.
+ * @param records Records of the event, left with the previous buffers
  */
-template <typename T>
-void OpticalSimulationRunAction::UpdateStatistics(T &stats, const T &newStats,
-                                                  TTree *tree) {
+void OpticalSimulationRunAction::UpdateStatisticsRecords(
+    std::vector<RunTallyRecord> &records, G4bool optical) {
+    if (!WriteTrees)
+        return;
     std::lock_guard<std::mutex> lock(fileMutex);
-    stats = newStats;
-    if (tree)
-        tree->Fill();
-    else
-        G4cerr << "Error: Tree is nullptr" << G4endl;
+    for (size_t s = 0; s < records.size(); ++s) {
+        RunTallyRecord &record = records[s];
+        StatsKey.subevent = s;
+        if (record.input.energy > 0) {
+            std::swap(StatsInput, record.input);
+            Tree_Input->Fill();
+        }
+        if (!record.zns.energy.empty()) {
+            std::swap(StatsZnS, record.zns);
+            Tree_ZnS->Fill();
+        }
+        if (!record.scintillator.energy.empty()) {
+            std::swap(StatsScintillator, record.scintillator);
+            Tree_Scintillator->Fill();
+        }
+        if (!optical)
+            continue;
+        std::swap(StatsOptical, record.optical);
+        Tree_Optical->Fill();
+    }
 }
 
-// --- Specific statistics update wrappers ---
-void OpticalSimulationRunAction::UpdateStatisticsInput(RunTallyInput a) {
-    UpdateStatistics(StatsInput, a, Tree_Input);
+void OpticalSimulationRunAction::UpdateStatisticsSteps(
+    const RunTallyInput &input, G4int sourcePDG) {
+    if (!Tree_Steps)
+        return;
+    std::lock_guard<std::mutex> lock(fileMutex);
+    fStepReplay.SetEventInput(input, sourcePDG);
+    Tree_Steps->Fill();
+    fStepReplay.Clear();
 }
-void OpticalSimulationRunAction::UpdateStatisticsZnS(RunTallySc a) {
-    UpdateStatistics(StatsZnS, a, Tree_ZnS);
+
+void OpticalSimulationRunAction::UpdateStatisticsOutlier(
+    const G4Event *event) {
+    if (!Tree_Outliers || !fWatchdog.IsOutlier())
+        return;
+    fWatchdog.EndOfEvent(event, suffixe);
+    std::lock_guard<std::mutex> lock(fileMutex);
+    Tree_Outliers->Fill();
 }
-void OpticalSimulationRunAction::UpdateStatisticsScintillator(RunTallySc a) {
-    UpdateStatistics(StatsScintillator, a, Tree_Scintillator);
+
+void OpticalSimulationRunAction::SetEventKey(const G4Event *event) {
+    StatsKey.segment = fSeedSegment;
+    StatsKey.run = G4RunManager::GetRunManager()->GetCurrentRun()->GetRunID();
+    StatsKey.thread = G4Threading::G4GetThreadId();
+    StatsKey.event = event->GetEventID();
+    StatsKey.subevent = 0;
+    RollOverChunk(StatsKey.event);
 }
-void OpticalSimulationRunAction::UpdateStatisticsOptical(RunTallyOptical a) {
-    UpdateStatistics(StatsOptical, a, Tree_Optical);
+
+//-----------------------------------------------------
+//  Sampling modes
+//-----------------------------------------------------
+/**
+ * @brief Refuse a run with several modes overriding the primary.
+ *
+ * The response matrix (particle and energy), the uniformity map (position),
+ * the QMC sampler (direction or whole primary), the adjoint light-collection
+ * map and the step replay (whole primary) are applied one after the other
+ * by the generator, and each of them spreads the events over its own
+ * strata or replicates from the event ID: combined, the later ones
+ * overwrite the earlier ones and no result keeps its meaning.
+ */
+void OpticalSimulationRunAction::CheckSamplers() const {
+    std::vector<G4String> active;
+    if (fResponseMatrix.IsEnabled())
+        active.push_back("/OpticalSimulation/response");
+    if (fUniformityMap.IsEnabled())
+        active.push_back("/OpticalSimulation/uniformity");
+    if (fQuasiRandom.IsEnabled())
+        active.push_back("/OpticalSimulation/qmc");
+    if (fLightCollectionMap.IsAdjoint())
+        active.push_back("/OpticalSimulation/lce (adjoint)");
+    if (fStepReplay.IsReplaying())
+        active.push_back("/OpticalSimulation/replay (replay)");
+    if (active.size() < 2)
+        return;
+
+    G4ExceptionDescription message;
+    message << "Several modes override the primary, enable only one of:";
+    for (const auto &mode : active)
+        message << " " << mode;
+    G4Exception("OpticalSimulationRunAction::BeginOfRunAction", "Samplers",
+                FatalException, message);
 }
 
 //-----------------------------------------------------
-//  BeginOfRunAction
+//  Seeds and statistics top-up
 //-----------------------------------------------------
 /**
- * @brief Called at the start of each run to set up ROOT output structures and
- * initialize state.
- * @param aRun Pointer to the current G4Run
+ * @brief Seed the engine of this thread for the run.
+ *
+ * MixMax (the Geant4 default engine) seeded with four 32-bit integers
+ * (seed, segment, run, thread) generates a stream guaranteed not to overlap
+ * with the stream of any other quadruplet. In MT the event seeds are drawn
+ * from the master stream, so jobs of different segments never share seeds.
+ * @param aRun Current run
+ * @param index File index of the thread (0 for the master)
  */
-void OpticalSimulationRunAction::BeginOfRunAction(const G4Run *aRun) {
-    // Populate branches for each TTree...
-    G4AutoLock lock(&fileMutex); // Automatic mutex lock
+void OpticalSimulationRunAction::SeedRun(const G4Run *aRun, G4int index) {
+    if (fSeed == 0)
+        fSeed = time(NULL);
+    long seeds[4] = {long(fSeed), long(fSeedSegment), long(aRun->GetRunID()),
+                     long(index)};
+    G4Random::setTheSeeds(seeds, 4);
+    G4cout << "seed = " << fSeed << " (segment " << fSeedSegment << ", run "
+           << aRun->GetRunID() << ")" << G4endl;
+}
 
-    start = time(NULL); // start the timer clock to calculate run times
+/**
+ * @brief Read the output extended by a statistics top-up.
+ *
+ * Its configuration and seed records are carried over and its run-level
+ * results are added to the totals, so that the master prints and writes the
+ * results of all the events.
+ */
+void OpticalSimulationRunAction::LoadTopUpInput() {
+    fConfiguration.clear();
+    fSeedRecord.clear();
+    if (fTopUpInput == "none")
+        return;
 
-    int a = activeThreads;
+    TFile input(fTopUpInput.c_str(), "READ");
+    if (input.IsZombie()) {
+        G4cerr << "Error: cannot open " << fTopUpInput << G4endl;
+        return;
+    }
+    if (auto *configuration = input.Get<TNamed>("configuration"))
+        fConfiguration = configuration->GetTitle();
+    if (auto *seeds = input.Get<TNamed>("seeds"))
+        fSeedRecord = seeds->GetTitle();
 
-    std::string s = flag_MT ? "_" + std::to_string(activeThreads) : "";
-    fileName = suffixe + s + ".root";
+    fClassifier.LoadRunTotals(&input);
+    fResponseMatrix.LoadRunTotals(&input);
+    fUniformityMap.LoadRunTotals(&input);
+    fQuasiRandom.LoadRunTotals(&input);
+    fLightCollectionMap.LoadRunTotals(&input);
+    G4cout << "Run-level results of " << fTopUpInput << " loaded" << G4endl;
+}
 
-    G4cout << "Filename = " << fileName << G4endl;
+/**
+ * @brief Store the configuration and the seeds of all the runs.
+ *
+ * One line per run: `segment <s> seed <seed> run <id> events <n>`.
+ */
+void OpticalSimulationRunAction::WriteBookkeeping(const G4Run *aRun) {
+    std::ostringstream line;
+    line << "segment " << fSeedSegment << " seed " << fSeed << " run "
+         << aRun->GetRunID() << " events " << aRun->GetNumberOfEvent()
+         << " aborted " << OpticalSimulationWatchdog::GetRunAborted() << "\n";
+    fSeedRecord += line.str();
 
-    f = new TFile(fileName.c_str(), "RECREATE");
+    f->cd();
+    TNamed("configuration",
+           fConfiguration.empty()
+               ? OpticalSimulationCache::Configuration().c_str()
+               : fConfiguration.c_str())
+        .Write();
+    TNamed("seeds", fSeedRecord.c_str()).Write();
+}
 
-    // Creating trees for different types of run information
+//-----------------------------------------------------
+//  Trees and chunk files
+//-----------------------------------------------------
+/**
+ * @brief Create the event trees in the current directory.
+ */
+void OpticalSimulationRunAction::CreateTrees() {
     Tree_Input = new TTree(
         "Input", "Input Information"); // Tree to access Input information
     Tree_ZnS = new TTree("ZnS", "ZnS Information"); // Tree to access ZnS infos
@@ -226,6 +431,7 @@ void OpticalSimulationRunAction::BeginOfRunAction(const G4Run *aRun) {
         {"z", &StatsInput.z},          {"zp", &StatsInput.zp},
         {"energy", &StatsInput.energy}};
     CreateBranches(Tree_Input, inputBranches);
+    Tree_Input->Branch("pdg", &StatsInput.pdg, "pdg/I");
 
     //************************************INFORMATIONS FROM THE
     // YAGs*****************************************
@@ -241,21 +447,185 @@ void OpticalSimulationRunAction::BeginOfRunAction(const G4Run *aRun) {
     // PHOTON*****************************************
     CreateOpticalBranches(Tree_Optical, StatsOptical);
 
-    // set the random seed to the CPU clock
-    // G4Random::setTheEngine(new CLHEP::HepJamesRandom);
-    G4long seed = time(NULL) + a;
-    G4Random::setTheSeed(seed);
-    // G4Random::setTheSeed(1712670533);
-    G4cout << "seed = " << seed << G4endl;
+    //**********IONISATION STEPS (RECORD MODE)***************************
+    Tree_Steps =
+        fStepReplay.IsRecording() ? fStepReplay.CreateTree() : nullptr;
+
+    for (TTree *tree : Trees())
+        CreateKeyBranches(tree, StatsKey);
+}
+
+std::vector<TTree *> OpticalSimulationRunAction::Trees() const {
+    std::vector<TTree *> trees = {Tree_Input, Tree_ZnS, Tree_Scintillator,
+                                  Tree_Optical};
+    if (Tree_Steps)
+        trees.push_back(Tree_Steps);
+    return trees;
+}
+
+/**
+ * @brief Open the next chunk file of this thread and create its trees.
+ *
+ * Chunks are named `<name>[_<thread file>]_c<k>.root`; fileMutex is held.
+ */
+void OpticalSimulationRunAction::OpenChunk(const G4Run *aRun) {
+    std::string thread =
+        flag_MT ? "_" + std::to_string(G4Threading::G4GetThreadId() + 1) : "";
+    fChunkName =
+        suffixe + thread + "_c" + std::to_string(fChunkIndex++) + ".root";
+    fChunkFile = new TFile(fChunkName.c_str(), "RECREATE");
+    CreateTrees();
+    fChunkRun = aRun->GetRunID();
+    fChunkEntries = 0;
+    fChunkFirstEvent = -1;
+    fChunkLastEvent = -1;
+}
+
+/**
+ * @brief Write and close the current chunk, then record it in the manifest.
+ *
+ * The manifest line is only written once the chunk is complete on disk, so
+ * that the chunks listed by an interrupted run are all usable.
+ */
+void OpticalSimulationRunAction::CloseChunk() {
+    if (!fChunkFile)
+        return;
+    fChunkFile->cd();
+    for (TTree *tree : Trees()) {
+        OpticalSimulationOutput::BuildIndex(tree);
+        tree->Write();
+    }
+    fChunkFile->Close();
+    delete fChunkFile;
+    fChunkFile = nullptr;
+
+    TMD5 *md5 = TMD5::FileChecksum(fChunkName.c_str());
+    std::ofstream manifest(suffixe + ".manifest", std::ios::app);
+    manifest << fChunkName << " " << G4Threading::G4GetThreadId() << " "
+             << fSeedSegment << " " << fChunkRun << " " << fChunkFirstEvent
+             << " " << fChunkLastEvent << " " << fChunkEntries << " "
+             << (md5 ? md5->AsString() : "-") << "\n";
+    delete md5;
+}
+
+/**
+ * @brief Start a new chunk when the current one is full (between events).
+ */
+void OpticalSimulationRunAction::RollOverChunk(G4int eventID) {
+    if (!fChunkFile)
+        return;
+    G4bool full = fChunkMaxEvents > 0 && fChunkEntries >= fChunkMaxEvents;
+    if (fChunkMaxSize > 0) {
+        // Compressed bytes already flushed to the chunk
+        Long64_t bytes = 0;
+        for (TTree *tree : Trees())
+            bytes += tree->GetZipBytes();
+        full = full || bytes >= Long64_t(fChunkMaxSize) * 1024 * 1024;
+    }
+    if (full && fChunkEntries > 0) {
+        G4AutoLock lock(&fileMutex);
+        const G4Run *run = G4RunManager::GetRunManager()->GetCurrentRun();
+        CloseChunk();
+        OpenChunk(run);
+    }
+    if (fChunkFirstEvent < 0)
+        fChunkFirstEvent = eventID;
+    fChunkLastEvent = eventID;
+    fChunkEntries++;
+}
+
+//-----------------------------------------------------
+//  BeginOfRunAction
+//-----------------------------------------------------
+/**
+ * @brief Called at the start of each run to set up ROOT output structures and
+ * initialize state.
+ * @param aRun Pointer to the current G4Run
+ */
+void OpticalSimulationRunAction::BeginOfRunAction(const G4Run *aRun) {
+    if (IsMaster())
+        CheckSamplers();
+
+    // Populate branches for each TTree...
+    G4AutoLock lock(&fileMutex); // Automatic mutex lock
+
+    start = time(NULL); // start the timer clock to calculate run times
+
+    // File index: 0 for the master, 1..N for the workers, stable over runs
+    int a = G4Threading::G4GetThreadId() + 1;
+
+    std::string s = flag_MT ? "_" + std::to_string(a) : "";
+    fileName = suffixe + s + ".root";
+
+    G4cout << "Filename = " << fileName << G4endl;
+
+    f = new TFile(fileName.c_str(), "RECREATE");
+
+    // Trees in the run file, or in the chunk files of the event threads
+    if (fChunkMaxEvents > 0 || fChunkMaxSize > 0) {
+        if (IsMaster()) {
+            G4String hash = OpticalSimulationCache::Hash(
+                OpticalSimulationCache::Configuration());
+            std::ofstream manifest(suffixe + ".manifest");
+            manifest << "# configuration " << hash << "\n"
+                     << "# file thread segment run first_event last_event "
+                        "events md5\n";
+        }
+        fChunkIndex = 0;
+        if (!IsMaster() || !flag_MT)
+            OpenChunk(aRun);
+        else
+            CreateTrees();
+    } else {
+        if (IsMaster())
+            std::remove((suffixe + ".manifest").c_str());
+        CreateTrees();
+    }
+    f->cd();
+
+    // Outliers of the watchdog, in the run file even when chunked
+    Tree_Outliers = nullptr;
+    if (fWatchdog.IsEnabled()) {
+        Tree_Outliers = fWatchdog.CreateTree();
+        CreateKeyBranches(Tree_Outliers, StatsKey);
+    }
+
+    SeedRun(aRun, a);
 
     G4cout << "### Run " << aRun->GetRunID() << " start." << G4endl;
 
+    // Light tables by particle type, read by the replay of this run
+    if (IsMaster())
+        OpticalSimulationQuenching::getInstance()->BuildTables();
+
+    // Run-level results: thread-local accumulators, totals reset by the master
+    fClassifier.BeginOfRun();
+    fPrecisionMonitor.BeginOfRun();
+    fResponseMatrix.BeginOfRun();
+    fUniformityMap.BeginOfRun();
+    fQuasiRandom.BeginOfRun();
+    fLightCollectionMap.BeginOfRun();
+    fStepReplay.BeginOfRun();
+    fWatchdog.BeginOfRun();
+    if (IsMaster()) {
+        OpticalSimulationClassifier::ResetRunTotals();
+        OpticalSimulationPrecisionMonitor::ResetRunTotals();
+        OpticalSimulationResponseMatrix::ResetRunTotals();
+        OpticalSimulationUniformityMap::ResetRunTotals();
+        OpticalSimulationQuasiRandom::ResetRunTotals();
+        OpticalSimulationLightCollectionMap::ResetRunTotals();
+        OpticalSimulationWatchdog::ResetRunTotals();
+        LoadTopUpInput();
+        fStepReplay.LoadReplayInput();
+        f->cd();
+        fEventStream.BeginOfRun(aRun->GetRunID());
+        fMonitor.BeginOfRun(aRun);
+    }
+
     if (G4VVisManager::GetConcreteInstance()) {
         G4UImanager *UI = G4UImanager::GetUIpointer();
         UI->ApplyCommand("/vis/scene/notifyHandlers");
     }
-
-    activeThreads++;
 }
 
 //-----------------------------------------------------
@@ -269,12 +639,54 @@ void OpticalSimulationRunAction::BeginOfRunAction(const G4Run *aRun) {
 void OpticalSimulationRunAction::EndOfRunAction(const G4Run *aRun) {
     G4AutoLock lock(&fileMutex);
 
-    // Write all trees to ROOT file
-    f->cd();
-    Tree_Input->Write();
-    Tree_ZnS->Write();
-    Tree_Scintillator->Write();
-    Tree_Optical->Write();
+    // Workers (or the sequential run action) fold their run-level results
+    // into the totals; in MT the master runs after all workers are done.
+    if (!IsMaster() || !flag_MT) {
+        fClassifier.MergeIntoRunTotals();
+        fResponseMatrix.MergeIntoRunTotals();
+        fUniformityMap.MergeIntoRunTotals();
+        fQuasiRandom.MergeIntoRunTotals();
+        fLightCollectionMap.MergeIntoRunTotals();
+        fWatchdog.MergeIntoRunTotals();
+        if (auto *boundary = OpticalSimulationFresnelBoundary::GetInstance())
+            boundary->MergeComparison();
+    }
+
+    if (IsMaster()) {
+        fMonitor.EndOfRun();
+        G4cout << "Events processed: " << aRun->GetNumberOfEvent()
+               << G4endl;
+        fClassifier.PrintRunTotals();
+        fPrecisionMonitor.PrintRunTotals();
+        fUniformityMap.PrintRunTotals();
+        fQuasiRandom.PrintRunTotals();
+        fLightCollectionMap.PrintRunTotals();
+        OpticalSimulationWatchdog::PrintRunTotals();
+        OpticalSimulationFresnelBoundary::PrintComparison();
+        fClassifier.WriteRunTotals(f);
+        fResponseMatrix.WriteRunTotals(f);
+        fUniformityMap.WriteRunTotals(f);
+        fQuasiRandom.WriteRunTotals(f);
+        fLightCollectionMap.WriteRunTotals(f);
+        WriteBookkeeping(aRun);
+        fEventStream.EndOfRun();
+    }
+
+    // Write all trees to ROOT file (or last chunk), indexed on the event key
+    if (fChunkFile)
+        CloseChunk();
+    else {
+        f->cd();
+        for (TTree *tree : Trees()) {
+            OpticalSimulationOutput::BuildIndex(tree);
+            tree->Write();
+        }
+    }
+    if (Tree_Outliers) {
+        f->cd();
+        OpticalSimulationOutput::BuildIndex(Tree_Outliers);
+        Tree_Outliers->Write();
+    }
     f->Close();
     delete f;
     f = nullptr;
@@ -0,0 +1,264 @@
+/**
+ * @file OpticalSimulationScanDriver.cc
+ * @brief Implementation of the adaptive scan driver.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * For a detection efficiency p measured on a fraction f of the events (the
+ * events of the monitored source type), the relative variance per simulated
+ * event is (1 - p) / (p f). With the cost per event c_i measured during the
+ * pilot and a wall time budget B:
+ *  - equalize : n_i = B v_i / sum_j(c_j v_j)
+ *  - minimize : n_i = B sqrt(v_i / c_i) / sum_j(sqrt(v_j c_j))
+ *
+ * Each run of a point writes `<name>_point<i>_<pass>` which are merged into
+ * `<name>_point<i>.root` at the end of the scan; the summary is written in
+ * `<name>_scan.csv`.
+ */
+
+#include "OpticalSimulationScanDriver.hh"
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "OpticalSimulationOutput.hh"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationScanDriver::OpticalSimulationScanDriver(const G4String &name,
+                                                         size_t nThreads,
+                                                         G4bool pMT)
+    : fName(name), fNThreads(nThreads), flag_MT(pMT) {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/scan/",
+                                        "Adaptive energy/position scans");
+
+    fMessenger->DeclareMethod("addPoint", &OpticalSimulationScanDriver::AddPoint)
+        .SetGuidance("Add a scan point defined by UI commands separated by "
+                     "';' (e.g. /gps/energy 50 keV; /gps/pos/centre 0 0 1 "
+                     "mm).")
+        .SetParameterName("Commands", false);
+
+    fMessenger
+        ->DeclareMethod("clearPoints", &OpticalSimulationScanDriver::ClearPoints)
+        .SetGuidance("Remove all the scan points.");
+
+    fMessenger->DeclareProperty("setPilotEvents", fPilotEvents)
+        .SetGuidance("Number of pilot events per point.")
+        .SetParameterName("PilotEvents", false)
+        .SetDefaultValue("1000");
+
+    fMessenger->DeclareProperty("setBudget", fBudget)
+        .SetGuidance("Wall time budget in seconds shared between the points "
+                     "after the pilot pass.")
+        .SetParameterName("Budget", false)
+        .SetDefaultValue("3600.");
+
+    fMessenger->DeclareProperty("setMaxEvents", fMaxEvents)
+        .SetGuidance("Maximum number of events of one point.")
+        .SetParameterName("MaxEvents", false)
+        .SetDefaultValue("100000000");
+
+    fMessenger->DeclareProperty("setAllocation", fAllocation)
+        .SetGuidance("equalize: same relative uncertainty for every point; "
+                     "minimize: smallest total uncertainty for the budget.")
+        .SetParameterName("Allocation", false)
+        .SetCandidates("equalize minimize")
+        .SetDefaultValue("equalize");
+
+    fMessenger->DeclareProperty("setQuantity", fQuantity)
+        .SetGuidance("Efficiency driving the allocation.")
+        .SetParameterName("Quantity", false)
+        .SetCandidates("efficiency efficiency_alpha efficiency_beta")
+        .SetDefaultValue("efficiency");
+
+    fMessenger->DeclareMethod("run", &OpticalSimulationScanDriver::Run)
+        .SetGuidance("Run the pilot and adaptive passes over all points.");
+}
+
+OpticalSimulationScanDriver::~OpticalSimulationScanDriver() {
+    delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationScanDriver::AddPoint(G4String commands) {
+    ScanPoint point;
+    std::istringstream is(commands);
+    G4String command;
+    while (std::getline(is, command, ';')) {
+        G4StrUtil::strip(command);
+        if (!command.empty())
+            point.commands.push_back(command);
+    }
+    fPoints.push_back(point);
+}
+
+/**
+ * @brief Apply the commands of a point and run @p nEvents events.
+ *
+ * The run-level classifier totals of the run are added to the point.
+ */
+void OpticalSimulationScanDriver::Simulate(size_t index, G4long nEvents,
+                                           const G4String &pass) {
+    if (nEvents <= 0)
+        return;
+
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    ScanPoint &point = fPoints[index];
+
+    G4String name = fName + "_point" + std::to_string(index) + "_" + pass;
+    UI->ApplyCommand("/OpticalSimulation/run/setOutputName " + name);
+    for (const auto &command : point.commands)
+        UI->ApplyCommand(command);
+
+    auto start = std::chrono::steady_clock::now();
+    G4RunManager::GetRunManager()->BeamOn(nEvents);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    if (flag_MT)
+        OpticalSimulationOutput::MergeThreadFiles(name, fNThreads);
+
+    point.results.Merge(OpticalSimulationClassifier::GetRunTotals());
+    const G4Run *run = G4RunManager::GetRunManager()->GetCurrentRun();
+    point.events += run ? run->GetNumberOfEvent() : nEvents;
+    point.seconds += elapsed.count();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4double
+OpticalSimulationScanDriver::Efficiency(const ScanPoint &point) const {
+    const auto &r = point.results;
+    if (fQuantity == "efficiency_alpha")
+        return r.DetectionEfficiency(OpticalSimulationClassifier::kSourceAlpha);
+    if (fQuantity == "efficiency_beta")
+        return r.DetectionEfficiency(OpticalSimulationClassifier::kSourceBeta);
+
+    G4long n = 0, undetected = 0;
+    for (G4int s = 0; s < OpticalSimulationClassifier::kNSourceTypes; ++s) {
+        n += r.Total(s);
+        undetected += r.counts[s][OpticalSimulationClassifier::kUndetected];
+    }
+    return n > 0 ? 1. - G4double(undetected) / n : 0.;
+}
+
+G4double
+OpticalSimulationScanDriver::RelativeVariance(const ScanPoint &point) const {
+    if (point.events == 0)
+        return 0.;
+
+    // Fraction of the events contributing to the monitored efficiency
+    G4long n = point.events;
+    if (fQuantity == "efficiency_alpha")
+        n = point.results.Total(OpticalSimulationClassifier::kSourceAlpha);
+    else if (fQuantity == "efficiency_beta")
+        n = point.results.Total(OpticalSimulationClassifier::kSourceBeta);
+    G4double f = G4double(std::max<G4long>(n, 1)) / point.events;
+
+    // An efficiency not seen during the pilot is given half an event
+    G4double p = std::max(Efficiency(point), 0.5 / std::max<G4long>(n, 1));
+    return (1. - p) / (p * f);
+}
+
+void OpticalSimulationScanDriver::Allocate() {
+    G4double norm = 0.;
+    for (const auto &point : fPoints) {
+        if (point.events == 0)
+            continue;
+        G4double c = point.seconds / point.events;
+        G4double v = RelativeVariance(point);
+        norm += (fAllocation == "minimize") ? std::sqrt(v * c) : v * c;
+    }
+
+    for (auto &point : fPoints) {
+        if (point.events == 0)
+            continue;
+        G4double c = point.seconds / point.events;
+        G4double v = RelativeVariance(point);
+        G4double n = 0.;
+        if (norm > 0. && c > 0.)
+            n = (fAllocation == "minimize") ? fBudget * std::sqrt(v / c) / norm
+                                            : fBudget * v / norm;
+        point.allocated = std::min<G4long>(G4long(n), fMaxEvents);
+    }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Pilot pass, allocation and adaptive pass over all the points.
+ */
+void OpticalSimulationScanDriver::Run() {
+    if (fPoints.empty()) {
+        G4cerr << "Error: no scan point defined" << G4endl;
+        return;
+    }
+    fHasRun = true;
+
+    for (auto &point : fPoints) {
+        point.results.Clear();
+        point.events = 0;
+        point.seconds = 0.;
+        point.allocated = 0;
+    }
+
+    G4cout << "\n### Scan: pilot pass (" << fPilotEvents << " events x "
+           << fPoints.size() << " points)" << G4endl;
+    for (size_t i = 0; i < fPoints.size(); ++i)
+        Simulate(i, fPilotEvents, "pilot");
+
+    Allocate();
+
+    G4cout << "\n### Scan: adaptive pass (" << fAllocation << ", budget "
+           << fBudget << " s)" << G4endl;
+    for (size_t i = 0; i < fPoints.size(); ++i)
+        Simulate(i, fPoints[i].allocated, "adaptive");
+
+    for (size_t i = 0; i < fPoints.size(); ++i) {
+        G4String name = fName + "_point" + std::to_string(i);
+        std::vector<G4String> inputs = {name + "_pilot.root"};
+        if (fPoints[i].allocated > 0)
+            inputs.push_back(name + "_adaptive.root");
+        OpticalSimulationOutput::Merge(name + ".root", inputs);
+        OpticalSimulationOutput::MoveToResults(name);
+    }
+
+    Report();
+}
+
+void OpticalSimulationScanDriver::Report() const {
+    G4String csvName = fName + "_scan.csv";
+    std::ofstream csv(csvName);
+    csv << "point,commands,events,seconds," << fQuantity << ",error\n";
+
+    G4cout << "\n---------------- Scan summary (" << fQuantity
+           << ") ----------------" << G4endl;
+    for (size_t i = 0; i < fPoints.size(); ++i) {
+        const ScanPoint &point = fPoints[i];
+        G4double p = Efficiency(point);
+        G4double error =
+            p * std::sqrt(RelativeVariance(point) / point.events);
+
+        G4String commands;
+        for (const auto &command : point.commands)
+            commands += (commands.empty() ? "" : "; ") + command;
+
+        G4cout << "  Point " << i << " [" << commands << "] : "
+               << point.events << " events, " << std::fixed
+               << std::setprecision(1) << point.seconds << " s, "
+               << std::setprecision(5) << p << " +/- " << error
+               << std::defaultfloat << G4endl;
+        csv << i << ",\"" << commands << "\"," << point.events << ","
+            << point.seconds << "," << p << "," << error << "\n";
+    }
+    G4cout << "------------------------------------------------------------"
+           << G4endl;
+
+    csv.close();
+    G4UImanager::GetUIpointer()->ApplyCommand("/control/shell mv " + csvName +
+                                              " ../Resultats");
+}
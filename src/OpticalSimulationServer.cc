@@ -0,0 +1,311 @@
+/**
+ * @file OpticalSimulationServer.cc
+ * @brief Implementation of the warm simulation server.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Connections are handled one at a time: jobs of concurrent clients are
+ * queued by the listen backlog and run in arrival order. The socket file is
+ * only readable and writable by the user running the server (0600).
+ */
+
+#include "OpticalSimulationServer.hh"
+#include "G4RunManager.hh"
+#include "G4UIcommand.hh"
+#include "G4UIcommandTree.hh"
+#include "G4UImanager.hh"
+#include "OpticalSimulationOutput.hh"
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+//! Commands restored after every job
+const G4String restoredDirectory = "/OpticalSimulation/";
+const G4String geometryDirectory = "/OpticalSimulation/geometry/";
+const G4String sourceDirectory = "/gps/";
+
+//! Commands kept in the UI history (GPS state of the server start)
+const G4int historySize = 100000;
+
+//! True if a path lies in a directory
+G4bool InDirectory(const G4String &path, const G4String &directory) {
+    return path.compare(0, directory.size(), directory) == 0;
+}
+
+//! Output names: [A-Za-z0-9_.-]+, not starting with '-'
+G4bool ValidOutput(const G4String &name) {
+    if (name.empty() || name[0] == '-')
+        return false;
+    for (char c : name)
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' &&
+            c != '.' && c != '-')
+            return false;
+    return true;
+}
+
+/**
+ * @brief True if a value passes the parameter checks of a command, i.e. if
+ * the command can be set back to it.
+ */
+G4bool Restorable(const G4String &path, const G4String &value) {
+    G4UIcommand *command =
+        G4UImanager::GetUIpointer()->GetTree()->FindPath(path);
+    if (!command || value.empty())
+        return false;
+    std::istringstream is(value);
+    std::vector<G4String> tokens;
+    G4String token;
+    while (is >> token)
+        tokens.push_back(token);
+    size_t n = command->GetParameterEntries();
+    if (tokens.empty() || n == 0)
+        return false;
+    // Extra tokens belong to a trailing string parameter
+    if (tokens.size() > n &&
+        command->GetParameter(n - 1)->GetParameterType() != 's')
+        return false;
+    for (size_t i = 0; i < n; ++i) {
+        G4UIparameter *parameter = command->GetParameter(i);
+        if (i >= tokens.size()) {
+            if (!parameter->IsOmittable())
+                return false;
+        } else if (parameter->CheckNewValue(tokens[i].c_str()) != 0)
+            return false;
+    }
+    return true;
+}
+
+//! Write a reply line
+void Reply(G4int connection, const G4String &line) {
+    G4String text = line + "\n";
+    // No SIGPIPE if the client has already gone
+    if (send(connection, text.data(), text.size(), MSG_NOSIGNAL) < 0)
+        G4cerr << "Warning: server reply lost" << G4endl;
+}
+
+void Collect(const G4UIcommandTree *tree,
+             std::map<G4String, G4String> &values) {
+    if (!tree)
+        return;
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    for (G4int i = 1; i <= tree->GetCommandEntry(); ++i) {
+        G4String path = tree->GetCommand(i)->GetCommandPath();
+        values[path] = UI->GetCurrentValues(path);
+    }
+    for (G4int i = 1; i <= tree->GetTreeEntry(); ++i)
+        Collect(tree->GetTree(i), values);
+}
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationServer::OpticalSimulationServer(size_t nThreads, G4bool pMT)
+    : fNThreads(nThreads), flag_MT(pMT) {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/server/",
+                                        "Warm simulation server");
+
+    fMessenger->DeclareProperty("setSocket", fSocket)
+        .SetGuidance("Path of the Unix-domain socket.")
+        .SetParameterName("Socket", false)
+        .SetDefaultValue("/tmp/OpticalSimulation.sock");
+
+    fMessenger->DeclareMethod("start", &OpticalSimulationServer::Start)
+        .SetGuidance("Serve jobs until a shutdown request.");
+
+    // The /gps/ commands of the macro are replayed after the jobs
+    G4UImanager::GetUIpointer()->SetMaxHistSize(historySize);
+}
+
+OpticalSimulationServer::~OpticalSimulationServer() { delete fMessenger; }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+std::map<G4String, G4String>
+OpticalSimulationServer::CurrentValues(const G4String &path) {
+    std::map<G4String, G4String> values;
+    Collect(G4UImanager::GetUIpointer()->GetTree()->FindCommandTree(path),
+            values);
+    return values;
+}
+
+void OpticalSimulationServer::Start() {
+    fHasRun = true;
+
+    G4int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (server < 0 || fSocket.size() >= sizeof(address.sun_path)) {
+        G4cerr << "Error: cannot create the server socket" << G4endl;
+        return;
+    }
+    std::strncpy(address.sun_path, fSocket.c_str(),
+                 sizeof(address.sun_path) - 1);
+    unlink(fSocket.c_str());
+    // Socket file private to the user from its creation
+    mode_t mask = umask(0177);
+    G4bool bound = bind(server, reinterpret_cast<sockaddr *>(&address),
+                        sizeof(address)) == 0;
+    umask(mask);
+    if (!bound || chmod(fSocket.c_str(), 0600) < 0 ||
+        listen(server, 16) < 0) {
+        G4cerr << "Error: cannot listen on " << fSocket << G4endl;
+        close(server);
+        return;
+    }
+
+    fBaseline = CurrentValues(restoredDirectory);
+    fBuiltGeometry = CurrentValues(geometryDirectory);
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    fSourceHistory.clear();
+    for (G4int i = 0; i < UI->GetNumberOfHistory(); ++i) {
+        G4String command = UI->GetPreviousCommand(i);
+        if (InDirectory(command, sourceDirectory))
+            fSourceHistory.push_back(command);
+    }
+    G4cout << "### Server ready on " << fSocket << G4endl;
+
+    G4bool running = true;
+    while (running) {
+        G4int connection = accept(server, nullptr, nullptr);
+        if (connection < 0)
+            continue;
+        running = Serve(connection);
+        close(connection);
+    }
+
+    close(server);
+    unlink(fSocket.c_str());
+    G4cout << "### Server stopped" << G4endl;
+}
+
+G4bool OpticalSimulationServer::Serve(G4int connection) {
+    Job job;
+    G4String pending;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(connection, buffer, sizeof(buffer))) > 0) {
+        pending.append(buffer, n);
+        size_t end;
+        while ((end = pending.find('\n')) != std::string::npos) {
+            G4String line = pending.substr(0, end);
+            pending.erase(0, end + 1);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+
+            std::istringstream is(line);
+            G4String keyword, rest;
+            is >> keyword;
+            std::getline(is >> std::ws, rest);
+
+            if (keyword == "output" && !rest.empty())
+                job.output = rest;
+            else if (keyword == "events")
+                job.events = std::atol(rest.c_str());
+            else if (keyword == "command")
+                job.commands.push_back(rest);
+            else if (keyword == "run") {
+                Reply(connection, Run(job));
+                job = Job();
+            } else if (keyword == "ping")
+                Reply(connection, "ok ready");
+            else if (keyword == "shutdown") {
+                Reply(connection, "ok shutdown");
+                return false;
+            } else if (!keyword.empty())
+                Reply(connection, "error unknown keyword " + keyword);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Check the commands of a job, apply them, simulate it and restore
+ * the state.
+ *
+ * Only /OpticalSimulation/ commands whose value at server start can be set
+ * back, and /gps/ commands, are accepted. The GPS is restored by clearing
+ * its sources and replaying the /gps/ commands applied before the server
+ * start.
+ */
+G4String OpticalSimulationServer::Run(const Job &job) {
+    if (job.events <= 0)
+        return "error no events";
+    if (!ValidOutput(job.output))
+        return "error invalid output name " + job.output;
+
+    std::vector<G4String> touched;
+    G4bool source = false;
+    for (const auto &command : job.commands) {
+        G4String path = command.substr(0, command.find(' '));
+        if (InDirectory(path, sourceDirectory)) {
+            source = true;
+            continue;
+        }
+        if (!InDirectory(path, restoredDirectory))
+            return "error only /OpticalSimulation/ and /gps/ commands are "
+                   "allowed in a job: " +
+                   path;
+        if (InDirectory(path, "/OpticalSimulation/server/"))
+            return "error server commands are not allowed in a job";
+        auto baseline = fBaseline.find(path);
+        if (baseline == fBaseline.end() ||
+            !Restorable(path, baseline->second))
+            return "error " + path + " cannot be restored after a job";
+        touched.push_back(path);
+    }
+
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    // Back to the server state for the next job
+    auto restore = [&]() {
+        for (const auto &path : touched)
+            UI->ApplyCommand(path + " " + fBaseline[path]);
+        if (source) {
+            UI->ApplyCommand("/gps/source/clear");
+            UI->ApplyCommand("/gps/source/add 1.");
+            for (const auto &command : fSourceHistory)
+                UI->ApplyCommand(command);
+        }
+    };
+
+    for (const auto &command : job.commands) {
+        G4int status = UI->ApplyCommand(command);
+        if (status != 0) {
+            restore();
+            std::ostringstream os;
+            os << "error command failed (" << status << "): " << command;
+            return os.str();
+        }
+    }
+
+    // Rebuild the world only when its parameters differ from the built ones
+    auto geometry = CurrentValues(geometryDirectory);
+    if (geometry != fBuiltGeometry) {
+        UI->ApplyCommand("/run/reinitializeGeometry");
+        fBuiltGeometry = geometry;
+    }
+
+    UI->ApplyCommand("/OpticalSimulation/run/setOutputName " + job.output);
+    auto start = std::chrono::steady_clock::now();
+    G4RunManager::GetRunManager()->BeamOn(job.events);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+
+    if (flag_MT)
+        OpticalSimulationOutput::MergeThreadFiles(job.output, fNThreads);
+    OpticalSimulationOutput::MoveToResults(job.output);
+
+    const G4Run *run = G4RunManager::GetRunManager()->GetCurrentRun();
+    G4long events = run ? run->GetNumberOfEvent() : job.events;
+
+    restore();
+
+    std::ostringstream os;
+    os << "ok " << job.output << " " << events << " " << elapsed.count();
+    return os.str();
+}
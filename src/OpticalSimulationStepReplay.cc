@@ -0,0 +1,443 @@
+/**
+ * @file OpticalSimulationStepReplay.cc
+ * @brief Implementation of the ionisation step record and optical replay.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The photon generation follows G4Scintillation::PostStepDoIt (Geant4 11)
+ * with the Birks quenching of G4EmSaturation for a single step, or the
+ * light tables by particle type when they are enabled, so that a replay
+ * with unchanged settings reproduces the photon statistics of a full
+ * simulation. The rise time of the components is not modelled.
+ */
+
+#include "OpticalSimulationStepReplay.hh"
+#include "G4Event.hh"
+#include "G4Material.hh"
+#include "G4OpticalParameters.hh"
+#include "G4ParticleTable.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4Poisson.hh"
+#include "G4PrimaryParticle.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4ProcessTable.hh"
+#include "G4Step.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#include "TChain.h"
+#include "TTree.h"
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+std::vector<OpticalSimulationStepReplay::Event>
+    OpticalSimulationStepReplay::fReplayEvents;
+
+namespace {
+//! Materials of the recorded volumes
+const char *materialNames[OpticalSimulationStepReplay::kNVolumes] = {
+    "ZnS", "EJ212"};
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Constructor.
+ *
+ * Declares the commands under /OpticalSimulation/replay/.
+ */
+OpticalSimulationStepReplay::OpticalSimulationStepReplay() {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/replay/",
+                                        "Ionisation step record and replay");
+
+    fMessenger->DeclareProperty("setMode", fMode)
+        .SetGuidance("off, record (ionisation steps in ZnS and EJ-212, no "
+                     "optical photon) or replay (photons of recorded steps).")
+        .SetParameterName("Mode", false)
+        .SetCandidates("off record replay")
+        .SetDefaultValue("off");
+
+    fMessenger->DeclareProperty("setInput", fInput)
+        .SetGuidance("Recorded output(s) replayed, wildcards allowed.")
+        .SetParameterName("Input", false)
+        .SetDefaultValue("");
+}
+
+/**
+ * @brief Destructor.
+ */
+OpticalSimulationStepReplay::~OpticalSimulationStepReplay() {
+    delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Create the Steps tree and its branches (key branches are added by
+ * the run action).
+ */
+TTree *OpticalSimulationStepReplay::CreateTree() {
+    auto *tree = new TTree("Steps", "Ionisation steps in ZnS and EJ-212");
+    tree->Branch("x", &fInputRecord.x, "x/F");
+    tree->Branch("xp", &fInputRecord.xp, "xp/F");
+    tree->Branch("y", &fInputRecord.y, "y/F");
+    tree->Branch("yp", &fInputRecord.yp, "yp/F");
+    tree->Branch("z", &fInputRecord.z, "z/F");
+    tree->Branch("zp", &fInputRecord.zp, "zp/F");
+    tree->Branch("energy", &fInputRecord.energy, "energy/F");
+    tree->Branch("source_pdg", &fSourcePDG, "source_pdg/I");
+    tree->Branch("volume", "vector<int>", &fVolume);
+    tree->Branch("particle", "vector<int>", &fParticle);
+    tree->Branch("parent", "vector<int>", &fParent);
+    const char *axes[3] = {"x", "y", "z"};
+    for (G4int a = 0; a < 3; ++a) {
+        tree->Branch((G4String(axes[a]) + "_pre").c_str(), "vector<float>",
+                     &fPre[a]);
+        tree->Branch((G4String(axes[a]) + "_post").c_str(), "vector<float>",
+                     &fPost[a]);
+    }
+    tree->Branch("time_pre", "vector<float>", &fTimePre);
+    tree->Branch("time_post", "vector<float>", &fTimePost);
+    tree->Branch("deposit", "vector<float>", &fDeposit);
+    tree->Branch("length", "vector<float>", &fLength);
+    tree->Branch("kinetic", "vector<float>", &fKinetic);
+    return tree;
+}
+
+/**
+ * @brief Inactivate the scintillation in record mode and read the
+ * scintillation properties of ZnS:Ag and EJ-212 for the run.
+ *
+ * The process table is thread-local: each thread switches its own
+ * Scintillation process, before its first event.
+ */
+void OpticalSimulationStepReplay::BeginOfRun() {
+    if (IsRecording() != fScintillationOff) {
+        G4ProcessTable::GetProcessTable()->SetProcessActivation(
+            "Scintillation", fScintillationOff);
+        fScintillationOff = IsRecording();
+    }
+
+    Clear();
+    fCurrent = nullptr;
+    if (!IsReplaying())
+        return;
+
+    for (G4int v = 0; v < kNVolumes; ++v) {
+        Emission &emission = fEmission[v];
+        emission = Emission();
+        G4Material *material = G4Material::GetMaterial(materialNames[v]);
+        G4MaterialPropertiesTable *mpt =
+            material ? material->GetMaterialPropertiesTable() : nullptr;
+        if (!mpt || !mpt->ConstPropertyExists("SCINTILLATIONYIELD")) {
+            G4cerr << "Warning: no scintillation yield for "
+                   << materialNames[v] << ", its steps are not replayed"
+                   << G4endl;
+            continue;
+        }
+        emission.yield = mpt->GetConstProperty("SCINTILLATIONYIELD");
+        if (mpt->ConstPropertyExists("RESOLUTIONSCALE"))
+            emission.resolution = mpt->GetConstProperty("RESOLUTIONSCALE");
+        emission.birks = material->GetIonisation()->GetBirksConstant();
+
+        // Light tables of the particle types, as G4Scintillation uses them
+        emission.byParticle =
+            G4OpticalParameters::Instance()->GetScintByParticleType();
+        for (G4int p = 0;
+             emission.byParticle && p < OpticalSimulationQuenching::kNParticles;
+             ++p) {
+            emission.light[p] = mpt->GetProperty(
+                OpticalSimulationQuenching::YieldProperty(p).c_str());
+            if (!emission.light[p]) {
+                G4cerr << "Warning: no "
+                       << OpticalSimulationQuenching::YieldProperty(p)
+                       << " for " << materialNames[v]
+                       << ", its steps are not replayed" << G4endl;
+                emission.yield = 0.;
+            }
+        }
+
+        G4double sum = 0.;
+        for (G4int c = 0; c < 3; ++c) {
+            G4String index = std::to_string(c + 1);
+            G4MaterialPropertyVector *spectrum =
+                mpt->GetProperty(("SCINTILLATIONCOMPONENT" + index).c_str());
+            G4String yieldName = "SCINTILLATIONYIELD" + index;
+            G4double yield = mpt->ConstPropertyExists(yieldName.c_str())
+                                 ? mpt->GetConstProperty(yieldName.c_str())
+                                 : (c == 0 ? 1. : 0.);
+            if (!spectrum || yield <= 0.)
+                continue;
+            G4int k = emission.nComponents++;
+            G4String tauName = "SCINTILLATIONTIMECONSTANT" + index;
+            emission.tau[k] = mpt->ConstPropertyExists(tauName.c_str())
+                                  ? mpt->GetConstProperty(tauName.c_str())
+                                  : 0.;
+            emission.spectrum[k] = spectrum;
+            emission.spectrumMax[k] = spectrum->GetMaxValue();
+            sum += yield;
+            emission.fraction[k] = sum;
+        }
+        for (G4int k = 0; k < emission.nComponents; ++k)
+            emission.fraction[k] /= sum;
+    }
+}
+
+/**
+ * @brief Load every recorded event of the replay input, ordered on the
+ * event key (segment, run, event) so that the mapping of the replayed
+ * events does not depend on the threads of the recording.
+ */
+void OpticalSimulationStepReplay::LoadReplayInput() const {
+    fReplayEvents.clear();
+    if (!IsReplaying())
+        return;
+
+    TChain chain("Steps");
+    if (fInput.empty() || chain.Add(fInput.c_str()) == 0 ||
+        chain.GetEntries() <= 0) {
+        G4cerr << "Error: no recorded steps in " << fInput << G4endl;
+        return;
+    }
+
+    RunTallyInput input;
+    G4int sourcePDG = 0, segment = 0, run = 0, eventID = 0;
+    std::vector<int> *volume = nullptr, *particle = nullptr,
+                     *parent = nullptr;
+    std::vector<float> *pre[3] = {nullptr, nullptr, nullptr};
+    std::vector<float> *post[3] = {nullptr, nullptr, nullptr};
+    std::vector<float> *timePre = nullptr, *timePost = nullptr,
+                       *deposit = nullptr, *length = nullptr;
+    chain.SetBranchAddress("segment", &segment);
+    chain.SetBranchAddress("run", &run);
+    chain.SetBranchAddress("event", &eventID);
+    chain.SetBranchAddress("x", &input.x);
+    chain.SetBranchAddress("xp", &input.xp);
+    chain.SetBranchAddress("y", &input.y);
+    chain.SetBranchAddress("yp", &input.yp);
+    chain.SetBranchAddress("z", &input.z);
+    chain.SetBranchAddress("zp", &input.zp);
+    chain.SetBranchAddress("energy", &input.energy);
+    chain.SetBranchAddress("source_pdg", &sourcePDG);
+    chain.SetBranchAddress("volume", &volume);
+    chain.SetBranchAddress("particle", &particle);
+    chain.SetBranchAddress("parent", &parent);
+    const char *axes[3] = {"x", "y", "z"};
+    for (G4int a = 0; a < 3; ++a) {
+        chain.SetBranchAddress((G4String(axes[a]) + "_pre").c_str(), &pre[a]);
+        chain.SetBranchAddress((G4String(axes[a]) + "_post").c_str(),
+                               &post[a]);
+    }
+    chain.SetBranchAddress("time_pre", &timePre);
+    chain.SetBranchAddress("time_post", &timePost);
+    chain.SetBranchAddress("deposit", &deposit);
+    chain.SetBranchAddress("length", &length);
+
+    // Scintillation by particle type: the light of a step depends on its
+    // pre-step kinetic energy, recorded since the quenching tables
+    std::vector<float> *kinetic = nullptr;
+    if (chain.GetBranch("kinetic"))
+        chain.SetBranchAddress("kinetic", &kinetic);
+    else if (G4OpticalParameters::Instance()->GetScintByParticleType()) {
+        G4cerr << "Error: " << fInput << " has no pre-step kinetic energy, "
+               << "it cannot be replayed with the scintillation by particle "
+               << "type" << G4endl;
+        chain.ResetBranchAddresses();
+        return;
+    }
+
+    std::vector<std::tuple<G4int, G4int, G4int, Long64_t>> order;
+    for (Long64_t i = 0; i < chain.GetEntries(); ++i) {
+        chain.GetEntry(i);
+        order.emplace_back(segment, run, eventID, i);
+    }
+    std::sort(order.begin(), order.end());
+
+    size_t nSteps = 0;
+    fReplayEvents.resize(order.size());
+    for (size_t e = 0; e < order.size(); ++e) {
+        chain.GetEntry(std::get<3>(order[e]));
+        Event &event = fReplayEvents[e];
+        event.input = input;
+        event.sourcePDG = sourcePDG;
+        event.steps.resize(volume->size());
+        for (size_t s = 0; s < volume->size(); ++s) {
+            Step &step = event.steps[s];
+            step.volume = (*volume)[s];
+            step.particle = (*particle)[s];
+            step.parent = (*parent)[s];
+            for (G4int a = 0; a < 3; ++a) {
+                step.pre[a] = (*pre[a])[s];
+                step.post[a] = (*post[a])[s];
+            }
+            step.timePre = (*timePre)[s];
+            step.timePost = (*timePost)[s];
+            step.deposit = (*deposit)[s];
+            step.length = (*length)[s];
+            step.kinetic = kinetic ? (*kinetic)[s] : 0.f;
+        }
+        nSteps += volume->size();
+    }
+    chain.ResetBranchAddresses();
+    G4cout << "Replay of " << fReplayEvents.size() << " recorded events ("
+           << nSteps << " steps) from " << fInput << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationStepReplay::Record(const G4Step *step, Volume volume) {
+    if (step->GetTotalEnergyDeposit() <= 0.)
+        return;
+    const G4StepPoint *pre = step->GetPreStepPoint();
+    const G4StepPoint *post = step->GetPostStepPoint();
+    const G4Track *track = step->GetTrack();
+    fVolume.push_back(volume);
+    fParticle.push_back(track->GetDefinition()->GetPDGEncoding());
+    fParent.push_back(track->GetParentID());
+    for (G4int a = 0; a < 3; ++a) {
+        fPre[a].push_back(pre->GetPosition()[a] / mm);
+        fPost[a].push_back(post->GetPosition()[a] / mm);
+    }
+    fTimePre.push_back(pre->GetGlobalTime() / ns);
+    fTimePost.push_back(post->GetGlobalTime() / ns);
+    fDeposit.push_back(step->GetTotalEnergyDeposit() / keV);
+    fLength.push_back(step->GetStepLength() / mm);
+    fKinetic.push_back(pre->GetKineticEnergy() / keV);
+}
+
+void OpticalSimulationStepReplay::SetEventInput(const RunTallyInput &input,
+                                                G4int sourcePDG) {
+    fInputRecord = input;
+    fSourcePDG = sourcePDG;
+}
+
+void OpticalSimulationStepReplay::Clear() {
+    for (auto *column : {&fVolume, &fParticle, &fParent})
+        column->clear();
+    for (G4int a = 0; a < 3; ++a) {
+        fPre[a].clear();
+        fPost[a].clear();
+    }
+    for (auto *column :
+         {&fTimePre, &fTimePost, &fDeposit, &fLength, &fKinetic})
+        column->clear();
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Fill the event with the photons of a recorded event (event ID
+ * modulo the number of recorded events); called instead of GPS.
+ */
+void OpticalSimulationStepReplay::SamplePrimary(G4Event *event) {
+    fCurrent = nullptr;
+    if (!IsReplaying() || fReplayEvents.empty())
+        return;
+    fCurrent = &fReplayEvents[event->GetEventID() % fReplayEvents.size()];
+    for (const Step &step : fCurrent->steps)
+        GeneratePhotons(step, event);
+}
+
+/**
+ * @brief Scintillation photons of one step, as primaries of the event.
+ */
+void OpticalSimulationStepReplay::GeneratePhotons(const Step &step,
+                                                  G4Event *event) const {
+    if (step.volume < 0 || step.volume >= kNVolumes)
+        return;
+    const Emission &emission = fEmission[step.volume];
+    if (emission.yield <= 0. || emission.nComponents == 0)
+        return;
+
+    G4double deposit = step.deposit * keV;
+    G4double mean;
+    if (emission.byParticle) {
+        // Light of the particle stopping from E minus the light from
+        // E - dE, as G4Scintillation with setByParticleType
+        G4MaterialPropertyVector *light =
+            emission.light[OpticalSimulationQuenching::ParticleOf(
+                step.particle)];
+        G4double kinetic = step.kinetic * keV;
+        mean = light->Value(kinetic) -
+               light->Value(std::max(0., kinetic - deposit));
+    } else {
+        // Birks quenching of the step: dE / (1 + kB dE/dx)
+        G4double length = step.length * mm;
+        if (emission.birks > 0. && length > 0.)
+            deposit /= 1. + emission.birks * deposit / length;
+        mean = emission.yield * deposit;
+    }
+    G4int nPhotons;
+    if (mean > 10.)
+        nPhotons = std::max(0, G4int(std::lround(G4RandGauss::shoot(
+                                   mean, emission.resolution *
+                                             std::sqrt(mean)))));
+    else
+        nPhotons = G4int(G4Poisson(mean));
+
+    static G4ParticleDefinition *photon =
+        G4ParticleTable::GetParticleTable()->FindParticle("opticalphoton");
+    const G4ThreeVector pre(step.pre[0], step.pre[1], step.pre[2]);
+    const G4ThreeVector delta =
+        G4ThreeVector(step.post[0], step.post[1], step.post[2]) - pre;
+
+    for (G4int i = 0; i < nPhotons; ++i) {
+        G4int k = 0;
+        G4double u = G4UniformRand();
+        while (k < emission.nComponents - 1 && u > emission.fraction[k])
+            ++k;
+
+        // Emission point and time along the step, then decay
+        G4double along = G4UniformRand();
+        G4ThreeVector position = (pre + along * delta) * mm;
+        G4double time =
+            (step.timePre + along * (step.timePost - step.timePre)) * ns;
+        if (emission.tau[k] > 0.)
+            time -= emission.tau[k] * std::log(G4UniformRand());
+
+        G4MaterialPropertyVector *spectrum = emission.spectrum[k];
+        G4double energy;
+        do {
+            energy = spectrum->GetMinEnergy() +
+                     (spectrum->GetMaxEnergy() - spectrum->GetMinEnergy()) *
+                         G4UniformRand();
+        } while (G4UniformRand() * emission.spectrumMax[k] >
+                 spectrum->Value(energy));
+
+        // Isotropic direction, random linear polarisation
+        G4double cosTheta = 1. - 2. * G4UniformRand();
+        G4double sinTheta = std::sqrt(1. - cosTheta * cosTheta);
+        G4double phi = twopi * G4UniformRand();
+        G4ThreeVector direction(sinTheta * std::cos(phi),
+                                sinTheta * std::sin(phi), cosTheta);
+        G4ThreeVector polarization = direction.orthogonal().unit();
+        polarization.rotate(twopi * G4UniformRand(), direction);
+
+        auto *primary = new G4PrimaryParticle(photon);
+        primary->SetKineticEnergy(energy);
+        primary->SetMomentumDirection(direction);
+        primary->SetPolarization(polarization);
+        auto *vertex = new G4PrimaryVertex(position, time);
+        vertex->SetPrimary(primary);
+        event->AddPrimaryVertex(vertex);
+    }
+}
+
+/**
+ * @brief Restore the primary, the source and the deposits per volume of the
+ * replayed event (the ZnS and scintillator trees stay empty).
+ */
+void OpticalSimulationStepReplay::RestoreEvent(RunTallyInput &input,
+                                               RunTallySc &zns,
+                                               RunTallySc &scintillator,
+                                               G4int &sourcePDG) const {
+    if (!IsReplaying() || !fCurrent)
+        return;
+    input = fCurrent->input;
+    sourcePDG = fCurrent->sourcePDG;
+    zns.deposited_energy_event = 0.f;
+    scintillator.deposited_energy_event = 0.f;
+    for (const Step &step : fCurrent->steps)
+        (step.volume == kZnS ? zns : scintillator).deposited_energy_event +=
+            step.deposit;
+}
@@ -18,6 +18,7 @@
  */
 
 #include "OpticalSimulationSteppingAction.hh"
+#include "OpticalSimulationFresnelBoundary.hh"
 
 /**
  * @brief Constructor.
@@ -85,7 +86,9 @@ void OpticalSimulationSteppingAction::CheckBoundaryStatus(
         }
     }
 
-    boundaryStatus = boundary->GetStatus();
+    // Tabulated interfaces keep their own status
+    auto *fresnel = dynamic_cast<OpticalSimulationFresnelBoundary *>(boundary);
+    boundaryStatus = fresnel ? fresnel->GetStatus() : boundary->GetStatus();
 
     if (endproc == "OpAbsorption") {
         if (aStep->GetPreStepPoint()->GetPhysicalVolume()->GetName() == "ZnS") {
@@ -247,47 +250,31 @@ void OpticalSimulationSteppingAction::SetPhotonBirthInformation(
 }
 
 /**
- * @brief Update YAG (Yttrium Aluminum Garnet screen) tally with particle data.
+ * @brief Update a ZnS or scintillator tally with a charged-particle step.
  *
- * @param tally YAG tally to update.
- * @param x Exit X position [mm].
- * @param y Exit Y position [mm].
- * @param z Exit Z position [mm].
+ * The deposit of the event is summed here; the entry of the track (entrance,
+ * particle, energy, deposit in the volume) is accumulated in the track
+ * tally of the event and written when the track ends.
+ *
+ * @param tally Volume tally to update.
+ * @param evtac Event action holding the track tally.
+ * @param volume Volume of the step.
+ * @param x Entrance X position [mm].
+ * @param y Entrance Y position [mm].
+ * @param z Entrance Z position [mm].
  * @param energy Particle kinetic energy [MeV].
  * @param energyDeposited Deposited energy [keV].
- * @param parentID ID of the parent track.
- * @param particleID PDG encoding of the particle.
- * @param volumeNamePostStep Name of the post-step volume.
- * @param trackingStatus Whether particle tracking is active.
  * @param track Pointer to the current Geant4 track.
  */
-void UpdateSc(RunTallySc &tally, G4float x, G4float y, G4float z,
-              G4float energy, G4float energyDeposited, G4float energy_post,
-              G4float parentID, G4int particleID,
-              const G4String &volumeNamePostStep, G4bool trackingStatus,
-              G4Track *track) {
-    // If this is the first step for this particle in this tally
-    if (!tally.flag) {
-        tally.AddXEntrance(x);
-        tally.AddYEntrance(y);
-        tally.AddZEntrance(z);
-        tally.AddParentID(parentID);
-        tally.AddParticleID(particleID);
-        tally.AddEnergy(energy);
-        tally.ActivateFlag();
-    }
-
-    // Add energy deposited for this step
-    tally.AddDepositedEnergy(energyDeposited);
+void UpdateSc(RunTallySc &tally, OpticalSimulationEventAction *evtac,
+              OpticalSimulationTrackTally::Volume volume, G4float x,
+              G4float y, G4float z, G4float energy, G4float energyDeposited,
+              const G4Track *track) {
     tally.AddDepositedEnergyEvent(energyDeposited);
-
-    // If particle reached holder volume or lost all energy
-    if (volumeNamePostStep == "Holder" || energy_post == 0) {
-        tally.AddTotalDepositedEnergy(tally.GetDepositedEnergy());
-        tally.ResetDepositedEnergy();
-        tally.ResetFlag();
-        // G4cout << "RESET SC" << G4endl;
-    }
+    evtac->GetTrackTally().Step(
+        track->GetTrackID(), volume, evtac->GetSubEvent(),
+        track->GetParentID(), track->GetDefinition()->GetPDGEncoding(), x, y,
+        z, energy, energyDeposited);
 }
 
 /**
@@ -346,8 +333,22 @@ void OpticalSimulationSteppingAction::UserSteppingAction(const G4Step *aStep) {
 
     // --- Begin main logic ---
 
-    // Initial beam info (step 1, primary particle only)
-    if (parentID == 0 && stepNo == 1)
+    auto runac = static_cast<OpticalSimulationRunAction *>(
+        G4RunManager::GetRunManager()->GetUserRunAction());
+    OpticalSimulationStepReplay &replay = runac->GetStepReplay();
+    OpticalSimulationWatchdog &watchdog = runac->GetWatchdog();
+
+    // Per-event budgets (may abort the event)
+    if (watchdog.IsEnabled())
+        watchdog.Step(theTrack);
+
+    // Batched events: tallies of the primary this track descends from
+    if (stepNo == 1 && evtac->IsBatched())
+        evtac->EnterTrack(theTrack);
+
+    // Initial beam info (step 1, primary particle only); replayed events
+    // get the primary of the recorded event
+    if (parentID == 0 && stepNo == 1 && !replay.IsReplaying())
         SetInputInformations(evtac);
 
     // YAG screens
@@ -361,9 +362,16 @@ void OpticalSimulationSteppingAction::UserSteppingAction(const G4Step *aStep) {
     auto it = ScMap.find(volumeNamePreStep);
     if (it != ScMap.end() && particleName != "opticalphoton") {
         RunTallySc &sc = (evtac->*(it->second))();
-        UpdateSc(sc, preStep.x, preStep.y, preStep.z, energy, energyDeposited,
-                 energy_post, parentID, particleID, volumeNamePostStep,
-                 TrackingStatus, theTrack);
+        G4bool zns = volumeNamePreStep == "ZnS";
+        UpdateSc(sc, evtac,
+                 zns ? OpticalSimulationTrackTally::kZnS
+                     : OpticalSimulationTrackTally::kScintillator,
+                 preStep.x, preStep.y, preStep.z, energy, energyDeposited,
+                 theTrack);
+        if (replay.IsRecording())
+            replay.Record(aStep,
+                          zns ? OpticalSimulationStepReplay::kZnS
+                              : OpticalSimulationStepReplay::kScintillator);
     }
 
     // ░█████╗░██████╗░████████╗██╗░█████╗░░█████╗░██╗░░░░░  ██████╗░░█████╗░██████╗░████████╗
@@ -374,22 +382,41 @@ void OpticalSimulationSteppingAction::UserSteppingAction(const G4Step *aStep) {
     // ░╚════╝░╚═╝░░░░░░░░╚═╝░░░╚═╝░╚════╝░╚═╝░░╚═╝╚══════╝  ╚═╝░░░░░╚═╝░░╚═╝╚═╝░░╚═╝░░░╚═╝░░░
 
     if (particleName == "opticalphoton") {
+        // Step record: the light is produced later, by the replay (the
+        // scintillation is off, any other photon is dropped)
+        if (replay.IsRecording()) {
+            theTrack->SetTrackStatus(fStopAndKill);
+            return;
+        }
+
+        // Track-length scoring of the adjoint light-collection maps
+        if (runac->GetLightCollectionMap().IsAdjoint())
+            runac->GetLightCollectionMap().Score(aStep);
+
         if (PhotonTrackStatus == false) {
             evtac->CountKilled();
             theTrack->SetTrackStatus(fStopAndKill);
         }
 
+        // Watchdog downgrade: the remaining photons are killed
+        else if (watchdog.KillsPhotons()) {
+            evtac->CountKilled();
+            watchdog.CountKilled();
+            theTrack->SetTrackStatus(fStopAndKill);
+        }
+
         else {
             CheckBoundaryStatus(aStep, evtac);
         }
 
         if (stepNo == 1) {
             SetPhotonBirthInformation(aStep, evtac);
-            if (aStep->GetTrack()->GetCreatorProcess()->GetProcessName() ==
-                "Scintillation")
+            // Primary optical photons (photon scans) have no creator process
+            const G4VProcess *creator = aStep->GetTrack()->GetCreatorProcess();
+            if ((creator && creator->GetProcessName() == "Scintillation") ||
+                (!creator && replay.IsReplaying()))
                 CountScintillation(aStep, evtac);
-            if (aStep->GetTrack()->GetCreatorProcess()->GetProcessName() ==
-                "Cerenkov")
+            if (creator && creator->GetProcessName() == "Cerenkov")
                 CountCerenkov(aStep, evtac);
         }
     }
@@ -439,4 +466,10 @@ void OpticalSimulationSteppingAction::UserSteppingAction(const G4Step *aStep) {
     if (aStep->GetPostStepPoint()->GetPhysicalVolume()->GetName() == "World") {
         theTrack->SetTrackStatus(fStopAndKill);
     }
+
+    // ZnS and scintillator entries of a charged track, once it ends
+    if (particleName != "opticalphoton" &&
+        (theTrack->GetTrackStatus() == fStopAndKill ||
+         theTrack->GetTrackStatus() == fKillTrackAndSecondaries))
+        evtac->EndTrack(trackID);
 }
@@ -0,0 +1,181 @@
+/**
+ * @file OpticalSimulationSymmetry.cc
+ * @brief Implementation of the transverse symmetry detection and folding.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Fundamental domains:
+ *  - mirror_x : x >= 0
+ *  - mirror_y : y >= 0
+ *  - d2       : x >= 0, y >= 0
+ *  - d4       : 0 <= y <= x
+ *
+ * @note The PMT is placed with the Flip rotation set by Construct(). The
+ * detection reads the rotation of the placed volume rather than assuming
+ * an on-axis PMT: with its axis
+ * along z the PMT keeps the d2/d4 symmetry, with its axis along y only
+ * mirror_x remains. A mirror also needs the same wrapping and finish on
+ * the two lateral faces it exchanges, d4 on the four of them.
+ */
+
+#include "OpticalSimulationSymmetry.hh"
+#include "OpticalSimulationGeometryConstruction.hh"
+#include <cmath>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Constructor.
+ *
+ * Declares the commands under /OpticalSimulation/symmetry/.
+ */
+OpticalSimulationSymmetry::OpticalSimulationSymmetry() {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/symmetry/",
+                                        "Symmetry folding of position studies");
+
+    fMessenger->DeclareProperty("setGroup", fRequested)
+        .SetGuidance("Symmetry group used by the position studies: auto "
+                     "(detected from the geometry), none, mirror_x, "
+                     "mirror_y, d2 or d4.")
+        .SetParameterName("Group", false)
+        .SetCandidates("auto none mirror_x mirror_y d2 d4")
+        .SetDefaultValue("auto");
+}
+
+/**
+ * @brief Destructor.
+ */
+OpticalSimulationSymmetry::~OpticalSimulationSymmetry() { delete fMessenger; }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+const char *OpticalSimulationSymmetry::GroupName(G4int group) {
+    static const char *names[kNGroups] = {"none", "mirror_x", "mirror_y", "d2",
+                                          "d4"};
+    return names[group];
+}
+
+std::vector<OpticalSimulationSymmetry::Element>
+OpticalSimulationSymmetry::Elements(G4int group) {
+    const Element identity = {1, 0, 0, 1};
+    const Element mirrorX = {-1, 0, 0, 1};
+    const Element mirrorY = {1, 0, 0, -1};
+    const Element rotation180 = {-1, 0, 0, -1};
+
+    switch (group) {
+    case kMirrorX:
+        return {identity, mirrorX};
+    case kMirrorY:
+        return {identity, mirrorY};
+    case kD2:
+        return {identity, mirrorX, mirrorY, rotation180};
+    case kD4:
+        return {identity,     mirrorX,       mirrorY,      rotation180,
+                {0, 1, 1, 0}, {0, -1, -1, 0}, {0, -1, 1, 0}, {0, 1, -1, 0}};
+    default:
+        return {identity};
+    }
+}
+
+/**
+ * @brief Detect the symmetry group of the current geometry.
+ */
+G4int OpticalSimulationSymmetry::Detect() const {
+    if (!fGeometry)
+        return kNone;
+
+    const G4double tolerance = 1e-6;
+    auto equal = [tolerance](G4double a, G4double b) {
+        return std::abs(a - b) < tolerance * std::max(1., std::abs(a));
+    };
+
+    // PMT: body of revolution, mirrors must map its axis and centre onto
+    // themselves
+    G4ThreeVector axis = fGeometry->GetPMTAxis().unit();
+    G4ThreeVector position = fGeometry->GetPMTPosition();
+    G4bool centredX = std::abs(position.x()) < tolerance;
+    G4bool centredY = std::abs(position.y()) < tolerance;
+    G4bool alongZ = std::abs(std::abs(axis.z()) - 1.) < tolerance;
+    G4bool mirrorX = centredX && std::abs(axis.x()) < tolerance;
+    G4bool mirrorY = centredY && std::abs(axis.y()) < tolerance;
+
+    // Wrapping: each mirror exchanges a pair of lateral faces
+    using Geom = OpticalSimulationGeometryConstruction;
+    const G4String xMin = fGeometry->GetWrapping(Geom::kXMin);
+    const G4String yMin = fGeometry->GetWrapping(Geom::kYMin);
+    mirrorX = mirrorX && xMin == fGeometry->GetWrapping(Geom::kXMax);
+    mirrorY = mirrorY && yMin == fGeometry->GetWrapping(Geom::kYMax);
+
+    if (!mirrorX && !mirrorY)
+        return kNone;
+    if (mirrorX && !mirrorY)
+        return kMirrorX;
+    if (mirrorY && !mirrorX)
+        return kMirrorY;
+
+    // Both mirrors: the diagonals need an on-axis PMT, square layers and
+    // the same wrapping on the x and y faces
+    G4bool square =
+        equal(fGeometry->GetZnSLength(), fGeometry->GetZnSWidth()) &&
+        equal(fGeometry->GetScintillatorLength(),
+              fGeometry->GetScintillatorWidth());
+    return (alongZ && square && xMin == yMin) ? kD4 : kD2;
+}
+
+/**
+ * @brief Resolve the requested group for the current geometry.
+ *
+ * A declared group is used as is; "auto" uses the detected one.
+ */
+void OpticalSimulationSymmetry::Update() {
+    fGroup = kNone;
+    if (fRequested == "auto") {
+        fGroup = Detect();
+    } else {
+        for (G4int g = 0; g < kNGroups; ++g)
+            if (fRequested == GroupName(g))
+                fGroup = g;
+    }
+    fElements = Elements(fGroup);
+}
+
+void OpticalSimulationSymmetry::RestrictToGrid(G4int nx, G4int ny) {
+    if (fGroup == kD4 && nx != ny) {
+        G4cout << "Symmetry: non-square grid, d4 restricted to d2" << G4endl;
+        fGroup = kD2;
+        fElements = Elements(fGroup);
+    }
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationSymmetry::Apply(G4int k, G4double &x,
+                                      G4double &y) const {
+    const Element &e = fElements[k];
+    G4double x0 = x, y0 = y;
+    x = e.xx * x0 + e.xy * y0;
+    y = e.yx * x0 + e.yy * y0;
+}
+
+void OpticalSimulationSymmetry::Fold(G4double &x, G4double &y) const {
+    switch (fGroup) {
+    case kMirrorX:
+        x = std::abs(x);
+        break;
+    case kMirrorY:
+        y = std::abs(y);
+        break;
+    case kD2:
+        x = std::abs(x);
+        y = std::abs(y);
+        break;
+    case kD4:
+        x = std::abs(x);
+        y = std::abs(y);
+        if (y > x)
+            std::swap(x, y);
+        break;
+    default:
+        break;
+    }
+}
@@ -0,0 +1,190 @@
+/**
+ * @file OpticalSimulationTopUp.cc
+ * @brief Implementation of the statistics top-up.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The seed record of an output has one line per run,
+ * `segment <s> seed <seed> run <id> events <n>`. The top-up runs in segment
+ * max(s) + 1 with the same base seed and writes `<name>_topup.root`, which
+ * holds the new events and the combined run-level results; its trees are
+ * then appended to the original output. With chunked output, the new
+ * chunks are moved next to the original ones and appended to its manifest.
+ */
+
+#include "OpticalSimulationTopUp.hh"
+#include "G4RunManager.hh"
+#include "G4UImanager.hh"
+#include "OpticalSimulationCache.hh"
+#include "OpticalSimulationOutput.hh"
+#include "TFile.h"
+#include "TNamed.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationTopUp::OpticalSimulationTopUp(const G4String &name,
+                                               size_t nThreads, G4bool pMT,
+                                               G4long nEvents)
+    : fName(name), fNThreads(nThreads), flag_MT(pMT),
+      fDefaultEvents(nEvents) {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/topup/",
+                                        "Statistics top-up");
+
+    fMessenger->DeclareProperty("setEvents", fEvents)
+        .SetGuidance("Additional events (0: events of the command line).")
+        .SetParameterName("Events", false)
+        .SetRange("Events>=0")
+        .SetDefaultValue("0");
+
+    fMessenger->DeclareProperty("setDirectory", fDirectory)
+        .SetGuidance("Directory of the outputs to extend.")
+        .SetParameterName("Directory", false)
+        .SetDefaultValue("../Resultats");
+
+    fMessenger->DeclareMethod("extend", &OpticalSimulationTopUp::Extend)
+        .SetGuidance("Add events to an existing output (name without "
+                     ".root).")
+        .SetParameterName("Output", false);
+}
+
+OpticalSimulationTopUp::~OpticalSimulationTopUp() { delete fMessenger; }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+G4String OpticalSimulationTopUp::Section(const G4String &configuration,
+                                         const G4String &name) {
+    G4String header = "[" + name + "]\n";
+    size_t begin = configuration.find(header);
+    if (begin == std::string::npos)
+        return "";
+    begin += header.size();
+    size_t end = configuration.find("\n[", begin - 1);
+    return configuration.substr(begin, end == std::string::npos
+                                           ? std::string::npos
+                                           : end + 1 - begin);
+}
+
+void OpticalSimulationTopUp::Replay(const G4String &configuration) const {
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    std::istringstream commands(Section(configuration, "commands"));
+    G4String command;
+    while (std::getline(commands, command))
+        if (!command.empty())
+            UI->ApplyCommand(command);
+}
+
+/**
+ * @brief Simulate additional events and merge them into an output.
+ * @param input Output name (without .root) in the results directory.
+ */
+void OpticalSimulationTopUp::Extend(G4String input) {
+    fHasRun = true;
+    G4String path = fDirectory + "/" + input + ".root";
+
+    // Embedded configuration and seed bookkeeping
+    G4String stored, seeds;
+    {
+        TFile file(path.c_str(), "READ");
+        if (file.IsZombie()) {
+            G4cerr << "Error: cannot open " << path << G4endl;
+            return;
+        }
+        auto *configuration = file.Get<TNamed>("configuration");
+        auto *record = file.Get<TNamed>("seeds");
+        if (!configuration || !record) {
+            G4cerr << "Error: " << path
+                   << " has no configuration or seed record" << G4endl;
+            return;
+        }
+        stored = configuration->GetTitle();
+        seeds = record->GetTitle();
+    }
+
+    G4long baseSeed = 0, previousEvents = 0;
+    G4int segment = -1;
+    std::istringstream lines(seeds);
+    G4String line;
+    while (std::getline(lines, line)) {
+        std::istringstream is(line);
+        G4String k1, k2, k3, k4;
+        G4int s = 0, run = 0;
+        G4long seed = 0, events = 0;
+        if (!(is >> k1 >> s >> k2 >> seed >> k3 >> run >> k4 >> events))
+            continue;
+        if (segment < 0)
+            baseSeed = seed;
+        segment = std::max(segment, s);
+        previousEvents += events;
+    }
+    if (segment < 0) {
+        G4cerr << "Error: empty seed record in " << path << G4endl;
+        return;
+    }
+
+    // Same configuration: replay it when the macro only asks for a top-up
+    G4String current = OpticalSimulationCache::Configuration();
+    if (Section(current, "commands").empty()) {
+        Replay(stored);
+        current = OpticalSimulationCache::Configuration();
+    }
+    if (current != stored) {
+        std::istringstream a(stored), b(current);
+        G4String la, lb;
+        while (std::getline(a, la) && std::getline(b, lb) && la == lb)
+            ;
+        G4cerr << "Error: the configuration differs from the one of " << path
+               << "\n  stored : " << la << "\n  current: " << lb << G4endl;
+        return;
+    }
+
+    G4long nEvents = fEvents > 0 ? fEvents : fDefaultEvents;
+    if (nEvents <= 0) {
+        G4cerr << "Error: no event requested for the top-up" << G4endl;
+        return;
+    }
+
+    G4cout << "\n### Top-up of " << path << ": " << nEvents
+           << " events added to " << previousEvents << " (seed " << baseSeed
+           << ", segment " << segment + 1 << ")" << G4endl;
+
+    G4UImanager *UI = G4UImanager::GetUIpointer();
+    G4String name = fName + "_topup";
+    UI->ApplyCommand("/OpticalSimulation/run/setSeed " +
+                     std::to_string(baseSeed));
+    UI->ApplyCommand("/OpticalSimulation/run/setSeedSegment " +
+                     std::to_string(segment + 1));
+    UI->ApplyCommand("/OpticalSimulation/qmc/setEventOffset " +
+                     std::to_string(previousEvents));
+    UI->ApplyCommand("/OpticalSimulation/run/setTopUpInput " + path);
+    UI->ApplyCommand("/OpticalSimulation/run/setOutputName " + name);
+
+    G4RunManager::GetRunManager()->BeamOn(nEvents);
+
+    if (flag_MT)
+        OpticalSimulationOutput::MergeThreadFiles(name, fNThreads);
+    if (OpticalSimulationOutput::Extend(path, name + ".root"))
+        G4cout << "Output " << path << " extended to "
+               << previousEvents + nEvents << " events" << G4endl;
+
+    // Chunked output: the new chunks join the original ones and manifest
+    if (std::ifstream(name + ".manifest")) {
+        std::ofstream manifest(fDirectory + "/" + input + ".manifest",
+                               std::ios::app);
+        for (const auto &entry :
+             OpticalSimulationOutput::ManifestEntries(name + ".manifest")) {
+            UI->ApplyCommand("/control/shell mv " +
+                             entry.substr(0, entry.find(' ')) + " " +
+                             fDirectory);
+            manifest << entry << "\n";
+        }
+        UI->ApplyCommand("/control/shell rm -f " + name + ".manifest");
+    }
+
+    UI->ApplyCommand("/OpticalSimulation/run/setTopUpInput none");
+    UI->ApplyCommand("/OpticalSimulation/run/setSeedSegment 0");
+    UI->ApplyCommand("/OpticalSimulation/qmc/setEventOffset 0");
+    UI->ApplyCommand("/OpticalSimulation/run/setOutputName " + fName);
+}
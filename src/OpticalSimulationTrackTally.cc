@@ -0,0 +1,157 @@
+/**
+ * @file OpticalSimulationTrackTally.cc
+ * @brief Implementation of the per-track charged-particle tally.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The table capacity is a power of two kept at least twice the number of
+ * open tracks, so that a probe sequence always ends on an empty slot.
+ * Removal shifts the following entries of the sequence back instead of
+ * leaving tombstones.
+ */
+
+#include "OpticalSimulationTrackTally.hh"
+#include "OpticalSimulationEventAction.hh"
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+//! Initial table capacity
+const size_t initialSlots = 64;
+
+//! Multiplicative hash of a track ID
+inline size_t HashTrack(G4int trackID) {
+    return size_t(uint32_t(trackID) * 2654435761u);
+}
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationTrackTally::Clear() {
+    if (fSize > 0)
+        std::fill(fSlots.begin(), fSlots.end(), -1);
+    fSize = 0;
+    fPool.clear();
+    fFree.clear();
+}
+
+size_t OpticalSimulationTrackTally::Find(G4int trackID) const {
+    size_t mask = fSlots.size() - 1;
+    size_t slot = HashTrack(trackID) & mask;
+    while (fSlots[slot] >= 0 && fPool[fSlots[slot]].trackID != trackID)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+void OpticalSimulationTrackTally::Grow() {
+    std::vector<G4int> slots(std::max(2 * fSlots.size(), initialSlots), -1);
+    std::swap(fSlots, slots);
+    for (G4int index : slots)
+        if (index >= 0)
+            fSlots[Find(fPool[index].trackID)] = index;
+}
+
+OpticalSimulationTrackTally::Entry &
+OpticalSimulationTrackTally::Acquire(G4int trackID) {
+    if (2 * (fSize + 1) > fSlots.size())
+        Grow();
+    size_t slot = Find(trackID);
+    if (fSlots[slot] >= 0)
+        return fPool[fSlots[slot]];
+
+    G4int index;
+    if (!fFree.empty()) {
+        index = fFree.back();
+        fFree.pop_back();
+        fPool[index] = Entry();
+    } else {
+        index = fPool.size();
+        fPool.emplace_back();
+    }
+    fPool[index].trackID = trackID;
+    fSlots[slot] = index;
+    ++fSize;
+    return fPool[index];
+}
+
+void OpticalSimulationTrackTally::Erase(size_t slot) {
+    size_t mask = fSlots.size() - 1;
+    fFree.push_back(fSlots[slot]);
+    size_t hole = slot;
+    for (size_t i = (hole + 1) & mask; fSlots[i] >= 0; i = (i + 1) & mask) {
+        // Move the entry into the hole unless its home lies in (hole, i]
+        size_t home = HashTrack(fPool[fSlots[i]].trackID) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            fSlots[hole] = fSlots[i];
+            hole = i;
+        }
+    }
+    fSlots[hole] = -1;
+    --fSize;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationTrackTally::Step(G4int trackID, Volume volume,
+                                       G4int subEvent, G4int parentID,
+                                       G4int particleID, G4float x, G4float y,
+                                       G4float z, G4float energy,
+                                       G4float deposit) {
+    Entry &entry = Acquire(trackID);
+    entry.subEvent = subEvent;
+    entry.parentID = parentID;
+    entry.particleID = particleID;
+    Crossing &crossing = entry.crossing[volume];
+    if (!crossing.active) {
+        crossing.active = true;
+        crossing.x = x;
+        crossing.y = y;
+        crossing.z = z;
+        crossing.energy = energy;
+    }
+    crossing.deposit += deposit;
+}
+
+void OpticalSimulationTrackTally::EndTrack(G4int trackID, RunTallySc &zns,
+                                           RunTallySc &scintillator) {
+    if (fSize == 0)
+        return;
+    size_t slot = Find(trackID);
+    if (fSlots[slot] < 0)
+        return;
+    Write(fPool[fSlots[slot]], zns, scintillator);
+    Erase(slot);
+}
+
+void OpticalSimulationTrackTally::Flush(G4int subEvent, RunTallySc &zns,
+                                        RunTallySc &scintillator) {
+    if (fSize == 0)
+        return;
+    // Track order, for reproducible entries
+    std::vector<G4int> open;
+    for (G4int index : fSlots)
+        if (index >= 0 && fPool[index].subEvent == subEvent)
+            open.push_back(index);
+    std::sort(open.begin(), open.end(), [this](G4int a, G4int b) {
+        return fPool[a].trackID < fPool[b].trackID;
+    });
+    for (G4int index : open)
+        Write(fPool[index], zns, scintillator);
+}
+
+void OpticalSimulationTrackTally::Write(const Entry &entry, RunTallySc &zns,
+                                        RunTallySc &scintillator) {
+    for (G4int v = 0; v < kNVolumes; ++v) {
+        const Crossing &crossing = entry.crossing[v];
+        if (!crossing.active)
+            continue;
+        RunTallySc &tally = v == kZnS ? zns : scintillator;
+        tally.AddXEntrance(crossing.x);
+        tally.AddYEntrance(crossing.y);
+        tally.AddZEntrance(crossing.z);
+        tally.AddParentID(entry.parentID);
+        tally.AddParticleID(entry.particleID);
+        tally.AddEnergy(crossing.energy);
+        tally.AddTotalDepositedEnergy(crossing.deposit);
+    }
+}
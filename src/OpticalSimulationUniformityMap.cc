@@ -0,0 +1,364 @@
+/**
+ * @file OpticalSimulationUniformityMap.cc
+ * @brief Implementation of the detection efficiency uniformity map.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The ZnS:Ag layer is centred on the origin with its entrance face at
+ * z = -thickness/2; the source plane is placed at z = -thickness/2 -
+ * stand-off. In stratified mode the cell of an event is eventID % nCells,
+ * so that every cell receives the same number of events whatever the
+ * number of threads.
+ *
+ * With a symmetry group the stratification runs over the representative
+ * cells only (the cells whose centre lies in the fundamental domain) and
+ * random positions are folded into the domain. The written maps are
+ * unfolded: each cell holds the counts summed over its orbit, so that cells
+ * of the same orbit share the same (correlated) estimate.
+ *
+ * Maps written by the master:
+ *  - uniformity_thrown/detected/alpha/beta : raw counts (hadd-mergeable)
+ *  - uniformity_efficiency, uniformity_alpha_fraction,
+ *    uniformity_beta_fraction : fractions with binomial errors
+ */
+
+#include "OpticalSimulationUniformityMap.hh"
+#include "G4Event.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4SystemOfUnits.hh"
+#include "OpticalSimulationClassifier.hh"
+#include "OpticalSimulationGeometryConstruction.hh"
+#include "OpticalSimulationQuasiRandom.hh"
+#include "OpticalSimulationSymmetry.hh"
+#include "Randomize.hh"
+#include "TFile.h"
+#include "TH2D.h"
+#include <algorithm>
+#include <cmath>
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationUniformityMap::Results::Reset(size_t nCells) {
+    for (G4int t = 0; t < kNTallies; ++t)
+        counts[t].assign(nCells, 0);
+}
+
+void OpticalSimulationUniformityMap::Results::Clear() {
+    for (auto &c : counts)
+        c.clear();
+}
+
+void OpticalSimulationUniformityMap::Results::Merge(const Results &other) {
+    if (!AddTallies(counts, other.counts))
+        G4cerr << "Error: uniformity maps with different binnings" << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Constructor.
+ *
+ * Declares the commands under /OpticalSimulation/uniformity/.
+ */
+OpticalSimulationUniformityMap::OpticalSimulationUniformityMap()
+    : fStandoff(1. * mm) {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/uniformity/",
+                                        "Efficiency map over the ZnS face");
+
+    fMessenger->DeclareProperty("setEnabled", fEnabled)
+        .SetGuidance("Sample the source position over the ZnS face.")
+        .SetParameterName("Enabled", false)
+        .SetDefaultValue("true");
+
+    fMessenger->DeclareProperty("setBinsX", fBinsX)
+        .SetGuidance("Number of cells along x (ZnS length).")
+        .SetParameterName("BinsX", false)
+        .SetDefaultValue("20");
+
+    fMessenger->DeclareProperty("setBinsY", fBinsY)
+        .SetGuidance("Number of cells along y (ZnS width).")
+        .SetParameterName("BinsY", false)
+        .SetDefaultValue("20");
+
+    fMessenger->DeclarePropertyWithUnit("setStandoff", "mm", fStandoff)
+        .SetGuidance("Distance between the source plane and the ZnS face.")
+        .SetParameterName("Standoff", false)
+        .SetDefaultValue("1.");
+
+    fMessenger->DeclareProperty("setSampling", fSampling)
+        .SetGuidance("Position sampling: stratified (one cell per event in "
+                     "turn), random or sobol (scrambled Sobol points, see "
+                     "/OpticalSimulation/qmc/).")
+        .SetParameterName("Sampling", false)
+        .SetCandidates("stratified random sobol")
+        .SetDefaultValue("stratified");
+}
+
+/**
+ * @brief Destructor.
+ */
+OpticalSimulationUniformityMap::~OpticalSimulationUniformityMap() {
+    delete fMessenger;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationUniformityMap::BeginOfRun() {
+    if (fGeometry) {
+        fHalfX = 0.5 * fGeometry->GetZnSLength() * mm;
+        fHalfY = 0.5 * fGeometry->GetZnSWidth() * mm;
+        fFaceZ = -0.5 * fGeometry->GetZnSThickness() * mm;
+    }
+    fLocal.Reset(size_t(fBinsX) * fBinsY);
+
+    if (fSymmetry) {
+        fSymmetry->Update();
+        fSymmetry->RestrictToGrid(fBinsX, fBinsY);
+    }
+
+    // Representative cells: their centre is left unchanged by the folding
+    fRepresentatives.clear();
+    for (G4int cell = 0; cell < fBinsX * fBinsY; ++cell) {
+        G4double x, y;
+        CellCentre(cell, x, y);
+        if (fSymmetry)
+            fSymmetry->Fold(x, y);
+        if (Cell(x, y) == cell)
+            fRepresentatives.push_back(cell);
+    }
+}
+
+void OpticalSimulationUniformityMap::CellCentre(G4int cell, G4double &x,
+                                                G4double &y) const {
+    x = ((cell % fBinsX + 0.5) / fBinsX * 2. - 1.) * fHalfX;
+    y = ((cell / fBinsX + 0.5) / fBinsY * 2. - 1.) * fHalfY;
+}
+
+std::vector<G4int> OpticalSimulationUniformityMap::Orbit(G4int cell) const {
+    std::vector<G4int> orbit = {cell};
+    if (!fSymmetry)
+        return orbit;
+
+    for (G4int k = 1; k < fSymmetry->Order(); ++k) {
+        G4double x, y;
+        CellCentre(cell, x, y);
+        fSymmetry->Apply(k, x, y);
+        G4int image = Cell(x, y);
+        if (image >= 0 &&
+            std::find(orbit.begin(), orbit.end(), image) == orbit.end())
+            orbit.push_back(image);
+    }
+    return orbit;
+}
+
+OpticalSimulationUniformityMap::Results
+OpticalSimulationUniformityMap::Unfold() const {
+    Results unfolded = GetRunTotals();
+    if (!fSymmetry || fSymmetry->Order() == 1)
+        return unfolded;
+
+    for (size_t cell = 0; cell < unfolded.counts[kThrown].size(); ++cell) {
+        for (G4int t = 0; t < kNTallies; ++t) {
+            G4long sum = 0;
+            for (G4int image : Orbit(cell))
+                sum += GetRunTotals().counts[t][image];
+            unfolded.counts[t][cell] = sum;
+        }
+    }
+    return unfolded;
+}
+
+G4int OpticalSimulationUniformityMap::Cell(G4double x, G4double y) const {
+    if (std::abs(x) >= fHalfX || std::abs(y) >= fHalfY)
+        return -1;
+    G4int ix = G4int((x + fHalfX) / (2. * fHalfX) * fBinsX);
+    G4int iy = G4int((y + fHalfY) / (2. * fHalfY) * fBinsY);
+    return std::min(iy, fBinsY - 1) * fBinsX + std::min(ix, fBinsX - 1);
+}
+
+/**
+ * @brief Move the primary vertex generated by GPS onto the source plane.
+ * @param event Event whose first primary vertex has been filled by GPS.
+ */
+void OpticalSimulationUniformityMap::SamplePosition(G4Event *event) const {
+    if (!fEnabled || !event->GetPrimaryVertex(0) || fHalfX <= 0.)
+        return;
+
+    G4double u = G4UniformRand();
+    G4double v = G4UniformRand();
+    if (fSampling == "sobol" && fQuasiRandom) {
+        u = fQuasiRandom->Sample(event->GetEventID(),
+                                 OpticalSimulationQuasiRandom::kPositionU);
+        v = fQuasiRandom->Sample(event->GetEventID(),
+                                 OpticalSimulationQuasiRandom::kPositionV);
+    } else if (fSampling == "stratified" && !fRepresentatives.empty()) {
+        G4int cell = fRepresentatives[event->GetEventID() %
+                                      fRepresentatives.size()];
+        u = (cell % fBinsX + u) / fBinsX;
+        v = (cell / fBinsX + v) / fBinsY;
+    }
+
+    G4double x = (2. * u - 1.) * fHalfX;
+    G4double y = (2. * v - 1.) * fHalfY;
+    if (fSymmetry && fSampling != "stratified")
+        fSymmetry->Fold(x, y);
+
+    event->GetPrimaryVertex(0)->SetPosition(x, y, fFaceZ - fStandoff);
+}
+
+/**
+ * @brief Accumulate one event in the cell of its source position.
+ * @param event Event summary already processed by the classifier.
+ */
+void OpticalSimulationUniformityMap::Fill(const RunTallyEvent &event) {
+    if (!fEnabled)
+        return;
+
+    G4int cell = Cell(event.x * mm, event.y * mm);
+    if (cell < 0)
+        return;
+
+    fLocal.counts[kThrown][cell]++;
+    if (event.eventClass != OpticalSimulationClassifier::kUndetected)
+        fLocal.counts[kDetected][cell]++;
+    if (event.eventClass == OpticalSimulationClassifier::kClassAlpha)
+        fLocal.counts[kAlpha][cell]++;
+    if (event.eventClass == OpticalSimulationClassifier::kClassBeta)
+        fLocal.counts[kBeta][cell]++;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationUniformityMap::MergeIntoRunTotals() const {
+    if (!fEnabled)
+        return;
+    RunTotals::Merge(fLocal);
+}
+
+void OpticalSimulationUniformityMap::ResetRunTotals() {
+    RunTotals::Clear();
+}
+
+/**
+ * @brief Add the count maps written by WriteRunTotals() in a previous
+ * output.
+ *
+ * The stored maps are unfolded: only the representative cells, where the
+ * events are sampled, are added back so that the next unfolding does not
+ * count them twice.
+ */
+void OpticalSimulationUniformityMap::LoadRunTotals(TFile *file) const {
+    if (!fEnabled || !file)
+        return;
+
+    static const char *names[kNTallies] = {"thrown", "detected", "alpha",
+                                           "beta"};
+    Results stored;
+    stored.Reset(size_t(fBinsX) * fBinsY);
+    for (G4int t = 0; t < kNTallies; ++t) {
+        auto *h = file->Get<TH2D>(
+            (G4String("uniformity_") + names[t]).c_str());
+        if (!h || h->GetNbinsX() != fBinsX || h->GetNbinsY() != fBinsY) {
+            G4cerr << "Warning: no matching uniformity map in "
+                   << file->GetName() << G4endl;
+            return;
+        }
+        for (G4int cell : fRepresentatives)
+            stored.counts[t][cell] = std::llround(
+                h->GetBinContent(cell % fBinsX + 1, cell / fBinsX + 1));
+    }
+
+    RunTotals::Merge(stored);
+}
+
+/**
+ * @brief Print the mean efficiency, its spread over the cells and extrema.
+ */
+void OpticalSimulationUniformityMap::PrintRunTotals() const {
+    if (!fEnabled || GetRunTotals().counts[kThrown].empty())
+        return;
+
+    Results totals = Unfold();
+    const auto &thrown = totals.counts[kThrown];
+
+    G4double sum = 0., sum2 = 0., min = 1., max = 0.;
+    G4int n = 0;
+    for (size_t i = 0; i < thrown.size(); ++i) {
+        if (thrown[i] == 0)
+            continue;
+        G4double eff = G4double(totals.counts[kDetected][i]) / thrown[i];
+        sum += eff;
+        sum2 += eff * eff;
+        min = std::min(min, eff);
+        max = std::max(max, eff);
+        n++;
+    }
+    if (n == 0)
+        return;
+
+    G4double mean = sum / n;
+    G4double rms = std::sqrt(std::max(0., sum2 / n - mean * mean));
+    G4cout << "\n---------------- Uniformity map (" << fBinsX << " x "
+           << fBinsY << " cells) ----------------" << G4endl;
+    if (fSymmetry && fSymmetry->Order() > 1)
+        G4cout << "     Symmetry             : "
+               << OpticalSimulationSymmetry::GroupName(fSymmetry->GetGroup())
+               << " (" << fRepresentatives.size() << " sampled cells)"
+               << G4endl;
+    G4cout << "     Mean cell efficiency : " << mean << G4endl;
+    G4cout << "     Non-uniformity (RMS) : "
+           << (mean > 0. ? rms / mean * 100. : 0.) << " %" << G4endl;
+    G4cout << "     Min / max            : " << min << " / " << max << G4endl;
+    G4cout << "------------------------------------------------------------"
+           << G4endl;
+}
+
+/**
+ * @brief Write the count maps and the efficiency maps with binomial errors.
+ */
+void OpticalSimulationUniformityMap::WriteRunTotals(TFile *file) const {
+    if (!fEnabled || !file || GetRunTotals().counts[kThrown].empty())
+        return;
+
+    Results totals = Unfold();
+    const auto &thrown = totals.counts[kThrown];
+
+    file->cd();
+    static const char *names[kNTallies] = {"thrown", "detected", "alpha",
+                                           "beta"};
+    auto makeMap = [this](const G4String &name, const G4String &title) {
+        return new TH2D(name.c_str(), (title + ";x [mm];y [mm]").c_str(),
+                        fBinsX, -fHalfX / mm, fHalfX / mm, fBinsY,
+                        -fHalfY / mm, fHalfY / mm);
+    };
+
+    for (G4int t = 0; t < kNTallies; ++t) {
+        TH2D *h = makeMap(G4String("uniformity_") + names[t],
+                          G4String("Events ") + names[t]);
+        for (size_t i = 0; i < thrown.size(); ++i)
+            h->SetBinContent(i % fBinsX + 1, i / fBinsX + 1,
+                             totals.counts[t][i]);
+        h->Write();
+        delete h;
+    }
+
+    // Fractions of the thrown events with binomial errors
+    const G4int fractions[3] = {kDetected, kAlpha, kBeta};
+    const char *fractionNames[3] = {"uniformity_efficiency",
+                                    "uniformity_alpha_fraction",
+                                    "uniformity_beta_fraction"};
+    for (G4int k = 0; k < 3; ++k) {
+        TH2D *h = makeMap(fractionNames[k], fractionNames[k]);
+        for (size_t i = 0; i < thrown.size(); ++i) {
+            if (thrown[i] == 0)
+                continue;
+            G4double p =
+                G4double(totals.counts[fractions[k]][i]) / thrown[i];
+            h->SetBinContent(i % fBinsX + 1, i / fBinsX + 1, p);
+            h->SetBinError(i % fBinsX + 1, i / fBinsX + 1,
+                           std::sqrt(p * (1. - p) / thrown[i]));
+        }
+        h->Write();
+        delete h;
+    }
+}
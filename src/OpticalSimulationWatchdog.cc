@@ -0,0 +1,232 @@
+/**
+ * @file OpticalSimulationWatchdog.cc
+ * @brief Implementation of the per-event watchdog.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The wall clock is only read every 1024 steps, so the time budget costs
+ * nothing on ordinary events and is checked within a few milliseconds.
+ */
+
+#include "OpticalSimulationWatchdog.hh"
+#include "G4AutoLock.hh"
+#include "G4Event.hh"
+#include "G4OpticalPhoton.hh"
+#include "G4Run.hh"
+#include "G4RunManager.hh"
+#include "G4Threading.hh"
+#include "G4Track.hh"
+#include "Randomize.hh"
+#include "TTree.h"
+#include <fstream>
+
+std::map<G4int, G4long> OpticalSimulationWatchdog::fRunAborted;
+
+namespace {
+//! Steps between two reads of the wall clock
+const G4long clockPeriod = 1024;
+
+//! Mutex protecting the run totals during the end-of-run merge
+G4Mutex watchdogMutex = G4MUTEX_INITIALIZER;
+} // namespace
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+OpticalSimulationWatchdog::OpticalSimulationWatchdog() {
+    fMessenger = new G4GenericMessenger(this, "/OpticalSimulation/watchdog/",
+                                        "Per-event budgets");
+
+    fMessenger->DeclareProperty("setMaxSteps", fMaxSteps)
+        .SetGuidance("Steps per event, all particles (0: no limit).")
+        .SetParameterName("MaxSteps", false)
+        .SetRange("MaxSteps>=0")
+        .SetDefaultValue("0");
+
+    fMessenger->DeclareProperty("setMaxPhotons", fMaxPhotons)
+        .SetGuidance("Optical photons tracked per event (0: no limit).")
+        .SetParameterName("MaxPhotons", false)
+        .SetRange("MaxPhotons>=0")
+        .SetDefaultValue("0");
+
+    fMessenger->DeclareProperty("setMaxTime", fMaxTime)
+        .SetGuidance("Wall time per event in seconds (0: no limit).")
+        .SetParameterName("MaxTime", false)
+        .SetRange("MaxTime>=0")
+        .SetDefaultValue("0");
+
+    fMessenger->DeclareProperty("setAction", fAction)
+        .SetGuidance("downgrade (kill the remaining optical photons, abort at "
+                     "twice the budget) or abort the event.")
+        .SetParameterName("Action", false)
+        .SetCandidates("downgrade abort")
+        .SetDefaultValue("downgrade");
+
+    fMessenger->DeclareProperty("setReplay", fReplay)
+        .SetGuidance("Random status (.rndm) restored before the first event "
+                     "of the next run (empty: none).")
+        .SetParameterName("Replay", true)
+        .SetDefaultValue("");
+}
+
+OpticalSimulationWatchdog::~OpticalSimulationWatchdog() { delete fMessenger; }
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+/**
+ * @brief Keep the random status of every event (taken before its
+ * primaries) so that an outlier can be replayed.
+ */
+void OpticalSimulationWatchdog::BeginOfRun() {
+    fReplayed = false;
+    if (!IsEnabled())
+        return;
+    G4RunManager *runManager = G4RunManager::GetRunManager();
+    G4int flag = runManager->GetFlagRandomNumberStatusToG4Event();
+    if (flag != 1 && flag != 3)
+        runManager->StoreRandomNumberStatusToG4Event(flag + 1);
+}
+
+TTree *OpticalSimulationWatchdog::CreateTree() {
+    auto *tree = new TTree("Outliers", "Events exceeding a watchdog budget");
+    tree->Branch("exceeded", &fExceeded, "exceeded/I");
+    tree->Branch("aborted", &fAborted, "aborted/I");
+    tree->Branch("steps", &fSteps, "steps/L");
+    tree->Branch("photons", &fPhotons, "photons/L");
+    tree->Branch("killed", &fKilled, "killed/L");
+    tree->Branch("wall_time", &fWallTime, "wall_time/F");
+    tree->Branch("status_file", &fStatusFile);
+    return tree;
+}
+
+void OpticalSimulationWatchdog::BeginOfEvent() {
+    fStart = Clock::now();
+    fSteps = 0;
+    fPhotons = 0;
+    fKilled = 0;
+    fExceeded = 0;
+    fAborted = 0;
+}
+
+/**
+ * @brief Count a step and act once a budget is exceeded.
+ * @param track Track of the current step
+ */
+void OpticalSimulationWatchdog::Step(const G4Track *track) {
+    ++fSteps;
+    if (track->GetCurrentStepNumber() == 1 &&
+        track->GetDefinition() == G4OpticalPhoton::Definition())
+        ++fPhotons;
+
+    G4int exceeded = 0;
+    G4bool hard = false;
+    if (fMaxSteps > 0 && fSteps > fMaxSteps) {
+        exceeded |= kSteps;
+        hard = fSteps > 2 * fMaxSteps;
+    }
+    if (fMaxPhotons > 0 && fPhotons > fMaxPhotons)
+        exceeded |= kPhotons;
+    if (fMaxTime > 0. && fSteps % clockPeriod == 0) {
+        std::chrono::duration<double> elapsed = Clock::now() - fStart;
+        if (elapsed.count() > fMaxTime) {
+            exceeded |= kTime;
+            hard = hard || elapsed.count() > 2. * fMaxTime;
+        }
+    }
+    if (!exceeded)
+        return;
+    fExceeded |= exceeded;
+
+    if (!fAborted && (fAction == "abort" || hard)) {
+        fAborted = 1;
+        G4RunManager::GetRunManager()->AbortEvent();
+    }
+}
+
+/**
+ * @brief Log an outlier and save the random status of its event.
+ * @param event Finished event
+ * @param outputName Base name of the ROOT output
+ */
+void OpticalSimulationWatchdog::EndOfEvent(const G4Event *event,
+                                           const G4String &outputName) {
+    if (!fExceeded)
+        return;
+    std::chrono::duration<double> elapsed = Clock::now() - fStart;
+    fWallTime = elapsed.count();
+    G4int run = G4RunManager::GetRunManager()->GetCurrentRun()->GetRunID();
+
+    fStatusFile.clear();
+    if (!event->GetRandomNumberStatus().empty()) {
+        fStatusFile = outputName + "_run" + std::to_string(run) + "_evt" +
+                      std::to_string(event->GetEventID()) + ".rndm";
+        std::ofstream status(fStatusFile);
+        status << event->GetRandomNumberStatus();
+    }
+
+    G4cerr << "Watchdog: event " << event->GetEventID() << " (run " << run
+           << ", thread " << G4Threading::G4GetThreadId() << ") exceeded"
+           << (fExceeded & kSteps ? " steps" : "")
+           << (fExceeded & kPhotons ? " photons" : "")
+           << (fExceeded & kTime ? " time" : "") << ": " << fSteps
+           << " steps, " << fPhotons << " photons, " << fWallTime << " s, "
+           << (fAborted ? "aborted" : "downgraded") << " (" << fKilled
+           << " photons killed)";
+    if (!fStatusFile.empty())
+        G4cerr << ", replay with " << fStatusFile;
+    G4cerr << G4endl;
+}
+
+/**
+ * @brief Restore the saved status before the first event of the run, so
+ * that the primaries and the tracking of the outlier are reproduced.
+ */
+void OpticalSimulationWatchdog::RestoreReplayStatus() {
+    if (fReplay.empty() || fReplayed)
+        return;
+    fReplayed = true;
+    std::ifstream status(fReplay);
+    if (!status) {
+        G4cerr << "Error: cannot read the random status " << fReplay
+               << G4endl;
+        return;
+    }
+    G4Random::restoreFullState(status);
+    G4cout << "Random status restored from " << fReplay << G4endl;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void OpticalSimulationWatchdog::MergeIntoRunTotals() {
+    G4AutoLock lock(&watchdogMutex);
+    for (const auto &entry : fLocalAborted)
+        fRunAborted[entry.first] += entry.second;
+    fLocalAborted.clear();
+}
+
+void OpticalSimulationWatchdog::ResetRunTotals() {
+    G4AutoLock lock(&watchdogMutex);
+    fRunAborted.clear();
+}
+
+G4long OpticalSimulationWatchdog::GetRunAborted() {
+    G4AutoLock lock(&watchdogMutex);
+    G4long aborted = 0;
+    for (const auto &entry : fRunAborted)
+        aborted += entry.second;
+    return aborted;
+}
+
+/**
+ * @brief Aborted events are missing from every efficiency and classifier
+ * total: their number is always reported.
+ */
+void OpticalSimulationWatchdog::PrintRunTotals() {
+    G4AutoLock lock(&watchdogMutex);
+    if (fRunAborted.empty())
+        return;
+    G4cout << "Watchdog: aborted events excluded from the run results "
+              "(source PDG: events)";
+    for (const auto &entry : fRunAborted)
+        G4cout << " " << entry.first << ": " << entry.second;
+    G4cout << G4endl;
+}
@@ -0,0 +1,44 @@
+#ifndef OpticalSimulationTest_h
+#define OpticalSimulationTest_h 1
+
+/**
+ * @file OpticalSimulationTest.hh
+ * @brief Minimal checks shared by the unit tests (ctest, BUILD_TESTS).
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Every test executable runs its checks, prints the failed ones and
+ * returns the number of failures (0: test passed).
+ */
+
+#include "G4String.hh"
+#include "G4Types.hh"
+#include "G4ios.hh"
+#include <cmath>
+#include <string>
+
+namespace OpticalSimulationTest {
+/// Number of failed checks of the executable
+inline G4int &Failures() {
+    static G4int failures = 0;
+    return failures;
+}
+
+/// Count and print a failed check
+inline void Check(G4bool condition, const G4String &what) {
+    if (condition)
+        return;
+    ++Failures();
+    G4cerr << "FAILED: " << what << G4endl;
+}
+
+/// Check that @p value is within @p tolerance of @p expected
+inline void CheckClose(G4double value, G4double expected, G4double tolerance,
+                       const G4String &what) {
+    Check(std::abs(value - expected) <= tolerance,
+          what + ": " + std::to_string(value) + " instead of " +
+              std::to_string(expected));
+}
+} // namespace OpticalSimulationTest
+
+#endif
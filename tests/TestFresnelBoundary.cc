@@ -0,0 +1,132 @@
+/**
+ * @file TestFresnelBoundary.cc
+ * @brief Unit test of the Fresnel amplitudes and of their tables.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * Fresnel() is compared with the amplitudes written from the angles of
+ * incidence and refraction (Snell), at normal incidence, at the Brewster
+ * angle and beyond the critical angle (total internal reflection). The
+ * tables of a dispersive interface are compared with Fresnel() at points
+ * between the grid nodes, in both directions of the interface.
+ */
+
+#include "G4SystemOfUnits.hh"
+#include "OpticalSimulationFresnelBoundary.hh"
+#include "OpticalSimulationTest.hh"
+#include <algorithm>
+#include <cmath>
+
+using OpticalSimulationTest::Check;
+using OpticalSimulationTest::CheckClose;
+
+/// Reaches the private amplitudes and tables of the process (friend)
+class OpticalSimulationFresnelBoundaryTest {
+  public:
+    static void TestClosedForm();
+    static void TestTables();
+
+  private:
+    using Table = OpticalSimulationFresnelBoundary::Table;
+
+    /// Check the table against Fresnel() over a range of cosines
+    static void CheckTable(const Table &table,
+                           const G4MaterialPropertyVector &rindex1,
+                           const G4MaterialPropertyVector &rindex2,
+                           G4double cosMin, G4double cosMax,
+                           const G4String &what);
+};
+
+void OpticalSimulationFresnelBoundaryTest::TestClosedForm() {
+    const G4double n1 = 1.58, n2 = 1.;
+    G4double s, p;
+
+    // Normal incidence: (n1 - n2) / (n1 + n2), opposite signs for s and p
+    OpticalSimulationFresnelBoundary::Fresnel(n1 / n2, 1., s, p);
+    CheckClose(s, (n1 - n2) / (n1 + n2), 1e-12, "normal incidence, s");
+    CheckClose(p, -(n1 - n2) / (n1 + n2), 1e-12, "normal incidence, p");
+
+    // Oblique incidence below the critical angle, both directions
+    for (G4double ratio : {n1 / n2, n2 / n1}) {
+        for (G4double angle = 0.; angle < 90. * deg; angle += 1. * deg) {
+            G4double sinT = ratio * std::sin(angle);
+            if (sinT >= 1.)
+                break;
+            G4double cosI = std::cos(angle);
+            G4double cosT = std::sqrt(1. - sinT * sinT);
+            OpticalSimulationFresnelBoundary::Fresnel(ratio, cosI, s, p);
+            G4String what = "n1/n2 " + std::to_string(ratio) + ", angle " +
+                            std::to_string(angle / deg);
+            CheckClose(s, (ratio * cosI - cosT) / (ratio * cosI + cosT),
+                       1e-12, what + ", s");
+            CheckClose(p, (cosI - ratio * cosT) / (cosI + ratio * cosT),
+                       1e-12, what + ", p");
+        }
+    }
+
+    // No p reflection at the Brewster angle, tan = n2 / n1
+    OpticalSimulationFresnelBoundary::Fresnel(
+        n1 / n2, std::cos(std::atan(n2 / n1)), s, p);
+    CheckClose(p, 0., 1e-12, "Brewster angle, p");
+
+    // Total internal reflection beyond the critical angle, sin = n2 / n1
+    G4double critical = std::asin(n2 / n1);
+    for (G4double angle : {critical + 1e-6, critical + 10. * deg, 89. * deg}) {
+        G4double cosine = std::cos(angle);
+        OpticalSimulationFresnelBoundary::Fresnel(n1 / n2, cosine, s, p);
+        Check(s == 1. && p == 1., "total internal reflection at " +
+                                      std::to_string(angle / deg) + " deg");
+    }
+}
+
+void OpticalSimulationFresnelBoundaryTest::CheckTable(
+    const Table &table, const G4MaterialPropertyVector &rindex1,
+    const G4MaterialPropertyVector &rindex2, G4double cosMin,
+    G4double cosMax, const G4String &what) {
+    G4double worst = 0.;
+    G4bool ratios = true;
+    for (G4double energy = 2.013 * eV; energy < 4. * eV; energy += 0.071 * eV)
+        for (G4double cosine = cosMin; cosine <= cosMax; cosine += 0.00137) {
+            G4double n12 = rindex1.Value(energy) / rindex2.Value(energy);
+            G4double n, s, p, s0, p0;
+            table.Lookup(energy, cosine, n, s, p);
+            OpticalSimulationFresnelBoundary::Fresnel(n12, cosine, s0, p0);
+            ratios &= std::abs(n - n12) < 1e-6;
+            worst = std::max({worst, std::abs(s - s0), std::abs(p - p0)});
+        }
+    Check(ratios, what + ": n1/n2 of the table");
+    CheckClose(worst, 0., 1e-3, what + ": largest amplitude error");
+}
+
+void OpticalSimulationFresnelBoundaryTest::TestTables() {
+    G4MaterialPropertyVector scintillator({2. * eV, 4. * eV}, {1.58, 1.62});
+    G4MaterialPropertyVector air({2. * eV, 4. * eV}, {1., 1.});
+
+    // Critical cosine between 0.774 (2 eV) and 0.790 (4 eV)
+    Table out;
+    out.rindex1 = &scintillator;
+    out.rindex2 = &air;
+    out.Fill();
+    CheckTable(out, scintillator, air, 0.80, 1., "scintillator -> air");
+
+    G4bool reflected = true;
+    for (G4double energy = 2. * eV; energy <= 4. * eV; energy += 0.1 * eV)
+        for (G4double cosine = 0.; cosine < 0.77; cosine += 0.01) {
+            G4double n, s, p;
+            out.Lookup(energy, cosine, n, s, p);
+            reflected &= std::abs(s - 1.) < 1e-6 && std::abs(p - 1.) < 1e-6;
+        }
+    Check(reflected, "scintillator -> air: total internal reflection");
+
+    Table in;
+    in.rindex1 = &air;
+    in.rindex2 = &scintillator;
+    in.Fill();
+    CheckTable(in, air, scintillator, 0.01, 1., "air -> scintillator");
+}
+
+int main() {
+    OpticalSimulationFresnelBoundaryTest::TestClosedForm();
+    OpticalSimulationFresnelBoundaryTest::TestTables();
+    return OpticalSimulationTest::Failures();
+}
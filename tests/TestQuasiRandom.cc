@@ -0,0 +1,92 @@
+/**
+ * @file TestQuasiRandom.cc
+ * @brief Unit test of the Sobol sequence and of its scrambling.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The reference points were generated with the Joe-Kuo reference program
+ * (new-joe-kuo-6.21201, Gray-code order) and put back in index order: the
+ * sampler uses the point of index i, the Gray-code program gives the point
+ * of index i ^ (i >> 1) at step i.
+ */
+
+#include "OpticalSimulationQuasiRandom.hh"
+#include "OpticalSimulationTest.hh"
+#include <vector>
+
+using OpticalSimulationTest::Check;
+
+namespace {
+//! Dimensions of the sequence
+const G4int nDimensions = OpticalSimulationQuasiRandom::kNDimensions;
+} // namespace
+
+/// Reaches the private sequence of the sampler (friend)
+class OpticalSimulationQuasiRandomTest {
+  public:
+    static void TestReferencePoints();
+    static void TestStratification();
+};
+
+/// First 16 points in sixteenths, then a point of high index
+void OpticalSimulationQuasiRandomTest::TestReferencePoints() {
+    const G4int sixteenths[16][nDimensions] = {
+        {0, 0, 0, 0, 0, 0, 0},       {8, 8, 8, 8, 8, 8, 8},
+        {4, 12, 12, 12, 4, 4, 12},   {12, 4, 4, 4, 12, 12, 4},
+        {2, 10, 6, 2, 2, 6, 10},     {10, 2, 14, 10, 10, 14, 2},
+        {6, 6, 10, 14, 6, 2, 6},     {14, 14, 2, 6, 14, 10, 14},
+        {1, 15, 9, 5, 11, 3, 13},    {9, 7, 1, 13, 3, 11, 5},
+        {5, 3, 5, 9, 15, 7, 1},      {13, 11, 13, 1, 7, 15, 9},
+        {3, 5, 15, 7, 9, 5, 7},      {11, 13, 7, 15, 1, 13, 15},
+        {7, 9, 3, 11, 13, 1, 11},    {15, 1, 11, 3, 5, 9, 3}};
+    for (std::uint32_t i = 0; i < 16; ++i)
+        for (G4int d = 0; d < nDimensions; ++d)
+            Check(OpticalSimulationQuasiRandom::Sobol(i, d) ==
+                      std::uint32_t(sixteenths[i][d]) << 28,
+                  "point " + std::to_string(i) + ", dimension " +
+                      std::to_string(d));
+
+    const std::uint32_t deep[nDimensions] = {
+        0xa8b3dae0u, 0x5f6572e0u, 0xfc9d8c20u, 0xc5e4e660u,
+        0x7653eee0u, 0xb7c756a0u, 0x52ee4760u};
+    for (G4int d = 0; d < nDimensions; ++d)
+        Check(OpticalSimulationQuasiRandom::Sobol(123456789u, d) == deep[d],
+              "point 123456789, dimension " + std::to_string(d));
+}
+
+/**
+ * The first 2^m points of a dimension fall one per interval of width 2^-m,
+ * with and without scrambling (the nested scrambling permutes the
+ * intervals of every level).
+ */
+void OpticalSimulationQuasiRandomTest::TestStratification() {
+    const G4int m = 10;
+    const std::uint32_t n = 1u << m;
+    for (std::uint32_t seed : {0u, 1u, 12345u, 0xdeadbeefu}) {
+        for (G4int d = 0; d < nDimensions; ++d) {
+            std::vector<G4int> hits(n, 0);
+            G4bool scrambled = false;
+            for (std::uint32_t i = 0; i < n; ++i) {
+                std::uint32_t x = OpticalSimulationQuasiRandom::Sobol(i, d);
+                std::uint32_t y =
+                    OpticalSimulationQuasiRandom::Scramble(x, seed);
+                ++hits[y >> (32 - m)];
+                scrambled |= y != x;
+            }
+            G4bool stratified = true;
+            for (G4int h : hits)
+                stratified &= h == 1;
+            Check(stratified, "stratification, seed " +
+                                  std::to_string(seed) + ", dimension " +
+                                  std::to_string(d));
+            Check(scrambled, "scrambling changes the points, seed " +
+                                 std::to_string(seed));
+        }
+    }
+}
+
+int main() {
+    OpticalSimulationQuasiRandomTest::TestReferencePoints();
+    OpticalSimulationQuasiRandomTest::TestStratification();
+    return OpticalSimulationTest::Failures();
+}
@@ -0,0 +1,144 @@
+/**
+ * @file TestTrackTally.cc
+ * @brief Unit test of the open-addressing table of the per-track tally.
+ * @author Arnaud HUBER <huber@lp2ib.in2p3.fr>
+ * @date 2026
+ *
+ * The track IDs are chosen to collide: IDs equal modulo the table capacity
+ * share the same home slot, so that insertion walks long probe sequences
+ * and removal has to shift entries back over other home slots. Every step
+ * deposits the track ID, the parent ID is the track ID: a track found
+ * twice, lost or merged with another one shows in the written deposits.
+ */
+
+#include "OpticalSimulationEventAction.hh"
+#include "OpticalSimulationTest.hh"
+#include "OpticalSimulationTrackTally.hh"
+#include <map>
+#include <set>
+#include <vector>
+
+using OpticalSimulationTest::Check;
+
+namespace {
+//! Capacity of a new table (OpticalSimulationTrackTally.cc)
+const G4int initialSlots = 64;
+
+//! Step of a track in ZnS depositing its ID
+void StepTrack(OpticalSimulationTrackTally &tally, G4int trackID,
+               G4int subEvent = 0) {
+    tally.Step(trackID, OpticalSimulationTrackTally::kZnS, subEvent, trackID,
+               11, G4float(trackID), 0.f, 0.f, 1.f, G4float(trackID));
+}
+
+//! Deposit written per track (parent ID), each track written at most once
+std::map<G4int, G4float> Written(const RunTallySc &zns) {
+    std::map<G4int, G4float> written;
+    for (size_t i = 0; i < zns.ParentIDSize(); ++i) {
+        G4int track = zns.GetParentID(i);
+        Check(written.count(track) == 0,
+              "track " + std::to_string(track) + " written twice");
+        written[track] = zns.total_deposited_energy[i];
+    }
+    return written;
+}
+
+//! Tracks sharing one home slot, with other tracks homed inside the chain
+void TestCollisions() {
+    OpticalSimulationTrackTally tally;
+    RunTallySc zns, scintillator;
+    tally.Clear();
+
+    std::vector<G4int> tracks;
+    for (G4int k = 0; k < 12; ++k)
+        tracks.push_back(1 + k * initialSlots);
+    for (G4int id = 2; id < 14; ++id)
+        tracks.push_back(id);
+    for (G4int track : tracks)
+        StepTrack(tally, track);
+
+    // Remove tracks in the middle and at the head of the chain
+    const std::set<G4int> ended = {1 + 5 * initialSlots, 1, 7};
+    for (G4int track : ended)
+        tally.EndTrack(track, zns, scintillator);
+
+    // The other tracks are still found: a second deposit, no new entry
+    for (G4int track : tracks)
+        if (!ended.count(track))
+            StepTrack(tally, track);
+    for (G4int track : tracks)
+        tally.EndTrack(track, zns, scintillator);
+
+    std::map<G4int, G4float> written = Written(zns);
+    Check(written.size() == tracks.size(), "collisions: tracks written");
+    for (G4int track : tracks) {
+        G4int steps = ended.count(track) ? 1 : 2;
+        Check(written[track] == G4float(steps * track),
+              "collisions: deposit of track " + std::to_string(track));
+    }
+
+    // Nothing left open, an absent track is ignored
+    RunTallySc left, leftScintillator;
+    tally.EndTrack(1, left, leftScintillator);
+    tally.Flush(0, left, leftScintillator);
+    Check(left.ParentIDSize() == 0, "collisions: no track left open");
+}
+
+//! Growth of the table while colliding tracks are open
+void TestGrowth() {
+    OpticalSimulationTrackTally tally;
+    RunTallySc zns, scintillator;
+    tally.Clear();
+
+    const G4int nTracks = 1000;
+    std::vector<G4int> tracks;
+    for (G4int i = 0; i < nTracks; ++i)
+        tracks.push_back(i % 2 ? 1 + (i / 2) * initialSlots : 2 + i);
+    for (G4int track : tracks)
+        StepTrack(tally, track);
+    for (G4int track : tracks)
+        StepTrack(tally, track);
+
+    // End the tracks in a scattered order
+    for (G4int i = 0; i < nTracks; ++i)
+        tally.EndTrack(tracks[(i * 7919) % nTracks], zns, scintillator);
+
+    std::map<G4int, G4float> written = Written(zns);
+    Check(G4int(written.size()) == nTracks, "growth: tracks written");
+    for (G4int track : tracks)
+        Check(written[track] == G4float(2 * track),
+              "growth: deposit of track " + std::to_string(track));
+    Check(scintillator.ParentIDSize() == 0, "growth: scintillator empty");
+}
+
+//! Reuse of the table over events, flush of the open tracks
+void TestClearAndFlush() {
+    OpticalSimulationTrackTally tally;
+    RunTallySc zns, scintillator;
+    tally.Clear();
+
+    for (G4int track = 1; track <= 200; ++track)
+        StepTrack(tally, track);
+    tally.Clear();
+
+    // Open tracks of two sub-events, written in track order by Flush
+    for (G4int track : {3 * initialSlots + 5, 5, 2 * initialSlots + 5})
+        StepTrack(tally, track, 1);
+    StepTrack(tally, 9, 2);
+    tally.Flush(1, zns, scintillator);
+
+    std::vector<G4int> expected = {5, 2 * initialSlots + 5,
+                                   3 * initialSlots + 5};
+    Check(zns.parentID == expected, "flush: tracks of the sub-event in order");
+    for (size_t i = 0; i < zns.TotalDepositedEnergySize(); ++i)
+        Check(zns.total_deposited_energy[i] == G4float(expected[i]),
+              "flush: deposit not carried over the cleared event");
+}
+} // namespace
+
+int main() {
+    TestCollisions();
+    TestGrowth();
+    TestClearAndFlush();
+    return OpticalSimulationTest::Failures();
+}